@@ -0,0 +1,323 @@
+/*
+ * DNS resolver cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <sys/types.h>
+
+#ifdef HAVE_NETINET_IN_H
+# include <netinet/in.h>
+#endif
+#ifdef HAVE_ARPA_NAMESER_H
+# include <arpa/nameser.h>
+# undef NOERROR
+#endif
+#ifdef HAVE_RESOLV_H
+# include <resolv.h>
+#endif
+
+#include "windef.h"
+#include "winbase.h"
+#include "winerror.h"
+#include "winnls.h"
+#include "windns.h"
+
+#include "wine/debug.h"
+#include "wine/list.h"
+
+#include "dnsapi.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dnsapi);
+
+/* same limits as the defaults of the Windows DNS client service */
+#define MAX_CACHE_TTL           86400
+#define NEGATIVE_CACHE_TTL      300
+#define MAX_CACHE_ENTRIES       1024
+#define CACHE_HASH_SIZE         64
+
+struct cache_entry
+{
+    struct list entry;      /* entry in hash bucket */
+    struct list lru_entry;  /* entry in lru list, most recently used first */
+    char *name;
+    WORD type;
+    DNS_STATUS status;      /* ERROR_SUCCESS or a cached name error */
+    DNS_RECORDA *records;   /* utf8 records for a positive entry */
+    ULONGLONG expires;
+};
+
+static struct list cache_hash[CACHE_HASH_SIZE];
+static struct list cache_lru = LIST_INIT( cache_lru );
+static unsigned int cache_count;
+static unsigned int cache_hits;
+static unsigned int cache_misses;
+static BOOL cache_initialized;
+
+static CRITICAL_SECTION cache_cs;
+static CRITICAL_SECTION_DEBUG cache_cs_debug =
+{
+    0, 0, &cache_cs,
+    { &cache_cs_debug.ProcessLocksList, &cache_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": cache_cs") }
+};
+static CRITICAL_SECTION cache_cs = { &cache_cs_debug, -1, 0, 0, 0, 0 };
+
+static inline char ascii_tolower( char c )
+{
+    return (c >= 'A' && c <= 'Z') ? c + 'a' - 'A' : c;
+}
+
+/* compare names ignoring ascii case and a trailing dot */
+static BOOL cache_name_equal( const char *name1, const char *name2 )
+{
+    while (*name1 && ascii_tolower( *name1 ) == ascii_tolower( *name2 )) { name1++; name2++; }
+    if (*name1 == '.' && !name1[1]) name1++;
+    if (*name2 == '.' && !name2[1]) name2++;
+    return !*name1 && !*name2;
+}
+
+static unsigned int cache_hash_name( const char *name, WORD type )
+{
+    unsigned int hash = type;
+
+    for (; *name; name++)
+    {
+        if (*name == '.' && !name[1]) break;
+        hash = hash * 31 + (unsigned char)ascii_tolower( *name );
+    }
+    return hash % CACHE_HASH_SIZE;
+}
+
+static void init_cache( void )
+{
+    unsigned int i;
+
+    if (cache_initialized) return;
+    for (i = 0; i < CACHE_HASH_SIZE; i++) list_init( &cache_hash[i] );
+    cache_initialized = TRUE;
+}
+
+static void free_cache_entry( struct cache_entry *entry )
+{
+    list_remove( &entry->entry );
+    list_remove( &entry->lru_entry );
+    DnsRecordListFree( (DNS_RECORD *)entry->records, DnsFreeRecordList );
+    heap_free( entry->name );
+    heap_free( entry );
+    cache_count--;
+}
+
+static struct cache_entry *find_cache_entry( const char *name, WORD type )
+{
+    struct cache_entry *entry;
+
+    LIST_FOR_EACH_ENTRY( entry, &cache_hash[cache_hash_name( name, type )], struct cache_entry, entry )
+    {
+        if (entry->type == type && cache_name_equal( entry->name, name )) return entry;
+    }
+    return NULL;
+}
+
+static BOOL cache_allowed( DWORD options, const void *servers )
+{
+    /* answers from explicitly given servers may differ from the system ones */
+    return !servers && !(options & (DNS_QUERY_BYPASS_CACHE | DNS_QUERY_WIRE_ONLY));
+}
+
+/* returns TRUE and the cached status (and records) if the query can be answered from the cache */
+BOOL dns_cache_lookup( const char *name, WORD type, DWORD options, const void *servers,
+                       DNS_RECORDA **result, DNS_STATUS *status )
+{
+    struct cache_entry *entry;
+    DNS_RECORDA *record;
+    ULONGLONG now;
+    DWORD ttl;
+    BOOL ret = FALSE;
+
+    if (!cache_allowed( options, servers )) return FALSE;
+
+    EnterCriticalSection( &cache_cs );
+    init_cache();
+
+    now = GetTickCount64();
+    if ((entry = find_cache_entry( name, type )) && entry->expires <= now)
+    {
+        free_cache_entry( entry );
+        entry = NULL;
+    }
+    if (!entry)
+    {
+        cache_misses++;
+        TRACE( "%s %s: miss (%u hits, %u misses)\n", debugstr_a(name), dns_type_to_str( type ),
+               cache_hits, cache_misses );
+        goto done;
+    }
+
+    if ((*status = entry->status) == ERROR_SUCCESS)
+    {
+        if (!(*result = (DNS_RECORDA *)DnsRecordSetCopyEx( (DNS_RECORD *)entry->records,
+                                                           DnsCharSetUtf8, DnsCharSetUtf8 )))
+            goto done;
+
+        /* report the time left to live like the Windows cache does */
+        ttl = (entry->expires - now + 999) / 1000;
+        for (record = *result; record; record = record->pNext)
+            record->dwTtl = min( record->dwTtl, ttl );
+    }
+
+    list_remove( &entry->lru_entry );
+    list_add_head( &cache_lru, &entry->lru_entry );
+    cache_hits++;
+    TRACE( "%s %s: hit, status %d (%u hits, %u misses)\n", debugstr_a(name), dns_type_to_str( type ),
+           *status, cache_hits, cache_misses );
+    ret = TRUE;
+
+done:
+    LeaveCriticalSection( &cache_cs );
+    return ret;
+}
+
+/* positive answers are kept for the smallest TTL in the answer section, name errors for a fixed time */
+void dns_cache_add( const char *name, WORD type, DWORD options, const void *servers,
+                    DNS_STATUS status, DNS_RECORDA *records )
+{
+    struct cache_entry *entry, *old;
+    DNS_RECORDA *record;
+    DWORD ttl = MAX_CACHE_TTL;
+
+    if (!cache_allowed( options, servers )) return;
+
+    if (status == ERROR_SUCCESS)
+    {
+        for (record = records; record; record = record->pNext)
+        {
+            if (record->Flags.S.Section == DnsSectionAnswer) ttl = min( ttl, record->dwTtl );
+        }
+        if (!ttl || !records) return;
+    }
+    else if (status == DNS_ERROR_RCODE_NAME_ERROR) ttl = NEGATIVE_CACHE_TTL;
+    else return;
+
+    if (!(entry = heap_alloc_zero( sizeof(*entry) ))) return;
+    if (!(entry->name = dns_strdup_u( name ))) goto error;
+    if (records && !(entry->records = (DNS_RECORDA *)DnsRecordSetCopyEx( (DNS_RECORD *)records,
+                                                                        DnsCharSetUtf8, DnsCharSetUtf8 )))
+        goto error;
+    entry->type = type;
+    entry->status = status;
+    entry->expires = GetTickCount64() + ttl * 1000;
+
+    EnterCriticalSection( &cache_cs );
+    init_cache();
+
+    if ((old = find_cache_entry( name, type ))) free_cache_entry( old );
+    if (cache_count >= MAX_CACHE_ENTRIES)
+        free_cache_entry( LIST_ENTRY( list_tail( &cache_lru ), struct cache_entry, lru_entry ) );
+
+    list_add_head( &cache_hash[cache_hash_name( name, type )], &entry->entry );
+    list_add_head( &cache_lru, &entry->lru_entry );
+    cache_count++;
+
+    LeaveCriticalSection( &cache_cs );
+
+    TRACE( "cached %s %s for %u seconds, status %d\n", debugstr_a(name), dns_type_to_str( type ),
+           ttl, status );
+    return;
+
+error:
+    heap_free( entry->name );
+    heap_free( entry );
+}
+
+/* remove all entries for the given name, or the whole cache if name is NULL */
+void dns_cache_flush( const char *name )
+{
+    struct cache_entry *entry, *next;
+
+    EnterCriticalSection( &cache_cs );
+    init_cache();
+
+    LIST_FOR_EACH_ENTRY_SAFE( entry, next, &cache_lru, struct cache_entry, lru_entry )
+    {
+        if (!name || cache_name_equal( entry->name, name )) free_cache_entry( entry );
+    }
+    TRACE( "%s: %u entries left (%u hits, %u misses)\n", debugstr_a(name), cache_count,
+           cache_hits, cache_misses );
+
+    LeaveCriticalSection( &cache_cs );
+}
+
+/******************************************************************************
+ * DnsFlushResolverCache               [DNSAPI.@]
+ *
+ */
+VOID WINAPI DnsFlushResolverCache(void)
+{
+    TRACE( "\n" );
+    dns_cache_flush( NULL );
+}
+
+/******************************************************************************
+ * DnsFlushResolverCacheEntry_A               [DNSAPI.@]
+ *
+ */
+BOOL WINAPI DnsFlushResolverCacheEntry_A( PCSTR entry )
+{
+    char *entryU;
+
+    TRACE( "%s\n", debugstr_a(entry) );
+
+    if (!entry) return FALSE;
+    if (!(entryU = dns_strdup_au( entry ))) return FALSE;
+    dns_cache_flush( entryU );
+    heap_free( entryU );
+    return TRUE;
+}
+
+/******************************************************************************
+ * DnsFlushResolverCacheEntry_UTF8               [DNSAPI.@]
+ *
+ */
+BOOL WINAPI DnsFlushResolverCacheEntry_UTF8( PCSTR entry )
+{
+    TRACE( "%s\n", debugstr_a(entry) );
+
+    if (!entry) return FALSE;
+    dns_cache_flush( entry );
+    return TRUE;
+}
+
+/******************************************************************************
+ * DnsFlushResolverCacheEntry_W               [DNSAPI.@]
+ *
+ */
+BOOL WINAPI DnsFlushResolverCacheEntry_W( PCWSTR entry )
+{
+    char *entryU;
+
+    TRACE( "%s\n", debugstr_w(entry) );
+
+    if (!entry) return FALSE;
+    if (!(entryU = dns_strdup_wu( entry ))) return FALSE;
+    dns_cache_flush( entryU );
+    heap_free( entryU );
+    return TRUE;
+}
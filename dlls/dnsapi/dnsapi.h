@@ -143,6 +143,10 @@ static inline LPSTR dns_strdup_ua( const char *src )
 
 const char *dns_type_to_str( unsigned short ) DECLSPEC_HIDDEN;
 
+BOOL dns_cache_lookup( const char *, WORD, DWORD, const void *, DNS_RECORDA **, DNS_STATUS * ) DECLSPEC_HIDDEN;
+void dns_cache_add( const char *, WORD, DWORD, const void *, DNS_STATUS, DNS_RECORDA * ) DECLSPEC_HIDDEN;
+void dns_cache_flush( const char * ) DECLSPEC_HIDDEN;
+
 #ifdef HAVE_RESOLV
 int dns_ns_initparse( const u_char *, int, ns_msg * ) DECLSPEC_HIDDEN;
 int dns_ns_parserr( ns_msg *, ns_sect, int, ns_rr * ) DECLSPEC_HIDDEN;
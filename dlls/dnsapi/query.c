@@ -105,10 +105,6 @@ static unsigned long dns_map_options( DWORD options )
         FIXME( "option DNS_QUERY_RESERVED not implemented\n" );
     if (options & DNS_QUERY_WIRE_ONLY)
         FIXME( "option DNS_QUERY_WIRE_ONLY not implemented\n" );
-    if (options & DNS_QUERY_NO_WIRE_QUERY)
-        FIXME( "option DNS_QUERY_NO_WIRE_QUERY not implemented\n" );
-    if (options & DNS_QUERY_BYPASS_CACHE)
-        FIXME( "option DNS_QUERY_BYPASS_CACHE not implemented\n" );
     if (options & DNS_QUERY_RETURN_MESSAGE)
         FIXME( "option DNS_QUERY_RETURN_MESSAGE not implemented\n" );
 
@@ -719,10 +715,19 @@ DNS_STATUS WINAPI DnsQuery_UTF8( PCSTR name, WORD type, DWORD options, PVOID ser
     if (servers && (ret = dns_set_serverlist( servers )))
         return ret;
 
-    ret = dns_do_query( name, type, options, result );
+    if (!dns_cache_lookup( name, type, options, servers, result, &ret ))
+    {
+        if (options & DNS_QUERY_NO_WIRE_QUERY)
+        {
+            TRACE( "not in the cache, wire query disabled\n" );
+            return DNS_ERROR_RECORD_DOES_NOT_EXIST;
+        }
+        ret = dns_do_query( name, type, options, result );
+        dns_cache_add( name, type, options, servers, ret, ret == ERROR_SUCCESS ? *result : NULL );
+    }
 
     if (ret == DNS_ERROR_RCODE_NAME_ERROR && type == DNS_TYPE_A &&
-        !(options & DNS_QUERY_NO_NETBT))
+        !(options & (DNS_QUERY_NO_NETBT | DNS_QUERY_NO_WIRE_QUERY)))
     {
         TRACE( "dns lookup failed, trying netbios query\n" );
         ret = dns_do_query_netbios( name, result );
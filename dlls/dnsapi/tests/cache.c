@@ -0,0 +1,139 @@
+/*
+ * Tests for the resolver cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "winnls.h"
+#include "windns.h"
+#include "winerror.h"
+
+#include "wine/test.h"
+
+static BOOL (WINAPI *pDnsFlushResolverCacheEntry_A)(PCSTR);
+
+static const char positive_name[] = "test.winehq.org";
+static const char negative_name[] = "nonexistent.invalid";
+
+static void test_positive_cache( void )
+{
+    DNS_RECORDA *rec, *cached;
+    DNS_STATUS status;
+
+    pDnsFlushResolverCacheEntry_A( positive_name );
+
+    status = DnsQuery_A( positive_name, DNS_TYPE_A, DNS_QUERY_NO_WIRE_QUERY, NULL, &rec, NULL );
+    ok( status == DNS_ERROR_RECORD_DOES_NOT_EXIST, "got %d\n", status );
+
+    status = DnsQuery_A( positive_name, DNS_TYPE_A, DNS_QUERY_STANDARD, NULL, &rec, NULL );
+    if (status)
+    {
+        skip( "%s not resolved, no network? (%d)\n", positive_name, status );
+        return;
+    }
+
+    /* the answer is now in the cache, with no more time to live than the original */
+    status = DnsQuery_A( positive_name, DNS_TYPE_A, DNS_QUERY_NO_WIRE_QUERY, NULL, &cached, NULL );
+    ok( status == ERROR_SUCCESS, "got %d\n", status );
+    if (!status)
+    {
+        ok( cached->wType == DNS_TYPE_A, "got type %u\n", cached->wType );
+        ok( cached->Data.A.IpAddress == rec->Data.A.IpAddress, "got address %08x, expected %08x\n",
+            cached->Data.A.IpAddress, rec->Data.A.IpAddress );
+        ok( cached->dwTtl <= rec->dwTtl, "got ttl %u, expected at most %u\n", cached->dwTtl, rec->dwTtl );
+        DnsRecordListFree( (DNS_RECORD *)cached, DnsFreeRecordList );
+    }
+    DnsRecordListFree( (DNS_RECORD *)rec, DnsFreeRecordList );
+
+    ok( pDnsFlushResolverCacheEntry_A( positive_name ), "DnsFlushResolverCacheEntry_A failed\n" );
+    status = DnsQuery_A( positive_name, DNS_TYPE_A, DNS_QUERY_NO_WIRE_QUERY, NULL, &rec, NULL );
+    ok( status == DNS_ERROR_RECORD_DOES_NOT_EXIST, "got %d\n", status );
+}
+
+static void test_negative_cache( void )
+{
+    DNS_RECORDA *rec;
+    DNS_STATUS status;
+
+    pDnsFlushResolverCacheEntry_A( negative_name );
+
+    status = DnsQuery_A( negative_name, DNS_TYPE_A, DNS_QUERY_NO_NETBT, NULL, &rec, NULL );
+    if (status != DNS_ERROR_RCODE_NAME_ERROR)
+    {
+        if (!status) DnsRecordListFree( (DNS_RECORD *)rec, DnsFreeRecordList );
+        skip( "%s not reported as missing, no network? (%d)\n", negative_name, status );
+        return;
+    }
+
+    /* the name error is remembered */
+    status = DnsQuery_A( negative_name, DNS_TYPE_A, DNS_QUERY_NO_WIRE_QUERY, NULL, &rec, NULL );
+    ok( status == DNS_ERROR_RCODE_NAME_ERROR, "got %d\n", status );
+
+    pDnsFlushResolverCacheEntry_A( negative_name );
+    status = DnsQuery_A( negative_name, DNS_TYPE_A, DNS_QUERY_NO_WIRE_QUERY, NULL, &rec, NULL );
+    ok( status == DNS_ERROR_RECORD_DOES_NOT_EXIST, "got %d\n", status );
+}
+
+static void test_bypass_cache( void )
+{
+    DNS_RECORDA *rec;
+    DNS_STATUS status;
+
+    pDnsFlushResolverCacheEntry_A( positive_name );
+
+    status = DnsQuery_A( positive_name, DNS_TYPE_A, DNS_QUERY_BYPASS_CACHE, NULL, &rec, NULL );
+    if (status)
+    {
+        skip( "%s not resolved, no network? (%d)\n", positive_name, status );
+        return;
+    }
+    DnsRecordListFree( (DNS_RECORD *)rec, DnsFreeRecordList );
+
+    /* answers to queries bypassing the cache are not cached */
+    status = DnsQuery_A( positive_name, DNS_TYPE_A, DNS_QUERY_NO_WIRE_QUERY, NULL, &rec, NULL );
+    ok( status == DNS_ERROR_RECORD_DOES_NOT_EXIST, "got %d\n", status );
+    if (!status) DnsRecordListFree( (DNS_RECORD *)rec, DnsFreeRecordList );
+
+    /* and a cached answer is not used */
+    status = DnsQuery_A( positive_name, DNS_TYPE_A, DNS_QUERY_STANDARD, NULL, &rec, NULL );
+    ok( status == ERROR_SUCCESS, "got %d\n", status );
+    if (!status) DnsRecordListFree( (DNS_RECORD *)rec, DnsFreeRecordList );
+    status = DnsQuery_A( positive_name, DNS_TYPE_A, DNS_QUERY_BYPASS_CACHE | DNS_QUERY_NO_WIRE_QUERY,
+                         NULL, &rec, NULL );
+    ok( status != ERROR_SUCCESS, "got %d\n", status );
+    if (!status) DnsRecordListFree( (DNS_RECORD *)rec, DnsFreeRecordList );
+
+    pDnsFlushResolverCacheEntry_A( positive_name );
+}
+
+START_TEST(cache)
+{
+    pDnsFlushResolverCacheEntry_A = (void *)GetProcAddress( GetModuleHandleA( "dnsapi.dll" ),
+                                                            "DnsFlushResolverCacheEntry_A" );
+    if (!pDnsFlushResolverCacheEntry_A)
+    {
+        win_skip( "DnsFlushResolverCacheEntry_A not available\n" );
+        return;
+    }
+
+    test_positive_cache();
+    test_negative_cache();
+    test_bypass_cache();
+}
@@ -0,0 +1,171 @@
+/*
+ * DIB driver parallel band processing
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <string.h>
+
+#include "gdi_private.h"
+#include "winreg.h"
+#include "dibdrv.h"
+
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dib);
+
+#define MAX_BAND_THREADS  64
+#define MIN_BAND_HEIGHT   16
+#define BANDS_PER_THREAD  4
+
+/* both are set from HKCU\Software\Wine\DIB Engine, parallel processing is disabled by default */
+static unsigned int band_threads;
+static unsigned int band_min_pixels = 1024 * 1024;
+
+struct band_job
+{
+    band_func   func;
+    void       *context;
+    RECT        bounds;
+    int         band_height;
+    LONG        next;       /* index of the next band to process */
+    LONG        pending;    /* threads still working on the job */
+    HANDLE      done;
+};
+
+DWORD get_dib_config_value( HKEY key, const char *name, DWORD def )
+{
+    char buffer[16];
+    DWORD type, size = sizeof(buffer), value;
+
+    if (RegQueryValueExA( key, name, NULL, &type, (BYTE *)buffer, &size )) return def;
+    if (type == REG_DWORD && size == sizeof(DWORD))
+    {
+        memcpy( &value, buffer, sizeof(value) );
+        return value;
+    }
+    if (type == REG_SZ && size < sizeof(buffer))
+    {
+        buffer[size] = 0;
+        return strtoul( buffer, NULL, 10 );
+    }
+    return def;
+}
+
+void init_dib_bands(void)
+{
+    HKEY key;
+
+    if (RegOpenKeyA( HKEY_CURRENT_USER, "Software\\Wine\\DIB Engine", &key )) return;
+
+    /* a thread count of 1 keeps everything on the calling thread */
+    band_threads = get_dib_config_value( key, "Threads", 0 );
+    band_min_pixels = get_dib_config_value( key, "MinPixels", band_min_pixels );
+    RegCloseKey( key );
+
+    band_threads = min( band_threads, MAX_BAND_THREADS );
+    if (band_threads > 1) TRACE( "using %u threads for operations over %u pixels\n", band_threads, band_min_pixels );
+}
+
+/* returns the height of the bands for a bounding rectangle, or 0 if it isn't split */
+static unsigned int get_band_height( const RECT *bounds )
+{
+    unsigned int height = bounds->bottom - bounds->top, bands;
+
+    if (band_threads < 2 || height < 2 * MIN_BAND_HEIGHT ||
+        (ULONGLONG)(bounds->right - bounds->left) * height < band_min_pixels)
+        return 0;
+
+    /* more bands than threads to even out the load */
+    bands = band_threads * BANDS_PER_THREAD;
+    return max( (height + bands - 1) / bands, MIN_BAND_HEIGHT );
+}
+
+unsigned int get_band_count( const RECT *bounds )
+{
+    unsigned int band_height = get_band_height( bounds );
+
+    if (!band_height) return 1;
+    return (bounds->bottom - bounds->top + band_height - 1) / band_height;
+}
+
+static void process_bands( struct band_job *job )
+{
+    RECT band = job->bounds;
+    LONG index;
+
+    for (;;)
+    {
+        index = InterlockedIncrement( &job->next ) - 1;
+        if (index >= (job->bounds.bottom - job->bounds.top + job->band_height - 1) / job->band_height) break;
+        band.top = job->bounds.top + index * job->band_height;
+        band.bottom = min( band.top + job->band_height, job->bounds.bottom );
+        job->func( job->context, &band, index );
+    }
+}
+
+static void CALLBACK band_worker( TP_CALLBACK_INSTANCE *instance, void *arg )
+{
+    struct band_job *job = arg;
+
+    process_bands( job );
+    if (!InterlockedDecrement( &job->pending )) SetEvent( job->done );
+}
+
+/* call func for horizontal bands covering the bounding rectangle exactly once, large
+ * operations are spread over the thread pool so func may only touch pixels inside its band */
+void run_in_bands( const RECT *bounds, band_func func, void *context )
+{
+    struct band_job job;
+    unsigned int i;
+
+    if (!(job.band_height = get_band_height( bounds )) ||
+        !(job.done = CreateEventW( NULL, TRUE, FALSE, NULL )))
+    {
+        func( context, bounds, 0 );
+        return;
+    }
+
+    job.func = func;
+    job.context = context;
+    job.bounds = *bounds;
+    job.next = 0;
+    job.pending = 1;
+
+    for (i = 1; i < band_threads; i++)
+    {
+        InterlockedIncrement( &job.pending );
+        if (!TrySubmitThreadpoolCallback( band_worker, &job, NULL ))
+        {
+            InterlockedDecrement( &job.pending );
+            break;
+        }
+    }
+
+    process_bands( &job );
+    if (InterlockedDecrement( &job.pending )) WaitForSingleObject( job.done, INFINITE );
+    CloseHandle( job.done );
+}
+
+/* same as run_in_bands() for the bounding rectangle of a list of rectangles */
+void run_in_bands_for_rects( const RECT *rects, int count, band_func func, void *context )
+{
+    RECT bounds;
+    int i;
+
+    reset_bounds( &bounds );
+    for (i = 0; i < count; i++) add_bounds_rect( &bounds, &rects[i] );
+    if (!is_rect_empty( &bounds )) run_in_bands( &bounds, func, context );
+}
@@ -552,20 +552,46 @@ static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
-static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
-                         HRGN clip, BLENDFUNCTION blend )
+struct blend_band
+{
+    const dib_info *dst;
+    const RECT *dst_rect;
+    const dib_info *src;
+    const RECT *src_rect;
+    const struct clipped_rects *clipped_rects;
+    BLENDFUNCTION blend;
+};
+
+static void blend_band( void *context, const RECT *band, unsigned int index )
 {
+    const struct blend_band *params = context;
     POINT origin;
-    struct clipped_rects clipped_rects;
+    RECT rect;
     int i;
 
-    if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
-    for (i = 0; i < clipped_rects.count; i++)
+    for (i = 0; i < params->clipped_rects->count; i++)
     {
-        origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
-        origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
-        dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
+        if (!intersect_rect( &rect, &params->clipped_rects->rects[i], band )) continue;
+        origin.x = params->src_rect->left + rect.left - params->dst_rect->left;
+        origin.y = params->src_rect->top  + rect.top  - params->dst_rect->top;
+        params->dst->funcs->blend_rect( params->dst, &rect, params->src, &origin, params->blend );
     }
+}
+
+static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
+                         HRGN clip, BLENDFUNCTION blend )
+{
+    struct clipped_rects clipped_rects;
+    struct blend_band params;
+
+    if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
+    params.dst = dst;
+    params.dst_rect = dst_rect;
+    params.src = src;
+    params.src_rect = src_rect;
+    params.clipped_rects = &clipped_rects;
+    params.blend = blend;
+    run_in_bands_for_rects( clipped_rects.rects, clipped_rects.count, blend_band, &params );
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
 }
@@ -649,17 +675,61 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
-static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
+struct gradient_band
 {
+    const dib_info *dib;
+    const TRIVERTEX *v;
+    int mode;
+    const struct clipped_rects *clipped_rects;
+    BOOL *ret;          /* one result per band */
+};
+
+static void gradient_band( void *context, const RECT *band, unsigned int index )
+{
+    struct gradient_band *params = context;
+    RECT rect;
     int i;
+
+    for (i = 0; i < params->clipped_rects->count; i++)
+    {
+        if (!intersect_rect( &rect, &params->clipped_rects->rects[i], band )) continue;
+        if (!params->dib->funcs->gradient_rect( params->dib, &rect, params->v, params->mode ))
+        {
+            params->ret[index] = FALSE;
+            break;
+        }
+    }
+}
+
+static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
+{
     struct clipped_rects clipped_rects;
+    struct gradient_band params;
     BOOL ret = TRUE;
+    RECT rect;
+    unsigned int i, count;
 
     if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
-    for (i = 0; i < clipped_rects.count; i++)
+
+    reset_bounds( &rect );
+    for (i = 0; i < clipped_rects.count; i++) add_bounds_rect( &rect, &clipped_rects.rects[i] );
+    count = get_band_count( &rect );
+
+    if (!(params.ret = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*params.ret) )))
     {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        free_clipped_rects( &clipped_rects );
+        return FALSE;
     }
+    for (i = 0; i < count; i++) params.ret[i] = TRUE;
+
+    params.dib = dib;
+    params.v = v;
+    params.mode = mode;
+    params.clipped_rects = &clipped_rects;
+    run_in_bands( &rect, gradient_band, &params );
+    for (i = 0; i < count; i++) ret = ret && params.ret[i];
+
+    HeapFree( GetProcessHeap(), 0, params.ret );
     free_clipped_rects( &clipped_rects );
     return ret;
 }
@@ -1147,6 +1217,97 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
+struct stretch_band
+{
+    dib_info *dst_dib;
+    const dib_info *src_dib;
+    POINT dst_start;
+    POINT src_start;
+    struct stretch_params v_params;
+    struct stretch_params h_params;
+    BOOL vstretch;
+    int mode;
+    int width;
+    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
+                    const dib_info *src_dib, const POINT *src_start,
+                    const struct stretch_params *params, int mode, BOOL keep_dst);
+};
+
+static void stretch_band( void *context, const RECT *band, unsigned int index )
+{
+    const struct stretch_band *params = context;
+    const struct stretch_params *v_params = &params->v_params;
+    POINT dst_start = params->dst_start, src_start = params->src_start;
+    int i, err = v_params->err_start;
+
+    if (params->vstretch)
+    {
+        BOOL need_row = TRUE;
+        RECT last_row, this_row;
+        last_row.left = 0;
+        last_row.right = params->width;
+
+        for (i = 0; i < band->bottom; i++)
+        {
+            if (i >= band->top)
+            {
+                /* the previous row may belong to another band */
+                if (need_row || i == band->top)
+                {
+                    params->row_fn( params->dst_dib, &dst_start, params->src_dib, &src_start,
+                                    &params->h_params, params->mode, FALSE );
+                    need_row = FALSE;
+                }
+                else
+                {
+                    last_row.top = dst_start.y - v_params->dst_inc;
+                    last_row.bottom = last_row.top + 1;
+                    this_row = last_row;
+                    offset_rect( &this_row, 0, v_params->dst_inc );
+                    copy_rect( params->dst_dib, &this_row, params->dst_dib, &last_row, NULL, R2_COPYPEN );
+                }
+            }
+
+            if (err > 0)
+            {
+                src_start.y += v_params->src_inc;
+                need_row = TRUE;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            dst_start.y += v_params->dst_inc;
+        }
+    }
+    else
+    {
+        int merged_rows = 0;
+        BOOL in_band = FALSE;
+
+        for (i = 0; i < v_params->length; i++)
+        {
+            /* a destination row is drawn by the band holding its first source row */
+            if (!merged_rows)
+            {
+                if (i >= band->bottom) break;
+                in_band = i >= band->top;
+            }
+            if (in_band && (params->mode != STRETCH_DELETESCANS || !merged_rows))
+                params->row_fn( params->dst_dib, &dst_start, params->src_dib, &src_start,
+                                &params->h_params, params->mode, merged_rows != 0 );
+            merged_rows++;
+
+            if (err > 0)
+            {
+                dst_start.y += v_params->dst_inc;
+                merged_rows = 0;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            src_start.y += v_params->src_inc;
+        }
+    }
+}
+
 DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                           const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
                           INT mode )
@@ -1156,11 +1317,8 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
-    int err;
+    struct stretch_band params;
     DWORD ret;
-    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
-                    const dib_info *src_dib, const POINT *src_start,
-                    const struct stretch_params *params, int mode, BOOL keep_dst);
 
     TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
           dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
@@ -1194,64 +1352,22 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     dst_start.x -= dst->visrect.left;
     dst_start.y -= dst->visrect.top;
 
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
-
-    if (vstretch)
-    {
-        BOOL need_row = TRUE;
-        RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
-        last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
-
-        while (v_params.length--)
-        {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
-            {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                offset_rect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
-            }
-
-            if (err > 0)
-            {
-                src_start.y += v_params.src_inc;
-                need_row = TRUE;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
-        }
-    }
-    else
-    {
-        int merged_rows = 0;
-
-        while (v_params.length--)
-        {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
-            merged_rows++;
-
-            if (err > 0)
-            {
-                dst_start.y += v_params.dst_inc;
-                merged_rows = 0;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
-        }
-    }
+    params.dst_dib = &dst_dib;
+    params.src_dib = &src_dib;
+    params.dst_start = dst_start;
+    params.src_start = src_start;
+    params.v_params = v_params;
+    params.h_params = h_params;
+    params.vstretch = vstretch;
+    params.mode = (vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    params.width = dst->visrect.right - dst->visrect.left;
+    params.row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+
+    /* bands are made of iterations of the vertical loop */
+    rect.left = rect.top = 0;
+    rect.right = h_params.length;
+    rect.bottom = v_params.length;
+    run_in_bands( &rect, stretch_band, &params );
 
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     *src = *dst;
@@ -203,8 +203,8 @@ typedef struct primitive_funcs
                                     const struct stretch_params *params, int mode, BOOL keep_dst);
 } primitive_funcs;
 
-extern const primitive_funcs funcs_8888 DECLSPEC_HIDDEN;
-extern const primitive_funcs funcs_32   DECLSPEC_HIDDEN;
+extern primitive_funcs funcs_8888 DECLSPEC_HIDDEN;
+extern primitive_funcs funcs_32   DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_24   DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_555  DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_16   DECLSPEC_HIDDEN;
@@ -237,6 +237,16 @@ struct clipped_rects
     RECT  buffer[32];
 };
 
+/* index is the position of the band in the bounding rectangle, below get_band_count() */
+typedef void (*band_func)( void *context, const RECT *band, unsigned int index );
+
+extern unsigned int get_band_count( const RECT *bounds ) DECLSPEC_HIDDEN;
+extern void run_in_bands( const RECT *bounds, band_func func, void *context ) DECLSPEC_HIDDEN;
+extern void run_in_bands_for_rects( const RECT *rects, int count, band_func func, void *context ) DECLSPEC_HIDDEN;
+extern DWORD get_dib_config_value( HKEY key, const char *name, DWORD def ) DECLSPEC_HIDDEN;
+extern ULONGLONG get_shared_font_key( HDC hdc, const LOGFONTW *lf, const XFORM *xform, UINT aa_flags ) DECLSPEC_HIDDEN;
+extern void *find_shared_glyph( ULONGLONG font, UINT index, DWORD *size ) DECLSPEC_HIDDEN;
+extern void add_shared_glyph( ULONGLONG font, UINT index, const void *data, DWORD size ) DECLSPEC_HIDDEN;
 extern void get_rop_codes(INT rop, struct rop_codes *codes) DECLSPEC_HIDDEN;
 extern void reset_dash_origin(dibdrv_physdev *pdev) DECLSPEC_HIDDEN;
 extern void init_dib_info_from_bitmapinfo(dib_info *dib, const BITMAPINFO *info, void *bits) DECLSPEC_HIDDEN;
@@ -0,0 +1,256 @@
+/*
+ * DIB driver glyph cache shared between processes
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <string.h>
+
+#include "gdi_private.h"
+#include "winreg.h"
+#include "dibdrv.h"
+
+#include "wine/unicode.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dib);
+
+/* The cache is a named section holding one set-associative table per glyph size class. A set
+ * is picked from the font key and glyph index, and the least recently used slot of the set is
+ * replaced. Slots carry a sequence number that is odd while a writer owns the slot, so readers
+ * don't take any lock: they copy the glyph and check that the sequence didn't change. The
+ * layout only depends on the size of the section, so there's nothing to initialize. */
+
+#define SHARED_CACHE_WAYS     8
+#define SHARED_CACHE_CLASSES  3
+
+static const DWORD class_sizes[SHARED_CACHE_CLASSES] = { 256, 1024, 4096 };
+
+static const WCHAR shared_cache_nameW[] =
+    {'_','_','w','i','n','e','_','d','i','b','_','g','l','y','p','h','_','c','a','c','h','e','_','1',0};
+
+struct shared_cache_header
+{
+    LONG clock;                 /* incremented on every hit and insertion */
+};
+
+struct shared_cache_slot
+{
+    LONG      seq;              /* odd while the slot is being written */
+    LONG      last_used;        /* clock value of the last access */
+    ULONGLONG font;
+    DWORD     index;
+    DWORD     size;             /* size of the data, 0 for an empty slot */
+};
+
+struct shared_cache_class
+{
+    struct shared_cache_slot *slots;
+    BYTE                     *data;
+    DWORD                     sets;
+    DWORD                     size;
+};
+
+static struct shared_cache_header *shared_cache;
+static struct shared_cache_class classes[SHARED_CACHE_CLASSES];
+
+static INIT_ONCE init_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL WINAPI init_shared_cache( INIT_ONCE *once, void *param, void **context )
+{
+    MEMORY_BASIC_INFORMATION info;
+    HANDLE mapping;
+    HKEY key;
+    DWORD size = 0, i;
+    BYTE *ptr;
+
+    /* @@ Wine registry key: HKCU\Software\Wine\DIB Engine */
+    if (!RegOpenKeyA( HKEY_CURRENT_USER, "Software\\Wine\\DIB Engine", &key ))
+    {
+        /* in kilobytes, the cache is disabled by default */
+        size = get_dib_config_value( key, "GlyphCacheSize", 0 );
+        RegCloseKey( key );
+    }
+    if (!size) return TRUE;
+    size = min( size, 256 * 1024 ) * 1024;
+
+    /* the first process creates the section, the others get its original size */
+    if (!(mapping = CreateFileMappingW( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, size,
+                                        shared_cache_nameW )))
+    {
+        WARN( "can't create the shared glyph cache, error %u\n", GetLastError() );
+        return TRUE;
+    }
+    ptr = MapViewOfFile( mapping, FILE_MAP_WRITE, 0, 0, 0 );
+    CloseHandle( mapping );
+    if (!ptr || !VirtualQuery( ptr, &info, sizeof(info) )) return TRUE;
+
+    size = info.RegionSize;
+    for (i = 0; i < SHARED_CACHE_CLASSES; i++)
+    {
+        DWORD set_size = SHARED_CACHE_WAYS * (sizeof(struct shared_cache_slot) + class_sizes[i]);
+
+        classes[i].sets = (size - sizeof(*shared_cache)) / SHARED_CACHE_CLASSES / set_size;
+        classes[i].size = class_sizes[i];
+        if (!classes[i].sets)
+        {
+            UnmapViewOfFile( ptr );
+            return TRUE;
+        }
+    }
+
+    shared_cache = (struct shared_cache_header *)ptr;
+    ptr += sizeof(*shared_cache);
+    for (i = 0; i < SHARED_CACHE_CLASSES; i++)
+    {
+        classes[i].slots = (struct shared_cache_slot *)ptr;
+        ptr += classes[i].sets * SHARED_CACHE_WAYS * sizeof(struct shared_cache_slot);
+        classes[i].data = ptr;
+        ptr += classes[i].sets * SHARED_CACHE_WAYS * classes[i].size;
+    }
+    TRACE( "using %u bytes, %u/%u/%u sets\n", size, classes[0].sets, classes[1].sets, classes[2].sets );
+    return TRUE;
+}
+
+static ULONGLONG hash_data( ULONGLONG hash, const void *data, DWORD size )
+{
+    const BYTE *ptr = data;
+
+    while (size--) hash = (hash ^ *ptr++) * 0x100000001b3ull;
+    return hash;
+}
+
+/* returns a key identifying the font file and face realized in the DC combined with the
+ * rendering parameters, or 0 if the shared cache isn't used */
+ULONGLONG get_shared_font_key( HDC hdc, const LOGFONTW *lf, const XFORM *xform, UINT aa_flags )
+{
+    struct font_realization_info info;
+    struct font_fileinfo *fileinfo;
+    ULONGLONG hash = 0xcbf29ce484222325ull;
+    DWORD needed = 0;
+
+    InitOnceExecuteOnce( &init_once, init_shared_cache, NULL, NULL );
+    if (!shared_cache) return 0;
+
+    info.size = sizeof(info);
+    if (!GetFontRealizationInfo( hdc, &info )) return 0;
+    GetFontFileInfo( info.instance_id, 0, NULL, 0, &needed );
+    if (!needed || !(fileinfo = HeapAlloc( GetProcessHeap(), 0, needed ))) return 0;
+    if (!GetFontFileInfo( info.instance_id, 0, fileinfo, needed, &needed ) || !fileinfo->path[0])
+    {
+        /* memory fonts have no file */
+        HeapFree( GetProcessHeap(), 0, fileinfo );
+        return 0;
+    }
+
+    hash = hash_data( hash, fileinfo->path, strlenW( fileinfo->path ) * sizeof(WCHAR) );
+    hash = hash_data( hash, &fileinfo->writetime, sizeof(fileinfo->writetime) );
+    hash = hash_data( hash, &fileinfo->size, sizeof(fileinfo->size) );
+    hash = hash_data( hash, &info.face_index, sizeof(info.face_index) );
+    hash = hash_data( hash, &info.simulations, sizeof(info.simulations) );
+    hash = hash_data( hash, lf, FIELD_OFFSET( LOGFONTW, lfFaceName ));
+    hash = hash_data( hash, lf->lfFaceName, strlenW( lf->lfFaceName ) * sizeof(WCHAR) );
+    hash = hash_data( hash, xform, sizeof(*xform) );
+    hash = hash_data( hash, &aa_flags, sizeof(aa_flags) );
+    HeapFree( GetProcessHeap(), 0, fileinfo );
+    return hash ? hash : 1;
+}
+
+static struct shared_cache_slot *get_set( const struct shared_cache_class *class, ULONGLONG font, UINT index,
+                                          BYTE **data )
+{
+    DWORD set = (DWORD)(hash_data( font, &index, sizeof(index) ) % class->sets);
+
+    *data = class->data + set * SHARED_CACHE_WAYS * class->size;
+    return class->slots + set * SHARED_CACHE_WAYS;
+}
+
+/* returns a heap copy of the cached data, or NULL */
+void *find_shared_glyph( ULONGLONG font, UINT index, DWORD *size )
+{
+    struct shared_cache_slot *slot;
+    BYTE *data;
+    void *ret = NULL;
+    DWORD i, j;
+    LONG seq;
+
+    if (!font) return NULL;
+
+    for (i = 0; i < SHARED_CACHE_CLASSES; i++)
+    {
+        slot = get_set( &classes[i], font, index, &data );
+        for (j = 0; j < SHARED_CACHE_WAYS; j++, slot++, data += classes[i].size)
+        {
+            seq = InterlockedCompareExchange( &slot->seq, 0, 0 );
+            if ((seq & 1) || slot->font != font || slot->index != index) continue;
+
+            *size = slot->size;
+            if (!*size || *size > classes[i].size) continue;
+            if (!ret && !(ret = HeapAlloc( GetProcessHeap(), 0, classes[i].size ))) return NULL;
+            memcpy( ret, data, *size );
+
+            /* make sure that no writer took the slot while we were copying */
+            if (InterlockedCompareExchange( &slot->seq, 0, 0 ) != seq) continue;
+
+            slot->last_used = InterlockedIncrement( &shared_cache->clock );
+            return ret;
+        }
+        HeapFree( GetProcessHeap(), 0, ret );
+        ret = NULL;
+    }
+    return NULL;
+}
+
+void add_shared_glyph( ULONGLONG font, UINT index, const void *data, DWORD size )
+{
+    struct shared_cache_slot *slot, *victim = NULL;
+    BYTE *set_data, *victim_data = NULL;
+    DWORD i, j;
+    LONG seq, clock;
+
+    if (!font || !size) return;
+
+    for (i = 0; i < SHARED_CACHE_CLASSES; i++) if (size <= classes[i].size) break;
+    if (i == SHARED_CACHE_CLASSES) return;
+
+    clock = shared_cache->clock;
+    slot = get_set( &classes[i], font, index, &set_data );
+    for (j = 0; j < SHARED_CACHE_WAYS; j++, slot++, set_data += classes[i].size)
+    {
+        if (slot->seq & 1) continue;
+        if (slot->size && slot->font == font && slot->index == index) return;  /* added by someone else */
+
+        /* take an empty slot, or else the least recently used one */
+        if (victim && !victim->size) continue;
+        if (!victim || !slot->size || clock - slot->last_used > clock - victim->last_used)
+        {
+            victim = slot;
+            victim_data = set_data;
+        }
+    }
+    if (!victim) return;
+
+    /* give up if another writer got there first, the glyph is only a cache entry */
+    seq = victim->seq & ~1;
+    if (InterlockedCompareExchange( &victim->seq, seq + 1, seq ) != seq) return;
+
+    victim->font = font;
+    victim->index = index;
+    victim->size = size;
+    memcpy( victim_data, data, size );
+    victim->last_used = InterlockedIncrement( &shared_cache->clock );
+
+    InterlockedExchange( &victim->seq, seq + 2 );
+}
@@ -51,6 +51,8 @@ struct cached_font
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    LONG                  shared_init;  /* shared_key has been set */
+    ULONGLONG             shared_key;   /* key in the shared glyph cache, 0 if not shared */
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
@@ -539,6 +541,8 @@ static struct cached_font *add_cached_font( HDC hdc, HFONT hfont, UINT aa_flags
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->shared_init = 0;
+    ptr->shared_key = 0;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
 done:
     list_add_head( &font_cache, &ptr->entry );
@@ -609,38 +613,6 @@ static inline void get_text_bkgnd_masks( HDC hdc, const dib_info *dib, rop_mask
     }
 }
 
-static void draw_glyph( dib_info *dib, int x, int y, const GLYPHMETRICS *metrics,
-                        const dib_info *glyph_dib, DWORD text_color,
-                        const struct intensity_range *ranges, const struct clipped_rects *clipped_rects,
-                        RECT *bounds )
-{
-    int i;
-    RECT rect, clipped_rect;
-    POINT src_origin;
-
-    rect.left   = x          + metrics->gmptGlyphOrigin.x;
-    rect.top    = y          - metrics->gmptGlyphOrigin.y;
-    rect.right  = rect.left  + metrics->gmBlackBoxX;
-    rect.bottom = rect.top   + metrics->gmBlackBoxY;
-    if (bounds) add_bounds_rect( bounds, &rect );
-
-    for (i = 0; i < clipped_rects->count; i++)
-    {
-        if (intersect_rect( &clipped_rect, &rect, clipped_rects->rects + i ))
-        {
-            src_origin.x = clipped_rect.left - rect.left;
-            src_origin.y = clipped_rect.top  - rect.top;
-
-            if (glyph_dib->bit_count == 32)
-                dib->funcs->draw_subpixel_glyph( dib, &clipped_rect, glyph_dib, &src_origin,
-                                                 text_color );
-            else
-                dib->funcs->draw_glyph( dib, &clipped_rect, glyph_dib, &src_origin,
-                                        text_color, ranges );
-        }
-    }
-}
-
 static int get_glyph_depth( UINT aa_flags )
 {
     switch (aa_flags)
@@ -678,6 +650,7 @@ static struct cached_glyph *cache_glyph_bitmap( HDC hdc, struct cached_font *fon
     UINT ggo_flags = font->aa_flags;
     static const MAT2 identity = { {0,1}, {0,0}, {0,0}, {0,1} };
     UINT indices[3] = {0, 0, 0x20};
+    UINT shared_index = (flags & ETO_GLYPH_INDEX) ? index | 0x10000 : index;
     int i, x, y;
     DWORD ret, size;
     BYTE *dst, *src;
@@ -685,6 +658,23 @@ static struct cached_glyph *cache_glyph_bitmap( HDC hdc, struct cached_font *fon
     GLYPHMETRICS metrics;
     struct cached_glyph *glyph;
 
+    if (!font->shared_init)
+    {
+        font->shared_key = get_shared_font_key( hdc, &font->lf, &font->xform, font->aa_flags );
+        InterlockedExchange( &font->shared_init, TRUE );
+    }
+    if ((glyph = find_shared_glyph( font->shared_key, shared_index, &size )))
+    {
+        /* another process already rendered it */
+        if (size >= FIELD_OFFSET( struct cached_glyph, bits ) &&
+            size == FIELD_OFFSET( struct cached_glyph,
+                                  bits[glyph->metrics.gmBlackBoxY *
+                                       get_dib_stride( glyph->metrics.gmBlackBoxX,
+                                                       get_glyph_depth( font->aa_flags )) ] ))
+            return add_cached_glyph( font, index, flags, glyph );
+        HeapFree( GetProcessHeap(), 0, glyph );
+    }
+
     if (flags & ETO_GLYPH_INDEX) ggo_flags |= GGO_GLYPH_INDEX;
     indices[0] = index;
     for (i = 0; i < sizeof(indices) / sizeof(indices[0]); i++)
@@ -733,43 +723,38 @@ static struct cached_glyph *cache_glyph_bitmap( HDC hdc, struct cached_font *fon
 
 done:
     glyph->metrics = metrics;
+    add_shared_glyph( font->shared_key, shared_index, glyph, FIELD_OFFSET( struct cached_glyph, bits[size] ));
     return add_cached_glyph( font, index, flags, glyph );
 }
 
-static void render_string( HDC hdc, dib_info *dib, struct cached_font *font, INT x, INT y,
-                           UINT flags, const WCHAR *str, UINT count, const INT *dx,
-                           const struct clipped_rects *clipped_rects, RECT *bounds )
+struct text_glyph
 {
-    UINT i;
-    struct cached_glyph *glyph;
-    dib_info glyph_dib;
-    DWORD text_color;
-    struct intensity_range ranges[17];
-
-    glyph_dib.bit_count    = get_glyph_depth( font->aa_flags );
-    glyph_dib.rect.left    = 0;
-    glyph_dib.rect.top     = 0;
-    glyph_dib.bits.is_copy = FALSE;
-    glyph_dib.bits.free    = NULL;
+    const struct cached_glyph *glyph;
+    RECT                       rect;    /* black box in device coordinates */
+};
 
-    text_color = get_pixel_color( hdc, dib, GetTextColor( hdc ), TRUE );
+#define TEXT_GLYPH_BUFFER 64
 
-    if (glyph_dib.bit_count == 8)
-        get_aa_ranges( dib->funcs->pixel_to_colorref( dib, text_color ), ranges );
+/* look up all the glyphs of the string and compute their positions */
+static UINT get_text_glyphs( HDC hdc, struct cached_font *font, INT x, INT y, UINT flags,
+                             const WCHAR *str, UINT count, const INT *dx,
+                             struct text_glyph *glyphs, RECT *bounds )
+{
+    UINT i, ret = 0;
+    struct cached_glyph *glyph;
 
     for (i = 0; i < count; i++)
     {
         if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
             !(glyph = cache_glyph_bitmap( hdc, font, str[i], flags ))) continue;
 
-        glyph_dib.width       = glyph->metrics.gmBlackBoxX;
-        glyph_dib.height      = glyph->metrics.gmBlackBoxY;
-        glyph_dib.rect.right  = glyph->metrics.gmBlackBoxX;
-        glyph_dib.rect.bottom = glyph->metrics.gmBlackBoxY;
-        glyph_dib.stride      = get_dib_stride( glyph->metrics.gmBlackBoxX, glyph_dib.bit_count );
-        glyph_dib.bits.ptr    = glyph->bits;
-
-        draw_glyph( dib, x, y, &glyph->metrics, &glyph_dib, text_color, ranges, clipped_rects, bounds );
+        glyphs[ret].glyph       = glyph;
+        glyphs[ret].rect.left   = x + glyph->metrics.gmptGlyphOrigin.x;
+        glyphs[ret].rect.top    = y - glyph->metrics.gmptGlyphOrigin.y;
+        glyphs[ret].rect.right  = glyphs[ret].rect.left + glyph->metrics.gmBlackBoxX;
+        glyphs[ret].rect.bottom = glyphs[ret].rect.top  + glyph->metrics.gmBlackBoxY;
+        add_bounds_rect( bounds, &glyphs[ret].rect );
+        ret++;
 
         if (dx)
         {
@@ -787,6 +772,73 @@ static void render_string( HDC hdc, dib_info *dib, struct cached_font *font, INT
             y += glyph->metrics.gmCellIncY;
         }
     }
+    return ret;
+}
+
+/***********************************************************************
+ *         draw_text_glyphs
+ *
+ * Draw the glyphs one clip rectangle at a time. If a background is given
+ * each clip rectangle is filled before the glyphs that fall into it are
+ * drawn, otherwise the rectangles below the text are skipped.
+ */
+static void draw_text_glyphs( HDC hdc, dib_info *dib, const struct cached_font *font,
+                              const struct text_glyph *glyphs, UINT count, const RECT *bounds,
+                              const struct clipped_rects *clipped_rects, const rop_mask *bkgnd )
+{
+    UINT i, j;
+    dib_info glyph_dib;
+    DWORD text_color = 0;
+    struct intensity_range ranges[17];
+    RECT run, clipped_rect;
+    POINT src_origin;
+
+    glyph_dib.bit_count    = get_glyph_depth( font->aa_flags );
+    glyph_dib.rect.left    = 0;
+    glyph_dib.rect.top     = 0;
+    glyph_dib.bits.is_copy = FALSE;
+    glyph_dib.bits.free    = NULL;
+
+    if (count)
+    {
+        text_color = get_pixel_color( hdc, dib, GetTextColor( hdc ), TRUE );
+        if (glyph_dib.bit_count == 8)
+            get_aa_ranges( dib->funcs->pixel_to_colorref( dib, text_color ), ranges );
+    }
+
+    for (i = 0; i < clipped_rects->count; i++)
+    {
+        const RECT *clip = clipped_rects->rects + i;
+
+        if (bkgnd) dib->funcs->solid_rects( dib, 1, clip, bkgnd->and, bkgnd->xor );
+        else if (clip->top >= bounds->bottom) break;  /* the rectangles are sorted top to bottom */
+
+        if (!intersect_rect( &run, clip, bounds )) continue;
+
+        for (j = 0; j < count; j++)
+        {
+            const struct cached_glyph *glyph = glyphs[j].glyph;
+
+            if (!intersect_rect( &clipped_rect, &glyphs[j].rect, &run )) continue;
+
+            glyph_dib.width       = glyph->metrics.gmBlackBoxX;
+            glyph_dib.height      = glyph->metrics.gmBlackBoxY;
+            glyph_dib.rect.right  = glyph->metrics.gmBlackBoxX;
+            glyph_dib.rect.bottom = glyph->metrics.gmBlackBoxY;
+            glyph_dib.stride      = get_dib_stride( glyph->metrics.gmBlackBoxX, glyph_dib.bit_count );
+            glyph_dib.bits.ptr    = (void *)glyph->bits;
+
+            src_origin.x = clipped_rect.left - glyphs[j].rect.left;
+            src_origin.y = clipped_rect.top  - glyphs[j].rect.top;
+
+            if (glyph_dib.bit_count == 32)
+                dib->funcs->draw_subpixel_glyph( dib, &clipped_rect, &glyph_dib, &src_origin,
+                                                 text_color );
+            else
+                dib->funcs->draw_glyph( dib, &clipped_rect, &glyph_dib, &src_origin,
+                                        text_color, ranges );
+        }
+    }
 }
 
 BOOL render_aa_text_bitmapinfo( HDC hdc, BITMAPINFO *info, struct gdi_image_bits *bits,
@@ -796,6 +848,10 @@ BOOL render_aa_text_bitmapinfo( HDC hdc, BITMAPINFO *info, struct gdi_image_bits
     dib_info dib;
     struct clipped_rects visrect;
     struct cached_font *font;
+    struct text_glyph buffer[TEXT_GLYPH_BUFFER], *glyphs = buffer;
+    rop_mask bkgnd_color;
+    RECT bounds;
+    UINT glyph_count;
 
     assert( info->bmiHeader.biBitCount > 8 ); /* mono and indexed formats don't support anti-aliasing */
 
@@ -804,17 +860,24 @@ BOOL render_aa_text_bitmapinfo( HDC hdc, BITMAPINFO *info, struct gdi_image_bits
     visrect.count = 1;
     visrect.rects = &src->visrect;
 
-    if (flags & ETO_OPAQUE)
+    if (count > TEXT_GLYPH_BUFFER &&
+        !(glyphs = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*glyphs) ))) return FALSE;
+
+    if (!(font = add_cached_font( hdc, GetCurrentObject( hdc, OBJ_FONT ), aa_flags )))
     {
-        rop_mask bkgnd_color;
-        get_text_bkgnd_masks( hdc, &dib, &bkgnd_color );
-        dib.funcs->solid_rects( &dib, 1, &src->visrect, bkgnd_color.and, bkgnd_color.xor );
+        if (glyphs != buffer) HeapFree( GetProcessHeap(), 0, glyphs );
+        return FALSE;
     }
 
-    if (!(font = add_cached_font( hdc, GetCurrentObject( hdc, OBJ_FONT ), aa_flags ))) return FALSE;
+    reset_bounds( &bounds );
+    glyph_count = get_text_glyphs( hdc, font, x, y, flags, str, count, dx, glyphs, &bounds );
+
+    if (flags & ETO_OPAQUE) get_text_bkgnd_masks( hdc, &dib, &bkgnd_color );
+    draw_text_glyphs( hdc, &dib, font, glyphs, glyph_count, &bounds, &visrect,
+                      (flags & ETO_OPAQUE) ? &bkgnd_color : NULL );
 
-    render_string( hdc, &dib, font, x, y, flags, str, count, dx, &visrect, NULL );
     release_cached_font( font );
+    if (glyphs != buffer) HeapFree( GetProcessHeap(), 0, glyphs );
     return TRUE;
 }
 
@@ -826,43 +889,58 @@ BOOL dibdrv_ExtTextOut( PHYSDEV dev, INT x, INT y, UINT flags,
 {
     dibdrv_physdev *pdev = get_dibdrv_pdev(dev);
     struct clipped_rects clipped_rects;
-    RECT bounds;
+    struct text_glyph buffer[TEXT_GLYPH_BUFFER], *glyphs = buffer;
+    rop_mask bkgnd_color;
+    RECT bounds, text_bounds, clip_rect;
+    UINT glyph_count;
 
     if (!pdev->font) return FALSE;
 
+    if (count > TEXT_GLYPH_BUFFER &&
+        !(glyphs = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*glyphs) ))) return FALSE;
+
     init_clipped_rects( &clipped_rects );
     reset_bounds( &bounds );
+    reset_bounds( &text_bounds );
+
+    glyph_count = get_text_glyphs( dev->hdc, pdev->font, x, y, flags, str, count, dx, glyphs, &text_bounds );
 
     if (flags & ETO_OPAQUE)
     {
-        rop_mask bkgnd_color;
         get_text_bkgnd_masks( dev->hdc, &pdev->dib, &bkgnd_color );
         add_bounds_rect( &bounds, rect );
         get_clipped_rects( &pdev->dib, rect, pdev->clip, &clipped_rects );
+
+        if (flags & ETO_CLIPPED)
+        {
+            /* the glyphs are clipped to the same rectangles, fill and draw in one pass */
+            if (clipped_rects.count) add_bounds_rect( &bounds, &text_bounds );
+            draw_text_glyphs( dev->hdc, &pdev->dib, pdev->font, glyphs, glyph_count, &text_bounds,
+                              &clipped_rects, &bkgnd_color );
+            goto done;
+        }
+
         pdev->dib.funcs->solid_rects( &pdev->dib, clipped_rects.count, clipped_rects.rects,
                                       bkgnd_color.and, bkgnd_color.xor );
+        free_clipped_rects( &clipped_rects );
+        init_clipped_rects( &clipped_rects );
     }
 
-    if (count == 0) goto done;
+    if (!glyph_count) goto done;
 
-    if (flags & ETO_CLIPPED)
-    {
-        if (!(flags & ETO_OPAQUE))  /* otherwise we have done it already */
-            get_clipped_rects( &pdev->dib, rect, pdev->clip, &clipped_rects );
-    }
-    else
-    {
-        free_clipped_rects( &clipped_rects );
-        get_clipped_rects( &pdev->dib, NULL, pdev->clip, &clipped_rects );
-    }
-    if (!clipped_rects.count) goto done;
+    /* only the clip rectangles covering the text are needed */
+    clip_rect = text_bounds;
+    if ((flags & ETO_CLIPPED) && !intersect_rect( &clip_rect, &clip_rect, rect )) goto done;
+    if (!get_clipped_rects( &pdev->dib, &clip_rect, pdev->clip, &clipped_rects )) goto done;
 
-    render_string( dev->hdc, &pdev->dib, pdev->font, x, y, flags, str, count, dx,
-                   &clipped_rects, &bounds );
+    add_bounds_rect( &bounds, &text_bounds );
+    draw_text_glyphs( dev->hdc, &pdev->dib, pdev->font, glyphs, glyph_count, &text_bounds,
+                      &clipped_rects, NULL );
 
 done:
     add_clipped_bounds( pdev, &bounds, pdev->clip );
     free_clipped_rects( &clipped_rects );
+    if (glyphs != buffer) HeapFree( GetProcessHeap(), 0, glyphs );
     return TRUE;
 }
 
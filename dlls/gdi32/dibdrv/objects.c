@@ -1983,6 +1983,29 @@ static BOOL select_pattern_brush( dibdrv_physdev *pdev, dib_brush *brush, BOOL *
     return TRUE;
 }
 
+struct pattern_band
+{
+    const dib_info *dib;
+    int num;
+    const RECT *rects;
+    const POINT *origin;
+    const dib_brush *brush;
+};
+
+static void pattern_band( void *context, const RECT *band, unsigned int index )
+{
+    const struct pattern_band *params = context;
+    RECT rect;
+    int i;
+
+    for (i = 0; i < params->num; i++)
+    {
+        if (!intersect_rect( &rect, &params->rects[i], band )) continue;
+        params->dib->funcs->pattern_rects( params->dib, 1, &rect, params->origin,
+                                           &params->brush->dib, &params->brush->masks );
+    }
+}
+
 /**********************************************************************
  *             pattern_brush
  *
@@ -1994,6 +2017,7 @@ static BOOL pattern_brush(dibdrv_physdev *pdev, dib_brush *brush, dib_info *dib,
 {
     POINT origin;
     BOOL needs_reselect = FALSE;
+    struct pattern_band params;
 
     if (rop != brush->rop)
     {
@@ -2030,7 +2054,12 @@ static BOOL pattern_brush(dibdrv_physdev *pdev, dib_brush *brush, dib_info *dib,
 
     GetBrushOrgEx(pdev->dev.hdc, &origin);
 
-    dib->funcs->pattern_rects( dib, num, rects, &origin, &brush->dib, &brush->masks );
+    params.dib = dib;
+    params.num = num;
+    params.rects = rects;
+    params.origin = &origin;
+    params.brush = brush;
+    run_in_bands_for_rects( rects, num, pattern_band, &params );
 
     if (needs_reselect) free_pattern_brush( brush );
     return TRUE;
@@ -20,6 +20,14 @@
 
 #include <assert.h>
 
+/* the target attribute is needed to use the intrinsics without building the whole file for sse2 */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define USE_SSE2_PRIMITIVES
+#define SSE2_FUNC __attribute__((__target__("sse2")))
+#include <emmintrin.h>
+#endif
+
 #include "gdi_private.h"
 #include "dibdrv.h"
 
@@ -4210,6 +4218,131 @@ static void blend_rect_8888(const dib_info *dst, const RECT *rc,
 		dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
 }
 
+#ifdef USE_SSE2_PRIMITIVES
+
+static inline DWORD blend_pixel_8888( DWORD dst, DWORD src, BLENDFUNCTION blend, BOOL src_alpha )
+{
+    if (blend.AlphaFormat & AC_SRC_ALPHA)
+    {
+        if (blend.SourceConstantAlpha == 255) return blend_argb( dst, src );
+        return blend_argb_alpha( dst, src, blend.SourceConstantAlpha );
+    }
+    if (src_alpha) return blend_argb_constant_alpha( dst, src, blend.SourceConstantAlpha );
+    return blend_argb_no_src_alpha( dst, src, blend.SourceConstantAlpha );
+}
+
+/* (x + 1 + (x >> 8)) >> 8 is the same as x / 255 for all x < 65280 */
+static inline SSE2_FUNC __m128i div255_epu16( __m128i x )
+{
+    return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( x, _mm_set1_epi16( 1 ) ), _mm_srli_epi16( x, 8 ) ), 8 );
+}
+
+static inline SSE2_FUNC __m128i mul_div255_epu16( __m128i x, __m128i alpha )
+{
+    return div255_epu16( _mm_add_epi16( _mm_mullo_epi16( x, alpha ), _mm_set1_epi16( 127 ) ) );
+}
+
+/* two pixels unpacked to 16-bit channels, same as blend_argb_alpha() but without packing the result */
+static inline SSE2_FUNC __m128i blend_argb_epu16( __m128i dst, __m128i src, __m128i alpha, BOOL scale )
+{
+    __m128i inv;
+
+    if (scale) src = mul_div255_epu16( src, alpha );
+    inv = _mm_shufflehi_epi16( _mm_shufflelo_epi16( src, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 3, 3, 3, 3 ) );
+    inv = _mm_sub_epi16( _mm_set1_epi16( 255 ), inv );
+    return _mm_add_epi16( src, mul_div255_epu16( dst, inv ) );
+}
+
+/* same as blend_argb_constant_alpha() */
+static inline SSE2_FUNC __m128i blend_constant_alpha_epu16( __m128i dst, __m128i src, __m128i alpha )
+{
+    __m128i inv = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+
+    return div255_epu16( _mm_add_epi16( _mm_add_epi16( _mm_mullo_epi16( src, alpha ), _mm_mullo_epi16( dst, inv ) ),
+                                        _mm_set1_epi16( 127 ) ) );
+}
+
+static SSE2_FUNC void blend_row_8888_sse2( DWORD *dst, const DWORD *src, int len, BLENDFUNCTION blend, BOOL src_alpha )
+{
+    const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16( 255 );
+    const __m128i alpha = _mm_set1_epi16( blend.SourceConstantAlpha );
+    const __m128i or_mask = _mm_set1_epi32( src_alpha ? 0 : 0xff000000 );
+    BOOL per_pixel = (blend.AlphaFormat & AC_SRC_ALPHA) != 0, scale = blend.SourceConstantAlpha != 255;
+    __m128i s, d, lo, hi;
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        if (per_pixel)
+        {
+            lo = blend_argb_epu16( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ), alpha, scale );
+            hi = blend_argb_epu16( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ), alpha, scale );
+            /* badly premultiplied sources overflow into the next channel, let the C code do that */
+            if (_mm_movemask_epi8( _mm_or_si128( _mm_cmpgt_epi16( lo, max ), _mm_cmpgt_epi16( hi, max ) ) ))
+            {
+                dst[x]     = blend_pixel_8888( dst[x],     src[x],     blend, src_alpha );
+                dst[x + 1] = blend_pixel_8888( dst[x + 1], src[x + 1], blend, src_alpha );
+                dst[x + 2] = blend_pixel_8888( dst[x + 2], src[x + 2], blend, src_alpha );
+                dst[x + 3] = blend_pixel_8888( dst[x + 3], src[x + 3], blend, src_alpha );
+                continue;
+            }
+        }
+        else
+        {
+            s = _mm_or_si128( s, or_mask );
+            lo = blend_constant_alpha_epu16( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ), alpha );
+            hi = blend_constant_alpha_epu16( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ), alpha );
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ) );
+    }
+    for (; x < len; x++) dst[x] = blend_pixel_8888( dst[x], src[x], blend, src_alpha );
+}
+
+static SSE2_FUNC void blend_rect_8888_sse2(const dib_info *dst, const RECT *rc,
+                                           const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
+{
+    DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
+    DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
+    int y;
+
+    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+        blend_row_8888_sse2( dst_ptr, src_ptr, rc->right - rc->left, blend, src->compression == BI_RGB );
+}
+
+static SSE2_FUNC void solid_rects_32_sse2(const dib_info *dib, int num, const RECT *rc, DWORD and, DWORD xor)
+{
+    const __m128i and_mask = _mm_set1_epi32( and ), xor_mask = _mm_set1_epi32( xor );
+    DWORD *ptr, *start;
+    int x, y, i;
+
+    if (!and)
+    {
+        solid_rects_32( dib, num, rc, and, xor );
+        return;
+    }
+
+    for(i = 0; i < num; i++, rc++)
+    {
+        assert( !is_rect_empty( rc ));
+
+        start = get_pixel_ptr_32(dib, rc->left, rc->top);
+        for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
+        {
+            for(x = rc->left, ptr = start; x + 4 <= rc->right; x += 4, ptr += 4)
+            {
+                __m128i val = _mm_loadu_si128( (const __m128i *)ptr );
+                _mm_storeu_si128( (__m128i *)ptr, _mm_xor_si128( _mm_and_si128( val, and_mask ), xor_mask ));
+            }
+            for(; x < rc->right; x++)
+                do_rop_32(ptr++, and, xor);
+        }
+    }
+}
+
+#endif  /* USE_SSE2_PRIMITIVES */
+
 static void blend_rect_32(const dib_info *dst, const RECT *rc,
                           const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
@@ -4961,6 +5094,49 @@ static void draw_glyph_8888( const dib_info *dib, const RECT *rect, const dib_in
     }
 }
 
+#ifdef USE_SSE2_PRIMITIVES
+/* same as draw_glyph_8888(), runs of 16 blank or fully covered glyph pixels are handled at once */
+static SSE2_FUNC void draw_glyph_8888_sse2( const dib_info *dib, const RECT *rect, const dib_info *glyph,
+                                            const POINT *origin, DWORD text_pixel,
+                                            const struct intensity_range *ranges )
+{
+    DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top );
+    const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
+    const __m128i one = _mm_set1_epi8( 1 ), fifteen = _mm_set1_epi8( 15 );
+    const __m128i text = _mm_set1_epi32( text_pixel );
+    int x, y, i, width = rect->right - rect->left;
+
+    for (y = rect->top; y < rect->bottom; y++)
+    {
+        for (x = 0; x + 16 <= width; x += 16)
+        {
+            __m128i g = _mm_loadu_si128( (const __m128i *)(glyph_ptr + x) );
+
+            if (!_mm_movemask_epi8( _mm_cmpgt_epi8( g, one ) )) continue;
+            if (_mm_movemask_epi8( _mm_cmpgt_epi8( g, fifteen ) ) == 0xffff)
+            {
+                for (i = 0; i < 16; i += 4) _mm_storeu_si128( (__m128i *)(dst_ptr + x + i), text );
+                continue;
+            }
+            for (i = x; i < x + 16; i++)
+            {
+                if (glyph_ptr[i] <= 1) continue;
+                if (glyph_ptr[i] >= 16) { dst_ptr[i] = text_pixel; continue; }
+                dst_ptr[i] = aa_rgb( dst_ptr[i] >> 16, dst_ptr[i] >> 8, dst_ptr[i], text_pixel, ranges + glyph_ptr[i] );
+            }
+        }
+        for (; x < width; x++)
+        {
+            if (glyph_ptr[x] <= 1) continue;
+            if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
+            dst_ptr[x] = aa_rgb( dst_ptr[x] >> 16, dst_ptr[x] >> 8, dst_ptr[x], text_pixel, ranges + glyph_ptr[x] );
+        }
+        dst_ptr += dib->stride / 4;
+        glyph_ptr += glyph->stride;
+    }
+}
+#endif
+
 static void draw_glyph_32( const dib_info *dib, const RECT *rect, const dib_info *glyph,
                            const POINT *origin, DWORD text_pixel, const struct intensity_range *ranges )
 {
@@ -6225,7 +6401,7 @@ static void shrink_row_null(const dib_info *dst_dib, const POINT *dst_start,
     return;
 }
 
-const primitive_funcs funcs_8888 =
+primitive_funcs funcs_8888 =
 {
     solid_rects_32,
     solid_line_32,
@@ -6245,7 +6421,7 @@ const primitive_funcs funcs_8888 =
     shrink_row_32
 };
 
-const primitive_funcs funcs_32 =
+primitive_funcs funcs_32 =
 {
     solid_rects_32,
     solid_line_32,
@@ -6404,3 +6580,17 @@ const primitive_funcs funcs_null =
     stretch_row_null,
     shrink_row_null
 };
+
+/* replace the generic 32-bpp primitives with vectorized ones if the cpu supports them */
+void init_dib_primitives(void)
+{
+#ifdef USE_SSE2_PRIMITIVES
+    if (!IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE )) return;
+
+    TRACE( "using sse2 primitives\n" );
+    funcs_8888.solid_rects = solid_rects_32_sse2;
+    funcs_8888.blend_rect  = blend_rect_8888_sse2;
+    funcs_8888.draw_glyph  = draw_glyph_8888_sse2;
+    funcs_32.solid_rects   = solid_rects_32_sse2;
+#endif
+}
@@ -36,6 +36,7 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <math.h>
 #include <string.h>
 #include <assert.h>
 #include "windef.h"
@@ -48,10 +49,31 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(enhmetafile);
 
+/* record index flags */
+#define EMF_RECORD_CULL      0x01  /* only draws around its points, can be skipped when they are not visible */
+#define EMF_RECORD_NO_PEN    0x02  /* the drawing doesn't depend on the pen width */
+#define EMF_RECORD_POLYLINE  0x04  /* can be drawn with the neighbouring polylines in one call */
+
+struct emf_record
+{
+    DWORD offset;   /* offset of the record in the metafile */
+    DWORD flags;
+    DWORD polys;    /* number of polylines for EMF_RECORD_POLYLINE */
+    DWORD points;   /* number of points for EMF_RECORD_POLYLINE */
+    RECTL bounds;   /* logical bounds of the points for EMF_RECORD_CULL */
+};
+
+struct emf_index
+{
+    DWORD count;
+    struct emf_record records[1];
+};
+
 typedef struct
 {
-    ENHMETAHEADER  *emh;
-    BOOL           on_disk;   /* true if metafile is on disk */
+    ENHMETAHEADER    *emh;
+    BOOL             on_disk;   /* true if metafile is on disk */
+    struct emf_index *index;    /* record index used by PlayEnhMetaFile, built on first use */
 } ENHMETAFILEOBJ;
 
 static const struct emr_name {
@@ -268,6 +290,7 @@ HENHMETAFILE EMF_Create_HENHMETAFILE(ENHMETAHEADER *emh, BOOL on_disk )
 
     metaObj->emh = emh;
     metaObj->on_disk = on_disk;
+    metaObj->index = NULL;
 
     if (!(hmf = alloc_gdi_handle( metaObj, OBJ_ENHMETAFILE, NULL )))
         HeapFree( GetProcessHeap(), 0, metaObj );
@@ -283,6 +306,7 @@ static BOOL EMF_Delete_HENHMETAFILE( HENHMETAFILE hmf )
 
     if(!metaObj) return FALSE;
 
+    HeapFree( GetProcessHeap(), 0, metaObj->index );
     if(metaObj->on_disk)
         UnmapViewOfFile( metaObj->emh );
     else
@@ -517,6 +541,8 @@ typedef struct enum_emh_data
     EMF_dc_state state;
     INT save_level;
     EMF_dc_state *saved_state;
+    XFORM transform;     /* world transform last set on the DC */
+    BOOL transform_set;  /* the DC uses transform */
 } enum_emh_data;
 
 #define ENUM_GET_PRIVATE_DATA(ht) \
@@ -527,9 +553,9 @@ typedef struct enum_emh_data
 
 #define IS_WIN9X() (GetVersion()&0x80000000)
 
-static void EMF_Update_MF_Xform(HDC hdc, const enum_emh_data *info)
+static void EMF_Update_MF_Xform(HDC hdc, enum_emh_data *info)
 {
-    XFORM mapping_mode_trans, final_trans;
+    XFORM mapping_mode_trans, final_trans, current;
     double scaleX, scaleY;
 
     scaleX = (double)info->state.vportExtX / (double)info->state.wndExtX;
@@ -543,11 +569,20 @@ static void EMF_Update_MF_Xform(HDC hdc, const enum_emh_data *info)
 
     CombineTransform(&final_trans, &info->state.world_transform, &mapping_mode_trans);
     CombineTransform(&final_trans, &final_trans, &info->init_transform);
- 
-    if (!SetWorldTransform(hdc, &final_trans))
+
+    /* most records don't change the transform, don't make the DC update its mappings */
+    if (GetWorldTransform(hdc, &current) && !memcmp(&current, &final_trans, sizeof(current)))
+    {
+        info->transform = final_trans;
+        info->transform_set = TRUE;
+        return;
+    }
+
+    if (!(info->transform_set = SetWorldTransform(hdc, &final_trans)))
     {
         ERR("World transform failed!\n");
     }
+    info->transform = final_trans;
 }
 
 static void EMF_RestoreDC( enum_emh_data *info, INT level )
@@ -2199,16 +2234,488 @@ BOOL WINAPI PlayEnhMetaFileRecord(
       FIXME("type %d is unimplemented\n", type);
       break;
     }
-  tmprc.left = tmprc.top = 0;
-  tmprc.right = tmprc.bottom = 1000;
-  LPtoDP(hdc, (POINT*)&tmprc, 2);
-  TRACE("L:0,0 - 1000,1000 -> D:%d,%d - %d,%d\n", tmprc.left,
-	tmprc.top, tmprc.right, tmprc.bottom);
+  if (TRACE_ON(enhmetafile))
+  {
+      tmprc.left = tmprc.top = 0;
+      tmprc.right = tmprc.bottom = 1000;
+      LPtoDP(hdc, (POINT*)&tmprc, 2);
+      TRACE("L:0,0 - 1000,1000 -> D:%d,%d - %d,%d\n", tmprc.left,
+            tmprc.top, tmprc.right, tmprc.bottom);
+  }
 
   return TRUE;
 }
 
 
+static void get_points_bounds( RECTL *bounds, const POINTL *pts, DWORD count )
+{
+    DWORD i;
+
+    bounds->left = bounds->right = pts[0].x;
+    bounds->top = bounds->bottom = pts[0].y;
+    for (i = 1; i < count; i++)
+    {
+        bounds->left   = min( bounds->left, pts[i].x );
+        bounds->right  = max( bounds->right, pts[i].x );
+        bounds->top    = min( bounds->top, pts[i].y );
+        bounds->bottom = max( bounds->bottom, pts[i].y );
+    }
+}
+
+static void get_points16_bounds( RECTL *bounds, const POINTS *pts, DWORD count )
+{
+    DWORD i;
+
+    bounds->left = bounds->right = pts[0].x;
+    bounds->top = bounds->bottom = pts[0].y;
+    for (i = 1; i < count; i++)
+    {
+        bounds->left   = min( bounds->left, pts[i].x );
+        bounds->right  = max( bounds->right, pts[i].x );
+        bounds->top    = min( bounds->top, pts[i].y );
+        bounds->bottom = max( bounds->bottom, pts[i].y );
+    }
+}
+
+static void get_dest_bounds( RECTL *bounds, LONG x, LONG y, LONG cx, LONG cy )
+{
+    bounds->left   = min( x, x + cx );
+    bounds->right  = max( x, x + cx );
+    bounds->top    = min( y, y + cy );
+    bounds->bottom = max( y, y + cy );
+}
+
+/* fill the index entry for polyline and polygon records, the points are checked
+ * against the record size since they are read without any further check */
+static void get_poly_record_info( const ENHMETARECORD *emr, struct emf_record *rec )
+{
+    const EMRPOLYLINE *poly = (const EMRPOLYLINE *)emr;
+    const EMRPOLYPOLYLINE *polypoly = (const EMRPOLYPOLYLINE *)emr;
+    BOOL small = FALSE;
+    DWORD i, total;
+
+    switch (emr->iType)
+    {
+    case EMR_POLYBEZIER16:
+    case EMR_POLYGON16:
+    case EMR_POLYLINE16:
+        small = TRUE;
+        /* fall through */
+    case EMR_POLYBEZIER:
+    case EMR_POLYGON:
+    case EMR_POLYLINE:
+        if (emr->nSize < FIELD_OFFSET( EMRPOLYLINE, aptl ) || !poly->cptl ||
+            poly->cptl > (emr->nSize - FIELD_OFFSET( EMRPOLYLINE, aptl )) / (small ? sizeof(POINTS) : sizeof(POINTL)))
+            return;
+        if (small) get_points16_bounds( &rec->bounds, ((const EMRPOLYLINE16 *)emr)->apts, poly->cptl );
+        else get_points_bounds( &rec->bounds, poly->aptl, poly->cptl );
+        rec->flags = EMF_RECORD_CULL;
+        if ((emr->iType == EMR_POLYLINE || emr->iType == EMR_POLYLINE16) && poly->cptl >= 2)
+        {
+            rec->flags |= EMF_RECORD_POLYLINE;
+            rec->polys = 1;
+            rec->points = poly->cptl;
+        }
+        return;
+
+    case EMR_POLYPOLYGON16:
+    case EMR_POLYPOLYLINE16:
+        small = TRUE;
+        /* fall through */
+    case EMR_POLYPOLYGON:
+    case EMR_POLYPOLYLINE:
+        if (emr->nSize < FIELD_OFFSET( EMRPOLYPOLYLINE, aPolyCounts ) || !polypoly->nPolys || !polypoly->cptl ||
+            polypoly->nPolys > (emr->nSize - FIELD_OFFSET( EMRPOLYPOLYLINE, aPolyCounts )) / sizeof(DWORD) ||
+            polypoly->cptl > (emr->nSize - FIELD_OFFSET( EMRPOLYPOLYLINE, aPolyCounts ) - polypoly->nPolys * sizeof(DWORD)) /
+                             (small ? sizeof(POINTS) : sizeof(POINTL)))
+            return;
+        for (i = total = 0; i < polypoly->nPolys; i++)
+        {
+            if (polypoly->aPolyCounts[i] > polypoly->cptl - total) return;
+            total += polypoly->aPolyCounts[i];
+        }
+        if (small) get_points16_bounds( &rec->bounds, (const POINTS *)(polypoly->aPolyCounts + polypoly->nPolys),
+                                        polypoly->cptl );
+        else get_points_bounds( &rec->bounds, (const POINTL *)(polypoly->aPolyCounts + polypoly->nPolys),
+                                polypoly->cptl );
+        rec->flags = EMF_RECORD_CULL;
+        if (emr->iType == EMR_POLYPOLYLINE || emr->iType == EMR_POLYPOLYLINE16)
+        {
+            for (i = 0; i < polypoly->nPolys; i++) if (polypoly->aPolyCounts[i] < 2) return;
+            rec->flags |= EMF_RECORD_POLYLINE;
+            rec->polys = polypoly->nPolys;
+            rec->points = total;
+        }
+        return;
+    }
+}
+
+static void get_record_info( const ENHMETARECORD *emr, struct emf_record *rec )
+{
+    switch (emr->iType)
+    {
+    case EMR_POLYBEZIER:
+    case EMR_POLYGON:
+    case EMR_POLYLINE:
+    case EMR_POLYPOLYLINE:
+    case EMR_POLYPOLYGON:
+    case EMR_POLYBEZIER16:
+    case EMR_POLYGON16:
+    case EMR_POLYLINE16:
+    case EMR_POLYPOLYLINE16:
+    case EMR_POLYPOLYGON16:
+        get_poly_record_info( emr, rec );
+        break;
+    case EMR_BITBLT:
+    {
+        const EMRBITBLT *blt = (const EMRBITBLT *)emr;
+        if (emr->nSize < FIELD_OFFSET( EMRBITBLT, xformSrc )) break;
+        get_dest_bounds( &rec->bounds, blt->xDest, blt->yDest, blt->cxDest, blt->cyDest );
+        rec->flags = EMF_RECORD_CULL | EMF_RECORD_NO_PEN;
+        break;
+    }
+    case EMR_STRETCHBLT:
+    {
+        const EMRSTRETCHBLT *blt = (const EMRSTRETCHBLT *)emr;
+        if (emr->nSize < FIELD_OFFSET( EMRSTRETCHBLT, xformSrc )) break;
+        get_dest_bounds( &rec->bounds, blt->xDest, blt->yDest, blt->cxDest, blt->cyDest );
+        rec->flags = EMF_RECORD_CULL | EMF_RECORD_NO_PEN;
+        break;
+    }
+    case EMR_ALPHABLEND:
+    {
+        const EMRALPHABLEND *blt = (const EMRALPHABLEND *)emr;
+        if (emr->nSize < FIELD_OFFSET( EMRALPHABLEND, xformSrc )) break;
+        get_dest_bounds( &rec->bounds, blt->xDest, blt->yDest, blt->cxDest, blt->cyDest );
+        rec->flags = EMF_RECORD_CULL | EMF_RECORD_NO_PEN;
+        break;
+    }
+    case EMR_STRETCHDIBITS:
+    {
+        const EMRSTRETCHDIBITS *blt = (const EMRSTRETCHDIBITS *)emr;
+        if (emr->nSize < sizeof(*blt)) break;
+        get_dest_bounds( &rec->bounds, blt->xDest, blt->yDest, blt->cxDest, blt->cyDest );
+        rec->flags = EMF_RECORD_CULL | EMF_RECORD_NO_PEN;
+        break;
+    }
+    }
+}
+
+/*****************************************************************************
+ *         EMF_BuildRecordIndex
+ *
+ * Walk the metafile once and record the offset of each record, along with the
+ * logical bounds of the drawing records that can be skipped during playback.
+ * Returns NULL if the records don't cover the metafile exactly.
+ */
+static struct emf_index *EMF_BuildRecordIndex( const ENHMETAHEADER *emh )
+{
+    const ENHMETARECORD *emr;
+    struct emf_index *index;
+    struct emf_record *rec;
+    DWORD offset, count = 0;
+    BOOL in_path = FALSE, path_used = FALSE;
+
+    for (offset = 0; offset < emh->nBytes; offset += emr->nSize, count++)
+    {
+        emr = (const ENHMETARECORD *)((const char *)emh + offset);
+        if (emh->nBytes - offset < sizeof(*emr) || emr->nSize < sizeof(*emr) || (emr->nSize & 3) ||
+            emr->nSize > emh->nBytes - offset)
+            return NULL;
+    }
+
+    if (!(index = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct emf_index, records[count] ))))
+        return NULL;
+
+    index->count = count;
+    for (offset = 0, rec = index->records; offset < emh->nBytes; offset += emr->nSize, rec++)
+    {
+        emr = (const ENHMETARECORD *)((const char *)emh + offset);
+        rec->offset = offset;
+        rec->flags = 0;
+
+        switch (emr->iType)
+        {
+        case EMR_BEGINPATH:
+            in_path = path_used = TRUE;
+            break;
+        case EMR_ENDPATH:
+        case EMR_ABORTPATH:
+            in_path = FALSE;
+            break;
+        case EMR_RESTOREDC:
+            /* the restored state may have an open path */
+            if (path_used) in_path = TRUE;
+            break;
+        default:
+            /* records in a path bracket only add to the path */
+            if (!in_path) get_record_info( emr, rec );
+            break;
+        }
+    }
+    TRACE( "%u records\n", count );
+    return index;
+}
+
+/******************************************************************
+ *         EMF_GetRecordIndex
+ */
+static const struct emf_index *EMF_GetRecordIndex( HENHMETAFILE hmf )
+{
+    ENHMETAFILEOBJ *metaObj;
+    struct emf_index *index;
+    const ENHMETAHEADER *emh;
+
+    if (!(metaObj = GDI_GetObjPtr( hmf, OBJ_ENHMETAFILE ))) return NULL;
+    index = metaObj->index;
+    emh = metaObj->emh;
+    GDI_ReleaseObj( hmf );
+    if (index) return index;
+
+    if (!(index = EMF_BuildRecordIndex( emh ))) return NULL;
+
+    if (!(metaObj = GDI_GetObjPtr( hmf, OBJ_ENHMETAFILE )))
+    {
+        HeapFree( GetProcessHeap(), 0, index );
+        return NULL;
+    }
+    /* another thread may have built it in the meantime */
+    if (metaObj->index) HeapFree( GetProcessHeap(), 0, index );
+    else metaObj->index = index;
+    index = metaObj->index;
+    GDI_ReleaseObj( hmf );
+    return index;
+}
+
+struct emf_playback
+{
+    const struct emf_index *index;
+    BOOL   cull;        /* records outside of clip can be skipped */
+    RECT   clip;        /* visible part of the device, in device coordinates */
+    BOOL   pen_valid;
+    double pen_width;   /* largest extent of the pen outside of the points, in logical units */
+    BOOL   path_valid;
+    BOOL   path;        /* the DC has a path, records must be played as they are */
+};
+
+/* get the part of the device that the DC can draw to, records outside of it don't
+ * need to be played */
+static BOOL get_playback_clip( HDC hdc, RECT *rect )
+{
+    DC *dc;
+    BOOL ret = FALSE;
+
+    if (!(dc = get_dc_ptr( hdc ))) return FALSE;
+    update_dc( dc );
+    if (!(dc->layout & LAYOUT_RTL))
+    {
+        if (dc->hVisRgn) ret = GetRgnBox( dc->hVisRgn, rect ) != ERROR;
+        else
+        {
+            *rect = dc->device_rect;
+            offset_rect( rect, -dc->vis_rect.left, -dc->vis_rect.top );
+            ret = !is_rect_empty( rect );
+        }
+    }
+    release_dc_ptr( dc );
+    return ret;
+}
+
+/* drawing records are added to an open path whether they are visible or not,
+ * and a closed path may still be drawn from */
+static void update_path( HDC hdc, struct emf_playback *play )
+{
+    DC *dc;
+
+    play->path = FALSE;
+    if ((dc = get_dc_ptr( hdc )))
+    {
+        play->path = dc->path || find_dc_driver( dc, &path_driver );
+        release_dc_ptr( dc );
+    }
+    play->path_valid = TRUE;
+}
+
+static void update_pen_width( HDC hdc, struct emf_playback *play )
+{
+    HPEN pen = GetCurrentObject( hdc, OBJ_PEN );
+    EXTLOGPEN *elp;
+    LOGPEN lp;
+    FLOAT miter = 1.0;
+    INT size;
+
+    play->pen_width = 0;
+    switch (GetObjectType( pen ))
+    {
+    case OBJ_PEN:
+        if (GetObjectW( pen, sizeof(lp), &lp ) && (lp.lopnStyle & PS_STYLE_MASK) != PS_NULL)
+            play->pen_width = abs( lp.lopnWidth.x );
+        break;
+    case OBJ_EXTPEN:
+        if (!(size = GetObjectW( pen, 0, NULL )) || !(elp = HeapAlloc( GetProcessHeap(), 0, size )))
+        {
+            play->cull = FALSE;
+            break;
+        }
+        if (GetObjectW( pen, size, elp ) && (elp->elpPenStyle & PS_TYPE_MASK) == PS_GEOMETRIC)
+            play->pen_width = elp->elpWidth;
+        HeapFree( GetProcessHeap(), 0, elp );
+        break;
+    }
+    /* miter joins can extend up to the miter limit times the width */
+    GetMiterLimit( hdc, &miter );
+    play->pen_width *= max( miter, 1.0 );
+    play->pen_valid = TRUE;
+}
+
+static BOOL is_record_visible( HDC hdc, const enum_emh_data *info, struct emf_playback *play,
+                               const struct emf_record *rec )
+{
+    const XFORM *xform = &info->transform;
+    double px, py, x, y, left = 0, top = 0, right = 0, bottom = 0, margin = 2.0;
+    int i;
+
+    if (!play->cull || !info->transform_set) return TRUE;
+
+    /* transform the corners of the bounds to device coordinates */
+    for (i = 0; i < 4; i++)
+    {
+        px = (i & 1) ? rec->bounds.right : rec->bounds.left;
+        py = (i & 2) ? rec->bounds.bottom : rec->bounds.top;
+        x = px * xform->eM11 + py * xform->eM21 + xform->eDx;
+        y = px * xform->eM12 + py * xform->eM22 + xform->eDy;
+        if (!i)
+        {
+            left = right = x;
+            top = bottom = y;
+            continue;
+        }
+        left = min( left, x );
+        right = max( right, x );
+        top = min( top, y );
+        bottom = max( bottom, y );
+    }
+
+    if (!(rec->flags & EMF_RECORD_NO_PEN))
+    {
+        if (!play->pen_valid) update_pen_width( hdc, play );
+        if (!play->cull) return TRUE;
+        margin += play->pen_width * sqrt( xform->eM11 * xform->eM11 + xform->eM12 * xform->eM12 +
+                                          xform->eM21 * xform->eM21 + xform->eM22 * xform->eM22 );
+    }
+
+    return right + margin >= play->clip.left && left - margin < play->clip.right &&
+           bottom + margin >= play->clip.top && top - margin < play->clip.bottom;
+}
+
+/* draw a run of polyline records with a single PolyPolyline call,
+ * returns the number of records that have been played */
+static UINT play_polyline_run( HDC hdc, const ENHMETAHEADER *emh, const enum_emh_data *info,
+                               struct emf_playback *play, UINT start )
+{
+    const struct emf_index *index = play->index;
+    const ENHMETARECORD *emr;
+    DWORD polys = 0, points = 0, *counts, i, j;
+    POINT *pts;
+    UINT end;
+
+    for (end = start; end < index->count && (index->records[end].flags & EMF_RECORD_POLYLINE); end++)
+    {
+        polys += index->records[end].polys;
+        points += index->records[end].points;
+    }
+
+    counts = HeapAlloc( GetProcessHeap(), 0, polys * sizeof(*counts) );
+    pts = HeapAlloc( GetProcessHeap(), 0, points * sizeof(*pts) );
+    if (!counts || !pts)
+    {
+        HeapFree( GetProcessHeap(), 0, counts );
+        HeapFree( GetProcessHeap(), 0, pts );
+        return 0;
+    }
+
+    polys = points = 0;
+    for (i = start; i < end; i++)
+    {
+        const struct emf_record *rec = &index->records[i];
+        const DWORD *rec_counts;
+        const POINTL *ptl = NULL;
+        const POINTS *pts16 = NULL;
+
+        if (!is_record_visible( hdc, info, play, rec )) continue;
+
+        emr = (const ENHMETARECORD *)((const char *)emh + rec->offset);
+        switch (emr->iType)
+        {
+        case EMR_POLYLINE:
+            rec_counts = &((const EMRPOLYLINE *)emr)->cptl;
+            ptl = ((const EMRPOLYLINE *)emr)->aptl;
+            break;
+        case EMR_POLYLINE16:
+            rec_counts = &((const EMRPOLYLINE16 *)emr)->cpts;
+            pts16 = ((const EMRPOLYLINE16 *)emr)->apts;
+            break;
+        case EMR_POLYPOLYLINE:
+            rec_counts = ((const EMRPOLYPOLYLINE *)emr)->aPolyCounts;
+            ptl = (const POINTL *)(rec_counts + rec->polys);
+            break;
+        default: /* EMR_POLYPOLYLINE16 */
+            rec_counts = ((const EMRPOLYPOLYLINE16 *)emr)->aPolyCounts;
+            pts16 = (const POINTS *)(rec_counts + rec->polys);
+            break;
+        }
+
+        memcpy( counts + polys, rec_counts, rec->polys * sizeof(*counts) );
+        if (ptl) memcpy( pts + points, ptl, rec->points * sizeof(*pts) );
+        else for (j = 0; j < rec->points; j++)
+        {
+            pts[points + j].x = pts16[j].x;
+            pts[points + j].y = pts16[j].y;
+        }
+        polys += rec->polys;
+        points += rec->points;
+    }
+
+    TRACE( "drawing %u polylines from %u records\n", polys, end - start );
+    if (polys) PolyPolyline( hdc, pts, counts, polys );
+    HeapFree( GetProcessHeap(), 0, counts );
+    HeapFree( GetProcessHeap(), 0, pts );
+    return end - start;
+}
+
+/* play the records that can be handled without calling PlayEnhMetaFileRecord,
+ * returns the number of records that have been played */
+static UINT play_indexed_records( HDC hdc, const ENHMETAHEADER *emh, const enum_emh_data *info,
+                                  struct emf_playback *play, UINT record )
+{
+    const struct emf_record *rec = &play->index->records[record];
+
+    if (!(rec->flags & EMF_RECORD_CULL))
+    {
+        /* it may select another pen or begin or end a path */
+        play->pen_valid = FALSE;
+        play->path_valid = FALSE;
+        return 0;
+    }
+
+    if (!play->path_valid) update_path( hdc, play );
+    if (play->path) return 0;
+
+    /* separate calls and a single one only draw the same pixels for a plain copy */
+    if ((rec->flags & EMF_RECORD_POLYLINE) && record + 1 < play->index->count &&
+        (rec[1].flags & EMF_RECORD_POLYLINE) && GetROP2( hdc ) == R2_COPYPEN)
+        return play_polyline_run( hdc, emh, info, play, record );
+
+    return is_record_visible( hdc, info, play, rec ) ? 0 : 1;
+}
+
+static INT CALLBACK EMF_PlayEnhMetaFileCallback(HDC hdc, HANDLETABLE *ht,
+						const ENHMETARECORD *emr,
+						INT handles, LPARAM data)
+{
+    return PlayEnhMetaFileRecord(hdc, ht, emr, handles);
+}
+
 /*****************************************************************************
  *
  *        EnumEnhMetaFile  (GDI32.@)
@@ -2229,6 +2736,9 @@ BOOL WINAPI PlayEnhMetaFileRecord(
  * NOTES
  *   This function behaves differently in Win9x and WinNT.
  *
+ *   When called from PlayEnhMetaFile, the drawing records that fall outside
+ *    of the device are skipped and runs of polylines are drawn at once.
+ *
  *   In WinNT, the DC's world transform is updated as the EMF changes
  *    the Window/Viewport Extent and Origin or its world transform.
  *    The actual Window/Viewport Extent and Origin are left untouched.
@@ -2268,6 +2778,8 @@ BOOL WINAPI EnumEnhMetaFile(
     POINT vp_org, win_org;
     INT mapMode = MM_TEXT, old_align = 0, old_rop2 = 0, old_arcdir = 0, old_polyfill = 0, old_stretchblt = 0;
     COLORREF old_text_color = 0, old_bk_color = 0;
+    struct emf_playback play;
+    UINT record, count;
 
     if(!lpRect && hdc)
     {
@@ -2304,6 +2816,17 @@ BOOL WINAPI EnumEnhMetaFile(
     info->state.next = NULL;
     info->save_level = 0;
     info->saved_state = NULL;
+    info->transform_set = FALSE;
+
+    /* PlayEnhMetaFile knows what the records do, and can skip or combine them,
+     * except when recording where the records have to be kept as they are */
+    play.index = NULL;
+    play.cull = FALSE;
+    play.pen_valid = FALSE;
+    play.path_valid = FALSE;
+    if (hdc && callback == EMF_PlayEnhMetaFileCallback && !IS_WIN9X() && !GdiIsMetaFileDC( hdc ) &&
+        (play.index = EMF_GetRecordIndex( hmf )))
+        play.cull = get_playback_clip( hdc, &play.clip );
 
     ht = (HANDLETABLE*) &info[1];
     ht->objectHandle[0] = hmf;
@@ -2406,10 +2929,18 @@ BOOL WINAPI EnumEnhMetaFile(
 
     ret = TRUE;
     offset = 0;
+    record = 0;
     while(ret && offset < emh->nBytes)
     {
 	emr = (ENHMETARECORD *)((char *)emh + offset);
 
+        if (play.index && (count = play_indexed_records( hdc, emh, info, &play, record )))
+        {
+            record += count;
+            offset = record < play.index->count ? play.index->records[record].offset : emh->nBytes;
+            continue;
+        }
+
         /* In Win9x mode we update the xform if the record will produce output */
         if (hdc && IS_WIN9X() && emr_produces_output(emr->iType))
             EMF_Update_MF_Xform(hdc, info);
@@ -2417,6 +2948,7 @@ BOOL WINAPI EnumEnhMetaFile(
 	TRACE("Calling EnumFunc with record %s, size %d\n", get_emr_name(emr->iType), emr->nSize);
 	ret = (*callback)(hdc, ht, emr, emh->nHandles, (LPARAM)data);
 	offset += emr->nSize;
+        record++;
 
         /* WinNT - update the transform (win9x updates when the next graphics
            output record is played). */
@@ -2465,13 +2997,6 @@ BOOL WINAPI EnumEnhMetaFile(
     return ret;
 }
 
-static INT CALLBACK EMF_PlayEnhMetaFileCallback(HDC hdc, HANDLETABLE *ht,
-						const ENHMETARECORD *emr,
-						INT handles, LPARAM data)
-{
-    return PlayEnhMetaFileRecord(hdc, ht, emr, handles);
-}
-
 /**************************************************************************
  *    PlayEnhMetaFile  (GDI32.@)
  *
@@ -369,12 +369,6 @@ typedef struct {
     GdiFont *font;
 } CHILD_FONT;
 
-struct font_fileinfo {
-    FILETIME writetime;
-    LARGE_INTEGER size;
-    WCHAR path[1];
-};
-
 struct tagGdiFont {
     struct list entry;
     struct list unused_entry;
@@ -548,20 +542,7 @@ typedef struct tagFontSubst {
 static const WCHAR wine_fonts_key[] = {'S','o','f','t','w','a','r','e','\\','W','i','n','e','\\',
                                        'F','o','n','t','s',0};
 static const WCHAR wine_fonts_cache_key[] = {'C','a','c','h','e',0};
-static const WCHAR english_name_value[] = {'E','n','g','l','i','s','h',' ','N','a','m','e',0};
-static const WCHAR face_index_value[] = {'I','n','d','e','x',0};
-static const WCHAR face_ntmflags_value[] = {'N','t','m','f','l','a','g','s',0};
-static const WCHAR face_version_value[] = {'V','e','r','s','i','o','n',0};
-static const WCHAR face_height_value[] = {'H','e','i','g','h','t',0};
-static const WCHAR face_width_value[] = {'W','i','d','t','h',0};
-static const WCHAR face_size_value[] = {'S','i','z','e',0};
-static const WCHAR face_x_ppem_value[] = {'X','p','p','e','m',0};
-static const WCHAR face_y_ppem_value[] = {'Y','p','p','e','m',0};
-static const WCHAR face_flags_value[] = {'F','l','a','g','s',0};
-static const WCHAR face_internal_leading_value[] = {'I','n','t','e','r','n','a','l',' ','L','e','a','d','i','n','g',0};
-static const WCHAR face_font_sig_value[] = {'F','o','n','t',' ','S','i','g','n','a','t','u','r','e',0};
-static const WCHAR face_file_name_value[] = {'F','i','l','e',' ','N','a','m','e','\0'};
-static const WCHAR face_full_name_value[] = {'F','u','l','l',' ','N','a','m','e','\0'};
+static const WCHAR font_index_stamp_value[] = {'I','n','d','e','x',' ','S','t','a','m','p',0};
 
 
 struct font_mapping
@@ -1475,9 +1456,9 @@ static void release_face( Face *face )
     if (--face->refcount) return;
     if (face->family)
     {
-        if (face->flags & ADDFONT_ADD_TO_CACHE) remove_face_from_cache( face );
         list_remove( &face->entry );
         release_family( face->family );
+        if (face->flags & ADDFONT_ADD_TO_CACHE) remove_face_from_cache( face );
     }
     HeapFree( GetProcessHeap(), 0, face->file );
     HeapFree( GetProcessHeap(), 0, face->StyleName );
@@ -1587,102 +1568,188 @@ static LONG reg_load_dword(HKEY hkey, const WCHAR *value, DWORD *data)
     return ERROR_SUCCESS;
 }
 
-static inline LONG reg_load_ftlong(HKEY hkey, const WCHAR *value, FT_Long *data)
+/* The font list is kept in a binary index file in the config dir, which every process maps
+ * instead of enumerating registry keys. The volatile Cache key only holds the stamp of the
+ * index built for the current session. All offsets are from the start of the file and
+ * strings are nul-terminated. */
+#define FONT_INDEX_MAGIC    0x58444946  /* "FIDX" */
+#define FONT_INDEX_VERSION  2
+
+struct font_index_header
+{
+    DWORD     magic;
+    DWORD     version;
+    ULONGLONG stamp;            /* value stored in the Cache key */
+    DWORD     size;             /* size of the whole file */
+    DWORD     dir_count;
+    DWORD     dirs;             /* array of struct font_index_dir */
+    DWORD     family_count;
+    DWORD     families;         /* array of struct font_index_family */
+    DWORD     font_path;        /* HKCU\Software\Wine\Fonts\Path (WCHAR) */
+    FILETIME  fonts_key_time;   /* last write time of the system Fonts key */
+};
+
+struct font_index_dir
 {
-    DWORD dw;
-    LONG ret = reg_load_dword(hkey, value, &dw);
-    *data = dw;
-    return ret;
-}
+    ULONGLONG mtime;
+    DWORD     name;             /* unix name */
+    DWORD     reserved;
+};
 
-static inline LONG reg_load_ftshort(HKEY hkey, const WCHAR *value, FT_Short *data)
+struct font_index_family
 {
-    DWORD dw;
-    LONG ret = reg_load_dword(hkey, value, &dw);
-    *data = dw;
-    return ret;
+    DWORD     name;             /* WCHAR */
+    DWORD     english_name;     /* WCHAR, optional */
+    DWORD     face_count;
+    DWORD     faces;            /* array of struct font_index_face */
+};
+
+struct font_index_face
+{
+    DWORD         style_name;   /* WCHAR */
+    DWORD         full_name;    /* WCHAR, optional */
+    DWORD         file;         /* WCHAR */
+    LONG          face_index;
+    FONTSIGNATURE fs;
+    DWORD         ntm_flags;
+    LONG          font_version;
+    DWORD         flags;
+    DWORD         scalable;
+    SHORT         height;
+    SHORT         width;
+    LONG          size;
+    LONG          x_ppem;
+    LONG          y_ppem;
+    LONG          internal_leading;
+    ULONGLONG     file_size;    /* size and mtime of the font file when it was indexed */
+    ULONGLONG     file_mtime;
+};
+
+static const char font_index_name[] = "/fontindex";
+
+/* directories scanned while building the font list, the index is rebuilt when they change */
+struct font_dir
+{
+    struct list entry;
+    char       *name;
+    ULONGLONG   mtime;
+};
+
+static struct list font_dirs = LIST_INIT( font_dirs );
+static int font_index_batch;        /* nesting level of font list updates, the index is written at the end */
+static BOOL font_index_dirty;       /* the cached faces have changed since the index was written */
+
+static const WCHAR *font_index_strW( const BYTE *data, DWORD offset )
+{
+    return offset ? (const WCHAR *)(data + offset) : NULL;
 }
 
-static inline LONG reg_save_dword(HKEY hkey, const WCHAR *value, DWORD data)
+/* check that an array of the index lies within the file */
+static BOOL font_index_check_array( DWORD size, DWORD offset, DWORD count, DWORD elem_size )
 {
-    return RegSetValueExW(hkey, value, 0, REG_DWORD, (BYTE*)&data, sizeof(DWORD));
+    if (offset < sizeof(struct font_index_header) || offset > size || (offset & 7)) return FALSE;
+    return count <= (size - offset) / elem_size;
 }
 
-static void load_face(HKEY hkey_face, WCHAR *face_name, Family *family, void *buffer, DWORD buffer_size)
+/* check that a string of the index is nul-terminated within the file */
+static BOOL font_index_check_str( const BYTE *data, DWORD size, DWORD offset, DWORD char_size, BOOL optional )
 {
-    DWORD needed, strike_index = 0;
-    HKEY hkey_strike;
+    DWORD i;
 
-    /* If we have a File Name key then this is a real font, not just the parent
-       key of a bunch of non-scalable strikes */
-    needed = buffer_size;
-    if (RegQueryValueExW(hkey_face, face_file_name_value, NULL, NULL, buffer, &needed) == ERROR_SUCCESS)
+    if (!offset) return optional;
+    if (offset < sizeof(struct font_index_header) || offset >= size || (offset & (char_size - 1))) return FALSE;
+    for (i = offset; i + char_size <= size; i += char_size)
     {
-        Face *face;
-        face = HeapAlloc(GetProcessHeap(), 0, sizeof(*face));
-        face->cached_enum_data = NULL;
-        face->family = NULL;
-
-        face->refcount = 1;
-        face->file = strdupW( buffer );
-        face->StyleName = strdupW(face_name);
+        if (char_size == sizeof(WCHAR) ? !*(const WCHAR *)(data + i) : !data[i]) return TRUE;
+    }
+    return FALSE;
+}
 
-        needed = buffer_size;
-        if(RegQueryValueExW(hkey_face, face_full_name_value, NULL, NULL, buffer, &needed) == ERROR_SUCCESS)
-            face->FullName = strdupW( buffer );
-        else
-            face->FullName = NULL;
+/* check every offset of a mapped index against its size before using it */
+static BOOL font_index_valid( const BYTE *data, DWORD size )
+{
+    const struct font_index_header *header = (const struct font_index_header *)data;
+    const struct font_index_dir *dirs;
+    const struct font_index_family *families;
+    const struct font_index_face *faces;
+    DWORD i, j;
 
-        reg_load_ftlong(hkey_face, face_index_value, &face->face_index);
-        reg_load_dword(hkey_face, face_ntmflags_value, &face->ntmFlags);
-        reg_load_ftlong(hkey_face, face_version_value, &face->font_version);
-        reg_load_dword(hkey_face, face_flags_value, &face->flags);
+    if (header->magic != FONT_INDEX_MAGIC || header->version != FONT_INDEX_VERSION ||
+        header->size != size)
+        return FALSE;
+    if (!font_index_check_str( data, size, header->font_path, sizeof(WCHAR), TRUE )) return FALSE;
 
-        needed = sizeof(face->fs);
-        RegQueryValueExW(hkey_face, face_font_sig_value, NULL, NULL, (BYTE*)&face->fs, &needed);
+    if (header->dir_count && !font_index_check_array( size, header->dirs, header->dir_count, sizeof(*dirs) ))
+        return FALSE;
+    dirs = (const struct font_index_dir *)(data + header->dirs);
+    for (i = 0; i < header->dir_count; i++)
+        if (!font_index_check_str( data, size, dirs[i].name, 1, FALSE )) return FALSE;
 
-        if(reg_load_ftshort(hkey_face, face_height_value, &face->size.height) != ERROR_SUCCESS)
-        {
-            face->scalable = TRUE;
-            memset(&face->size, 0, sizeof(face->size));
-        }
-        else
+    if (header->family_count &&
+        !font_index_check_array( size, header->families, header->family_count, sizeof(*families) ))
+        return FALSE;
+    families = (const struct font_index_family *)(data + header->families);
+    for (i = 0; i < header->family_count; i++)
+    {
+        if (!font_index_check_str( data, size, families[i].name, sizeof(WCHAR), FALSE ) ||
+            !font_index_check_str( data, size, families[i].english_name, sizeof(WCHAR), TRUE ))
+            return FALSE;
+        if (families[i].face_count &&
+            !font_index_check_array( size, families[i].faces, families[i].face_count, sizeof(*faces) ))
+            return FALSE;
+        faces = (const struct font_index_face *)(data + families[i].faces);
+        for (j = 0; j < families[i].face_count; j++)
         {
-            face->scalable = FALSE;
-            reg_load_ftshort(hkey_face, face_width_value, &face->size.width);
-            reg_load_ftlong(hkey_face, face_size_value, &face->size.size);
-            reg_load_ftlong(hkey_face, face_x_ppem_value, &face->size.x_ppem);
-            reg_load_ftlong(hkey_face, face_y_ppem_value, &face->size.y_ppem);
-            reg_load_ftshort(hkey_face, face_internal_leading_value, &face->size.internal_leading);
-
-            TRACE("Adding bitmap size h %d w %d size %ld x_ppem %ld y_ppem %ld\n",
-                  face->size.height, face->size.width, face->size.size >> 6,
-                  face->size.x_ppem >> 6, face->size.y_ppem >> 6);
+            if (!font_index_check_str( data, size, faces[j].style_name, sizeof(WCHAR), FALSE ) ||
+                !font_index_check_str( data, size, faces[j].full_name, sizeof(WCHAR), TRUE ) ||
+                !font_index_check_str( data, size, faces[j].file, sizeof(WCHAR), FALSE ))
+                return FALSE;
         }
+    }
+    return TRUE;
+}
 
-        TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
-              face->fs.fsCsb[0], face->fs.fsCsb[1],
-              face->fs.fsUsb[0], face->fs.fsUsb[1],
-              face->fs.fsUsb[2], face->fs.fsUsb[3]);
+static void load_face_from_index( const BYTE *data, const struct font_index_face *entry, Family *family )
+{
+    Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
 
-        if (insert_face_in_family_list(face, family))
-            TRACE("Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName));
+    face->cached_enum_data = NULL;
+    face->family = NULL;
+    face->refcount = 1;
+    face->file = strdupW( font_index_strW( data, entry->file ));
+    face->StyleName = strdupW( font_index_strW( data, entry->style_name ));
+    face->FullName = entry->full_name ? strdupW( font_index_strW( data, entry->full_name )) : NULL;
+    face->face_index = entry->face_index;
+    face->ntmFlags = entry->ntm_flags;
+    face->font_version = entry->font_version;
+    face->flags = entry->flags;
+    face->fs = entry->fs;
+    face->scalable = entry->scalable;
+
+    if (face->scalable) memset( &face->size, 0, sizeof(face->size) );
+    else
+    {
+        face->size.height = entry->height;
+        face->size.width = entry->width;
+        face->size.size = entry->size;
+        face->size.x_ppem = entry->x_ppem;
+        face->size.y_ppem = entry->y_ppem;
+        face->size.internal_leading = entry->internal_leading;
 
-        release_face( face );
+        TRACE("Adding bitmap size h %d w %d size %ld x_ppem %ld y_ppem %ld\n",
+              face->size.height, face->size.width, face->size.size >> 6,
+              face->size.x_ppem >> 6, face->size.y_ppem >> 6);
     }
 
-    /* load bitmap strikes */
+    TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
+          face->fs.fsCsb[0], face->fs.fsCsb[1],
+          face->fs.fsUsb[0], face->fs.fsUsb[1],
+          face->fs.fsUsb[2], face->fs.fsUsb[3]);
 
-    needed = buffer_size;
-    while (!RegEnumKeyExW(hkey_face, strike_index++, buffer, &needed, NULL, NULL, NULL, NULL))
-    {
-        if (!RegOpenKeyExW(hkey_face, buffer, 0, KEY_ALL_ACCESS, &hkey_strike))
-        {
-            load_face(hkey_strike, face_name, family, buffer, buffer_size);
-            RegCloseKey(hkey_strike);
-        }
-        needed = buffer_size;
-    }
+    if (insert_face_in_family_list(face, family))
+        TRACE("Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName));
+
+    release_face( face );
 }
 
 /* move vertical fonts after their horizontal counterpart */
@@ -1717,58 +1784,451 @@ static void reorder_vertical_fonts(void)
     list_move_tail( &font_list, &vertical_families );
 }
 
-static void load_font_list_from_cache(HKEY hkey_font_cache)
+static void set_font_index_stamp( ULONGLONG stamp )
 {
-    DWORD size, family_index = 0;
-    Family *family;
-    HKEY hkey_family;
-    WCHAR buffer[4096];
+    RegSetValueExW( hkey_font_cache, font_index_stamp_value, 0, REG_BINARY, (BYTE *)&stamp, sizeof(stamp) );
+}
 
-    size = sizeof(buffer);
-    while (!RegEnumKeyExW(hkey_font_cache, family_index++, buffer, &size, NULL, NULL, NULL, NULL))
+static ULONGLONG get_font_index_stamp(void)
+{
+    ULONGLONG stamp;
+    DWORD type, size = sizeof(stamp);
+
+    if (RegQueryValueExW( hkey_font_cache, font_index_stamp_value, NULL, &type, (BYTE *)&stamp, &size ) ||
+        type != REG_BINARY || size != sizeof(stamp))
+        return 0;
+    return stamp;
+}
+
+static char *get_font_index_path(void)
+{
+    const char *config_dir = wine_get_config_dir();
+    char *path;
+
+    if (!(path = HeapAlloc( GetProcessHeap(), 0, strlen(config_dir) + sizeof(font_index_name) ))) return NULL;
+    strcpy( path, config_dir );
+    strcat( path, font_index_name );
+    return path;
+}
+
+static ULONGLONG get_dir_mtime( const char *name )
+{
+    struct stat st;
+
+    if (stat( name, &st ) == -1) return 0;
+    return st.st_mtime;
+}
+
+static void get_font_file_stamp( const WCHAR *file, ULONGLONG *size, ULONGLONG *mtime )
+{
+    char *name = strWtoA( CP_UNIXCP, file );
+    struct stat st;
+
+    *size = *mtime = 0;
+    if (name && stat( name, &st ) != -1)
     {
-        WCHAR *english_family = NULL;
-        WCHAR *family_name = strdupW( buffer );
-        DWORD face_index = 0;
+        *size = st.st_size;
+        *mtime = st.st_mtime;
+    }
+    HeapFree( GetProcessHeap(), 0, name );
+}
 
-        RegOpenKeyExW(hkey_font_cache, family_name, 0, KEY_ALL_ACCESS, &hkey_family);
-        TRACE("opened family key %s\n", debugstr_w(family_name));
-        size = sizeof(buffer);
-        if (!RegQueryValueExW(hkey_family, english_name_value, NULL, NULL, (BYTE *)buffer, &size))
-            english_family = strdupW( buffer );
+static void add_font_dir( const char *name )
+{
+    struct font_dir *dir;
+
+    LIST_FOR_EACH_ENTRY( dir, &font_dirs, struct font_dir, entry )
+        if (!strcmp( dir->name, name )) return;
+
+    if (!(dir = HeapAlloc( GetProcessHeap(), 0, sizeof(*dir) ))) return;
+    if (!(dir->name = HeapAlloc( GetProcessHeap(), 0, strlen(name) + 1 )))
+    {
+        HeapFree( GetProcessHeap(), 0, dir );
+        return;
+    }
+    strcpy( dir->name, name );
+    dir->mtime = get_dir_mtime( name );
+    list_add_tail( &font_dirs, &dir->entry );
+}
+
+static WCHAR *get_font_path_value(void)
+{
+    static const WCHAR pathW[] = {'P','a','t','h',0};
+    WCHAR *value = NULL;
+    DWORD size;
+    HKEY hkey;
+
+    if (RegOpenKeyW( HKEY_CURRENT_USER, wine_fonts_key, &hkey )) return NULL;
+    if (!RegQueryValueExW( hkey, pathW, NULL, NULL, NULL, &size ) &&
+        (value = HeapAlloc( GetProcessHeap(), 0, size + sizeof(WCHAR) )))
+    {
+        if (RegQueryValueExW( hkey, pathW, NULL, NULL, (BYTE *)value, &size ))
+        {
+            HeapFree( GetProcessHeap(), 0, value );
+            value = NULL;
+        }
+        else value[size / sizeof(WCHAR)] = 0;
+    }
+    RegCloseKey( hkey );
+    return value;
+}
+
+static void get_fonts_key_time( FILETIME *time )
+{
+    HKEY hkey;
+
+    memset( time, 0, sizeof(*time) );
+    if (RegOpenKeyW( HKEY_LOCAL_MACHINE, is_win9x() ? win9x_font_reg_key : winnt_font_reg_key, &hkey ))
+        return;
+    RegQueryInfoKeyW( hkey, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, time );
+    RegCloseKey( hkey );
+}
 
-        family = create_family(family_name, english_family);
+/* check that nothing the index was built from has changed since */
+static BOOL font_index_sources_unchanged( const BYTE *data )
+{
+    const struct font_index_header *header = (const struct font_index_header *)data;
+    const struct font_index_dir *dirs = (const struct font_index_dir *)(data + header->dirs);
+    const struct font_index_family *families = (const struct font_index_family *)(data + header->families);
+    const struct font_index_face *faces;
+    const WCHAR *font_path = font_index_strW( data, header->font_path );
+    ULONGLONG size, mtime;
+    WCHAR *path;
+    FILETIME time;
+    BOOL ret;
+    DWORD i, j;
+
+    for (i = 0; i < header->dir_count; i++)
+    {
+        const char *name = (const char *)data + dirs[i].name;
+        if (get_dir_mtime( name ) != dirs[i].mtime)
+        {
+            TRACE( "%s changed\n", debugstr_a(name) );
+            return FALSE;
+        }
+    }
 
-        if(english_family)
+    /* a font file can be replaced in place without changing its directory */
+    for (i = 0; i < header->family_count; i++)
+    {
+        faces = (const struct font_index_face *)(data + families[i].faces);
+        for (j = 0; j < families[i].face_count; j++)
+        {
+            const WCHAR *file = font_index_strW( data, faces[j].file );
+
+            get_font_file_stamp( file, &size, &mtime );
+            if (size != faces[j].file_size || mtime != faces[j].file_mtime)
+            {
+                TRACE( "%s changed\n", debugstr_w(file) );
+                return FALSE;
+            }
+        }
+    }
+
+    get_fonts_key_time( &time );
+    if (CompareFileTime( &time, &header->fonts_key_time )) return FALSE;
+
+    path = get_font_path_value();
+    ret = (!path && !font_path) || (path && font_path && !strcmpW( path, font_path ));
+    HeapFree( GetProcessHeap(), 0, path );
+    return ret;
+}
+
+/* load the font list from the index file; a zero stamp means that the index is from a
+ * previous session and has to be checked against the font directories */
+static BOOL load_font_list_from_index( ULONGLONG stamp )
+{
+    const struct font_index_header *header;
+    const struct font_index_family *families;
+    const struct font_index_face *faces;
+    const BYTE *data;
+    struct stat st;
+    char *path;
+    BOOL ret = FALSE;
+    DWORD i, j;
+    int fd;
+
+    if (!(path = get_font_index_path())) return FALSE;
+    fd = open( path, O_RDONLY );
+    HeapFree( GetProcessHeap(), 0, path );
+    if (fd == -1) return FALSE;
+
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) ||
+        (data = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return FALSE;
+    }
+    close( fd );
+
+    header = (const struct font_index_header *)data;
+    if (!font_index_valid( data, st.st_size ))
+    {
+        WARN( "invalid font index\n" );
+        goto done;
+    }
+    if (stamp ? header->stamp != stamp : !font_index_sources_unchanged( data )) goto done;
+
+    families = (const struct font_index_family *)(data + header->families);
+    for (i = 0; i < header->family_count; i++)
+    {
+        const WCHAR *english_family = font_index_strW( data, families[i].english_name );
+        Family *family = create_family( strdupW( font_index_strW( data, families[i].name )),
+                                        english_family ? strdupW( english_family ) : NULL );
+
+        TRACE("loading family %s\n", debugstr_w(family->FamilyName));
+        if (english_family)
         {
             FontSubst *subst = HeapAlloc(GetProcessHeap(), 0, sizeof(*subst));
             subst->from.name = strdupW(english_family);
             subst->from.charset = -1;
-            subst->to.name = strdupW(family_name);
+            subst->to.name = strdupW(family->FamilyName);
             subst->to.charset = -1;
             add_font_subst(&font_subst_list, subst, 0);
         }
 
-        size = sizeof(buffer);
-        while (!RegEnumKeyExW(hkey_family, face_index++, buffer, &size, NULL, NULL, NULL, NULL))
+        faces = (const struct font_index_face *)(data + families[i].faces);
+        for (j = 0; j < families[i].face_count; j++) load_face_from_index( data, &faces[j], family );
+        release_family( family );
+    }
+
+    reorder_vertical_fonts();
+    if (!stamp) set_font_index_stamp( header->stamp );
+    TRACE( "loaded %u families from the font index\n", header->family_count );
+    ret = TRUE;
+
+done:
+    munmap( (void *)data, st.st_size );
+    return ret;
+}
+
+struct font_index_buffer
+{
+    BYTE  *data;
+    DWORD  size;
+    DWORD  pos;
+};
+
+/* returns the offset of a zeroed block of the index, or 0 on failure */
+static DWORD font_index_reserve( struct font_index_buffer *buffer, DWORD size )
+{
+    DWORD pos = buffer->pos;
+
+    if (!buffer->data) return 0;
+    size = (size + 7) & ~7;
+    if (pos + size > buffer->size)
+    {
+        DWORD new_size = max( buffer->size * 2, pos + size );
+        BYTE *data = HeapReAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, buffer->data, new_size );
+
+        if (!data)
         {
-            WCHAR *face_name = strdupW( buffer );
-            HKEY hkey_face;
+            HeapFree( GetProcessHeap(), 0, buffer->data );
+            buffer->data = NULL;
+            return 0;
+        }
+        buffer->data = data;
+        buffer->size = new_size;
+    }
+    buffer->pos += size;
+    return pos;
+}
+
+static DWORD font_index_add_strW( struct font_index_buffer *buffer, const WCHAR *str )
+{
+    DWORD len, pos;
+
+    if (!str) return 0;
+    len = (strlenW( str ) + 1) * sizeof(WCHAR);
+    if ((pos = font_index_reserve( buffer, len ))) memcpy( buffer->data + pos, str, len );
+    return pos;
+}
+
+static DWORD font_index_add_str( struct font_index_buffer *buffer, const char *str )
+{
+    DWORD len = strlen( str ) + 1, pos;
+
+    if ((pos = font_index_reserve( buffer, len ))) memcpy( buffer->data + pos, str, len );
+    return pos;
+}
 
-            if (!RegOpenKeyExW(hkey_family, face_name, 0, KEY_ALL_ACCESS, &hkey_face))
+static int family_name_cmp( const void *a, const void *b )
+{
+    const Family *family1 = *(const Family * const *)a, *family2 = *(const Family * const *)b;
+    return strcmpiW( family1->FamilyName, family2->FamilyName );
+}
+
+static BOOL is_cached_face( const Face *face )
+{
+    return face->flags & ADDFONT_ADD_TO_CACHE;
+}
+
+/* write the index file for the cached faces of the font list */
+static void save_font_index(void)
+{
+    struct font_index_buffer buffer = { NULL, 0, 0 };
+    struct font_index_header *header;
+    struct font_index_family *index_family;
+    struct font_index_face *index_face;
+    struct font_dir *dir;
+    Family *family, **families = NULL;
+    Face *face;
+    DWORD i, count = 0, family_count = 0, pos, faces, name, english_name;
+    WCHAR *font_path;
+    FILETIME time;
+    HANDLE mutex;
+    char *path = NULL, *tmp_path = NULL, *p;
+    int fd = -1;
+
+    font_index_dirty = FALSE;
+
+    /* serialize writers, this also holds the font mutex while loading the font list */
+    if (!(mutex = CreateMutexW( NULL, FALSE, font_mutex_nameW ))) return;
+    WaitForSingleObject( mutex, INFINITE );
+
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry ) family_count++;
+    if (!(families = HeapAlloc( GetProcessHeap(), 0, max( family_count, 1 ) * sizeof(*families) ))) goto done;
+
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+    {
+        BOOL cached = FALSE;
+
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+        {
+            if (!is_cached_face( face )) continue;
+            cached = TRUE;
+            p = strWtoA( CP_UNIXCP, face->file );
+            if (strrchr( p, '/' )) *strrchr( p, '/' ) = 0;
+            add_font_dir( p );
+            HeapFree( GetProcessHeap(), 0, p );
+        }
+        if (cached) families[count++] = family;
+    }
+    /* families are listed sorted like the registry keys were */
+    qsort( families, count, sizeof(*families), family_name_cmp );
+
+    buffer.size = 64 * 1024;
+    buffer.pos = 0;
+    buffer.data = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, buffer.size );
+    font_index_reserve( &buffer, sizeof(*header) );
+
+    i = 0;
+    LIST_FOR_EACH_ENTRY( dir, &font_dirs, struct font_dir, entry ) i++;
+    pos = font_index_reserve( &buffer, i * sizeof(struct font_index_dir) );
+    i = 0;
+    LIST_FOR_EACH_ENTRY( dir, &font_dirs, struct font_dir, entry )
+    {
+        name = font_index_add_str( &buffer, dir->name );
+        if (!buffer.data) goto done;
+        ((struct font_index_dir *)(buffer.data + pos))[i].name = name;
+        ((struct font_index_dir *)(buffer.data + pos))[i].mtime = dir->mtime;
+        i++;
+    }
+    header = (struct font_index_header *)buffer.data;
+    header->dir_count = i;
+    header->dirs = pos;
+
+    pos = font_index_reserve( &buffer, count * sizeof(struct font_index_family) );
+    for (i = 0; i < count; i++)
+    {
+        DWORD face_count = 0, j = 0;
+
+        name = font_index_add_strW( &buffer, families[i]->FamilyName );
+        english_name = font_index_add_strW( &buffer, families[i]->EnglishName );
+        LIST_FOR_EACH_ENTRY( face, &families[i]->faces, Face, entry )
+            if (is_cached_face( face )) face_count++;
+        faces = font_index_reserve( &buffer, face_count * sizeof(struct font_index_face) );
+
+        LIST_FOR_EACH_ENTRY( face, &families[i]->faces, Face, entry )
+        {
+            DWORD style_name, full_name, file;
+
+            if (!is_cached_face( face )) continue;
+            style_name = font_index_add_strW( &buffer, face->StyleName );
+            full_name = font_index_add_strW( &buffer, face->FullName );
+            file = font_index_add_strW( &buffer, face->file );
+            if (!buffer.data) goto done;
+
+            index_face = (struct font_index_face *)(buffer.data + faces) + j++;
+            index_face->style_name = style_name;
+            index_face->full_name = full_name;
+            index_face->file = file;
+            index_face->face_index = face->face_index;
+            index_face->fs = face->fs;
+            index_face->ntm_flags = face->ntmFlags;
+            index_face->font_version = face->font_version;
+            index_face->flags = face->flags;
+            index_face->scalable = face->scalable;
+            get_font_file_stamp( face->file, &index_face->file_size, &index_face->file_mtime );
+            if (!face->scalable)
             {
-                load_face(hkey_face, face_name, family, buffer, sizeof(buffer));
-                RegCloseKey(hkey_face);
+                index_face->height = face->size.height;
+                index_face->width = face->size.width;
+                index_face->size = face->size.size;
+                index_face->x_ppem = face->size.x_ppem;
+                index_face->y_ppem = face->size.y_ppem;
+                index_face->internal_leading = face->size.internal_leading;
             }
-            HeapFree( GetProcessHeap(), 0, face_name );
-            size = sizeof(buffer);
         }
-        RegCloseKey(hkey_family);
-        release_family( family );
-        size = sizeof(buffer);
+        if (!buffer.data) goto done;
+
+        index_family = (struct font_index_family *)(buffer.data + pos) + i;
+        index_family->name = name;
+        index_family->english_name = english_name;
+        index_family->face_count = face_count;
+        index_family->faces = faces;
+    }
+
+    font_path = get_font_path_value();
+    name = font_index_add_strW( &buffer, font_path );
+    HeapFree( GetProcessHeap(), 0, font_path );
+    if (!buffer.data) goto done;
+
+    GetSystemTimeAsFileTime( &time );
+    header = (struct font_index_header *)buffer.data;
+    header->magic = FONT_INDEX_MAGIC;
+    header->version = FONT_INDEX_VERSION;
+    header->stamp = ((ULONGLONG)time.dwHighDateTime << 32) | time.dwLowDateTime;
+    if (header->stamp <= get_font_index_stamp()) header->stamp = get_font_index_stamp() + 1;
+    header->size = buffer.pos;
+    header->family_count = count;
+    header->families = pos;
+    header->font_path = name;
+    get_fonts_key_time( &header->fonts_key_time );
+
+    /* write a new file and rename it, processes that have the old one mapped keep it */
+    if (!(path = get_font_index_path())) goto done;
+    if (!(tmp_path = HeapAlloc( GetProcessHeap(), 0, strlen(path) + 16 ))) goto done;
+    sprintf( tmp_path, "%s.%x", path, GetCurrentProcessId() );
+    if ((fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) == -1)
+    {
+        WARN( "can't create %s\n", debugstr_a(tmp_path) );
+        goto done;
+    }
+    for (pos = 0; pos < buffer.pos; pos += i)
+    {
+        int ret = write( fd, buffer.data + pos, buffer.pos - pos );
+        if (ret <= 0) break;
+        i = ret;
+    }
+    close( fd );
+    if (pos < buffer.pos || rename( tmp_path, path ) == -1)
+    {
+        WARN( "can't write %s\n", debugstr_a(path) );
+        unlink( tmp_path );
+        goto done;
     }
 
-    reorder_vertical_fonts();
+    set_font_index_stamp( header->stamp );
+    TRACE( "wrote %u families, %u bytes\n", count, buffer.pos );
+
+done:
+    HeapFree( GetProcessHeap(), 0, tmp_path );
+    HeapFree( GetProcessHeap(), 0, path );
+    HeapFree( GetProcessHeap(), 0, buffer.data );
+    HeapFree( GetProcessHeap(), 0, families );
+    ReleaseMutex( mutex );
+    CloseHandle( mutex );
 }
 
 static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
@@ -1791,75 +2251,31 @@ static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
     return ret;
 }
 
-static void add_face_to_cache(Face *face)
+/* rewrite the index now, or at the end of the current batch of updates */
+static void font_index_changed(void)
 {
-    HKEY hkey_family, hkey_face;
-    WCHAR *face_key_name;
-
-    RegCreateKeyExW(hkey_font_cache, face->family->FamilyName, 0,
-                    NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &hkey_family, NULL);
-    if(face->family->EnglishName)
-        RegSetValueExW(hkey_family, english_name_value, 0, REG_SZ, (BYTE*)face->family->EnglishName,
-                       (strlenW(face->family->EnglishName) + 1) * sizeof(WCHAR));
-
-    if(face->scalable)
-        face_key_name = face->StyleName;
-    else
-    {
-        static const WCHAR fmtW[] = {'%','s','\\','%','d',0};
-        face_key_name = HeapAlloc(GetProcessHeap(), 0, (strlenW(face->StyleName) + 10) * sizeof(WCHAR));
-        sprintfW(face_key_name, fmtW, face->StyleName, face->size.y_ppem);
-    }
-    RegCreateKeyExW(hkey_family, face_key_name, 0, NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL,
-                    &hkey_face, NULL);
-    if(!face->scalable)
-        HeapFree(GetProcessHeap(), 0, face_key_name);
-
-    RegSetValueExW(hkey_face, face_file_name_value, 0, REG_SZ, (BYTE *)face->file,
-                   (strlenW(face->file) + 1) * sizeof(WCHAR));
-    if (face->FullName)
-        RegSetValueExW(hkey_face, face_full_name_value, 0, REG_SZ, (BYTE*)face->FullName,
-                       (strlenW(face->FullName) + 1) * sizeof(WCHAR));
+    font_index_dirty = TRUE;
+    if (!font_index_batch) save_font_index();
+}
 
-    reg_save_dword(hkey_face, face_index_value, face->face_index);
-    reg_save_dword(hkey_face, face_ntmflags_value, face->ntmFlags);
-    reg_save_dword(hkey_face, face_version_value, face->font_version);
-    if (face->flags) reg_save_dword(hkey_face, face_flags_value, face->flags);
+static void begin_font_index_update(void)
+{
+    font_index_batch++;
+}
 
-    RegSetValueExW(hkey_face, face_font_sig_value, 0, REG_BINARY, (BYTE*)&face->fs, sizeof(face->fs));
+static void end_font_index_update(void)
+{
+    if (!--font_index_batch && font_index_dirty) save_font_index();
+}
 
-    if(!face->scalable)
-    {
-        reg_save_dword(hkey_face, face_height_value, face->size.height);
-        reg_save_dword(hkey_face, face_width_value, face->size.width);
-        reg_save_dword(hkey_face, face_size_value, face->size.size);
-        reg_save_dword(hkey_face, face_x_ppem_value, face->size.x_ppem);
-        reg_save_dword(hkey_face, face_y_ppem_value, face->size.y_ppem);
-        reg_save_dword(hkey_face, face_internal_leading_value, face->size.internal_leading);
-    }
-    RegCloseKey(hkey_face);
-    RegCloseKey(hkey_family);
+static void add_face_to_cache(Face *face)
+{
+    font_index_changed();
 }
 
 static void remove_face_from_cache( Face *face )
 {
-    HKEY hkey_family;
-
-    RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family );
-
-    if (face->scalable)
-    {
-        RegDeleteKeyW( hkey_family, face->StyleName );
-    }
-    else
-    {
-        static const WCHAR fmtW[] = {'%','s','\\','%','d',0};
-        WCHAR *face_key_name = HeapAlloc(GetProcessHeap(), 0, (strlenW(face->StyleName) + 10) * sizeof(WCHAR));
-        sprintfW(face_key_name, fmtW, face->StyleName, face->size.y_ppem);
-        RegDeleteKeyW( hkey_family, face_key_name );
-        HeapFree(GetProcessHeap(), 0, face_key_name);
-    }
-    RegCloseKey(hkey_family);
+    font_index_changed();
 }
 
 static WCHAR *prepend_at(WCHAR *family)
@@ -2712,6 +3128,7 @@ static BOOL ReadFontDir(const char *dirname, BOOL external_fonts)
         WARN("Can't open directory %s\n", debugstr_a(dirname));
 	return FALSE;
     }
+    add_font_dir(dirname);
     while((dent = readdir(dir)) != NULL) {
 	struct stat statbuf;
 
@@ -3225,6 +3642,7 @@ INT WineEngAddFontResourceEx(LPCWSTR file, DWORD flags, PVOID pdv)
         char *unixname;
 
         EnterCriticalSection( &freetype_cs );
+        begin_font_index_update();
 
         if((unixname = wine_get_unix_file_name(file)))
         {
@@ -3249,6 +3667,7 @@ INT WineEngAddFontResourceEx(LPCWSTR file, DWORD flags, PVOID pdv)
             }
         }
 
+        end_font_index_update();
         LeaveCriticalSection( &freetype_cs );
     }
     return ret;
@@ -3305,6 +3724,7 @@ BOOL WineEngRemoveFontResourceEx(LPCWSTR file, DWORD flags, PVOID pdv)
         char *unixname;
 
         EnterCriticalSection( &freetype_cs );
+        begin_font_index_update();
 
         if ((unixname = wine_get_unix_file_name(file)))
         {
@@ -3328,6 +3748,7 @@ BOOL WineEngRemoveFontResourceEx(LPCWSTR file, DWORD flags, PVOID pdv)
             }
         }
 
+        end_font_index_update();
         LeaveCriticalSection( &freetype_cs );
     }
     return ret;
@@ -4327,6 +4748,7 @@ BOOL WineEngInit(void)
     HKEY hkey;
     DWORD disposition;
     HANDLE font_mutex;
+    BOOL rebuild = FALSE;
 
     /* update locale dependent font info in registry */
     update_font_info();
@@ -4363,10 +4785,12 @@ BOOL WineEngInit(void)
 
     create_font_cache_key(&hkey_font_cache, &disposition);
 
-    if(disposition == REG_CREATED_NEW_KEY)
+    begin_font_index_update();
+    if (!load_font_list_from_index( disposition == REG_CREATED_NEW_KEY ? 0 : get_font_index_stamp() ))
+    {
         init_font_list();
-    else
-        load_font_list_from_cache(hkey_font_cache);
+        rebuild = TRUE;
+    }
 
     reorder_font_list();
 
@@ -4375,8 +4799,9 @@ BOOL WineEngInit(void)
     DumpSubstList();
     LoadReplaceList();
 
-    if(disposition == REG_CREATED_NEW_KEY)
-        update_reg_entries();
+    if (rebuild) update_reg_entries();
+
+    end_font_index_update();
 
     init_system_links();
     
@@ -655,6 +655,8 @@ BOOL WINAPI DllMain( HINSTANCE inst, DWORD reason, LPVOID reserved )
 
     gdi32_module = inst;
     DisableThreadLibraryCalls( inst );
+    init_dib_primitives();
+    init_dib_bands();
     WineEngInit();
 
     /* create stock objects */
@@ -154,6 +154,36 @@ static inline BOOL is_in_rect( const RECT *rect, int x, int y )
     return (rect->right > x && rect->left <= x && rect->bottom > y && rect->top <= y);
 }
 
+/* return the index of the first rectangle that ends below y; the rectangles are sorted
+ * in bands so their bottoms never decrease and a binary search finds the band holding y */
+int find_region_band( const WINEREGION *region, int y )
+{
+    int lo = 0, hi = region->numRects, mid;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (region->rects[mid].bottom <= y) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* return the index of the first rectangle of the band starting at index band that ends
+ * to the right of x, or of the first rectangle of the next band if there is none */
+static int find_band_rect( const WINEREGION *region, int band, int x )
+{
+    int lo = band, hi = region->numRects, mid, top = region->rects[band].top;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (region->rects[mid].top == top && region->rects[mid].right <= x) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
 /*
  * number of points to buffer before sending them off
  * to scanlines() :  Must be an even number
@@ -1045,12 +1075,14 @@ BOOL WINAPI PtInRegion( HRGN hrgn, INT x, INT y )
 	int i;
 
 	if (obj->numRects > 0 && is_in_rect(&obj->extents, x, y))
-	    for (i = 0; i < obj->numRects; i++)
-		if (is_in_rect(&obj->rects[i], x, y))
-                {
-		    ret = TRUE;
-                    break;
-                }
+	{
+	    i = find_region_band( obj, y );
+	    if (i < obj->numRects && obj->rects[i].top <= y)
+	    {
+	        i = find_band_rect( obj, i, x );
+	        ret = i < obj->numRects && is_in_rect( &obj->rects[i], x, y );
+	    }
+	}
 	GDI_ReleaseObj( hrgn );
     }
     return ret;
@@ -1088,7 +1120,7 @@ BOOL WINAPI RectInRegion( HRGN hrgn, const RECT *rect )
     /* this is (just) a useful optimization */
 	if ((obj->numRects > 0) && overlapping(&obj->extents, &rc))
 	{
-	    for (pCurRect = obj->rects, pRectEnd = pCurRect +
+	    for (pCurRect = obj->rects + find_region_band( obj, rc.top ), pRectEnd = obj->rects +
 	     obj->numRects; pCurRect < pRectEnd; pCurRect++)
 	    {
 	        if (pCurRect->bottom <= rc.top)
@@ -1867,6 +1899,120 @@ static BOOL REGION_RegionOp(
     return TRUE;
 }
 
+/***********************************************************************
+ *           REGION_LastBand
+ *
+ *      Return the index of the start of the band holding the rectangle
+ *      before end.
+ */
+static INT REGION_LastBand( const WINEREGION *pReg, INT end )
+{
+    INT start = end - 1;
+
+    while (start > 0 && pReg->rects[start - 1].top == pReg->rects[end - 1].top) start--;
+    return start;
+}
+
+/***********************************************************************
+ *           REGION_RegionOpBands
+ *
+ *      Same as REGION_RegionOp for operations that leave the bands of
+ *      region 1 above and below region 2 untouched, such as union and
+ *      subtraction.
+ *
+ * Notes:
+ *      Only the bands of region 1 that overlap region 2 vertically are
+ *      passed to REGION_RegionOp, the others are copied as they are and
+ *      coalesced with the result. Adding rectangles to a large region is
+ *      then proportional to the size of the affected bands, and appending
+ *      below the last band (the usual way regions are built) reuses the
+ *      array of the region in place.
+ */
+static BOOL REGION_RegionOpBands(
+	    WINEREGION *destReg, /* Place to store result */
+	    WINEREGION *reg1,   /* First region in operation */
+            WINEREGION *reg2,   /* 2nd region in operation */
+	    BOOL (*overlapFunc)(WINEREGION*, RECT*, RECT*, RECT*, RECT*, INT, INT),
+	    BOOL (*nonOverlap1Func)(WINEREGION*, RECT*, RECT*, INT, INT),
+	    BOOL (*nonOverlap2Func)(WINEREGION*, RECT*, RECT*, INT, INT)
+) {
+    WINEREGION middle, result, newReg;
+    RECT *src = NULL;
+    INT first, last, count, suffix, suffixStart;
+
+    first = find_region_band( reg1, reg2->extents.top );
+    for (last = first; last < reg1->numRects; last++)
+        if (reg1->rects[last].top >= reg2->extents.bottom) break;
+
+    if (!first && last == reg1->numRects)
+        return REGION_RegionOp( destReg, reg1, reg2, overlapFunc, nonOverlap1Func, nonOverlap2Func );
+
+    result.rects = NULL;
+    result.size = result.numRects = 0;
+    if (last > first)
+    {
+        middle.rects = reg1->rects + first;
+        middle.size = middle.numRects = last - first;
+        REGION_SetExtents( &middle );
+        if (!REGION_RegionOp( &result, &middle, reg2, overlapFunc, nonOverlap1Func, nonOverlap2Func ))
+            return FALSE;
+        src = result.rects;
+    }
+    else if (nonOverlap2Func)
+    {
+        /* region 2 fits between two bands of region 1 */
+        src = reg2->rects;
+        result.numRects = reg2->numRects;
+    }
+
+    suffix = reg1->numRects - last;
+    count = first + result.numRects + suffix;
+
+    if (destReg == reg1)
+    {
+        newReg = *reg1;
+        if (newReg.size < count)
+        {
+            INT size = max( count, newReg.size * 2 );
+            RECT *rects = HeapReAlloc( GetProcessHeap(), 0, newReg.rects, size * sizeof(RECT) );
+            if (!rects) goto error;
+            newReg.rects = rects;
+            newReg.size = size;
+        }
+        memmove( newReg.rects + first + result.numRects, newReg.rects + last, suffix * sizeof(RECT) );
+    }
+    else
+    {
+        if (!init_region( &newReg, count )) goto error;
+        memcpy( newReg.rects, reg1->rects, first * sizeof(RECT) );
+        memcpy( newReg.rects + first + result.numRects, reg1->rects + last, suffix * sizeof(RECT) );
+    }
+    if (result.numRects) memcpy( newReg.rects + first, src, result.numRects * sizeof(RECT) );
+    HeapFree( GetProcessHeap(), 0, result.rects );
+
+    /* merge the bands across both junctions */
+    newReg.numRects = first + result.numRects;
+    if (first && result.numRects) REGION_Coalesce( &newReg, REGION_LastBand( &newReg, first ), first );
+    if (suffix)
+    {
+        suffixStart = first + result.numRects;
+        first = newReg.numRects;
+        memmove( newReg.rects + first, newReg.rects + suffixStart, suffix * sizeof(RECT) );
+        newReg.numRects += suffix;
+        if (first) REGION_Coalesce( &newReg, REGION_LastBand( &newReg, first ), first );
+    }
+
+    if (destReg != reg1) HeapFree( GetProcessHeap(), 0, destReg->rects );
+    destReg->rects    = newReg.rects;
+    destReg->size     = newReg.size;
+    destReg->numRects = newReg.numRects;
+    return TRUE;
+
+error:
+    HeapFree( GetProcessHeap(), 0, result.rects );
+    return FALSE;
+}
+
 /***********************************************************************
  *          Region Intersection
  ***********************************************************************/
@@ -2098,7 +2244,7 @@ static BOOL REGION_UnionRegion(WINEREGION *newReg, WINEREGION *reg1, WINEREGION
 	return ret;
     }
 
-    if ((ret = REGION_RegionOp (newReg, reg1, reg2, REGION_UnionO, REGION_UnionNonO, REGION_UnionNonO)))
+    if ((ret = REGION_RegionOpBands (newReg, reg1, reg2, REGION_UnionO, REGION_UnionNonO, REGION_UnionNonO)))
     {
         newReg->extents.left = min(reg1->extents.left, reg2->extents.left);
         newReg->extents.top = min(reg1->extents.top, reg2->extents.top);
@@ -2263,7 +2409,7 @@ static BOOL REGION_SubtractRegion(WINEREGION *regD, WINEREGION *regM, WINEREGION
 	(!overlapping(&regM->extents, &regS->extents)) )
 	return REGION_CopyRegion(regD, regM);
 
-    if (!REGION_RegionOp (regD, regM, regS, REGION_SubtractO, REGION_SubtractNonO1, NULL))
+    if (!REGION_RegionOpBands (regD, regM, regS, REGION_SubtractO, REGION_SubtractNonO1, NULL))
         return FALSE;
 
     /*
@@ -22,12 +22,14 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <string.h>
+#include <stdio.h>
 
 #include "windef.h"
 #include "winbase.h"
 #include "winerror.h"
 #include "wingdi.h"
 #include "winuser.h"
+#include "winreg.h"
 #include "mmsystem.h"
 
 #include "wine/test.h"
@@ -3814,6 +3816,285 @@ static void test_GdiAlphaBlend(void)
     HeapFree(GetProcessHeap(), 0, bmi);
 }
 
+static BYTE blend_channel( BYTE dst, BYTE src, BYTE src_alpha, BYTE alpha, BOOL per_pixel )
+{
+    if (!per_pixel) return (src * alpha + dst * (255 - alpha) + 127) / 255;
+    src = (src * alpha + 127) / 255;
+    src_alpha = (src_alpha * alpha + 127) / 255;
+    return src + (dst * (255 - src_alpha) + 127) / 255;
+}
+
+static BOOL blend_pixel_ok( DWORD result, DWORD dst, DWORD src, BYTE alpha, BOOL per_pixel, BOOL exact )
+{
+    int i, diff;
+
+    /* the destination alpha is only well defined for per-pixel alpha */
+    for (i = 0; i < (per_pixel ? 32 : 24); i += 8)
+    {
+        diff = (BYTE)(result >> i) - blend_channel( dst >> i, src >> i, src >> 24, alpha, per_pixel );
+        if (exact ? diff : abs( diff ) > 1) return FALSE;
+    }
+    return TRUE;
+}
+
+static void test_GdiAlphaBlend_widths(void)
+{
+    static const BYTE alphas[] = { 255, 128, 1 };
+    BITMAPINFO info;
+    HDC hdc_src, hdc_dst;
+    HBITMAP bmp_src, bmp_dst, old_src, old_dst;
+    DWORD *src_bits, *dst_bits, expect_dst[20 * 20], seed = 12345;
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, 0 };
+    int i, x, y, format;
+    DWORD start;
+    BOOL ret;
+
+    if (!pGdiAlphaBlend)
+    {
+        win_skip("GdiAlphaBlend() is not implemented\n");
+        return;
+    }
+
+    memset( &info, 0, sizeof(info) );
+    info.bmiHeader.biSize = sizeof(info.bmiHeader);
+    info.bmiHeader.biWidth = 20;
+    info.bmiHeader.biHeight = -20;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    hdc_src = CreateCompatibleDC( 0 );
+    hdc_dst = CreateCompatibleDC( 0 );
+    bmp_src = CreateDIBSection( hdc_src, &info, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    bmp_dst = CreateDIBSection( hdc_dst, &info, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    old_src = SelectObject( hdc_src, bmp_src );
+    old_dst = SelectObject( hdc_dst, bmp_dst );
+
+    for (format = 0; format <= AC_SRC_ALPHA; format++)
+    {
+        for (i = 0; i < sizeof(alphas); i++)
+        {
+            for (x = 0; x < 20 * 20; x++)
+            {
+                BYTE a;
+
+                seed = seed * 1103515245 + 12345;
+                a = seed >> 24;
+                /* premultiplied source pixels */
+                src_bits[x] = (a << 24) | ((((seed >> 16) & 0xff) * a / 255) << 16) |
+                              ((((seed >> 8) & 0xff) * a / 255) << 8) | ((seed & 0xff) * a / 255);
+                seed = seed * 1103515245 + 12345;
+                expect_dst[x] = dst_bits[x] = seed;
+            }
+
+            blend.SourceConstantAlpha = alphas[i];
+            blend.AlphaFormat = format;
+
+            /* one row per width, starting on an odd pixel */
+            for (y = 0; y < 19; y++)
+            {
+                ret = pGdiAlphaBlend( hdc_dst, 1, y, y + 1, 1, hdc_src, 1, y, y + 1, 1, blend );
+                ok( ret, "GdiAlphaBlend failed for width %d\n", y + 1 );
+            }
+
+            for (y = 0; y < 20; y++)
+            {
+                for (x = 0; x < 20; x++)
+                {
+                    DWORD result = dst_bits[y * 20 + x], dst = expect_dst[y * 20 + x], src = src_bits[y * 20 + x];
+
+                    if (y == 19 || x == 0 || x > y + 1)
+                        ok( result == dst, "%d,%d: pixel outside the blend changed %08x -> %08x\n", x, y, dst, result );
+                    else
+                        ok( blend_pixel_ok( result, dst, src, alphas[i], format, TRUE ) ||
+                            broken( blend_pixel_ok( result, dst, src, alphas[i], format, FALSE )),
+                            "format %d alpha %u %d,%d: src %08x dst %08x got %08x\n",
+                            format, alphas[i], x, y, src, dst, result );
+                }
+            }
+        }
+    }
+
+    SelectObject( hdc_src, old_src );
+    SelectObject( hdc_dst, old_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+
+    /* trace the cost of a large per-pixel alpha blend */
+    info.bmiHeader.biWidth = 512;
+    info.bmiHeader.biHeight = -512;
+    bmp_src = CreateDIBSection( hdc_src, &info, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    bmp_dst = CreateDIBSection( hdc_dst, &info, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    SelectObject( hdc_src, bmp_src );
+    SelectObject( hdc_dst, bmp_dst );
+    for (x = 0; x < 512 * 512; x++) src_bits[x] = 0x80404040;
+
+    blend.SourceConstantAlpha = 255;
+    blend.AlphaFormat = AC_SRC_ALPHA;
+    start = GetTickCount();
+    for (i = 0; i < 20; i++) pGdiAlphaBlend( hdc_dst, 0, 0, 512, 512, hdc_src, 0, 0, 512, 512, blend );
+    trace( "20 512x512 alpha blends took %u ms\n", GetTickCount() - start );
+
+    SelectObject( hdc_src, old_src );
+    SelectObject( hdc_dst, old_dst );
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+}
+
+#define BAND_DIB_SIZE 512
+#define BAND_DIB_OPS  4
+
+/* draw operations that the dib engine can spread over threads, saving the result after each one */
+static void draw_large_dib( DWORD *results )
+{
+    TRIVERTEX vert[2] = { { 0, 0, 0xff00, 0x8000, 0x0000, 0x8000 },
+                          { BAND_DIB_SIZE, BAND_DIB_SIZE, 0x0000, 0x8000, 0xff00, 0xff00 } };
+    GRADIENT_RECT grad = { 0, 1 };
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 128, 0 };
+    const DWORD size = BAND_DIB_SIZE * BAND_DIB_SIZE;
+    BITMAPINFO info;
+    HDC hdc_src, hdc_dst;
+    HBITMAP bmp_src, bmp_dst, old_src, old_dst;
+    HBRUSH brush;
+    DWORD *src_bits, *dst_bits;
+    int i;
+
+    memset( &info, 0, sizeof(info) );
+    info.bmiHeader.biSize = sizeof(info.bmiHeader);
+    info.bmiHeader.biWidth = BAND_DIB_SIZE;
+    info.bmiHeader.biHeight = -BAND_DIB_SIZE;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    hdc_src = CreateCompatibleDC( 0 );
+    hdc_dst = CreateCompatibleDC( 0 );
+    bmp_src = CreateDIBSection( hdc_src, &info, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    bmp_dst = CreateDIBSection( hdc_dst, &info, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    old_src = SelectObject( hdc_src, bmp_src );
+    old_dst = SelectObject( hdc_dst, bmp_dst );
+    for (i = 0; i < size; i++)
+    {
+        src_bits[i] = i * 0x01030507;
+        dst_bits[i] = i * 0x07050301;
+    }
+
+    StretchBlt( hdc_dst, 0, 0, BAND_DIB_SIZE, BAND_DIB_SIZE, hdc_src, 0, 0, 384, 384, SRCCOPY );
+    StretchBlt( hdc_dst, 13, 7, 300, 450, hdc_src, 0, 0, BAND_DIB_SIZE, BAND_DIB_SIZE, SRCINVERT );
+    memcpy( results, dst_bits, size * sizeof(DWORD) );
+
+    if (pGdiAlphaBlend)
+        pGdiAlphaBlend( hdc_dst, 5, 5, 500, 500, hdc_src, 0, 0, 500, 500, blend );
+    memcpy( results + size, dst_bits, size * sizeof(DWORD) );
+
+    if (pGdiGradientFill)
+        pGdiGradientFill( hdc_dst, vert, 2, &grad, 1, GRADIENT_FILL_RECT_V );
+    memcpy( results + 2 * size, dst_bits, size * sizeof(DWORD) );
+
+    brush = SelectObject( hdc_dst, CreateHatchBrush( HS_DIAGCROSS, RGB(0x40, 0x80, 0xc0) ));
+    PatBlt( hdc_dst, 3, 1, BAND_DIB_SIZE - 6, BAND_DIB_SIZE - 2, PATINVERT );
+    DeleteObject( SelectObject( hdc_dst, brush ));
+    memcpy( results + 3 * size, dst_bits, size * sizeof(DWORD) );
+
+    SelectObject( hdc_src, old_src );
+    SelectObject( hdc_dst, old_dst );
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+}
+
+static void draw_large_dib_child( const char *file_name )
+{
+    const DWORD size = BAND_DIB_SIZE * BAND_DIB_SIZE * BAND_DIB_OPS * sizeof(DWORD);
+    DWORD *results = HeapAlloc( GetProcessHeap(), 0, size ), written;
+    HANDLE file;
+
+    draw_large_dib( results );
+    file = CreateFileA( file_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed %u\n", GetLastError() );
+    WriteFile( file, results, size, &written, NULL );
+    ok( written == size, "wrote %u bytes\n", written );
+    CloseHandle( file );
+    HeapFree( GetProcessHeap(), 0, results );
+}
+
+static BOOL set_band_setting( HKEY key, const char *name, const DWORD *value )
+{
+    if (!value) return !RegDeleteValueA( key, name );
+    return !RegSetValueExA( key, name, 0, REG_DWORD, (const BYTE *)value, sizeof(*value) );
+}
+
+/* the dib engine spreads large operations over threads when HKCU\Software\Wine\DIB Engine\Threads
+ * is set, which is only read at startup so the banded drawing is done in a child process */
+static void test_dib_bands( char **argv )
+{
+    static const char *const names[BAND_DIB_OPS] = { "StretchBlt", "GdiAlphaBlend", "GdiGradientFill", "PatBlt" };
+    static const DWORD threads = 4, min_pixels = 1;
+    const DWORD size = BAND_DIB_SIZE * BAND_DIB_SIZE;
+    DWORD *expect, *results, read, old_threads, old_min_pixels, len, i, j, diff;
+    BOOL has_threads, has_min_pixels;
+    char cmdline[MAX_PATH * 2], path[MAX_PATH], file_name[MAX_PATH];
+    STARTUPINFOA startup;
+    PROCESS_INFORMATION info;
+    HANDLE file;
+    HKEY key;
+
+    if (RegCreateKeyA( HKEY_CURRENT_USER, "Software\\Wine\\DIB Engine", &key ))
+    {
+        skip( "can't create the DIB engine key\n" );
+        return;
+    }
+    len = sizeof(old_threads);
+    has_threads = !RegQueryValueExA( key, "Threads", NULL, NULL, (BYTE *)&old_threads, &len );
+    len = sizeof(old_min_pixels);
+    has_min_pixels = !RegQueryValueExA( key, "MinPixels", NULL, NULL, (BYTE *)&old_min_pixels, &len );
+
+    expect = HeapAlloc( GetProcessHeap(), 0, size * BAND_DIB_OPS * sizeof(DWORD) );
+    results = HeapAlloc( GetProcessHeap(), 0, size * BAND_DIB_OPS * sizeof(DWORD) );
+    draw_large_dib( expect );
+
+    GetTempPathA( sizeof(path), path );
+    GetTempFileNameA( path, "dib", 0, file_name );
+    sprintf( cmdline, "%s bitmap bands %s", argv[0], file_name );
+
+    set_band_setting( key, "Threads", &threads );
+    set_band_setting( key, "MinPixels", &min_pixels );
+
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+    ok( CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info ),
+        "CreateProcess failed %u\n", GetLastError() );
+    winetest_wait_child_process( info.hProcess );
+    CloseHandle( info.hProcess );
+    CloseHandle( info.hThread );
+
+    set_band_setting( key, "Threads", has_threads ? &old_threads : NULL );
+    set_band_setting( key, "MinPixels", has_min_pixels ? &old_min_pixels : NULL );
+    RegCloseKey( key );
+
+    file = CreateFileA( file_name, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed %u\n", GetLastError() );
+    ReadFile( file, results, size * BAND_DIB_OPS * sizeof(DWORD), &read, NULL );
+    CloseHandle( file );
+    DeleteFileA( file_name );
+    ok( read == size * BAND_DIB_OPS * sizeof(DWORD), "read %u bytes\n", read );
+
+    if (read == size * BAND_DIB_OPS * sizeof(DWORD))
+    {
+        for (i = 0; i < BAND_DIB_OPS; i++)
+        {
+            for (j = diff = 0; j < size; j++) if (results[i * size + j] != expect[i * size + j]) diff++;
+            ok( !diff, "%s: %u pixels differ with bands\n", names[i], diff );
+        }
+    }
+
+    HeapFree( GetProcessHeap(), 0, expect );
+    HeapFree( GetProcessHeap(), 0, results );
+}
+
 static void test_GdiGradientFill(void)
 {
     HDC hdc;
@@ -5645,12 +5926,21 @@ static void test_SetDIBitsToDevice_RLE8(void)
 START_TEST(bitmap)
 {
     HMODULE hdll;
+    char **argv;
+    int argc;
 
     hdll = GetModuleHandleA("gdi32.dll");
     pGdiAlphaBlend   = (void*)GetProcAddress(hdll, "GdiAlphaBlend");
     pGdiGradientFill = (void*)GetProcAddress(hdll, "GdiGradientFill");
     pSetLayout       = (void*)GetProcAddress(hdll, "SetLayout");
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 4 && !strcmp( argv[2], "bands" ))
+    {
+        draw_large_dib_child( argv[3] );
+        return;
+    }
+
     test_createdibitmap();
     test_dibsections();
     test_dib_formats();
@@ -5671,6 +5961,8 @@ START_TEST(bitmap)
     test_StretchBlt();
     test_StretchDIBits();
     test_GdiAlphaBlend();
+    test_GdiAlphaBlend_widths();
+    test_dib_bands( argv );
     test_GdiGradientFill();
     test_32bit_ddb();
     test_bitmapinfoheadersize();
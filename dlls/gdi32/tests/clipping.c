@@ -548,6 +548,89 @@ static void test_window_dc_clipping(void)
 }
 
 
+static void test_large_regions(void)
+{
+    HRGN grid, shuffled, rect, tmp;
+    DWORD start, size;
+    RGNDATA *data;
+    RECT rc;
+    int i, x, y, ret;
+
+    /* a 100x100 grid of 2x2 squares 4 pixels apart */
+    grid = CreateRectRgn( 0, 0, 0, 0 );
+    rect = CreateRectRgn( 0, 0, 0, 0 );
+    start = GetTickCount();
+    for (y = 0; y < 100; y++)
+        for (x = 0; x < 100; x++)
+        {
+            SetRectRgn( rect, x * 4, y * 4, x * 4 + 2, y * 4 + 2 );
+            CombineRgn( grid, grid, rect, RGN_OR );
+        }
+    trace( "building a 10000 rect region took %u ms\n", GetTickCount() - start );
+
+    size = GetRegionData( grid, 0, NULL );
+    data = HeapAlloc( GetProcessHeap(), 0, size );
+    ret = GetRegionData( grid, size, data );
+    ok( ret == size, "GetRegionData returned %d\n", ret );
+    ok( data->rdh.nCount == 10000, "got %u rects\n", data->rdh.nCount );
+    HeapFree( GetProcessHeap(), 0, data );
+
+    /* adding the rows from the bottom and inside out gives the same region */
+    shuffled = CreateRectRgn( 0, 0, 0, 0 );
+    for (i = 0; i < 100; i++)
+    {
+        y = (i % 2) ? 50 + i / 2 : 49 - i / 2;
+        for (x = 99; x >= 0; x--)
+        {
+            SetRectRgn( rect, x * 4, y * 4, x * 4 + 2, y * 4 + 2 );
+            CombineRgn( shuffled, shuffled, rect, RGN_OR );
+        }
+    }
+    ok( EqualRgn( grid, shuffled ), "regions differ\n" );
+
+    start = GetTickCount();
+    for (i = 0; i < 100000; i++)
+    {
+        x = (i * 7) % 400;
+        y = (i * 13) % 400;
+        ret = PtInRegion( grid, x, y );
+        if (ret != (x % 4 < 2 && y % 4 < 2))
+        {
+            ok( 0, "PtInRegion(%d,%d) returned %d\n", x, y, ret );
+            break;
+        }
+    }
+    trace( "100000 PtInRegion calls took %u ms\n", GetTickCount() - start );
+
+    SetRect( &rc, 2, 2, 4, 4 );
+    ok( !RectInRegion( grid, &rc ), "RectInRegion succeeded\n" );
+    SetRect( &rc, 393, 393, 400, 400 );
+    ok( RectInRegion( grid, &rc ), "RectInRegion failed\n" );
+    SetRect( &rc, 398, 398, 400, 400 );
+    ok( !RectInRegion( grid, &rc ), "RectInRegion succeeded\n" );
+
+    /* cut out the middle rows and put them back */
+    tmp = CreateRectRgn( 0, 0, 0, 0 );
+    CombineRgn( tmp, grid, 0, RGN_COPY );
+    SetRectRgn( rect, 0, 100, 400, 300 );
+    start = GetTickCount();
+    ret = CombineRgn( tmp, tmp, rect, RGN_DIFF );
+    ok( ret == COMPLEXREGION, "CombineRgn returned %d\n", ret );
+    ok( !PtInRegion( tmp, 200, 200 ), "PtInRegion succeeded\n" );
+    ok( PtInRegion( tmp, 0, 300 ), "PtInRegion failed\n" );
+    ret = CombineRgn( rect, grid, rect, RGN_AND );
+    ok( ret == COMPLEXREGION, "CombineRgn returned %d\n", ret );
+    ret = CombineRgn( tmp, tmp, rect, RGN_OR );
+    ok( ret == COMPLEXREGION, "CombineRgn returned %d\n", ret );
+    trace( "cutting and restoring 5000 rects took %u ms\n", GetTickCount() - start );
+    ok( EqualRgn( grid, tmp ), "regions differ\n" );
+
+    DeleteObject( tmp );
+    DeleteObject( rect );
+    DeleteObject( shuffled );
+    DeleteObject( grid );
+}
+
 START_TEST(clipping)
 {
     test_GetRandomRgn();
@@ -555,4 +638,5 @@ START_TEST(clipping)
     test_GetClipRgn();
     test_memory_dc_clipping();
     test_window_dc_clipping();
+    test_large_regions();
 }
@@ -2837,7 +2837,7 @@ static inline COLORREF aa_colorref( COLORREF dst, COLORREF text, BYTE glyph )
 
 static const BYTE masks[8] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
 
-static void draw_text_2( HDC hdc, const BITMAPINFO *bmi, BYTE *bits, BOOL aa )
+static void draw_text_2( HDC hdc, const BITMAPINFO *bmi, BYTE *bits, BOOL aa, HRGN clip )
 {
     DWORD dib_size = get_dib_size(bmi), ret;
     LOGFONTA lf;
@@ -2878,6 +2878,7 @@ static void draw_text_2( HDC hdc, const BITMAPINFO *bmi, BYTE *bits, BOOL aa )
     origin.x = 10;
     origin.y = 100;
 
+    SelectClipRgn( hdc, clip );
     ExtTextOutA( hdc, origin.x, origin.y, 0, NULL, str, strlen(str), NULL );
     eto_hash = hash_dib( bmi, bits );
 
@@ -2943,8 +2944,9 @@ static void draw_text_2( HDC hdc, const BITMAPINFO *bmi, BYTE *bits, BOOL aa )
         }
     }
 
+    SelectClipRgn( hdc, NULL );
     diy_hash = hash_dib( bmi, bits );
-    ok( !strcmp( eto_hash, diy_hash ), "hash mismatch - aa %d\n", aa );
+    ok( !strcmp( eto_hash, diy_hash ), "hash mismatch - aa %d clip %p\n", aa, clip );
 
     HeapFree( GetProcessHeap(), 0, diy_hash );
     HeapFree( GetProcessHeap(), 0, eto_hash );
@@ -2953,16 +2955,101 @@ static void draw_text_2( HDC hdc, const BITMAPINFO *bmi, BYTE *bits, BOOL aa )
     DeleteObject( font );
 }
 
+static void draw_text_opaque( HDC hdc, const BITMAPINFO *bmi, BYTE *bits, HRGN clip )
+{
+    static const char str[] = "Hello Wine";
+    static const RECT rect = { 5, 75, 150, 105 };
+    DWORD dib_size = get_dib_size(bmi);
+    char *eto_hash, *ref_hash;
+    HBRUSH brush;
+    LOGFONTA lf;
+    HFONT font;
+
+    memset( &lf, 0, sizeof(lf) );
+    strcpy( lf.lfFaceName, "Tahoma" );
+    lf.lfHeight = 24;
+    lf.lfQuality = NONANTIALIASED_QUALITY;
+    font = SelectObject( hdc, CreateFontIndirectA( &lf ) );
+
+    SetTextColor( hdc, RGB(0xff, 0x00, 0x00) );
+    SetBkColor( hdc, RGB(0xff, 0xff, 0xff) );
+    SetTextAlign( hdc, TA_BASELINE );
+    SetBkMode( hdc, TRANSPARENT );
+    brush = CreateSolidBrush( RGB(0xff, 0xff, 0xff) );
+    SelectClipRgn( hdc, clip );
+
+    /* filling a rectangle without any text */
+    memset( bits, 0, dib_size );
+    ExtTextOutA( hdc, 10, 100, ETO_OPAQUE, &rect, "", 0, NULL );
+    eto_hash = hash_dib( bmi, bits );
+
+    memset( bits, 0, dib_size );
+    FillRect( hdc, &rect, brush );
+    ref_hash = hash_dib( bmi, bits );
+    ok( !strcmp( eto_hash, ref_hash ), "hash mismatch - empty string clip %p\n", clip );
+    HeapFree( GetProcessHeap(), 0, ref_hash );
+    HeapFree( GetProcessHeap(), 0, eto_hash );
+
+    /* filling and drawing clipped text */
+    memset( bits, 0, dib_size );
+    ExtTextOutA( hdc, 10, 100, ETO_OPAQUE | ETO_CLIPPED, &rect, str, strlen(str), NULL );
+    eto_hash = hash_dib( bmi, bits );
+
+    memset( bits, 0, dib_size );
+    FillRect( hdc, &rect, brush );
+    ExtTextOutA( hdc, 10, 100, ETO_CLIPPED, &rect, str, strlen(str), NULL );
+    ref_hash = hash_dib( bmi, bits );
+    ok( !strcmp( eto_hash, ref_hash ), "hash mismatch - opaque clipped clip %p\n", clip );
+    HeapFree( GetProcessHeap(), 0, ref_hash );
+    HeapFree( GetProcessHeap(), 0, eto_hash );
+
+    SelectClipRgn( hdc, NULL );
+    DeleteObject( brush );
+    DeleteObject( SelectObject( hdc, font ) );
+}
+
 static void draw_text( HDC hdc, const BITMAPINFO *bmi, BYTE *bits )
 {
-    draw_text_2( hdc, bmi, bits, FALSE );
+    HRGN clip, columns, stripe;
+    int i;
+
+    /* glyphs split over several bands and several rectangles per band */
+    clip = CreateRectRgn( 0, 90, 200, 95 );
+    for (i = 0; i < 10; i++)
+    {
+        stripe = CreateRectRgn( 12 + i * 13, 70 + i, 19 + i * 13, 110 );
+        CombineRgn( clip, clip, stripe, RGN_XOR );
+        DeleteObject( stripe );
+    }
+
+    draw_text_2( hdc, bmi, bits, FALSE, NULL );
+    draw_text_2( hdc, bmi, bits, FALSE, clip );
+
+    draw_text_opaque( hdc, bmi, bits, NULL );
+    draw_text_opaque( hdc, bmi, bits, clip );
+
+    /* more rectangles than fit in the clipped rects buffer */
+    columns = CreateRectRgn( 0, 0, 0, 0 );
+    for (i = 0; i < 48; i++)
+    {
+        stripe = CreateRectRgn( i * 4, 0, i * 4 + 2, 200 );
+        CombineRgn( columns, columns, stripe, RGN_OR );
+        DeleteObject( stripe );
+    }
+    draw_text_opaque( hdc, bmi, bits, columns );
+    DeleteObject( columns );
 
     /* Rounding errors make these cases hard to test */
     if ((bmi->bmiHeader.biCompression == BI_BITFIELDS && ((DWORD*)bmi->bmiColors)[0] == 0x3f000) ||
         (bmi->bmiHeader.biBitCount == 16))
+    {
+        DeleteObject( clip );
         return;
+    }
 
-    draw_text_2( hdc, bmi, bits, TRUE );
+    draw_text_2( hdc, bmi, bits, TRUE, NULL );
+    draw_text_2( hdc, bmi, bits, TRUE, clip );
+    DeleteObject( clip );
 }
 
 static void test_simple_graphics(void)
@@ -20,6 +20,7 @@
  */
 
 #include <stdarg.h>
+#include <stdio.h>
 #include <assert.h>
 
 #include "windef.h"
@@ -27,6 +28,7 @@
 #include "wingdi.h"
 #include "winuser.h"
 #include "winnls.h"
+#include "winreg.h"
 
 #include "wine/test.h"
 
@@ -6549,8 +6551,138 @@ static void test_bitmap_font_glyph_index(void)
     DeleteDC(hdc);
 }
 
+static char *(CDECL *pwine_get_unix_file_name)(const WCHAR *);
+
+static void run_font_index_child(char **argv, BOOL new_session, BOOL expect, int line)
+{
+    char cmdline[MAX_PATH];
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+
+    /* the font index is only checked against its sources once per session */
+    if (new_session) RegDeleteKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Fonts\\Cache");
+
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    sprintf(cmdline, "\"%s\" font font_index %d %d", argv[0], expect, line);
+    ok(CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info),
+       "CreateProcess failed %u\n", GetLastError());
+    winetest_wait_child_process(info.hProcess);
+    CloseHandle(info.hProcess);
+    CloseHandle(info.hThread);
+}
+
+static void write_font_index_file(const char *name, BOOL valid, const FILETIME *mtime)
+{
+    DWORD size, written;
+    void *data = get_res_data("wine_test.ttf", &size);
+    char *garbage;
+    HANDLE file;
+
+    file = CreateFileA(name, GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile failed %u\n", GetLastError());
+    if (valid) WriteFile(file, data, size, &written, NULL);
+    else
+    {
+        /* same size, but not a font anymore */
+        garbage = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, size);
+        WriteFile(file, garbage, size, &written, NULL);
+        HeapFree(GetProcessHeap(), 0, garbage);
+    }
+    ok(written == size, "wrote %u of %u bytes\n", written, size);
+    if (mtime) SetFileTime(file, NULL, NULL, mtime);
+    CloseHandle(file);
+}
+
+static void test_font_index(char **argv)
+{
+    char dir[MAX_PATH], file[MAX_PATH], tmp[MAX_PATH], *unix_dir;
+    WCHAR dirW[MAX_PATH];
+    BYTE old_path[1024];
+    DWORD size, old_path_size, old_path_type;
+    FILETIME mtime;
+    HANDLE handle;
+    HKEY key;
+    LONG ret;
+
+    /* the index of the system font list is specific to wine */
+    pwine_get_unix_file_name = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "wine_get_unix_file_name");
+    if (!pwine_get_unix_file_name)
+    {
+        skip("not running on wine\n");
+        return;
+    }
+    if (!get_res_data("wine_test.ttf", &size))
+    {
+        skip("wine_test.ttf resource not available\n");
+        return;
+    }
+
+    GetTempPathA(MAX_PATH, dir);
+    strcat(dir, "wine_font_index");
+    CreateDirectoryA(dir, NULL);
+    sprintf(file, "%s\\wine_test.ttf", dir);
+    sprintf(tmp, "%s\\tmp", dir);
+    MultiByteToWideChar(CP_ACP, 0, dir, -1, dirW, MAX_PATH);
+    unix_dir = pwine_get_unix_file_name(dirW);
+    ok(unix_dir != NULL, "can't get unix name of %s\n", dir);
+    if (!unix_dir) return;
+
+    ret = RegCreateKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Fonts", &key);
+    ok(!ret, "RegCreateKey failed %d\n", ret);
+    old_path_size = sizeof(old_path);
+    if (RegQueryValueExA(key, "Path", NULL, &old_path_type, old_path, &old_path_size)) old_path_size = 0;
+    RegSetValueExA(key, "Path", 0, REG_SZ, (BYTE *)unix_dir, strlen(unix_dir) + 1);
+    HeapFree(GetProcessHeap(), 0, unix_dir);
+
+    /* the index is written, then used as is by later processes */
+    write_font_index_file(file, TRUE, NULL);
+    run_font_index_child(argv, TRUE, TRUE, __LINE__);
+    run_font_index_child(argv, FALSE, TRUE, __LINE__);
+    run_font_index_child(argv, TRUE, TRUE, __LINE__);
+
+    /* a file changed without changing its size and time isn't noticed, which shows that
+     * the index was used rather than the directory */
+    handle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0);
+    GetFileTime(handle, NULL, NULL, &mtime);
+    CloseHandle(handle);
+    write_font_index_file(file, FALSE, &mtime);
+    run_font_index_child(argv, TRUE, TRUE, __LINE__);
+
+    /* the index is rejected once the directory changes */
+    Sleep(1100);
+    CloseHandle(CreateFileA(tmp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0));
+    DeleteFileA(tmp);
+    run_font_index_child(argv, TRUE, FALSE, __LINE__);
+
+    /* and once a font file changes */
+    write_font_index_file(file, TRUE, NULL);
+    run_font_index_child(argv, TRUE, TRUE, __LINE__);
+    Sleep(1100);
+    write_font_index_file(file, FALSE, NULL);
+    run_font_index_child(argv, TRUE, FALSE, __LINE__);
+
+    if (old_path_size) RegSetValueExA(key, "Path", 0, old_path_type, old_path, old_path_size);
+    else RegDeleteValueA(key, "Path");
+    RegCloseKey(key);
+    DeleteFileA(file);
+    RemoveDirectoryA(dir);
+    RegDeleteKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Fonts\\Cache");
+}
+
 START_TEST(font)
 {
+    char **argv;
+    int argc;
+
+    argc = winetest_get_mainargs(&argv);
+    if (argc >= 5 && !strcmp(argv[2], "font_index"))
+    {
+        ok_(__FILE__, atoi(argv[4]))(is_truetype_font_installed("wine_test") == atoi(argv[3]),
+                                     "font wine_test %s enumerated\n", atoi(argv[3]) ? "not" : "wrongly");
+        return;
+    }
+
     init();
 
     test_stock_fonts();
@@ -6617,4 +6749,5 @@ START_TEST(font)
      */
     test_vertical_font();
     test_CreateScalableFontResource();
+    test_font_index(argv);
 }
@@ -3599,6 +3599,172 @@ static void test_emf_PolyPolyline(void)
     DeleteEnhMetaFile(hemf);
 }
 
+static int CALLBACK play_enum_proc(HDC hdc, HANDLETABLE *handle_table,
+                                   const ENHMETARECORD *emr, int n_objs, LPARAM param)
+{
+    PlayEnhMetaFileRecord(hdc, handle_table, emr, n_objs);
+    return 1;
+}
+
+static int CALLBACK count_polyline_enum_proc(HDC hdc, HANDLETABLE *handle_table,
+                                              const ENHMETARECORD *emr, int n_objs, LPARAM param)
+{
+    switch (emr->iType)
+    {
+    case EMR_POLYLINE:
+    case EMR_POLYLINE16:
+    case EMR_POLYPOLYLINE:
+    case EMR_POLYPOLYLINE16:
+        (*(int *)param)++;
+        break;
+    }
+    return 1;
+}
+
+static void test_emf_playback(void)
+{
+    static const POINT line[] = {{10, 10}, {60, 30}, {20, 70}};
+    static const POINT far_line[] = {{1000, 1000}, {1200, 1100}};
+    static const POINT big_line[] = {{10, 0x10000}, {60, 0x10010}};
+    static const DWORD counts[] = {2, 3};
+    char bmibuf[FIELD_OFFSET(BITMAPINFO, bmiColors)];
+    BITMAPINFO *bmi = (BITMAPINFO *)bmibuf;
+    HDC hdcMetafile, hdc[2];
+    HBITMAP bitmap[2];
+    HENHMETAFILE hemf, hemf2;
+    HPEN pen, old_pen;
+    RECT rect = {0, 0, 400, 400}, frame;
+    POINT pts[5];
+    DWORD *bits[2];
+    int i, x, y, diff, drawn;
+    BOOL ret;
+
+    /* make the frame 400 reference pixels wide so that a logical unit is about a pixel */
+    hdc[0] = GetDC(0);
+    SetRect(&frame, 0, 0, MulDiv(400, GetDeviceCaps(hdc[0], HORZSIZE) * 100, GetDeviceCaps(hdc[0], HORZRES)),
+            MulDiv(400, GetDeviceCaps(hdc[0], VERTSIZE) * 100, GetDeviceCaps(hdc[0], VERTRES)));
+    hdcMetafile = CreateEnhMetaFileA(hdc[0], NULL, &frame, NULL);
+    ok(hdcMetafile != 0, "CreateEnhMetaFileA error %d\n", GetLastError());
+    ReleaseDC(0, hdc[0]);
+
+    /* runs of polylines, some of them far from the visible area */
+    for (i = 0; i < 20; i++)
+    {
+        for (x = 0; x < 3; x++)
+        {
+            pts[x].x = line[x].x + i * 3;
+            pts[x].y = line[x].y + i * 2;
+        }
+        Polyline(hdcMetafile, pts, 3);
+        Polyline(hdcMetafile, far_line, 2);
+    }
+    Polyline(hdcMetafile, big_line, 2);
+    for (i = 0; i < 5; i++)
+    {
+        pts[i].x = 30 + i * 7;
+        pts[i].y = 5 + (i & 1) * 40;
+    }
+    PolyPolyline(hdcMetafile, pts, counts, 2);
+    Polygon(hdcMetafile, far_line, 2);
+
+    /* a wide pen reaching the visible area from outside */
+    pen = CreatePen(PS_SOLID, 40, RGB(0xff, 0, 0));
+    old_pen = SelectObject(hdcMetafile, pen);
+    pts[0].x = -15;
+    pts[0].y = 10;
+    pts[1].x = -15;
+    pts[1].y = 80;
+    Polyline(hdcMetafile, pts, 2);
+    Polyline(hdcMetafile, far_line, 2);
+    SelectObject(hdcMetafile, old_pen);
+    DeleteObject(pen);
+
+    /* overlapping lines must not be merged with a xor pen */
+    SetROP2(hdcMetafile, R2_XORPEN);
+    Polyline(hdcMetafile, line, 3);
+    Polyline(hdcMetafile, line, 2);
+    SetROP2(hdcMetafile, R2_COPYPEN);
+
+    PatBlt(hdcMetafile, 1000, 1000, 100, 100, BLACKNESS);
+    PatBlt(hdcMetafile, 80, 80, 10, 10, BLACKNESS);
+    Polyline(hdcMetafile, far_line, 2);
+
+    hemf = CloseEnhMetaFile(hdcMetafile);
+    ok(hemf != 0, "CloseEnhMetaFile error %d\n", GetLastError());
+
+    memset(bmi, 0, sizeof(bmibuf));
+    bmi->bmiHeader.biSize = sizeof(bmi->bmiHeader);
+    bmi->bmiHeader.biWidth = 100;
+    bmi->bmiHeader.biHeight = -100;
+    bmi->bmiHeader.biPlanes = 1;
+    bmi->bmiHeader.biBitCount = 32;
+    bmi->bmiHeader.biCompression = BI_RGB;
+
+    for (i = 0; i < 2; i++)
+    {
+        hdc[i] = CreateCompatibleDC(0);
+        bitmap[i] = CreateDIBSection(hdc[i], bmi, DIB_RGB_COLORS, (void **)&bits[i], NULL, 0);
+        SelectObject(hdc[i], bitmap[i]);
+        memset(bits[i], 0xcc, 100 * 100 * 4);
+    }
+
+    /* the records are played one by one through the callback */
+    ret = PlayEnhMetaFile(hdc[0], hemf, &rect);
+    ok(ret, "PlayEnhMetaFile error %d\n", GetLastError());
+    ret = EnumEnhMetaFile(hdc[1], hemf, play_enum_proc, NULL, &rect);
+    ok(ret, "EnumEnhMetaFile error %d\n", GetLastError());
+
+    for (y = diff = drawn = 0; y < 100; y++)
+        for (x = 0; x < 100; x++)
+        {
+            if (bits[0][y * 100 + x] != bits[1][y * 100 + x]) diff++;
+            if (bits[0][y * 100 + x] != 0xcccccccc) drawn++;
+        }
+    ok(!diff, "%d pixels differ\n", diff);
+    ok(drawn, "nothing drawn\n");
+
+    /* playing again uses the same record index */
+    memset(bits[0], 0xcc, 100 * 100 * 4);
+    ret = PlayEnhMetaFile(hdc[0], hemf, &rect);
+    ok(ret, "PlayEnhMetaFile error %d\n", GetLastError());
+    ok(!memcmp(bits[0], bits[1], 100 * 100 * 4), "bits differ\n");
+
+    /* records played into an open path are all added to it, visible or not */
+    for (i = 0; i < 2; i++) BeginPath(hdc[i]);
+    ret = PlayEnhMetaFile(hdc[0], hemf, &rect);
+    ok(ret, "PlayEnhMetaFile error %d\n", GetLastError());
+    ret = EnumEnhMetaFile(hdc[1], hemf, play_enum_proc, NULL, &rect);
+    ok(ret, "EnumEnhMetaFile error %d\n", GetLastError());
+    for (i = 0; i < 2; i++) EndPath(hdc[i]);
+    x = GetPath(hdc[0], NULL, NULL, 0);
+    y = GetPath(hdc[1], NULL, NULL, 0);
+    ok(y > 0, "got %d path points\n", y);
+    ok(x == y, "got %d path points, expected %d\n", x, y);
+
+    for (i = 0; i < 2; i++)
+    {
+        DeleteDC(hdc[i]);
+        DeleteObject(bitmap[i]);
+    }
+
+    /* records played into a metafile are neither skipped nor merged */
+    hdcMetafile = CreateEnhMetaFileA(0, NULL, NULL, NULL);
+    ok(hdcMetafile != 0, "CreateEnhMetaFileA error %d\n", GetLastError());
+    ret = PlayEnhMetaFile(hdcMetafile, hemf, &rect);
+    ok(ret, "PlayEnhMetaFile error %d\n", GetLastError());
+    hemf2 = CloseEnhMetaFile(hdcMetafile);
+    ok(hemf2 != 0, "CloseEnhMetaFile error %d\n", GetLastError());
+
+    x = y = 0;
+    EnumEnhMetaFile(0, hemf, count_polyline_enum_proc, &x, NULL);
+    EnumEnhMetaFile(0, hemf2, count_polyline_enum_proc, &y, NULL);
+    ok(x == 47, "got %d polyline records\n", x);
+    ok(y == x, "got %d polyline records, expected %d\n", y, x);
+
+    DeleteEnhMetaFile(hemf2);
+    DeleteEnhMetaFile(hemf);
+}
+
 START_TEST(metafile)
 {
     init_function_pointers();
@@ -3614,6 +3780,7 @@ START_TEST(metafile)
     test_emf_polybezier();
     test_emf_GetPath();
     test_emf_PolyPolyline();
+    test_emf_playback();
 
     /* For win-format metafiles (mfdrv) */
     test_mf_SaveDC();
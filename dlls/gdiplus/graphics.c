@@ -19,6 +19,14 @@
 #include <stdarg.h>
 #include <math.h>
 #include <limits.h>
+#include <stdlib.h>
+
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define USE_SSE2_BLEND
+#define SSE2_FUNC __attribute__((__target__("sse2")))
+#include <emmintrin.h>
+#endif
 
 #include "windef.h"
 #include "winbase.h"
@@ -354,6 +362,98 @@ static GpStatus get_clip_hrgn(GpGraphics *graphics, HRGN *hrgn)
     return GdipGetRegionHRgn(graphics->clip, NULL, hrgn);
 }
 
+/* Blend a row of ARGB pixels over a 32bppARGB or 32bppRGB row, same as
+ * GdipBitmapGetPixel + color_over + GdipBitmapSetPixel for each pixel. */
+static void blend_row_32bpp(DWORD *dst, const DWORD *src, INT width, BOOL dst_rgb, BOOL src_premult)
+{
+    INT x;
+
+    for (x = 0; x < width; x++)
+    {
+        ARGB dst_color, src_color = src[x];
+
+        if (!(src_color & 0xff000000))
+            continue;
+
+        dst_color = dst_rgb ? dst[x] | 0xff000000 : dst[x];
+        if (src_premult)
+            dst_color = color_over_fgpremult(dst_color, src_color);
+        else
+            dst_color = color_over(dst_color, src_color);
+        dst[x] = dst_rgb ? dst_color & 0xffffff : dst_color;
+    }
+}
+
+#ifdef USE_SSE2_BLEND
+
+/* exact x / 255 for 0 <= x <= 255 * 255 */
+static inline SSE2_FUNC __m128i div255_epu16(__m128i x)
+{
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+}
+
+/* With an opaque destination color_over() reduces to (bg * (255 - a) + fg * a) / 255, and
+ * to (bg * (255 - a) + fg * 255) / 255 for a premultiplied source, which can be done for
+ * four pixels at a time. Groups with a translucent destination pixel use the C code. */
+static SSE2_FUNC void blend_row_32bpp_sse2(DWORD *dst, const DWORD *src, INT width, BOOL dst_rgb, BOOL src_premult)
+{
+    const __m128i zero = _mm_setzero_si128(), alpha_mask = _mm_set1_epi32(0xff000000);
+    const __m128i ff = _mm_set1_epi16(0xff);
+    INT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i d = _mm_loadu_si128((__m128i *)(dst + x));
+        __m128i transparent, alpha, s_lo, s_hi, d_lo, d_hi, a_lo, a_hi, res;
+
+        transparent = _mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), zero);
+        if (_mm_movemask_epi8(transparent) == 0xffff) continue;
+
+        if (!dst_rgb && _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(d, alpha_mask), alpha_mask)) != 0xffff)
+        {
+            blend_row_32bpp(dst + x, src + x, 4, dst_rgb, src_premult);
+            continue;
+        }
+
+        /* broadcast the source alpha to all four channels */
+        alpha = _mm_srli_epi32(s, 24);
+        alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+        a_lo = _mm_unpacklo_epi32(alpha, alpha);
+        a_hi = _mm_unpackhi_epi32(alpha, alpha);
+
+        s_lo = _mm_unpacklo_epi8(s, zero);
+        s_hi = _mm_unpackhi_epi8(s, zero);
+        d_lo = _mm_unpacklo_epi8(d, zero);
+        d_hi = _mm_unpackhi_epi8(d, zero);
+
+        if (src_premult)
+        {
+            s_lo = _mm_mullo_epi16(s_lo, ff);
+            s_hi = _mm_mullo_epi16(s_hi, ff);
+        }
+        else
+        {
+            s_lo = _mm_mullo_epi16(s_lo, a_lo);
+            s_hi = _mm_mullo_epi16(s_hi, a_hi);
+        }
+        d_lo = _mm_add_epi16(_mm_mullo_epi16(d_lo, _mm_sub_epi16(ff, a_lo)), s_lo);
+        d_hi = _mm_add_epi16(_mm_mullo_epi16(d_hi, _mm_sub_epi16(ff, a_hi)), s_hi);
+
+        res = _mm_packus_epi16(div255_epu16(d_lo), div255_epu16(d_hi));
+        res = _mm_andnot_si128(alpha_mask, res);
+        if (!dst_rgb) res = _mm_or_si128(res, alpha_mask);
+
+        /* leave the pixels with a transparent source untouched */
+        res = _mm_or_si128(_mm_andnot_si128(transparent, res), _mm_and_si128(transparent, d));
+        _mm_storeu_si128((__m128i *)(dst + x), res);
+    }
+
+    blend_row_32bpp(dst + x, src + x, width - x, dst_rgb, src_premult);
+}
+
+#endif
+
 /* Draw ARGB data to the given graphics object */
 static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
     const BYTE *src, INT src_width, INT src_height, INT src_stride, const PixelFormat fmt)
@@ -361,6 +461,48 @@ static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_
     GpBitmap *dst_bitmap = (GpBitmap*)graphics->image;
     INT x, y;
 
+    if (dst_bitmap->format == PixelFormat32bppARGB || dst_bitmap->format == PixelFormat32bppRGB)
+    {
+        BOOL dst_rgb = dst_bitmap->format == PixelFormat32bppRGB;
+        BOOL src_premult = (fmt & PixelFormatPAlpha) != 0;
+#ifdef USE_SSE2_BLEND
+        BOOL use_sse2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#endif
+
+        /* pixels outside of the bitmap are ignored by GdipBitmapSetPixel */
+        if (dst_x < 0)
+        {
+            src -= dst_x * 4;
+            src_width += dst_x;
+            dst_x = 0;
+        }
+        if (dst_y < 0)
+        {
+            src -= dst_y * src_stride;
+            src_height += dst_y;
+            dst_y = 0;
+        }
+        src_width = min(src_width, (INT)dst_bitmap->width - dst_x);
+        src_height = min(src_height, (INT)dst_bitmap->height - dst_y);
+
+        for (y=0; y<src_height; y++)
+        {
+            DWORD *dst_row = (DWORD *)(dst_bitmap->bits + dst_bitmap->stride * (y + dst_y)) + dst_x;
+            const DWORD *src_row = (const DWORD *)(src + src_stride * y);
+
+#ifdef USE_SSE2_BLEND
+            if (use_sse2)
+            {
+                blend_row_32bpp_sse2(dst_row, src_row, src_width, dst_rgb, src_premult);
+                continue;
+            }
+#endif
+            blend_row_32bpp(dst_row, src_row, src_width, dst_rgb, src_premult);
+        }
+
+        return Ok;
+    }
+
     for (y=0; y<src_height; y++)
     {
         for (x=0; x<src_width; x++)
@@ -930,72 +1072,107 @@ static ARGB sample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT wi
     return ((DWORD*)(bits))[(x - src_rect->X) + (y - src_rect->Y) * src_rect->Width];
 }
 
-static ARGB resample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
-    UINT height, GpPointF *point, GDIPCONST GpImageAttributes *attributes,
-    InterpolationMode interpolation, PixelOffsetMode offset_mode)
+/* Same as sample_bitmap_pixel(), with the common case of a pixel inside of
+ * the sampled area inlined. */
+static inline ARGB fetch_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
+    UINT height, INT x, INT y, GDIPCONST GpImageAttributes *attributes)
 {
-    static int fixme;
+    if ((UINT)(x - src_rect->X) < src_rect->Width && (UINT)(y - src_rect->Y) < src_rect->Height)
+        return ((DWORD*)(bits))[(x - src_rect->X) + (y - src_rect->Y) * src_rect->Width];
 
-    switch (interpolation)
+    return sample_bitmap_pixel(src_rect, bits, width, height, x, y, attributes);
+}
+
+static inline ARGB resample_bitmap_pixel_bilinear(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
+    UINT height, GpPointF *point, GDIPCONST GpImageAttributes *attributes)
+{
+    REAL leftxf, topyf;
+    INT leftx, rightx, topy, bottomy;
+    ARGB topleft, topright, bottomleft, bottomright;
+    ARGB top, bottom;
+    float x_offset;
+
+    leftxf = floorf(point->X);
+    leftx = (INT)leftxf;
+    rightx = (INT)ceilf(point->X);
+    topyf = floorf(point->Y);
+    topy = (INT)topyf;
+    bottomy = (INT)ceilf(point->Y);
+
+    if (leftx == rightx && topy == bottomy)
+        return fetch_bitmap_pixel(src_rect, bits, width, height,
+            leftx, topy, attributes);
+
+    topleft = fetch_bitmap_pixel(src_rect, bits, width, height,
+        leftx, topy, attributes);
+    topright = fetch_bitmap_pixel(src_rect, bits, width, height,
+        rightx, topy, attributes);
+    bottomleft = fetch_bitmap_pixel(src_rect, bits, width, height,
+        leftx, bottomy, attributes);
+    bottomright = fetch_bitmap_pixel(src_rect, bits, width, height,
+        rightx, bottomy, attributes);
+
+    x_offset = point->X - leftxf;
+    top = blend_colors(topleft, topright, x_offset);
+    bottom = blend_colors(bottomleft, bottomright, x_offset);
+
+    return blend_colors(top, bottom, point->Y - topyf);
+}
+
+static FLOAT get_nearest_pixel_offset(PixelOffsetMode offset_mode)
+{
+    switch (offset_mode)
     {
     default:
-        if (!fixme++)
-            FIXME("Unimplemented interpolation %i\n", interpolation);
-        /* fall-through */
-    case InterpolationModeBilinear:
-    {
-        REAL leftxf, topyf;
-        INT leftx, rightx, topy, bottomy;
-        ARGB topleft, topright, bottomleft, bottomright;
-        ARGB top, bottom;
-        float x_offset;
-
-        leftxf = floorf(point->X);
-        leftx = (INT)leftxf;
-        rightx = (INT)ceilf(point->X);
-        topyf = floorf(point->Y);
-        topy = (INT)topyf;
-        bottomy = (INT)ceilf(point->Y);
-
-        if (leftx == rightx && topy == bottomy)
-            return sample_bitmap_pixel(src_rect, bits, width, height,
-                leftx, topy, attributes);
-
-        topleft = sample_bitmap_pixel(src_rect, bits, width, height,
-            leftx, topy, attributes);
-        topright = sample_bitmap_pixel(src_rect, bits, width, height,
-            rightx, topy, attributes);
-        bottomleft = sample_bitmap_pixel(src_rect, bits, width, height,
-            leftx, bottomy, attributes);
-        bottomright = sample_bitmap_pixel(src_rect, bits, width, height,
-            rightx, bottomy, attributes);
+    case PixelOffsetModeNone:
+    case PixelOffsetModeHighSpeed:
+        return 0.5;
 
-        x_offset = point->X - leftxf;
-        top = blend_colors(topleft, topright, x_offset);
-        bottom = blend_colors(bottomleft, bottomright, x_offset);
+    case PixelOffsetModeHalf:
+    case PixelOffsetModeHighQuality:
+        return 0.0;
+    }
+}
+
+/* Resample the span of count destination pixels starting at (x, y), the source
+ * position of a pixel is origin + x * (x_dx, x_dy) + y * (y_dx, y_dy). Pixels
+ * mapping outside of bounds, if given, are set to 0. The interpolation mode is
+ * only looked at once per span. */
+static void resample_bitmap_row(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
+    UINT height, GDIPCONST GpPointF *origin, REAL x_dx, REAL x_dy, REAL y_dx, REAL y_dy,
+    INT x, INT y, INT count, ARGB *dst, GDIPCONST GpRectF *bounds,
+    GDIPCONST GpImageAttributes *attributes, InterpolationMode interpolation,
+    PixelOffsetMode offset_mode)
+{
+    FLOAT pixel_offset = get_nearest_pixel_offset(offset_mode);
+    GpPointF point;
+    INT end = x + count;
 
-        return blend_colors(top, bottom, point->Y - topyf);
+    if (interpolation != InterpolationModeNearestNeighbor && interpolation != InterpolationModeBilinear)
+    {
+        static int fixme;
+        if (!fixme++)
+            FIXME("Unimplemented interpolation %i\n", interpolation);
     }
-    case InterpolationModeNearestNeighbor:
+
+    for (; x < end; x++, dst++)
     {
-        FLOAT pixel_offset;
-        switch (offset_mode)
-        {
-        default:
-        case PixelOffsetModeNone:
-        case PixelOffsetModeHighSpeed:
-            pixel_offset = 0.5;
-            break;
+        /* evaluated the same way for each pixel so that rounding doesn't depend on the span */
+        point.X = origin->X + x * x_dx + y * y_dx;
+        point.Y = origin->Y + x * x_dy + y * y_dy;
 
-        case PixelOffsetModeHalf:
-        case PixelOffsetModeHighQuality:
-            pixel_offset = 0.0;
-            break;
+        if (bounds && !(point.X >= bounds->X && point.X < bounds->X + bounds->Width &&
+                        point.Y >= bounds->Y && point.Y < bounds->Y + bounds->Height))
+        {
+            *dst = 0;
+            continue;
         }
-        return sample_bitmap_pixel(src_rect, bits, width, height,
-            floorf(point->X + pixel_offset), floorf(point->Y + pixel_offset), attributes);
-    }
 
+        if (interpolation == InterpolationModeNearestNeighbor)
+            *dst = fetch_bitmap_pixel(src_rect, bits, width, height,
+                floorf(point.X + pixel_offset), floorf(point.Y + pixel_offset), attributes);
+        else
+            *dst = resample_bitmap_pixel_bilinear(src_rect, bits, width, height, &point, attributes);
     }
 }
 
@@ -1096,9 +1273,12 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
     {
         int x, y;
         GpSolidFill *fill = (GpSolidFill*)brush;
-        for (x=0; x<fill_area->Width; x++)
-            for (y=0; y<fill_area->Height; y++)
-                argb_pixels[x + y*cdwStride] = fill->color;
+        for (y=0; y<fill_area->Height; y++)
+        {
+            DWORD *row = argb_pixels + y*cdwStride;
+            for (x=0; x<fill_area->Width; x++)
+                row[x] = fill->color;
+        }
         return Ok;
     }
     case BrushTypeHatchFill:
@@ -1110,20 +1290,24 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         if (get_hatch_data(fill->hatchstyle, &hatch_data) != Ok)
             return NotImplemented;
 
-        for (x=0; x<fill_area->Width; x++)
-            for (y=0; y<fill_area->Height; y++)
-            {
-                int hx, hy;
+        for (y=0; y<fill_area->Height; y++)
+        {
+            DWORD *row = argb_pixels + y*cdwStride;
+            int hy;
 
-                /* FIXME: Account for the rendering origin */
-                hx = (x + fill_area->X) % 8;
-                hy = (y + fill_area->Y) % 8;
+            /* FIXME: Account for the rendering origin */
+            hy = (y + fill_area->Y) % 8;
+
+            for (x=0; x<fill_area->Width; x++)
+            {
+                int hx = (x + fill_area->X) % 8;
 
                 if ((hatch_data[7-hy] & (0x80 >> hx)) != 0)
-                    argb_pixels[x + y*cdwStride] = fill->forecol;
+                    row[x] = fill->forecol;
                 else
-                    argb_pixels[x + y*cdwStride] = fill->backcol;
+                    row[x] = fill->backcol;
             }
+        }
 
         return Ok;
     }
@@ -1192,7 +1376,7 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         GpTexture *fill = (GpTexture*)brush;
         GpPointF draw_points[3];
         GpStatus stat;
-        int x, y;
+        int y;
         GpBitmap *bitmap;
         int src_stride;
         GpRect src_area;
@@ -1274,17 +1458,10 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
 
             for (y=0; y<fill_area->Height; y++)
             {
-                for (x=0; x<fill_area->Width; x++)
-                {
-                    GpPointF point;
-                    point.X = draw_points[0].X + x * x_dx + y * y_dx;
-                    point.Y = draw_points[0].Y + y * x_dy + y * y_dy;
-
-                    argb_pixels[x + y*cdwStride] = resample_bitmap_pixel(
-                        &src_area, fill->bitmap_bits, bitmap->width, bitmap->height,
-                        &point, fill->imageattributes, graphics->interpolation,
-                        graphics->pixeloffset);
-                }
+                resample_bitmap_row(&src_area, fill->bitmap_bits, bitmap->width, bitmap->height,
+                    &draw_points[0], x_dx, x_dy, y_dx, y_dy, 0, y, fill_area->Width,
+                    argb_pixels + y*cdwStride, NULL, fill->imageattributes,
+                    graphics->interpolation, graphics->pixeloffset);
             }
         }
 
@@ -2940,7 +3117,7 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             RECT dst_area;
             GpRectF graphics_bounds;
             GpRect src_area;
-            int i, x, y, src_stride, dst_stride;
+            int i, y, src_stride, dst_stride;
             GpMatrix dst_to_src;
             REAL m11, m12, m21, m22, mdx, mdy;
             LPBYTE src_data, dst_data, dst_dyn_data=NULL;
@@ -2949,6 +3126,7 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             PixelOffsetMode offset_mode = graphics->pixeloffset;
             GpPointF dst_to_src_points[3] = {{0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0}};
             REAL x_dx, x_dy, y_dx, y_dy;
+            GpRectF src_bounds;
             static const GpImageAttributes defaultImageAttributes = {WrapModeClamp, 0, FALSE};
 
             if (!imageAttributes)
@@ -3054,24 +3232,17 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
                 y_dx = dst_to_src_points[2].X - dst_to_src_points[0].X;
                 y_dy = dst_to_src_points[2].Y - dst_to_src_points[0].Y;
 
-                for (x=dst_area.left; x<dst_area.right; x++)
-                {
-                    for (y=dst_area.top; y<dst_area.bottom; y++)
-                    {
-                        GpPointF src_pointf;
-                        ARGB *dst_color;
-
-                        src_pointf.X = dst_to_src_points[0].X + x * x_dx + y * y_dx;
-                        src_pointf.Y = dst_to_src_points[0].Y + x * x_dy + y * y_dy;
+                src_bounds.X = srcx;
+                src_bounds.Y = srcy;
+                src_bounds.Width = srcwidth;
+                src_bounds.Height = srcheight;
 
-                        dst_color = (ARGB*)(dst_data + dst_stride * (y - dst_area.top) + sizeof(ARGB) * (x - dst_area.left));
-
-                        if (src_pointf.X >= srcx && src_pointf.X < srcx + srcwidth && src_pointf.Y >= srcy && src_pointf.Y < srcy+srcheight)
-                            *dst_color = resample_bitmap_pixel(&src_area, src_data, bitmap->width, bitmap->height, &src_pointf,
-                                                               imageAttributes, interpolation, offset_mode);
-                        else
-                            *dst_color = 0;
-                    }
+                for (y=dst_area.top; y<dst_area.bottom; y++)
+                {
+                    resample_bitmap_row(&src_area, src_data, bitmap->width, bitmap->height,
+                        &dst_to_src_points[0], x_dx, x_dy, y_dx, y_dy, dst_area.left, y,
+                        dst_area.right - dst_area.left, (ARGB*)(dst_data + dst_stride * (y - dst_area.top)),
+                        &src_bounds, imageAttributes, interpolation, offset_mode);
                 }
             }
             else
@@ -3684,6 +3855,272 @@ end:
     return retval;
 }
 
+/* Anti-aliased scanline rasterizer. Each pixel row is sampled by RASTER_SUBSAMPLES
+ * sub-scanlines, the spans between the edge crossings of a sub-scanline add their
+ * exact horizontal coverage (in 1/256 of a pixel) to the row, and the coverage is
+ * then applied to the alpha of the brush pixels. */
+#define RASTER_SUBSAMPLES 4
+
+struct raster_edge
+{
+    REAL x;         /* x at y_top */
+    REAL dxdy;
+    REAL y_top;
+    REAL y_bottom;
+    INT dir;        /* 1 for a downward edge, -1 for an upward edge */
+};
+
+struct raster_crossing
+{
+    REAL x;
+    INT dir;
+};
+
+static int compare_raster_edges(const void *a, const void *b)
+{
+    const struct raster_edge *edge1 = a, *edge2 = b;
+
+    if (edge1->y_top < edge2->y_top) return -1;
+    return edge1->y_top > edge2->y_top;
+}
+
+static void raster_add_span(INT *cover, INT *delta, REAL left, REAL right, INT width)
+{
+    INT start, end;
+
+    if (left < 0.0) left = 0.0;
+    if (right > width) right = width;
+    if (right <= left) return;
+
+    start = (INT)(left * 256.0 + 0.5);
+    end = (INT)(right * 256.0 + 0.5);
+
+    if (start >> 8 == end >> 8)
+    {
+        cover[start >> 8] += end - start;
+        return;
+    }
+
+    /* partial first and last pixels, full pixels in between */
+    cover[start >> 8] += 256 - (start & 0xff);
+    delta[(start >> 8) + 1] += 256;
+    delta[end >> 8] -= 256;
+    cover[end >> 8] += end & 0xff;
+}
+
+static void raster_build_edges(GpPath *path, struct raster_edge *edges, INT *count, GpRectF *bounds)
+{
+    GpPointF *points = path->pathdata.Points;
+    BYTE *types = path->pathdata.Types;
+    REAL min_x = 0.0, min_y = 0.0, max_x = 0.0, max_y = 0.0;
+    INT i, figure_start = 0;
+
+    *count = 0;
+    for (i = 0; i < path->pathdata.Count; i++)
+    {
+        const GpPointF *start = &points[i], *end;
+
+        if ((types[i] & PathPointTypePathTypeMask) == PathPointTypeStart)
+            figure_start = i;
+
+        /* figures are implicitly closed when filled */
+        if ((types[i] & PathPointTypeCloseSubpath) || i + 1 == path->pathdata.Count ||
+            (types[i + 1] & PathPointTypePathTypeMask) == PathPointTypeStart)
+            end = &points[figure_start];
+        else
+            end = &points[i + 1];
+
+        if (!i || start->X < min_x) min_x = start->X;
+        if (!i || start->X > max_x) max_x = start->X;
+        if (!i || start->Y < min_y) min_y = start->Y;
+        if (!i || start->Y > max_y) max_y = start->Y;
+
+        if (start->Y == end->Y) continue;
+
+        if (start->Y < end->Y)
+        {
+            edges[*count].dir = 1;
+        }
+        else
+        {
+            const GpPointF *tmp = start;
+            start = end;
+            end = tmp;
+            edges[*count].dir = -1;
+        }
+        edges[*count].x = start->X;
+        edges[*count].dxdy = (end->X - start->X) / (end->Y - start->Y);
+        edges[*count].y_top = start->Y;
+        edges[*count].y_bottom = end->Y;
+        (*count)++;
+    }
+
+    bounds->X = min_x;
+    bounds->Y = min_y;
+    bounds->Width = max_x - min_x;
+    bounds->Height = max_y - min_y;
+
+    qsort(edges, *count, sizeof(*edges), compare_raster_edges);
+}
+
+/* Compute the coverage of the pixels of one row and apply it to their alpha. */
+static void raster_fill_row(const struct raster_edge *edges, INT edge_count, INT *next_edge,
+    INT *active, INT *active_count, struct raster_crossing *crossings, INT *cover, INT *delta,
+    GpFillMode fill_mode, INT left, INT y, INT width, ARGB *pixels)
+{
+    INT i, j, s, winding, count, running;
+
+    memset(cover, 0, sizeof(*cover) * (width + 1));
+    memset(delta, 0, sizeof(*delta) * (width + 1));
+
+    for (s = 0; s < RASTER_SUBSAMPLES; s++)
+    {
+        REAL sample_y = y + (s + 0.5) / RASTER_SUBSAMPLES;
+
+        while (*next_edge < edge_count && edges[*next_edge].y_top <= sample_y)
+            active[(*active_count)++] = (*next_edge)++;
+
+        /* drop the edges ending above the sample, and sort the crossings by x */
+        count = 0;
+        for (i = 0; i < *active_count; i++)
+        {
+            const struct raster_edge *edge = &edges[active[i]];
+            struct raster_crossing crossing;
+
+            if (edge->y_bottom <= sample_y)
+            {
+                active[i--] = active[--(*active_count)];
+                continue;
+            }
+            crossing.x = edge->x + (sample_y - edge->y_top) * edge->dxdy - left;
+            crossing.dir = edge->dir;
+            for (j = count; j > 0 && crossings[j - 1].x > crossing.x; j--)
+                crossings[j] = crossings[j - 1];
+            crossings[j] = crossing;
+            count++;
+        }
+
+        winding = 0;
+        for (i = 0; i + 1 < count; i++)
+        {
+            winding += crossings[i].dir;
+            if (fill_mode == FillModeAlternate ? (winding & 1) : winding != 0)
+                raster_add_span(cover, delta, crossings[i].x, crossings[i + 1].x, width);
+        }
+    }
+
+    running = 0;
+    for (i = 0; i < width; i++)
+    {
+        INT coverage;
+
+        running += delta[i];
+        coverage = running + cover[i];
+
+        if (coverage <= 0)
+            pixels[i] = 0;
+        else if (coverage < 256 * RASTER_SUBSAMPLES)
+            pixels[i] = (pixels[i] & 0xffffff) |
+                ((((pixels[i] >> 24) * coverage + 128 * RASTER_SUBSAMPLES) / (256 * RASTER_SUBSAMPLES)) << 24);
+    }
+}
+
+static GpStatus fill_path_antialiased(GpGraphics *graphics, GpBrush *brush, GpPath *path)
+{
+    GpStatus stat;
+    GpPath *flat_path;
+    GpMatrix world_to_device;
+    GpRectF path_bounds, graphics_bounds;
+    GpRect fill_area;
+    struct raster_edge *edges = NULL;
+    struct raster_crossing *crossings = NULL;
+    INT *active = NULL, *cover = NULL, *delta, edge_count, active_count = 0, next_edge = 0, y;
+    INT left, top, right, bottom;
+    ARGB *pixels = NULL;
+
+    stat = get_graphics_bounds(graphics, &graphics_bounds);
+    if (stat != Ok)
+        return stat;
+
+    stat = GdipClonePath(path, &flat_path);
+    if (stat != Ok)
+        return stat;
+
+    stat = get_graphics_transform(graphics, CoordinateSpaceDevice,
+        CoordinateSpaceWorld, &world_to_device);
+
+    /* pixel centres are on integer coordinates unless the pixel offset mode says otherwise,
+     * shifting the path is the same as moving the sample grid of the rows back */
+    if (stat == Ok)
+    {
+        REAL offset = get_nearest_pixel_offset(graphics->pixeloffset);
+        stat = GdipTranslateMatrix(&world_to_device, offset, offset, MatrixOrderAppend);
+    }
+
+    if (stat == Ok)
+        stat = GdipTransformPath(flat_path, &world_to_device);
+
+    if (stat == Ok)
+        stat = GdipFlattenPath(flat_path, NULL, 0.25);
+
+    if (stat == Ok && flat_path->pathdata.Count < 2)
+        goto done;
+
+    if (stat == Ok && !(edges = heap_alloc(sizeof(*edges) * flat_path->pathdata.Count)))
+        stat = OutOfMemory;
+
+    if (stat != Ok)
+        goto done;
+
+    raster_build_edges(flat_path, edges, &edge_count, &path_bounds);
+
+    left = max(floorf(path_bounds.X), floorf(graphics_bounds.X));
+    top = max(floorf(path_bounds.Y), floorf(graphics_bounds.Y));
+    right = min(ceilf(path_bounds.X + path_bounds.Width), ceilf(graphics_bounds.X + graphics_bounds.Width));
+    bottom = min(ceilf(path_bounds.Y + path_bounds.Height), ceilf(graphics_bounds.Y + graphics_bounds.Height));
+
+    if (!edge_count || left >= right || top >= bottom)
+        goto done;
+
+    fill_area.X = left;
+    fill_area.Y = top;
+    fill_area.Width = right - left;
+    fill_area.Height = bottom - top;
+
+    pixels = heap_alloc(sizeof(*pixels) * fill_area.Width * fill_area.Height);
+    crossings = heap_alloc(sizeof(*crossings) * edge_count);
+    active = heap_alloc(sizeof(*active) * edge_count);
+    cover = heap_alloc(sizeof(*cover) * (fill_area.Width + 1) * 2);
+    if (!pixels || !crossings || !active || !cover)
+    {
+        stat = OutOfMemory;
+        goto done;
+    }
+    delta = cover + fill_area.Width + 1;
+
+    stat = brush_fill_pixels(graphics, brush, pixels, &fill_area, fill_area.Width);
+
+    if (stat == Ok)
+    {
+        for (y = top; y < bottom; y++)
+            raster_fill_row(edges, edge_count, &next_edge, active, &active_count, crossings,
+                cover, delta, flat_path->fill, left, y, fill_area.Width,
+                pixels + (y - top) * fill_area.Width);
+
+        stat = alpha_blend_pixels(graphics, left, top, (BYTE *)pixels, fill_area.Width,
+            fill_area.Height, fill_area.Width * 4, PixelFormat32bppARGB);
+    }
+
+done:
+    heap_free(cover);
+    heap_free(active);
+    heap_free(crossings);
+    heap_free(pixels);
+    heap_free(edges);
+    GdipDeletePath(flat_path);
+    return stat;
+}
+
 static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPath *path)
 {
     GpStatus stat;
@@ -3692,6 +4129,9 @@ static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPa
     if (!brush_can_fill_pixels(brush))
         return NotImplemented;
 
+    if (graphics->smoothing == SmoothingModeAntiAlias || graphics->smoothing == SmoothingModeHighQuality)
+        return fill_path_antialiased(graphics, brush, path);
+
     /* FIXME: This could probably be done more efficiently without regions. */
 
     stat = GdipCreateRegionPath(path, &rgn);
@@ -5763,6 +5763,81 @@ static void test_GdipFillRectangles(void)
     ReleaseDC(hwnd, hdc);
 }
 
+static void check_fill_path_antialias(PixelOffsetMode mode, REAL x, REAL y)
+{
+    GpStatus status;
+    GpGraphics *graphics = NULL;
+    GpBitmap *bitmap = NULL;
+    GpBrush *brush = NULL;
+    GpPath *path = NULL;
+    ARGB color;
+
+    status = GdipCreateBitmapFromScan0(8, 8, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, status);
+
+    status = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+    expect(Ok, status);
+
+    status = GdipSetSmoothingMode(graphics, SmoothingModeAntiAlias);
+    expect(Ok, status);
+
+    status = GdipSetPixelOffsetMode(graphics, mode);
+    expect(Ok, status);
+
+    status = GdipCreateSolidFill((ARGB)0xff0000ff, (GpSolidFill**)&brush);
+    expect(Ok, status);
+
+    status = GdipCreatePath(FillModeAlternate, &path);
+    expect(Ok, status);
+
+    status = GdipAddPathRectangle(path, x, y, 4.0, 4.0);
+    expect(Ok, status);
+
+    status = GdipFillPath(graphics, brush, path);
+    expect(Ok, status);
+
+    GdipDeletePath(path);
+    GdipDeleteBrush(brush);
+    GdipDeleteGraphics(graphics);
+
+    status = GdipBitmapGetPixel(bitmap, 3, 3, &color);
+    expect(Ok, status);
+    ok(color == 0xff0000ff, "mode %d: expected covered pixel, got %08x\n", mode, color);
+
+    status = GdipBitmapGetPixel(bitmap, 0, 0, &color);
+    expect(Ok, status);
+    ok(color == 0, "mode %d: expected empty pixel, got %08x\n", mode, color);
+
+    status = GdipBitmapGetPixel(bitmap, 6, 3, &color);
+    expect(Ok, status);
+    ok(color == 0, "mode %d: expected empty pixel, got %08x\n", mode, color);
+
+    /* half covered pixels */
+    status = GdipBitmapGetPixel(bitmap, 1, 3, &color);
+    expect(Ok, status);
+    ok((color & 0xffffff) == 0xff && (color >> 24) > 0x40 && (color >> 24) < 0xc0,
+       "mode %d: expected partially covered pixel, got %08x\n", mode, color);
+
+    status = GdipBitmapGetPixel(bitmap, 3, 5, &color);
+    expect(Ok, status);
+    ok((color & 0xffffff) == 0xff && (color >> 24) > 0x40 && (color >> 24) < 0xc0,
+       "mode %d: expected partially covered pixel, got %08x\n", mode, color);
+
+    GdipDisposeImage((GpImage*)bitmap);
+}
+
+static void test_GdipFillPath_antialias(void)
+{
+    /* pixel centres are on integer coordinates by default, edges there cover half a pixel */
+    check_fill_path_antialias(PixelOffsetModeDefault, 1.0, 1.0);
+    check_fill_path_antialias(PixelOffsetModeHighSpeed, 1.0, 1.0);
+    check_fill_path_antialias(PixelOffsetModeNone, 1.0, 1.0);
+
+    /* and on half coordinates with a half pixel offset */
+    check_fill_path_antialias(PixelOffsetModeHalf, 1.5, 1.5);
+    check_fill_path_antialias(PixelOffsetModeHighQuality, 1.5, 1.5);
+}
+
 static void test_GdipGetVisibleClipBounds_memoryDC(void)
 {
     HDC hdc,dc;
@@ -5890,6 +5965,7 @@ START_TEST(graphics)
     test_alpha_hdc();
     test_bitmapfromgraphics();
     test_GdipFillRectangles();
+    test_GdipFillPath_antialias();
     test_GdipGetVisibleClipBounds_memoryDC();
 
     GdiplusShutdown(gdiplusToken);
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -86,6 +87,10 @@
 #include "ifenum.h"
 #include "ws2ipdef.h"
 
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(iphlpapi);
+
 #ifdef HAVE_STRUCT_SOCKADDR_SA_LEN
 #define ifreq_len(ifr) \
  max(sizeof(struct ifreq), sizeof((ifr)->ifr_name)+(ifr)->ifr_addr.sa_len)
@@ -166,7 +171,7 @@ BOOL isIfIndexLoopback(ULONG idx)
 }
 
 #ifdef HAVE_IF_NAMEINDEX
-DWORD get_interface_indices( BOOL skip_loopback, InterfaceIndexTable **table )
+static DWORD enum_interface_indices( BOOL skip_loopback, InterfaceIndexTable **table )
 {
     DWORD count = 0, i;
     struct if_nameindex *p, *indices = if_nameindex();
@@ -352,7 +357,7 @@ static DWORD get_indices_from_reply( struct netlink_reply *reply, int pid, int s
     return count;
 }
 
-DWORD get_interface_indices( BOOL skip_loopback, InterfaceIndexTable **table )
+static DWORD enum_interface_indices( BOOL skip_loopback, InterfaceIndexTable **table )
 {
     int fd, pid, seq;
     struct netlink_reply *reply = NULL;
@@ -391,13 +396,157 @@ end:
 }
 
 #else
-DWORD get_interface_indices( BOOL skip_loopback, InterfaceIndexTable **table )
+static DWORD enum_interface_indices( BOOL skip_loopback, InterfaceIndexTable **table )
 {
     if (table) *table = NULL;
     return 0;
 }
 #endif
 
+/* Interface indices and IPv4 addresses are cached until the kernel reports a
+ * link or address change on an rtnetlink socket subscribed to those events.
+ * Without such a socket nothing is cached.
+ */
+static CRITICAL_SECTION ifenum_cs;
+static CRITICAL_SECTION_DEBUG ifenum_cs_debug =
+{
+    0, 0, &ifenum_cs,
+    { &ifenum_cs_debug.ProcessLocksList, &ifenum_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": ifenum_cs") }
+};
+static CRITICAL_SECTION ifenum_cs = { &ifenum_cs_debug, -1, 0, 0, 0, 0 };
+
+static InterfaceIndexTable *index_cache[2]; /* indexed by skip_loopback */
+static MIB_IPADDRTABLE *ipaddr_cache;
+
+static void flush_interface_cache( void )
+{
+    HeapFree( GetProcessHeap(), 0, index_cache[0] );
+    HeapFree( GetProcessHeap(), 0, index_cache[1] );
+    HeapFree( GetProcessHeap(), 0, ipaddr_cache );
+    index_cache[0] = index_cache[1] = NULL;
+    ipaddr_cache = NULL;
+}
+
+#ifdef HAVE_LINUX_RTNETLINK_H
+
+static int open_change_socket( unsigned int groups )
+{
+    struct sockaddr_nl addr;
+    int fd;
+
+    if ((fd = socket( AF_NETLINK, SOCK_RAW, NETLINK_ROUTE )) < 0) return -1;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = groups;
+    if (bind( fd, (struct sockaddr *)&addr, sizeof(addr) ) < 0)
+    {
+        close( fd );
+        return -1;
+    }
+    return fd;
+}
+
+/* caller must hold ifenum_cs; returns FALSE if caching isn't possible */
+static BOOL update_interface_cache( void )
+{
+    static int change_fd = -2;
+    char buf[4096];
+    BOOL changed = FALSE;
+    int ret;
+
+    if (change_fd == -2)
+    {
+        change_fd = open_change_socket( RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR );
+        if (change_fd == -1) WARN( "can't subscribe to interface changes, not caching\n" );
+    }
+    if (change_fd == -1) return FALSE;
+
+    for (;;)
+    {
+        if ((ret = recv( change_fd, buf, sizeof(buf), MSG_DONTWAIT )) > 0) changed = TRUE;
+        else if (ret < 0 && errno == ENOBUFS) changed = TRUE; /* events were dropped */
+        else if (ret < 0 && errno == EINTR) continue;
+        else break;
+    }
+    if (changed)
+    {
+        TRACE( "interfaces changed, flushing cache\n" );
+        flush_interface_cache();
+    }
+    return TRUE;
+}
+
+DWORD wait_for_address_change(void)
+{
+    struct sockaddr_nl addr;
+    socklen_t len;
+    char buf[4096];
+    int fd;
+
+    if ((fd = open_change_socket( RTMGRP_IPV4_IFADDR )) < 0) return ERROR_NOT_SUPPORTED;
+    for (;;)
+    {
+        len = sizeof(addr);
+        if (recvfrom( fd, buf, sizeof(buf), 0, (struct sockaddr *)&addr, &len ) < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == ENOBUFS) break;
+            close( fd );
+            return ERROR_NOT_SUPPORTED;
+        }
+        if (!addr.nl_pid) break; /* from the kernel */
+    }
+    close( fd );
+    return NO_ERROR;
+}
+
+#else
+
+static BOOL update_interface_cache( void )
+{
+    return FALSE;
+}
+
+DWORD wait_for_address_change(void)
+{
+    return ERROR_NOT_SUPPORTED;
+}
+
+#endif
+
+static InterfaceIndexTable *copy_index_table( const InterfaceIndexTable *src )
+{
+    DWORD size = FIELD_OFFSET(InterfaceIndexTable, indexes[src->numIndexes]);
+    InterfaceIndexTable *ret;
+
+    if ((ret = HeapAlloc( GetProcessHeap(), 0, size ))) memcpy( ret, src, size );
+    return ret;
+}
+
+DWORD get_interface_indices( BOOL skip_loopback, InterfaceIndexTable **table )
+{
+    InterfaceIndexTable **cache = &index_cache[skip_loopback != 0];
+    DWORD count;
+
+    EnterCriticalSection( &ifenum_cs );
+    if (update_interface_cache())
+    {
+        if (!*cache) enum_interface_indices( skip_loopback, cache );
+        if (*cache)
+        {
+            count = (*cache)->numIndexes;
+            if (table && !(*table = copy_index_table( *cache ))) count = 0;
+            LeaveCriticalSection( &ifenum_cs );
+            return count;
+        }
+    }
+    count = enum_interface_indices( skip_loopback, table );
+    LeaveCriticalSection( &ifenum_cs );
+    return count;
+}
+
 static DWORD getInterfaceBCastAddrByName(const char *name)
 {
   DWORD ret = INADDR_ANY;
@@ -843,7 +992,7 @@ DWORD getNumIPAddresses(void)
   return numAddresses;
 }
 
-DWORD getIPAddrTable(PMIB_IPADDRTABLE *ppIpAddrTable, HANDLE heap, DWORD flags)
+static DWORD enumIPAddrTable(PMIB_IPADDRTABLE *ppIpAddrTable, HANDLE heap, DWORD flags)
 {
   DWORD ret;
 
@@ -1048,7 +1197,7 @@ DWORD getNumIPAddresses(void)
   return numAddresses;
 }
 
-DWORD getIPAddrTable(PMIB_IPADDRTABLE *ppIpAddrTable, HANDLE heap, DWORD flags)
+static DWORD enumIPAddrTable(PMIB_IPADDRTABLE *ppIpAddrTable, HANDLE heap, DWORD flags)
 {
   DWORD ret;
 
@@ -1107,6 +1256,34 @@ ULONG v6addressesFromIndex(IF_INDEX index, SOCKET_ADDRESS **addrs, ULONG *num_ad
 
 #endif
 
+DWORD getIPAddrTable(PMIB_IPADDRTABLE *ppIpAddrTable, HANDLE heap, DWORD flags)
+{
+    DWORD ret, size;
+
+    if (!ppIpAddrTable) return ERROR_INVALID_PARAMETER;
+
+    EnterCriticalSection( &ifenum_cs );
+    if (update_interface_cache())
+    {
+        if (!ipaddr_cache && enumIPAddrTable( &ipaddr_cache, GetProcessHeap(), 0 )) ipaddr_cache = NULL;
+        if (ipaddr_cache)
+        {
+            size = FIELD_OFFSET(MIB_IPADDRTABLE, table[max( ipaddr_cache->dwNumEntries, 1 )]);
+            if ((*ppIpAddrTable = HeapAlloc( heap, flags, size )))
+            {
+                memcpy( *ppIpAddrTable, ipaddr_cache, size );
+                ret = NO_ERROR;
+            }
+            else ret = ERROR_OUTOFMEMORY;
+            LeaveCriticalSection( &ifenum_cs );
+            return ret;
+        }
+    }
+    ret = enumIPAddrTable( ppIpAddrTable, heap, flags );
+    LeaveCriticalSection( &ifenum_cs );
+    return ret;
+}
+
 char *toIPAddressString(unsigned int addr, char string[16])
 {
   if (string) {
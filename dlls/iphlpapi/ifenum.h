@@ -57,6 +57,11 @@ typedef struct _InterfaceIndexTable {
  */
 DWORD get_interface_indices( BOOL skip_loopback, InterfaceIndexTable **table ) DECLSPEC_HIDDEN;
 
+/* Blocks until an IPv4 address is added or removed.  Returns NO_ERROR, or
+ * ERROR_NOT_SUPPORTED if change notifications aren't available.
+ */
+DWORD wait_for_address_change(void) DECLSPEC_HIDDEN;
+
 /* ByName/ByIndex versions of various getter functions. */
 
 /* can be used as quick check to see if you've got a valid index, returns NULL
@@ -263,6 +263,26 @@ static void testGetIpAddrTable(void)
                 ntoa(buf->table[i].dwAddr), buf->table[i].dwIndex, buf->table[i].wType);
         }
       }
+      if (apiReturn == NO_ERROR)
+      {
+        /* the table is copied to the caller's buffer, overwriting it doesn't change later queries */
+        PMIB_IPADDRTABLE copy = HeapAlloc(GetProcessHeap(), 0, dwSize);
+        ULONG size2 = dwSize;
+
+        memcpy(copy, buf, dwSize);
+        memset(buf, 0xcc, dwSize);
+        apiReturn = pGetIpAddrTable(buf, &size2, FALSE);
+        ok(apiReturn == NO_ERROR, "GetIpAddrTable returned %d, expected NO_ERROR\n", apiReturn);
+        if (apiReturn == NO_ERROR)
+        {
+          ok(buf->dwNumEntries == copy->dwNumEntries, "got %u entries, expected %u\n",
+             buf->dwNumEntries, copy->dwNumEntries);
+          if (buf->dwNumEntries == copy->dwNumEntries)
+            ok(!memcmp(buf->table, copy->table, copy->dwNumEntries * sizeof(MIB_IPADDRROW)),
+               "tables differ\n");
+        }
+        HeapFree(GetProcessHeap(), 0, copy);
+      }
       HeapFree(GetProcessHeap(), 0, buf);
     }
   }
@@ -1649,32 +1649,50 @@ BOOL WINAPI DisconnectNamedPipe(HANDLE hPipe)
 
 /***********************************************************************
  *           TransactNamedPipe   (KERNEL32.@)
- *
- * BUGS
- *  should be done as a single operation in the wineserver or kernel
  */
 BOOL WINAPI TransactNamedPipe(
     HANDLE handle, LPVOID write_buf, DWORD write_size, LPVOID read_buf,
     DWORD read_size, LPDWORD bytes_read, LPOVERLAPPED overlapped)
 {
-    BOOL r;
-    DWORD count;
+    IO_STATUS_BLOCK iosb;
+    PIO_STATUS_BLOCK io_status = &iosb;
+    HANDLE event = 0;
+    LPVOID cvalue = NULL;
+    NTSTATUS status;
 
     TRACE("%p %p %d %p %d %p %p\n",
           handle, write_buf, write_size, read_buf,
           read_size, bytes_read, overlapped);
 
+    if (bytes_read) *bytes_read = 0;
+
     if (overlapped)
     {
-        FIXME("Doesn't support overlapped operation as yet\n");
-        return FALSE;
+        event = overlapped->hEvent;
+        io_status = (PIO_STATUS_BLOCK)overlapped;
+        if (((ULONG_PTR)event & 1) == 0) cvalue = overlapped;
     }
+    io_status->u.Status = STATUS_PENDING;
+    io_status->Information = 0;
+
+    status = NtFsControlFile(handle, event, NULL, cvalue, io_status, FSCTL_PIPE_TRANSCEIVE,
+                             write_buf, write_size, read_buf, read_size);
 
-    r = WriteFile(handle, write_buf, write_size, &count, NULL);
-    if (r)
-        r = ReadFile(handle, read_buf, read_size, bytes_read, NULL);
+    if (status == STATUS_PENDING && !overlapped)
+    {
+        WaitForSingleObject( handle, INFINITE );
+        status = io_status->u.Status;
+    }
 
-    return r;
+    if (status != STATUS_PENDING && bytes_read)
+        *bytes_read = io_status->Information;
+
+    if (status)
+    {
+        SetLastError( RtlNtStatusToDosError(status) );
+        return FALSE;
+    }
+    return TRUE;
 }
 
 /***********************************************************************
@@ -2212,6 +2212,23 @@ static void test_LockFile(void)
 
     ok( UnlockFile( handle, 100, 0, 0, 0 ), "UnlockFile 100,0 failed\n" );
 
+    /* overlapping ranges locked and unlocked through two handles */
+    ok( LockFile( handle, 0, 0, 100, 0 ), "LockFile 0,100 failed\n" );
+    ok( !LockFile( handle2, 50, 0, 100, 0 ), "LockFile handle2 50,100 succeeded\n" );
+    ok( LockFile( handle2, 100, 0, 100, 0 ), "LockFile handle2 100,100 failed\n" );
+    ok( !UnlockFile( handle2, 0, 0, 100, 0 ), "UnlockFile handle2 0,100 succeeded\n" );
+    ok( !LockFile( handle, 150, 0, 10, 0 ), "LockFile 150,10 succeeded\n" );
+    ok( UnlockFile( handle, 0, 0, 100, 0 ), "UnlockFile 0,100 failed\n" );
+    /* the lock held through the other handle is kept */
+    ok( !LockFile( handle, 150, 0, 10, 0 ), "LockFile 150,10 succeeded after unlock\n" );
+    ok( LockFile( handle2, 50, 0, 50, 0 ), "LockFile handle2 50,50 failed\n" );
+    ok( !LockFile( handle, 0, 0, 60, 0 ), "LockFile 0,60 succeeded\n" );
+    ok( UnlockFile( handle2, 100, 0, 100, 0 ), "UnlockFile handle2 100,100 failed\n" );
+    ok( !LockFile( handle, 90, 0, 20, 0 ), "LockFile 90,20 succeeded\n" );
+    ok( UnlockFile( handle2, 50, 0, 50, 0 ), "UnlockFile handle2 50,50 failed\n" );
+    ok( LockFile( handle, 0, 0, 200, 0 ), "LockFile 0,200 failed\n" );
+    ok( UnlockFile( handle, 0, 0, 200, 0 ), "UnlockFile 0,200 failed\n" );
+
     CloseHandle( handle2 );
 cleanup:
     CloseHandle( handle );
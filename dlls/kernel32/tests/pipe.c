@@ -2353,6 +2353,152 @@ todo_wine
     CloseHandle(event);
 }
 
+static DWORD CALLBACK transact_server(LPVOID arg)
+{
+    HANDLE pipe = arg;
+    char buf[16];
+    DWORD num;
+    BOOL ret;
+
+    ret = ConnectNamedPipe(pipe, NULL);
+    ok(ret || GetLastError() == ERROR_PIPE_CONNECTED, "ConnectNamedPipe failed with %u\n", GetLastError());
+
+    ret = ReadFile(pipe, buf, sizeof(buf), &num, NULL);
+    ok(ret, "ReadFile failed with %u\n", GetLastError());
+    ok(num == 7 && !memcmp(buf, "request", 7), "got %u bytes\n", num);
+
+    ret = WriteFile(pipe, "reply", 5, &num, NULL);
+    ok(ret, "WriteFile failed with %u\n", GetLastError());
+
+    FlushFileBuffers(pipe);
+    DisconnectNamedPipe(pipe);
+    return 0;
+}
+
+static void test_TransactNamedPipe(void)
+{
+    HANDLE server, client, thread;
+    DWORD num, mode;
+    char buf[16];
+    BOOL ret;
+
+    server = CreateNamedPipeA(PIPENAME, PIPE_ACCESS_DUPLEX, PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
+                              1, 1024, 1024, NMPWAIT_USE_DEFAULT_WAIT, NULL);
+    ok(server != INVALID_HANDLE_VALUE, "CreateNamedPipe failed with %u\n", GetLastError());
+
+    thread = CreateThread(NULL, 0, transact_server, server, 0, NULL);
+
+    client = CreateFileA(PIPENAME, GENERIC_READ|GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(client != INVALID_HANDLE_VALUE, "CreateFile failed with %u\n", GetLastError());
+
+    mode = PIPE_READMODE_MESSAGE;
+    ret = SetNamedPipeHandleState(client, &mode, NULL, NULL);
+    ok(ret, "SetNamedPipeHandleState failed with %u\n", GetLastError());
+
+    memset(buf, 0, sizeof(buf));
+    num = 0xdeadbeef;
+    ret = TransactNamedPipe(client, (void *)"request", 7, buf, sizeof(buf), &num, NULL);
+    ok(ret, "TransactNamedPipe failed with %u\n", GetLastError());
+    ok(num == 5, "got %u bytes\n", num);
+    ok(!memcmp(buf, "reply", 5), "got %s\n", buf);
+
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+    CloseHandle(client);
+    CloseHandle(server);
+
+    /* transactions need a message mode pipe */
+    server = CreateNamedPipeA(PIPENAME, PIPE_ACCESS_DUPLEX, PIPE_TYPE_BYTE | PIPE_WAIT,
+                              1, 1024, 1024, NMPWAIT_USE_DEFAULT_WAIT, NULL);
+    ok(server != INVALID_HANDLE_VALUE, "CreateNamedPipe failed with %u\n", GetLastError());
+    client = CreateFileA(PIPENAME, GENERIC_READ|GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(client != INVALID_HANDLE_VALUE, "CreateFile failed with %u\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    ret = TransactNamedPipe(client, (void *)"request", 7, buf, sizeof(buf), &num, NULL);
+    ok(!ret, "TransactNamedPipe succeeded\n");
+    ok(GetLastError() == ERROR_BAD_PIPE, "got error %u\n", GetLastError());
+
+    CloseHandle(client);
+    CloseHandle(server);
+}
+
+#define TRANSACT_REQUEST_SIZE (256 * 1024)
+
+static DWORD CALLBACK transact_large_server(LPVOID arg)
+{
+    HANDLE pipe = arg;
+    char *buf = HeapAlloc(GetProcessHeap(), 0, TRANSACT_REQUEST_SIZE);
+    DWORD num, total = 0;
+    BOOL ret;
+
+    ret = ConnectNamedPipe(pipe, NULL);
+    ok(ret || GetLastError() == ERROR_PIPE_CONNECTED, "ConnectNamedPipe failed with %u\n", GetLastError());
+
+    while (total < TRANSACT_REQUEST_SIZE)
+    {
+        ret = ReadFile(pipe, buf + total, TRANSACT_REQUEST_SIZE - total, &num, NULL);
+        if (!ret && GetLastError() != ERROR_MORE_DATA) break;
+        total += num;
+    }
+    ok(total == TRANSACT_REQUEST_SIZE, "got %u bytes\n", total);
+
+    ret = WriteFile(pipe, "reply", 5, &num, NULL);
+    ok(ret, "WriteFile failed with %u\n", GetLastError());
+
+    FlushFileBuffers(pipe);
+    DisconnectNamedPipe(pipe);
+    HeapFree(GetProcessHeap(), 0, buf);
+    return 0;
+}
+
+/* a request larger than the pipe buffer can't be written at once */
+static void test_TransactNamedPipe_overlapped(void)
+{
+    HANDLE server, client, thread, event;
+    OVERLAPPED overlapped;
+    DWORD num, mode;
+    char buf[16], *request;
+    BOOL ret;
+
+    server = CreateNamedPipeA(PIPENAME, PIPE_ACCESS_DUPLEX, PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
+                              1, 1024, 1024, NMPWAIT_USE_DEFAULT_WAIT, NULL);
+    ok(server != INVALID_HANDLE_VALUE, "CreateNamedPipe failed with %u\n", GetLastError());
+    client = CreateFileA(PIPENAME, GENERIC_READ|GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                         FILE_FLAG_OVERLAPPED, NULL);
+    ok(client != INVALID_HANDLE_VALUE, "CreateFile failed with %u\n", GetLastError());
+    mode = PIPE_READMODE_MESSAGE;
+    ret = SetNamedPipeHandleState(client, &mode, NULL, NULL);
+    ok(ret, "SetNamedPipeHandleState failed with %u\n", GetLastError());
+
+    request = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, TRANSACT_REQUEST_SIZE);
+    event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.hEvent = event;
+    memset(buf, 0, sizeof(buf));
+
+    ret = TransactNamedPipe(client, request, TRANSACT_REQUEST_SIZE, buf, sizeof(buf), &num, &overlapped);
+    ok(!ret && GetLastError() == ERROR_IO_PENDING, "TransactNamedPipe returned %d error %u\n", ret, GetLastError());
+
+    /* the transaction can't complete before the server has read the request */
+    ok(WaitForSingleObject(event, 100) == WAIT_TIMEOUT, "event signaled\n");
+
+    thread = CreateThread(NULL, 0, transact_large_server, server, 0, NULL);
+    ok(!WaitForSingleObject(event, 10000), "transaction didn't complete\n");
+    num = 0xdeadbeef;
+    ret = GetOverlappedResult(client, &overlapped, &num, TRUE);
+    ok(ret, "GetOverlappedResult failed with %u\n", GetLastError());
+    ok(num == 5, "got %u bytes\n", num);
+    ok(!memcmp(buf, "reply", 5), "got %s\n", buf);
+
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+    CloseHandle(event);
+    CloseHandle(client);
+    CloseHandle(server);
+    HeapFree(GetProcessHeap(), 0, request);
+}
+
 START_TEST(pipe)
 {
     HMODULE hmod;
@@ -2374,4 +2520,6 @@ START_TEST(pipe)
     test_overlapped();
     test_NamedPipeHandleState();
     test_readfileex_pending();
+    test_TransactNamedPipe();
+    test_TransactNamedPipe_overlapped();
 }
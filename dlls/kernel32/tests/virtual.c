@@ -51,6 +51,8 @@ static BOOL   (WINAPI *pIsWow64Process)(HANDLE, PBOOL);
 static NTSTATUS (WINAPI *pNtProtectVirtualMemory)(HANDLE, PVOID *, SIZE_T *, ULONG, ULONG *);
 static NTSTATUS (WINAPI *pNtAllocateVirtualMemory)(HANDLE, PVOID *, ULONG, SIZE_T *, ULONG, ULONG);
 static NTSTATUS (WINAPI *pNtFreeVirtualMemory)(HANDLE, PVOID *, SIZE_T *, ULONG);
+static BOOL   (WINAPI *pPrefetchVirtualMemory)(HANDLE, ULONG_PTR, PWIN32_MEMORY_RANGE_ENTRY, ULONG);
+static SIZE_T (WINAPI *pGetLargePageMinimum)(void);
 
 /* ############################### */
 
@@ -3767,6 +3769,155 @@ static void test_shared_memory_ro(BOOL is_child, DWORD child_access)
     CloseHandle(mapping);
 }
 
+static void test_PrefetchVirtualMemory(void)
+{
+    WIN32_MEMORY_RANGE_ENTRY range[2];
+    SIZE_T large_page;
+    HANDLE process;
+    char *mem;
+    BOOL ret;
+
+    if (!pPrefetchVirtualMemory)
+    {
+        win_skip( "PrefetchVirtualMemory not supported\n" );
+        return;
+    }
+
+    mem = VirtualAlloc( NULL, 0x20000, MEM_COMMIT, PAGE_READWRITE );
+    ok( mem != NULL, "VirtualAlloc failed %u\n", GetLastError() );
+
+    range[0].VirtualAddress = mem;
+    range[0].NumberOfBytes = 0x10000;
+    range[1].VirtualAddress = mem + 0x10100;
+    range[1].NumberOfBytes = 0x100;
+
+    ret = pPrefetchVirtualMemory( GetCurrentProcess(), 2, range, 0 );
+    ok( ret, "PrefetchVirtualMemory failed %u\n", GetLastError() );
+
+    process = OpenProcess( PROCESS_QUERY_INFORMATION | PROCESS_VM_OPERATION, FALSE, GetCurrentProcessId() );
+    ok( process != NULL, "OpenProcess failed %u\n", GetLastError() );
+    ret = pPrefetchVirtualMemory( process, 2, range, 0 );
+    ok( ret, "PrefetchVirtualMemory failed %u\n", GetLastError() );
+    CloseHandle( process );
+
+    SetLastError( 0xdeadbeef );
+    ret = pPrefetchVirtualMemory( GetCurrentProcess(), 0, range, 0 );
+    ok( !ret, "PrefetchVirtualMemory succeeded\n" );
+    ok( GetLastError() == ERROR_INVALID_PARAMETER, "wrong error %u\n", GetLastError() );
+
+    SetLastError( 0xdeadbeef );
+    ret = pPrefetchVirtualMemory( GetCurrentProcess(), 1, range, 1 );
+    ok( !ret, "PrefetchVirtualMemory succeeded\n" );
+    ok( GetLastError() == ERROR_INVALID_PARAMETER, "wrong error %u\n", GetLastError() );
+
+    VirtualFree( mem, 0, MEM_RELEASE );
+
+    if (pGetLargePageMinimum)
+    {
+        large_page = pGetLargePageMinimum();
+        ok( !(large_page & (large_page - 1)), "large page size %lx not a power of two\n", large_page );
+        if (large_page) ok( large_page >= 0x10000, "large page size %lx too small\n", large_page );
+    }
+}
+
+static void test_large_pages(void)
+{
+    TOKEN_PRIVILEGES privs;
+    SIZE_T large_page;
+    HANDLE token, mapping;
+    char *mem;
+
+    if (!pGetLargePageMinimum || !(large_page = pGetLargePageMinimum()))
+    {
+        win_skip( "large pages not supported\n" );
+        return;
+    }
+
+    SetLastError( 0xdeadbeef );
+    mem = VirtualAlloc( NULL, large_page + 0x1000, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE );
+    ok( !mem, "VirtualAlloc succeeded\n" );
+    ok( GetLastError() == ERROR_INVALID_PARAMETER, "wrong error %u\n", GetLastError() );
+
+    privs.PrivilegeCount = 1;
+    privs.Privileges[0].Attributes = 0;
+    if (!OpenProcessToken( GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token ) ||
+        !LookupPrivilegeValueA( NULL, SE_LOCK_MEMORY_NAME, &privs.Privileges[0].Luid ))
+    {
+        win_skip( "cannot look up SE_LOCK_MEMORY_NAME privilege\n" );
+        return;
+    }
+    AdjustTokenPrivileges( token, FALSE, &privs, sizeof(privs), NULL, NULL );
+
+    SetLastError( 0xdeadbeef );
+    mem = VirtualAlloc( NULL, large_page, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE );
+    ok( !mem, "VirtualAlloc succeeded\n" );
+    ok( GetLastError() == ERROR_PRIVILEGE_NOT_HELD, "wrong error %u\n", GetLastError() );
+
+    SetLastError( 0xdeadbeef );
+    mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+                                  0, large_page, NULL );
+    ok( !mapping, "CreateFileMapping succeeded\n" );
+    ok( GetLastError() == ERROR_PRIVILEGE_NOT_HELD, "wrong error %u\n", GetLastError() );
+
+    privs.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    if (!AdjustTokenPrivileges( token, FALSE, &privs, sizeof(privs), NULL, NULL ) ||
+        GetLastError() == ERROR_NOT_ALL_ASSIGNED)
+    {
+        skip( "cannot enable SE_LOCK_MEMORY_NAME privilege\n" );
+        CloseHandle( token );
+        return;
+    }
+
+    SetLastError( 0xdeadbeef );
+    mem = VirtualAlloc( NULL, large_page, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE );
+    ok( mem != NULL || broken(GetLastError() == ERROR_NO_SYSTEM_RESOURCES), /* not enough contiguous memory */
+        "VirtualAlloc failed %u\n", GetLastError() );
+    if (mem)
+    {
+        ok( !((ULONG_PTR)mem & (large_page - 1)), "large pages not aligned %p\n", mem );
+        mem[0] = mem[large_page - 1] = 1;
+        VirtualFree( mem, 0, MEM_RELEASE );
+    }
+
+    SetLastError( 0xdeadbeef );
+    mem = VirtualAlloc( NULL, large_page / 2, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE );
+    ok( !mem, "VirtualAlloc succeeded\n" );
+    ok( GetLastError() == ERROR_INVALID_PARAMETER, "wrong error %u\n", GetLastError() );
+
+    SetLastError( 0xdeadbeef );
+    mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+                                  0, large_page / 2, NULL );
+    ok( !mapping, "CreateFileMapping succeeded\n" );
+    ok( GetLastError() == ERROR_INVALID_PARAMETER, "wrong error %u\n", GetLastError() );
+
+    SetLastError( 0xdeadbeef );
+    mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_RESERVE | SEC_LARGE_PAGES,
+                                  0, large_page, NULL );
+    ok( !mapping, "CreateFileMapping succeeded\n" );
+    ok( GetLastError() == ERROR_INVALID_PARAMETER, "wrong error %u\n", GetLastError() );
+
+    SetLastError( 0xdeadbeef );
+    mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+                                  0, large_page, NULL );
+    ok( mapping != NULL || broken(GetLastError() == ERROR_NO_SYSTEM_RESOURCES),
+        "CreateFileMapping failed %u\n", GetLastError() );
+    if (mapping)
+    {
+        mem = MapViewOfFile( mapping, FILE_MAP_WRITE, 0, 0, 0 );
+        ok( mem != NULL, "MapViewOfFile failed %u\n", GetLastError() );
+        if (mem)
+        {
+            mem[0] = mem[large_page - 1] = 1;
+            UnmapViewOfFile( mem );
+        }
+        CloseHandle( mapping );
+    }
+
+    privs.Privileges[0].Attributes = 0;
+    AdjustTokenPrivileges( token, FALSE, &privs, sizeof(privs), NULL, NULL );
+    CloseHandle( token );
+}
+
 START_TEST(virtual)
 {
     int argc;
@@ -3823,6 +3974,8 @@ START_TEST(virtual)
     pNtProtectVirtualMemory = (void *)GetProcAddress( hntdll, "NtProtectVirtualMemory" );
     pNtAllocateVirtualMemory = (void *)GetProcAddress( hntdll, "NtAllocateVirtualMemory" );
     pNtFreeVirtualMemory = (void *)GetProcAddress( hntdll, "NtFreeVirtualMemory" );
+    pPrefetchVirtualMemory = (void *)GetProcAddress( hkernel32, "PrefetchVirtualMemory" );
+    pGetLargePageMinimum = (void *)GetProcAddress( hkernel32, "GetLargePageMinimum" );
 
     test_shared_memory(FALSE);
     test_shared_memory_ro(FALSE, FILE_MAP_READ|FILE_MAP_WRITE);
@@ -3842,6 +3995,8 @@ START_TEST(virtual)
     test_IsBadWritePtr();
     test_IsBadCodePtr();
     test_write_watch();
+    test_PrefetchVirtualMemory();
+    test_large_pages();
 #ifdef __i386__
     test_guard_page();
     test_stack_commit();
@@ -39,6 +39,7 @@
 #include "winternl.h"
 #include "winerror.h"
 #include "psapi.h"
+#include "ddk/wdm.h"
 #include "wine/exception.h"
 #include "wine/debug.h"
 
@@ -607,6 +608,43 @@ BOOL WINAPI FlushViewOfFile( LPCVOID base, SIZE_T size )
 }
 
 
+/***********************************************************************
+ *             PrefetchVirtualMemory   (KERNEL32.@)
+ *
+ * Starts reading in the pages of the given ranges of a process address space.
+ *
+ * PARAMS
+ *  process   [I] Handle to the process.
+ *  count     [I] Number of entries in the addresses array.
+ *  addresses [I] Ranges to prefetch.
+ *  flags     [I] Reserved, must be 0.
+ *
+ * RETURNS
+ *	Success: TRUE.
+ *	Failure: FALSE.
+ */
+BOOL WINAPI PrefetchVirtualMemory( HANDLE process, ULONG_PTR count,
+                                   WIN32_MEMORY_RANGE_ENTRY *addresses, ULONG flags )
+{
+    NTSTATUS status = NtSetInformationVirtualMemory( process, VmPrefetchInformation, count,
+                                                     (PMEMORY_RANGE_ENTRY)addresses, &flags, sizeof(flags) );
+    if (status) SetLastError( RtlNtStatusToDosError(status) );
+    return !status;
+}
+
+
+/***********************************************************************
+ *             GetLargePageMinimum   (KERNEL32.@)
+ *
+ * Returns the minimum size of a large page allocation, or 0 if large
+ * pages are not supported.
+ */
+SIZE_T WINAPI GetLargePageMinimum(void)
+{
+    return ((KSHARED_USER_DATA *)0x7ffe0000)->LargePageMinimum;
+}
+
+
 /***********************************************************************
  *             GetWriteWatch   (KERNEL32.@)
  */
@@ -90,6 +90,9 @@
 #ifdef HAVE_VALGRIND_MEMCHECK_H
 # include <valgrind/memcheck.h>
 #endif
+#ifdef HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -97,6 +100,8 @@
 #include "wine/unicode.h"
 #include "wine/debug.h"
 #include "wine/server.h"
+#include "wine/list.h"
+#include "wine/library.h"
 #include "ntdll_misc.h"
 
 #include "winternl.h"
@@ -1645,6 +1650,201 @@ NTSTATUS WINAPI NtDeviceIoControlFile(HANDLE handle, HANDLE event,
 }
 
 
+/* state of an overlapped pipe transaction while its request is written */
+struct async_transceive
+{
+    struct async_fileio io;
+    HANDLE              event;        /* event of the transaction */
+    IO_STATUS_BLOCK    *iosb;         /* status block of the transaction */
+    ULONG_PTR           cvalue;       /* completion value of the transaction */
+    HANDLE              write_event;  /* private event for the request write */
+    const char         *in_buffer;
+    ULONG               in_size;
+    ULONG               written;
+    void               *out_buffer;
+    ULONG               out_size;
+};
+
+/* queue the read of the reply, the server completes the transaction when it arrives */
+static NTSTATUS register_transceive_read( struct async_transceive *async )
+{
+    struct async_fileio_read *fileio;
+    NTSTATUS status;
+
+    fileio = (struct async_fileio_read *)alloc_fileio( sizeof(*fileio), async->io.handle,
+                                                       async->io.apc, async->io.apc_arg );
+    if (!fileio) return STATUS_NO_MEMORY;
+    fileio->already = 0;
+    fileio->count = async->out_size;
+    fileio->buffer = async->out_buffer;
+    fileio->avail_mode = TRUE;
+
+    SERVER_START_REQ( register_async )
+    {
+        req->type   = ASYNC_TYPE_READ;
+        req->count  = async->out_size;
+        req->async.handle   = wine_server_obj_handle( async->io.handle );
+        req->async.event    = wine_server_obj_handle( async->event );
+        req->async.callback = wine_server_client_ptr( FILE_AsyncReadService );
+        req->async.iosb     = wine_server_client_ptr( async->iosb );
+        req->async.arg      = wine_server_client_ptr( fileio );
+        req->async.cvalue   = async->cvalue;
+        status = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+
+    if (status != STATUS_PENDING) RtlFreeHeap( GetProcessHeap(), 0, fileio );
+    return status;
+}
+
+/* callback for the request write of an overlapped pipe transaction; it only
+ * signals the private event, the transaction completes with the reply read */
+static NTSTATUS pipe_transceive_write_service( void *user, IO_STATUS_BLOCK *iosb,
+                                               NTSTATUS status, void **apc, void **arg )
+{
+    struct async_transceive *async = user;
+    NTSTATUS read_status;
+    int fd, needs_close, result;
+
+    if (status == STATUS_ALERTED &&
+        !(status = server_get_unix_fd( async->io.handle, FILE_WRITE_DATA, &fd, &needs_close, NULL, NULL )))
+    {
+        result = write( fd, async->in_buffer + async->written, async->in_size - async->written );
+        if (needs_close) close( fd );
+
+        if (result >= 0)
+        {
+            async->written += result;
+            status = (async->written < async->in_size) ? STATUS_PENDING : STATUS_SUCCESS;
+        }
+        else if (errno == EAGAIN || errno == EINTR) status = STATUS_PENDING;
+        else status = (errno == EPIPE) ? STATUS_PIPE_BROKEN : FILE_GetNtStatus();
+    }
+    if (status == STATUS_PENDING) return status;
+
+    *apc = NULL;
+    *arg = NULL;
+
+    /* a broken pipe is reported by the read like any other completion */
+    if (!status || status == STATUS_PIPE_BROKEN) read_status = register_transceive_read( async );
+    else read_status = status;
+
+    if (read_status != STATUS_PENDING)
+    {
+        async->iosb->u.Status = read_status;
+        async->iosb->Information = 0;
+        if (async->event) NtSetEvent( async->event, NULL );
+        if (async->cvalue) NTDLL_AddCompletion( async->io.handle, async->cvalue, read_status, 0 );
+    }
+    NtClose( async->write_event );
+    release_fileio( &async->io );
+    return status;
+}
+
+/* write the request and read the reply of a pipe transaction without going through the server */
+static NTSTATUS pipe_transceive( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_context,
+                                 IO_STATUS_BLOCK *io, const void *in_buffer, ULONG in_size,
+                                 void *out_buffer, ULONG out_size )
+{
+    struct async_transceive *async;
+    int fd, needs_close, result;
+    enum server_fd_type type;
+    unsigned int options;
+    NTSTATUS status;
+    BOOL message_read;
+    ULONG total = 0;
+
+    if ((status = server_get_unix_fd( handle, FILE_READ_DATA | FILE_WRITE_DATA, &fd,
+                                      &needs_close, &type, &options )))
+        return status;
+
+    if (type != FD_TYPE_PIPE)
+    {
+        status = STATUS_INVALID_PARAMETER;
+        goto done;
+    }
+
+    /* transactions need the pipe to be read in message mode */
+    if (!(status = server_get_pipe_read_mode( handle, &message_read )) && !message_read)
+        status = STATUS_INVALID_PIPE_STATE;
+    if (status) goto done;
+
+    /* the request must be written entirely before waiting for the reply */
+    while (total < in_size)
+    {
+        if ((result = write( fd, (const char *)in_buffer + total, in_size - total )) >= 0)
+        {
+            total += result;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN)
+        {
+            status = (errno == EPIPE) ? STATUS_PIPE_BROKEN : FILE_GetNtStatus();
+            goto done;
+        }
+
+        if (!(options & (FILE_SYNCHRONOUS_IO_ALERT | FILE_SYNCHRONOUS_IO_NONALERT)))
+        {
+            /* overlapped handle, write the rest when the pipe has room */
+            if (!(async = (struct async_transceive *)alloc_fileio( sizeof(*async), handle, apc, apc_context )))
+            {
+                status = STATUS_NO_MEMORY;
+                goto done;
+            }
+            async->event      = event;
+            async->iosb       = io;
+            async->cvalue     = apc ? 0 : (ULONG_PTR)apc_context;
+            async->in_buffer  = in_buffer;
+            async->in_size    = in_size;
+            async->written    = total;
+            async->out_buffer = out_buffer;
+            async->out_size   = out_size;
+            if ((status = NtCreateEvent( &async->write_event, EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE )))
+            {
+                RtlFreeHeap( GetProcessHeap(), 0, async );
+                goto done;
+            }
+
+            SERVER_START_REQ( register_async )
+            {
+                req->type   = ASYNC_TYPE_WRITE;
+                req->count  = in_size;
+                req->async.handle   = wine_server_obj_handle( handle );
+                req->async.event    = wine_server_obj_handle( async->write_event );
+                req->async.callback = wine_server_client_ptr( pipe_transceive_write_service );
+                req->async.iosb     = wine_server_client_ptr( io );
+                req->async.arg      = wine_server_client_ptr( async );
+                status = wine_server_call( req );
+            }
+            SERVER_END_REQ;
+
+            if (status != STATUS_PENDING)
+            {
+                NtClose( async->write_event );
+                RtlFreeHeap( GetProcessHeap(), 0, async );
+            }
+            else if (event) NtResetEvent( event, NULL );
+            goto done;
+        }
+        else  /* synchronous handle, wait for room in the pipe */
+        {
+            struct pollfd pfd;
+
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            poll( &pfd, 1, -1 );
+        }
+    }
+
+done:
+    if (needs_close) close( fd );
+    if (status) return status;
+    return NtReadFile( handle, event, apc, apc_context, io, out_buffer, out_size, NULL, NULL );
+}
+
+
 /**************************************************************************
  *              NtFsControlFile                 [NTDLL.@]
  *              ZwFsControlFile                 [NTDLL.@]
@@ -1747,6 +1947,11 @@ NTSTATUS WINAPI NtFsControlFile(HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc
         }
         break;
 
+    case FSCTL_PIPE_TRANSCEIVE:
+        status = pipe_transceive( handle, event, apc, apc_context, io,
+                                  in_buffer, in_size, out_buffer, out_size );
+        break;
+
     case FSCTL_PIPE_DISCONNECT:
         status = server_ioctl_file( handle, event, apc, apc_context, io, code,
                                     in_buffer, in_size, out_buffer, out_size );
@@ -2712,6 +2917,7 @@ NTSTATUS WINAPI NtSetInformationFile(HANDLE handle, PIO_STATUS_BLOCK io,
                 io->u.Status = wine_server_call( req );
             }
             SERVER_END_REQ;
+            if (!io->u.Status) server_set_pipe_read_mode( handle, info->ReadMode );
         }
         else io->u.Status = STATUS_INVALID_PARAMETER_3;
         break;
@@ -2894,42 +3100,484 @@ NTSTATUS WINAPI NtSetInformationFile(HANDLE handle, PIO_STATUS_BLOCK io,
 }
 
 
-/******************************************************************************
- *              NtQueryFullAttributesFile   (NTDLL.@)
+/* file attributes cache
+ *
+ * Optional per-process cache of the attributes of files looked up by NT path,
+ * enabled by setting HKCU\Software\Wine\FileAttributeCache to the maximum
+ * number of entries. Files are keyed on the device and inode of the unix
+ * directory containing them and on their name; the NT paths that resolved to
+ * each directory are remembered separately. Only case-insensitive lookups are
+ * cached. Entries are dropped when inotify reports a change in the directory
+ * containing the file; any change to the directory hierarchy itself or to the
+ * dosdevices directory flushes the whole cache.
  */
-NTSTATUS WINAPI NtQueryFullAttributesFile( const OBJECT_ATTRIBUTES *attr,
-                                           FILE_NETWORK_OPEN_INFORMATION *info )
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+#define ATTR_CACHE_HASH_SIZE 1021
+#define ATTR_CACHE_DIR_HASH_SIZE 127
+
+struct attr_cache_dir
+{
+    struct list            entry;      /* entry in dir hash table */
+    struct list            files;      /* cached files in this directory */
+    struct list            names;      /* NT paths resolving to this directory */
+    struct attr_cache_dir *parent;     /* watched parent directory */
+    unsigned int           refs;       /* cached files, watched subdirectories and callers */
+    int                    wd;         /* inotify watch descriptor */
+    dev_t                  dev;
+    ino_t                  ino;
+};
+
+struct attr_cache_name
+{
+    struct list            entry;      /* entry in name hash table */
+    struct list            dir_entry;  /* entry in directory names list */
+    struct attr_cache_dir *dir;
+    ULONG                  hash;
+    USHORT                 len;        /* length of name in bytes */
+    WCHAR                  name[1];    /* NT path of the directory */
+};
+
+struct attr_cache_entry
+{
+    struct list            entry;      /* entry in hash table */
+    struct list            lru_entry;  /* entry in lru list */
+    struct list            dir_entry;  /* entry in directory files list */
+    struct attr_cache_dir *dir;        /* containing directory */
+    struct stat            st;         /* unix file information */
+    ULONG                  attributes; /* unix attributes from get_file_info */
+    ULONG                  hash;
+    USHORT                 len;        /* length of name in bytes */
+    WCHAR                  name[1];    /* file name in the directory */
+};
+
+static struct list attr_cache_hash[ATTR_CACHE_HASH_SIZE];
+static struct list attr_cache_names[ATTR_CACHE_HASH_SIZE];
+static struct list attr_cache_dirs[ATTR_CACHE_DIR_HASH_SIZE];
+static struct list attr_cache_lru = LIST_INIT( attr_cache_lru );
+static unsigned int attr_cache_count;
+static unsigned int attr_cache_max;
+static int attr_cache_fd = -1;
+static struct attr_cache_dir *attr_cache_dosdevices;  /* always watched while the cache is active */
+static RTL_RUN_ONCE attr_cache_once = RTL_RUN_ONCE_INIT;
+
+static RTL_CRITICAL_SECTION attr_cache_section;
+static RTL_CRITICAL_SECTION_DEBUG attr_cache_critsect_debug =
+{
+    0, 0, &attr_cache_section,
+    { &attr_cache_critsect_debug.ProcessLocksList, &attr_cache_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": attr_cache_section") }
+};
+static RTL_CRITICAL_SECTION attr_cache_section = { &attr_cache_critsect_debug, -1, 0, 0, 0, 0 };
+
+static DWORD WINAPI init_attr_cache( RTL_RUN_ONCE *once, void *param, void **context )
+{
+    static const WCHAR WineW[] = {'S','o','f','t','w','a','r','e','\\','W','i','n','e',0};
+    static const WCHAR FileAttributeCacheW[] = {'F','i','l','e','A','t','t','r','i','b','u','t','e',
+                                                'C','a','c','h','e',0};
+    char tmp[80];
+    HANDLE root, hkey;
+    DWORD dummy;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING nameW;
+    unsigned int i;
+
+    RtlOpenCurrentUser( KEY_ALL_ACCESS, &root );
+    attr.Length = sizeof(attr);
+    attr.RootDirectory = root;
+    attr.ObjectName = &nameW;
+    attr.Attributes = 0;
+    attr.SecurityDescriptor = NULL;
+    attr.SecurityQualityOfService = NULL;
+    RtlInitUnicodeString( &nameW, WineW );
+
+    /* @@ Wine registry key: HKCU\Software\Wine */
+    if (!NtOpenKey( &hkey, KEY_ALL_ACCESS, &attr ))
+    {
+        RtlInitUnicodeString( &nameW, FileAttributeCacheW );
+        if (!NtQueryValueKey( hkey, &nameW, KeyValuePartialInformation, tmp, sizeof(tmp), &dummy ))
+        {
+            KEY_VALUE_PARTIAL_INFORMATION *info = (KEY_VALUE_PARTIAL_INFORMATION *)tmp;
+
+            if (info->Type == REG_DWORD) attr_cache_max = *(DWORD *)info->Data;
+            else if (info->Type == REG_SZ) attr_cache_max = atoiW( (WCHAR *)info->Data );
+        }
+        NtClose( hkey );
+    }
+    NtClose( root );
+
+    for (i = 0; i < ATTR_CACHE_HASH_SIZE; i++) list_init( &attr_cache_hash[i] );
+    for (i = 0; i < ATTR_CACHE_HASH_SIZE; i++) list_init( &attr_cache_names[i] );
+    for (i = 0; i < ATTR_CACHE_DIR_HASH_SIZE; i++) list_init( &attr_cache_dirs[i] );
+    if (attr_cache_max) TRACE( "caching attributes of up to %u files\n", attr_cache_max );
+    return TRUE;
+}
+
+static ULONG attr_cache_hash_name( const WCHAR *name, USHORT len )
+{
+    ULONG hash = 0;
+    USHORT i;
+
+    for (i = 0; i < len / sizeof(WCHAR); i++) hash = hash * 31 + toupperW( name[i] );
+    return hash;
+}
+
+static ULONG attr_cache_hash_file( const struct attr_cache_dir *dir, const WCHAR *name, USHORT len )
+{
+    return attr_cache_hash_name( name, len ) ^ (ULONG)dir->ino ^ ((ULONG)dir->dev << 16);
+}
+
+/* split an NT path into its directory and the name of the file in it */
+static BOOL attr_cache_split_name( const UNICODE_STRING *name, UNICODE_STRING *dir, UNICODE_STRING *file )
+{
+    USHORT pos = name->Length / sizeof(WCHAR);
+
+    while (pos && name->Buffer[pos - 1] != '\\') pos--;
+    if (!pos || pos == name->Length / sizeof(WCHAR)) return FALSE;
+    dir->Buffer = name->Buffer;
+    dir->Length = dir->MaximumLength = (pos - 1) * sizeof(WCHAR);
+    file->Buffer = name->Buffer + pos;
+    file->Length = file->MaximumLength = name->Length - pos * sizeof(WCHAR);
+    return TRUE;
+}
+
+/* release a reference to a directory, removing its watch when it's no longer used */
+static void attr_cache_release_dir( struct attr_cache_dir *dir )
+{
+    struct attr_cache_dir *parent;
+    struct list *ptr;
+
+    while (dir && !--dir->refs)
+    {
+        while ((ptr = list_head( &dir->names )))
+        {
+            struct attr_cache_name *name = LIST_ENTRY( ptr, struct attr_cache_name, dir_entry );
+            list_remove( &name->entry );
+            list_remove( &name->dir_entry );
+            RtlFreeHeap( GetProcessHeap(), 0, name );
+        }
+        list_remove( &dir->entry );
+        if (attr_cache_fd != -1) inotify_rm_watch( attr_cache_fd, dir->wd );
+        parent = dir->parent;
+        RtlFreeHeap( GetProcessHeap(), 0, dir );
+        dir = parent;
+    }
+}
+
+static void attr_cache_remove( struct attr_cache_entry *cache )
+{
+    list_remove( &cache->entry );
+    list_remove( &cache->lru_entry );
+    list_remove( &cache->dir_entry );
+    attr_cache_release_dir( cache->dir );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+    attr_cache_count--;
+}
+
+/* drop all entries and watches; the attr_cache_section must be held */
+static void attr_cache_flush(void)
+{
+    struct list *ptr;
+
+    while ((ptr = list_head( &attr_cache_lru )))
+        attr_cache_remove( LIST_ENTRY( ptr, struct attr_cache_entry, lru_entry ));
+    attr_cache_release_dir( attr_cache_dosdevices );
+    attr_cache_dosdevices = NULL;
+    if (attr_cache_fd != -1) close( attr_cache_fd );
+    attr_cache_fd = -1;
+}
+
+static struct attr_cache_dir *attr_cache_find_dir( int wd )
+{
+    struct attr_cache_dir *dir;
+
+    LIST_FOR_EACH_ENTRY( dir, &attr_cache_dirs[wd % ATTR_CACHE_DIR_HASH_SIZE], struct attr_cache_dir, entry )
+        if (dir->wd == wd) return dir;
+    return NULL;
+}
+
+/* process pending change notifications; the attr_cache_section must be held */
+static void attr_cache_process_events(void)
+{
+    char buffer[4096];
+    struct inotify_event *ie;
+    struct attr_cache_dir *dir;
+    struct list *ptr;
+    int ret, ofs;
+
+    if (attr_cache_fd == -1) return;
+
+    while ((ret = read( attr_cache_fd, buffer, sizeof(buffer) )) > 0)
+    {
+        for (ofs = 0; ofs + sizeof(*ie) <= ret; ofs += sizeof(*ie) + ie->len)
+        {
+            ie = (struct inotify_event *)(buffer + ofs);
+
+            dir = attr_cache_find_dir( ie->wd );
+            /* watches removed by attr_cache_release_dir report IN_IGNORED */
+            if ((ie->mask & IN_IGNORED) && !dir) continue;
+
+            /* directories moving around or drive mappings changing invalidate everything */
+            if ((ie->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_UNMOUNT | IN_DELETE_SELF | IN_MOVE_SELF)) ||
+                ((ie->mask & IN_ISDIR) && (ie->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))) ||
+                (dir && dir == attr_cache_dosdevices))
+            {
+                attr_cache_flush();
+                return;
+            }
+            if (!dir) continue;
+            /* keep the directory alive while its files are removed */
+            dir->refs++;
+            while ((ptr = list_head( &dir->files )))
+                attr_cache_remove( LIST_ENTRY( ptr, struct attr_cache_entry, dir_entry ));
+            attr_cache_release_dir( dir );
+        }
+    }
+    if (ret == 0 || (ret == -1 && errno != EAGAIN && errno != EINTR)) attr_cache_flush();
+}
+
+static struct attr_cache_name *attr_cache_find_name( const UNICODE_STRING *name, ULONG hash )
+{
+    struct attr_cache_name *dir_name;
+
+    LIST_FOR_EACH_ENTRY( dir_name, &attr_cache_names[hash % ATTR_CACHE_HASH_SIZE], struct attr_cache_name, entry )
+    {
+        if (dir_name->hash != hash || dir_name->len != name->Length) continue;
+        if (!memicmpW( dir_name->name, name->Buffer, name->Length / sizeof(WCHAR) )) return dir_name;
+    }
+    return NULL;
+}
+
+static struct attr_cache_entry *attr_cache_find( const struct attr_cache_dir *dir,
+                                                 const UNICODE_STRING *name, ULONG hash )
+{
+    struct attr_cache_entry *cache;
+
+    LIST_FOR_EACH_ENTRY( cache, &attr_cache_hash[hash % ATTR_CACHE_HASH_SIZE], struct attr_cache_entry, entry )
+    {
+        if (cache->hash != hash || cache->len != name->Length) continue;
+        if (cache->dir->dev != dir->dev || cache->dir->ino != dir->ino) continue;
+        if (!memicmpW( cache->name, name->Buffer, name->Length / sizeof(WCHAR) )) return cache;
+    }
+    return NULL;
+}
+
+/* check whether the cache can be used for these object attributes */
+static BOOL attr_cache_enabled( const OBJECT_ATTRIBUTES *attr )
+{
+    RtlRunOnceExecuteOnce( &attr_cache_once, init_attr_cache, NULL, NULL );
+    /* case-sensitive lookups have to go through the directory contents */
+    return attr_cache_max && !attr->RootDirectory && attr->ObjectName &&
+           (attr->Attributes & OBJ_CASE_INSENSITIVE);
+}
+
+static BOOL attr_cache_lookup( const OBJECT_ATTRIBUTES *attr, struct stat *st, ULONG *attributes )
+{
+    struct attr_cache_entry *cache;
+    struct attr_cache_name *dir_name;
+    UNICODE_STRING dir, file;
+    BOOL ret = FALSE;
+
+    if (!attr_cache_enabled( attr )) return FALSE;
+    if (!attr_cache_split_name( attr->ObjectName, &dir, &file )) return FALSE;
+
+    RtlEnterCriticalSection( &attr_cache_section );
+    attr_cache_process_events();
+    if ((dir_name = attr_cache_find_name( &dir, attr_cache_hash_name( dir.Buffer, dir.Length ))) &&
+        (cache = attr_cache_find( dir_name->dir, &file,
+                                  attr_cache_hash_file( dir_name->dir, file.Buffer, file.Length ))))
+    {
+        *st = cache->st;
+        *attributes = cache->attributes;
+        list_remove( &cache->lru_entry );
+        list_add_head( &attr_cache_lru, &cache->lru_entry );
+        ret = TRUE;
+    }
+    RtlLeaveCriticalSection( &attr_cache_section );
+    return ret;
+}
+
+/* watch a directory and all its parents, returning it with an added reference */
+static struct attr_cache_dir *attr_cache_watch_dir( char *path )
+{
+    static const unsigned int mask = IN_ATTRIB | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                     IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    struct attr_cache_dir *dir, *parent = NULL;
+    struct stat st;
+    char *p;
+    int wd;
+
+    if ((wd = inotify_add_watch( attr_cache_fd, path[0] ? path : "/", mask )) == -1) return NULL;
+    if ((dir = attr_cache_find_dir( wd )))
+    {
+        dir->refs++;
+        return dir;
+    }
+
+    if (stat( path[0] ? path : "/", &st ) == -1) goto failed;
+    if ((p = strrchr( path, '/' )))
+    {
+        *p = 0;
+        parent = attr_cache_watch_dir( path );
+        *p = '/';
+        if (!parent) goto failed;
+    }
+    if (!(dir = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*dir) )))
+    {
+        attr_cache_release_dir( parent );
+        goto failed;
+    }
+    dir->parent = parent;
+    dir->refs = 1;
+    dir->wd = wd;
+    dir->dev = st.st_dev;
+    dir->ino = st.st_ino;
+    list_init( &dir->files );
+    list_init( &dir->names );
+    list_add_head( &attr_cache_dirs[wd % ATTR_CACHE_DIR_HASH_SIZE], &dir->entry );
+    return dir;
+
+failed:
+    inotify_rm_watch( attr_cache_fd, wd );
+    return NULL;
+}
+
+/* start watching the dosdevices directory, drive mappings affect every NT path */
+static BOOL attr_cache_init_watch(void)
+{
+    static const char dosdevices[] = "/dosdevices";
+    const char *config_dir = wine_get_config_dir();
+    char *path;
+
+    if ((attr_cache_fd = inotify_init()) == -1) return FALSE;
+    fcntl( attr_cache_fd, F_SETFD, FD_CLOEXEC );
+    fcntl( attr_cache_fd, F_SETFL, O_NONBLOCK );
+
+    if ((path = RtlAllocateHeap( GetProcessHeap(), 0, strlen(config_dir) + sizeof(dosdevices) )))
+    {
+        strcpy( path, config_dir );
+        strcat( path, dosdevices );
+        attr_cache_dosdevices = attr_cache_watch_dir( path );
+        RtlFreeHeap( GetProcessHeap(), 0, path );
+    }
+    if (attr_cache_dosdevices) return TRUE;
+    close( attr_cache_fd );
+    attr_cache_fd = -1;
+    return FALSE;
+}
+
+static void attr_cache_insert( const OBJECT_ATTRIBUTES *attr, const char *unix_name,
+                               const struct stat *st, ULONG attributes )
+{
+    struct attr_cache_entry *cache;
+    struct attr_cache_name *dir_name;
+    struct attr_cache_dir *dir;
+    UNICODE_STRING nt_dir, file;
+    struct stat new_st;
+    ULONG hash, dir_hash, new_attributes;
+    char *path, *p;
+
+    if (!attr_cache_enabled( attr )) return;
+    if (!attr_cache_split_name( attr->ObjectName, &nt_dir, &file )) return;
+    if (!(path = RtlAllocateHeap( GetProcessHeap(), 0, strlen(unix_name) + 1 ))) return;
+    strcpy( path, unix_name );
+    if (!(p = strrchr( path, '/' )))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, path );
+        return;
+    }
+    *p = 0;
+
+    RtlEnterCriticalSection( &attr_cache_section );
+
+    /* pick up changes that happened since the file information was read */
+    attr_cache_process_events();
+    if (attr_cache_fd == -1 && !attr_cache_init_watch()) goto done;
+
+    if (!(dir = attr_cache_watch_dir( path ))) goto done;
+    attr_cache_process_events();
+    if (attr_cache_fd == -1) goto release;  /* the cache was flushed */
+
+    hash = attr_cache_hash_file( dir, file.Buffer, file.Length );
+    if (attr_cache_find( dir, &file, hash )) goto release;
+
+    /* make sure the file didn't change before the watch was set up */
+    if (get_file_info( unix_name, &new_st, &new_attributes ) == -1 ||
+        new_attributes != attributes || new_st.st_dev != st->st_dev || new_st.st_ino != st->st_ino ||
+        new_st.st_size != st->st_size || new_st.st_mtime != st->st_mtime || new_st.st_ctime != st->st_ctime)
+        goto release;
+
+    dir_hash = attr_cache_hash_name( nt_dir.Buffer, nt_dir.Length );
+    if (!(dir_name = attr_cache_find_name( &nt_dir, dir_hash )))
+    {
+        if (!(dir_name = RtlAllocateHeap( GetProcessHeap(), 0,
+                                          FIELD_OFFSET( struct attr_cache_name, name[nt_dir.Length / sizeof(WCHAR)] ))))
+            goto release;
+        dir_name->hash = dir_hash;
+        dir_name->len = nt_dir.Length;
+        memcpy( dir_name->name, nt_dir.Buffer, nt_dir.Length );
+        list_add_head( &attr_cache_names[dir_hash % ATTR_CACHE_HASH_SIZE], &dir_name->entry );
+    }
+    else list_remove( &dir_name->dir_entry );
+    /* the NT path may now resolve to a different directory */
+    dir_name->dir = dir;
+    list_add_tail( &dir->names, &dir_name->dir_entry );
+
+    if (!(cache = RtlAllocateHeap( GetProcessHeap(), 0,
+                                   FIELD_OFFSET( struct attr_cache_entry, name[file.Length / sizeof(WCHAR)] ))))
+        goto release;
+    cache->dir = dir;  /* takes over the reference */
+    cache->st = *st;
+    cache->attributes = attributes;
+    cache->hash = hash;
+    cache->len = file.Length;
+    memcpy( cache->name, file.Buffer, file.Length );
+    list_add_head( &attr_cache_hash[hash % ATTR_CACHE_HASH_SIZE], &cache->entry );
+    list_add_head( &attr_cache_lru, &cache->lru_entry );
+    list_add_tail( &dir->files, &cache->dir_entry );
+
+    if (++attr_cache_count > attr_cache_max)
+        attr_cache_remove( LIST_ENTRY( list_tail( &attr_cache_lru ), struct attr_cache_entry, lru_entry ));
+    goto done;
+
+release:
+    attr_cache_release_dir( dir );
+done:
+    RtlLeaveCriticalSection( &attr_cache_section );
+    RtlFreeHeap( GetProcessHeap(), 0, path );
+}
+
+#else  /* HAVE_SYS_INOTIFY_H */
+
+static BOOL attr_cache_lookup( const OBJECT_ATTRIBUTES *attr, struct stat *st, ULONG *attributes )
+{
+    return FALSE;
+}
+
+static void attr_cache_insert( const OBJECT_ATTRIBUTES *attr, const char *unix_name,
+                               const struct stat *st, ULONG attributes )
+{
+}
+
+#endif  /* HAVE_SYS_INOTIFY_H */
+
+/* retrieve the unix information of a file for the NtQuery*AttributesFile functions */
+static NTSTATUS get_file_info_by_name( const OBJECT_ATTRIBUTES *attr, struct stat *st, ULONG *attributes )
 {
     ANSI_STRING unix_name;
     NTSTATUS status;
 
+    if (attr_cache_lookup( attr, st, attributes )) return STATUS_SUCCESS;
+
     if (!(status = nt_to_unix_file_name_attr( attr, &unix_name, FILE_OPEN )))
     {
-        ULONG attributes;
-        struct stat st;
-
-        if (get_file_info( unix_name.Buffer, &st, &attributes ) == -1)
+        if (get_file_info( unix_name.Buffer, st, attributes ) == -1)
             status = FILE_GetNtStatus();
-        else if (!S_ISREG(st.st_mode) && !S_ISDIR(st.st_mode))
+        else if (!S_ISREG(st->st_mode) && !S_ISDIR(st->st_mode))
             status = STATUS_INVALID_INFO_CLASS;
         else
-        {
-            FILE_BASIC_INFORMATION basic;
-            FILE_STANDARD_INFORMATION std;
-
-            fill_file_info( &st, attributes, &basic, FileBasicInformation );
-            fill_file_info( &st, attributes, &std, FileStandardInformation );
-
-            info->CreationTime   = basic.CreationTime;
-            info->LastAccessTime = basic.LastAccessTime;
-            info->LastWriteTime  = basic.LastWriteTime;
-            info->ChangeTime     = basic.ChangeTime;
-            info->AllocationSize = std.AllocationSize;
-            info->EndOfFile      = std.EndOfFile;
-            info->FileAttributes = basic.FileAttributes;
-            if (DIR_is_hidden_file( attr->ObjectName ))
-                info->FileAttributes |= FILE_ATTRIBUTE_HIDDEN;
-        }
+            attr_cache_insert( attr, unix_name.Buffer, st, *attributes );
         RtlFreeAnsiString( &unix_name );
     }
     else WARN("%s not found (%x)\n", debugstr_us(attr->ObjectName), status );
@@ -2937,33 +3585,54 @@ NTSTATUS WINAPI NtQueryFullAttributesFile( const OBJECT_ATTRIBUTES *attr,
 }
 
 
+/******************************************************************************
+ *              NtQueryFullAttributesFile   (NTDLL.@)
+ */
+NTSTATUS WINAPI NtQueryFullAttributesFile( const OBJECT_ATTRIBUTES *attr,
+                                           FILE_NETWORK_OPEN_INFORMATION *info )
+{
+    ULONG attributes;
+    struct stat st;
+    NTSTATUS status;
+
+    if (!(status = get_file_info_by_name( attr, &st, &attributes )))
+    {
+        FILE_BASIC_INFORMATION basic;
+        FILE_STANDARD_INFORMATION std;
+
+        fill_file_info( &st, attributes, &basic, FileBasicInformation );
+        fill_file_info( &st, attributes, &std, FileStandardInformation );
+
+        info->CreationTime   = basic.CreationTime;
+        info->LastAccessTime = basic.LastAccessTime;
+        info->LastWriteTime  = basic.LastWriteTime;
+        info->ChangeTime     = basic.ChangeTime;
+        info->AllocationSize = std.AllocationSize;
+        info->EndOfFile      = std.EndOfFile;
+        info->FileAttributes = basic.FileAttributes;
+        if (DIR_is_hidden_file( attr->ObjectName ))
+            info->FileAttributes |= FILE_ATTRIBUTE_HIDDEN;
+    }
+    return status;
+}
+
+
 /******************************************************************************
  *              NtQueryAttributesFile   (NTDLL.@)
  *              ZwQueryAttributesFile   (NTDLL.@)
  */
 NTSTATUS WINAPI NtQueryAttributesFile( const OBJECT_ATTRIBUTES *attr, FILE_BASIC_INFORMATION *info )
 {
-    ANSI_STRING unix_name;
+    ULONG attributes;
+    struct stat st;
     NTSTATUS status;
 
-    if (!(status = nt_to_unix_file_name_attr( attr, &unix_name, FILE_OPEN )))
+    if (!(status = get_file_info_by_name( attr, &st, &attributes )))
     {
-        ULONG attributes;
-        struct stat st;
-
-        if (get_file_info( unix_name.Buffer, &st, &attributes ) == -1)
-            status = FILE_GetNtStatus();
-        else if (!S_ISREG(st.st_mode) && !S_ISDIR(st.st_mode))
-            status = STATUS_INVALID_INFO_CLASS;
-        else
-        {
-            status = fill_file_info( &st, attributes, info, FileBasicInformation );
-            if (DIR_is_hidden_file( attr->ObjectName ))
-                info->FileAttributes |= FILE_ATTRIBUTE_HIDDEN;
-        }
-        RtlFreeAnsiString( &unix_name );
+        status = fill_file_info( &st, attributes, info, FileBasicInformation );
+        if (DIR_is_hidden_file( attr->ObjectName ))
+            info->FileAttributes |= FILE_ATTRIBUTE_HIDDEN;
     }
-    else WARN("%s not found (%x)\n", debugstr_us(attr->ObjectName), status );
     return status;
 }
 
@@ -338,6 +338,7 @@
 @ stdcall NtSetInformationProcess(long long long long)
 @ stdcall NtSetInformationThread(long long ptr long)
 @ stdcall NtSetInformationToken(long long ptr long)
+@ stdcall NtSetInformationVirtualMemory(long long long ptr ptr long)
 @ stdcall NtSetIntervalProfile(long long)
 @ stdcall NtSetIoCompletion(ptr long ptr long long)
 @ stub NtSetLdtEntries
@@ -1259,6 +1260,7 @@
 @ stdcall ZwSetInformationProcess(long long long long) NtSetInformationProcess
 @ stdcall ZwSetInformationThread(long long ptr long) NtSetInformationThread
 @ stdcall ZwSetInformationToken(long long ptr long) NtSetInformationToken
+@ stdcall ZwSetInformationVirtualMemory(long long long ptr ptr long) NtSetInformationVirtualMemory
 @ stdcall ZwSetIntervalProfile(long long) NtSetIntervalProfile
 @ stdcall ZwSetIoCompletion(ptr long ptr long long) NtSetIoCompletion
 @ stub ZwSetLdtEntries
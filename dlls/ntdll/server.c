@@ -810,7 +810,8 @@ union fd_cache_entry
     struct
     {
         int fd;
-        enum server_fd_type type : 5;
+        enum server_fd_type type : 4;
+        unsigned int        message_read : 1;  /* pipe read in message mode */
         unsigned int        access : 3;
         unsigned int        options : 24;
     } s;
@@ -818,6 +819,7 @@ union fd_cache_entry
 #include "poppack.h"
 
 C_ASSERT( sizeof(union fd_cache_entry) == sizeof(LONG64) );
+C_ASSERT( FD_TYPE_NB_TYPES <= 16 );
 
 #define FD_CACHE_BLOCK_SIZE  (65536 / sizeof(union fd_cache_entry))
 #define FD_CACHE_ENTRIES     128
@@ -839,7 +841,7 @@ static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
  * Caller must hold fd_cache_section.
  */
 static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
-                            unsigned int access, unsigned int options )
+                            unsigned int access, unsigned int options, BOOL message_read )
 {
     unsigned int entry, idx = handle_to_index( handle, &entry );
     union fd_cache_entry cache;
@@ -865,6 +867,7 @@ static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
     /* store fd+1 so that 0 can be used as the unset value */
     cache.s.fd = fd + 1;
     cache.s.type = type;
+    cache.s.message_read = message_read;
     cache.s.access = access;
     cache.s.options = options;
     cache.data = interlocked_xchg64( &fd_cache[entry][idx].data, cache.data );
@@ -914,6 +917,75 @@ int server_remove_fd_from_cache( HANDLE handle )
 }
 
 
+/***********************************************************************
+ *           get_pipe_read_mode
+ *
+ * Ask the server whether a pipe handle is read in message mode.
+ */
+static NTSTATUS get_pipe_read_mode( HANDLE handle, BOOL *message_read )
+{
+    NTSTATUS ret;
+
+    SERVER_START_REQ( get_named_pipe_info )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        if (!(ret = wine_server_call( req )))
+            *message_read = (reply->flags & NAMED_PIPE_MESSAGE_STREAM_READ) != 0;
+    }
+    SERVER_END_REQ;
+    return ret;
+}
+
+
+/***********************************************************************
+ *           server_get_pipe_read_mode
+ *
+ * Check whether a pipe handle is read in message mode, using the mode
+ * cached with its fd when there is one.
+ */
+NTSTATUS server_get_pipe_read_mode( HANDLE handle, BOOL *message_read )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry < FD_CACHE_ENTRIES && fd_cache[entry])
+    {
+        union fd_cache_entry cache;
+        cache.data = interlocked_cmpxchg64( &fd_cache[entry][idx].data, 0, 0 );
+        if (cache.s.fd && cache.s.type == FD_TYPE_PIPE)
+        {
+            *message_read = cache.s.message_read;
+            return STATUS_SUCCESS;
+        }
+    }
+    return get_pipe_read_mode( handle, message_read );
+}
+
+
+/***********************************************************************
+ *           server_set_pipe_read_mode
+ *
+ * Update the cached read mode of a pipe handle after it has been changed.
+ */
+void server_set_pipe_read_mode( HANDLE handle, BOOL message_read )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fd_cache_entry cache, old;
+
+    if (entry >= FD_CACHE_ENTRIES || !fd_cache[entry]) return;
+
+    old.data = interlocked_cmpxchg64( &fd_cache[entry][idx].data, 0, 0 );
+    for (;;)
+    {
+        if (!old.s.fd || old.s.type != FD_TYPE_PIPE) return;
+        cache = old;
+        cache.s.message_read = message_read;
+        cache.data = interlocked_cmpxchg64( &fd_cache[entry][idx].data, cache.data, old.data );
+        if (cache.data == old.data) return;
+        old = cache;
+    }
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -938,25 +1010,35 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
     fd = get_cached_fd( handle, type, &access, options );
     if (fd == -1)
     {
+        enum server_fd_type fd_type = FD_TYPE_INVALID;
+        unsigned int fd_options = 0;
+        BOOL cacheable = FALSE, message_read = FALSE;
+
         SERVER_START_REQ( get_handle_fd )
         {
             req->handle = wine_server_obj_handle( handle );
             if (!(ret = wine_server_call( req )))
             {
-                if (type) *type = reply->type;
-                if (options) *options = reply->options;
+                fd_type = reply->type;
+                fd_options = reply->options;
                 access = reply->access;
+                cacheable = reply->cacheable;
                 if ((fd = receive_fd( &fd_handle )) != -1)
-                {
                     assert( wine_server_ptr_handle(fd_handle) == handle );
-                    *needs_close = (!reply->cacheable ||
-                                    !add_fd_to_cache( handle, fd, reply->type,
-                                                      reply->access, reply->options ));
-                }
                 else ret = STATUS_TOO_MANY_OPENED_FILES;
             }
         }
         SERVER_END_REQ;
+
+        if (!ret)
+        {
+            if (type) *type = fd_type;
+            if (options) *options = fd_options;
+            /* the read mode of pipes is cached with the fd, it is only changed through FilePipeInformation */
+            if (cacheable && fd_type == FD_TYPE_PIPE) get_pipe_read_mode( handle, &message_read );
+            *needs_close = (!cacheable ||
+                            !add_fd_to_cache( handle, fd, fd_type, access, fd_options, message_read ));
+        }
     }
     server_leave_uninterrupted_section( &fd_cache_section, &sigset );
 
@@ -310,6 +310,98 @@ static void test_ntncdf_async(void)
     CloseHandle(hEvent);
 }
 
+static void test_ntncdf_batch(void)
+{
+    NTSTATUS r;
+    HANDLE hdir, hEvent;
+    char buffer[0x2000];
+    DWORD fflags, filter;
+    IO_STATUS_BLOCK iosb;
+    WCHAR path[MAX_PATH], subdir[MAX_PATH], file[MAX_PATH];
+    static const WCHAR szBoo[] = { '\\','b','o','o',0 };
+    static const WCHAR szHoo[] = { '\\','h','o','o',0 };
+    static const WCHAR fmtW[] = { '%','s','\\','f','%','0','2','u',0 };
+    PFILE_NOTIFY_INFORMATION pfni;
+    int i, count, added;
+
+    r = GetTempPathW( MAX_PATH, path );
+    ok( r != 0, "temp path failed\n");
+    if (!r)
+        return;
+
+    lstrcatW( path, szBoo );
+    lstrcpyW( subdir, path );
+    lstrcatW( subdir, szHoo );
+
+    r = CreateDirectoryW( path, NULL );
+    ok( r == TRUE, "failed to create directory\n");
+    r = CreateDirectoryW( subdir, NULL );
+    ok( r == TRUE, "failed to create directory\n");
+
+    fflags = FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED;
+    hdir = CreateFileW(path, GENERIC_READ|SYNCHRONIZE, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, fflags, NULL);
+    ok( hdir != INVALID_HANDLE_VALUE, "failed to open directory\n");
+
+    hEvent = CreateEventA( NULL, 0, 0, NULL );
+    filter = FILE_NOTIFY_CHANGE_FILE_NAME;
+
+    r = pNtNotifyChangeDirectoryFile(hdir,hEvent,NULL,NULL,&iosb,buffer,sizeof buffer,filter,1);
+    ok(r==STATUS_PENDING, "should status pending\n");
+
+    /* the first change completes the request, the others are queued until the next one */
+    for (i = 0; i < 32; i++)
+    {
+        HANDLE hfile;
+
+        wsprintfW( file, fmtW, subdir, i );
+        hfile = CreateFileW( file, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, NULL );
+        ok( hfile != INVALID_HANDLE_VALUE, "failed to create file %u\n", i );
+        CloseHandle( hfile );
+    }
+
+    r = WaitForSingleObject( hEvent, 1000 );
+    ok( r == WAIT_OBJECT_0, "event should be ready\n" );
+    ok( U(iosb).Status == STATUS_SUCCESS, "got status %x\n", U(iosb).Status );
+    Sleep( 100 );
+
+    /* all the pending records must be returned by a single request */
+    U(iosb).Status = 1;
+    iosb.Information = 0;
+    r = pNtNotifyChangeDirectoryFile(hdir,hEvent,NULL,NULL,&iosb,buffer,sizeof buffer,filter,1);
+    ok(r==STATUS_PENDING || r==STATUS_SUCCESS, "got %x\n", r);
+
+    r = WaitForSingleObject( hEvent, 1000 );
+    ok( r == WAIT_OBJECT_0, "event should be ready\n" );
+    ok( U(iosb).Status == STATUS_SUCCESS, "got status %x\n", U(iosb).Status );
+    ok( iosb.Information != 0, "no data returned\n" );
+
+    count = added = 0;
+    pfni = (PFILE_NOTIFY_INFORMATION) buffer;
+    while (iosb.Information)
+    {
+        count++;
+        if (pfni->Action == FILE_ACTION_ADDED) added++;
+        if (!pfni->NextEntryOffset) break;
+        pfni = (PFILE_NOTIFY_INFORMATION)((char *)pfni + pfni->NextEntryOffset);
+    }
+    ok( count > 1, "expected several records, got %u\n", count );
+    ok( added == count, "expected only added records, got %u/%u\n", added, count );
+
+    CloseHandle(hdir);
+    CloseHandle(hEvent);
+
+    for (i = 0; i < 32; i++)
+    {
+        wsprintfW( file, fmtW, subdir, i );
+        DeleteFileW( file );
+    }
+    r = RemoveDirectoryW( subdir );
+    ok( r == TRUE, "failed to remove directory\n");
+    r = RemoveDirectoryW( path );
+    ok( r == TRUE, "failed to remove directory\n");
+}
+
 START_TEST(change)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll");
@@ -330,4 +422,5 @@ START_TEST(change)
 
     test_ntncdf();
     test_ntncdf_async();
+    test_ntncdf_batch();
 }
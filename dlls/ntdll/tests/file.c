@@ -36,6 +36,8 @@
 #include "wine/test.h"
 #include "winternl.h"
 #include "winuser.h"
+#include "winnls.h"
+#include "winreg.h"
 #include "winioctl.h"
 
 #ifndef IO_COMPLETION_ALL_ACCESS
@@ -4159,10 +4161,127 @@ static void test_read_write(void)
     CloseHandle(hfile);
 }
 
+static void query_full_attributes( const char *file, FILE_NETWORK_OPEN_INFORMATION *info, int line )
+{
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING nameW;
+    WCHAR pathW[MAX_PATH];
+    NTSTATUS status;
+
+    MultiByteToWideChar( CP_ACP, 0, file, -1, pathW, MAX_PATH );
+    pRtlDosPathNameToNtPathName_U( pathW, &nameW, NULL, NULL );
+    InitializeObjectAttributes( &attr, &nameW, OBJ_CASE_INSENSITIVE, 0, NULL );
+    memset( info, 0, sizeof(*info) );
+    status = pNtQueryFullAttributesFile( &attr, info );
+    ok_(__FILE__,line)( !status, "NtQueryFullAttributesFile failed %x\n", status );
+    pRtlFreeUnicodeString( &nameW );
+}
+
+/* runs with HKCU\Software\Wine\FileAttributeCache set, the changes must be seen by the next query */
+static void attribute_cache_child( const char *file )
+{
+    FILE_NETWORK_OPEN_INFORMATION info;
+    HANDLE handle, ready, changed;
+    DWORD written;
+
+    ready = OpenEventA( EVENT_ALL_ACCESS, FALSE, "attribute_cache_ready" );
+    changed = OpenEventA( EVENT_ALL_ACCESS, FALSE, "attribute_cache_changed" );
+    ok( ready && changed, "OpenEvent failed %u\n", GetLastError() );
+
+    query_full_attributes( file, &info, __LINE__ );
+    ok( !(info.FileAttributes & FILE_ATTRIBUTE_READONLY), "got attributes %x\n", info.FileAttributes );
+    ok( !info.EndOfFile.QuadPart, "got size %u\n", info.EndOfFile.u.LowPart );
+    query_full_attributes( file, &info, __LINE__ );
+    ok( !info.EndOfFile.QuadPart, "got size %u\n", info.EndOfFile.u.LowPart );
+
+    /* changes made through other handles */
+    handle = CreateFileA( file, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, 0 );
+    ok( handle != INVALID_HANDLE_VALUE, "CreateFile failed %u\n", GetLastError() );
+    WriteFile( handle, "data", 4, &written, NULL );
+    CloseHandle( handle );
+    query_full_attributes( file, &info, __LINE__ );
+    ok( info.EndOfFile.QuadPart == 4, "got size %u\n", info.EndOfFile.u.LowPart );
+
+    ok( SetFileAttributesA( file, FILE_ATTRIBUTE_READONLY ), "SetFileAttributes failed %u\n", GetLastError() );
+    query_full_attributes( file, &info, __LINE__ );
+    ok( info.FileAttributes & FILE_ATTRIBUTE_READONLY, "got attributes %x\n", info.FileAttributes );
+    ok( SetFileAttributesA( file, FILE_ATTRIBUTE_NORMAL ), "SetFileAttributes failed %u\n", GetLastError() );
+    query_full_attributes( file, &info, __LINE__ );
+    ok( !(info.FileAttributes & FILE_ATTRIBUTE_READONLY), "got attributes %x\n", info.FileAttributes );
+
+    /* changes made by another process */
+    SetEvent( ready );
+    ok( !WaitForSingleObject( changed, 10000 ), "wait failed\n" );
+    query_full_attributes( file, &info, __LINE__ );
+    ok( info.FileAttributes & FILE_ATTRIBUTE_READONLY, "got attributes %x\n", info.FileAttributes );
+
+    CloseHandle( ready );
+    CloseHandle( changed );
+}
+
+static void test_query_attribute_cache( char **argv )
+{
+    static const DWORD cache_size = 100;
+    char path[MAX_PATH], file[MAX_PATH], cmdline[MAX_PATH * 2];
+    DWORD old_size, size = sizeof(old_size);
+    BOOL has_size;
+    HANDLE ready, changed;
+    STARTUPINFOA startup;
+    PROCESS_INFORMATION info;
+    HKEY key;
+
+    if (!pRtlDosPathNameToNtPathName_U || !pNtQueryFullAttributesFile)
+    {
+        win_skip( "NtQueryFullAttributesFile not available\n" );
+        return;
+    }
+    if (RegCreateKeyA( HKEY_CURRENT_USER, "Software\\Wine", &key ))
+    {
+        skip( "can't create the Wine key\n" );
+        return;
+    }
+    has_size = !RegQueryValueExA( key, "FileAttributeCache", NULL, NULL, (BYTE *)&old_size, &size );
+    RegSetValueExA( key, "FileAttributeCache", 0, REG_DWORD, (const BYTE *)&cache_size, sizeof(cache_size) );
+
+    GetTempPathA( MAX_PATH, path );
+    GetTempFileNameA( path, "atc", 0, file );
+    ready = CreateEventA( NULL, FALSE, FALSE, "attribute_cache_ready" );
+    changed = CreateEventA( NULL, FALSE, FALSE, "attribute_cache_changed" );
+
+    sprintf( cmdline, "%s file attribute_cache %s", argv[0], file );
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+    ok( CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info ),
+        "CreateProcess failed %u\n", GetLastError() );
+    if (!WaitForSingleObject( ready, 10000 ))
+    {
+        ok( SetFileAttributesA( file, FILE_ATTRIBUTE_READONLY ), "SetFileAttributes failed %u\n", GetLastError() );
+        SetEvent( changed );
+    }
+    else ok( 0, "child didn't signal\n" );
+    winetest_wait_child_process( info.hProcess );
+    CloseHandle( info.hProcess );
+    CloseHandle( info.hThread );
+
+    if (has_size)
+        RegSetValueExA( key, "FileAttributeCache", 0, REG_DWORD, (const BYTE *)&old_size, sizeof(old_size) );
+    else
+        RegDeleteValueA( key, "FileAttributeCache" );
+    RegCloseKey( key );
+
+    SetFileAttributesA( file, FILE_ATTRIBUTE_NORMAL );
+    DeleteFileA( file );
+    CloseHandle( ready );
+    CloseHandle( changed );
+}
+
 START_TEST(file)
 {
     HMODULE hkernel32 = GetModuleHandleA("kernel32.dll");
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
+    char **argv;
+    int argc;
+
     if (!hntdll)
     {
         skip("not running on NT, skipping test\n");
@@ -4196,6 +4315,13 @@ START_TEST(file)
     pNtQueryVolumeInformationFile = (void *)GetProcAddress(hntdll, "NtQueryVolumeInformationFile");
     pNtQueryFullAttributesFile = (void *)GetProcAddress(hntdll, "NtQueryFullAttributesFile");
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 4 && !strcmp( argv[2], "attribute_cache" ))
+    {
+        attribute_cache_child( argv[3] );
+        return;
+    }
+
     test_read_write();
     test_NtCreateFile();
     create_file_test();
@@ -4216,4 +4342,5 @@ START_TEST(file)
     test_file_disposition_information();
     test_query_volume_information_file();
     test_query_attribute_information_file();
+    test_query_attribute_cache( argv );
 }
@@ -237,6 +237,7 @@ HANDLE thread_init(void)
         exit(1);
     }
     user_shared_data = addr;
+    user_shared_data->LargePageMinimum = virtual_get_large_page_size();
 
     /* allocate and initialize the PEB */
 
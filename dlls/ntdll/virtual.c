@@ -144,6 +144,7 @@ static const BOOL is_win64 = (sizeof(void *) > sizeof(int));
 #define VIRTUAL_HEAP_SIZE (sizeof(void*)*1024*1024)
 
 static HANDLE virtual_heap;
+static SIZE_T large_page_size;  /* size of huge pages, 0 if not supported */
 static void *preload_reserve_start;
 static void *preload_reserve_end;
 static BOOL use_locks;
@@ -856,6 +857,20 @@ done:
 }
 
 
+/***********************************************************************
+ *           set_large_pages
+ *
+ * Ask the kernel to back a range with huge pages, if supported.
+ */
+static void set_large_pages( void *base, size_t size )
+{
+#ifdef MADV_HUGEPAGE
+    if (madvise( base, size, MADV_HUGEPAGE ))
+        WARN( "huge pages not available for %p-%p\n", base, (char *)base + size );
+#endif
+}
+
+
 /***********************************************************************
  *           map_file_into_view
  *
@@ -1297,6 +1312,72 @@ static int alloc_virtual_heap( void *base, size_t size, void *arg )
     return (*heap_base != (void *)-1);
 }
 
+/***********************************************************************
+ *           init_large_page_size
+ *
+ * Get the size of the huge pages that can back large page allocations.
+ */
+static void init_large_page_size(void)
+{
+#ifdef linux
+    FILE *f = fopen( "/proc/meminfo", "r" );
+    if (f)
+    {
+        char buffer[256];
+        unsigned long value;
+
+        while (fgets( buffer, sizeof(buffer), f ))
+        {
+            if (sscanf( buffer, "Hugepagesize: %lu", &value ) == 1)
+            {
+                large_page_size = (SIZE_T)value * 1024;
+                break;
+            }
+        }
+        fclose( f );
+    }
+#endif
+#if defined(__i386__) || defined(__x86_64__)
+    if (!large_page_size) large_page_size = 2 * 1024 * 1024;
+#endif
+}
+
+
+/***********************************************************************
+ *           virtual_get_large_page_size
+ */
+SIZE_T virtual_get_large_page_size(void)
+{
+    return large_page_size;
+}
+
+
+/***********************************************************************
+ *           check_lock_memory_privilege
+ *
+ * Check that the caller may allocate large pages.
+ */
+static BOOL check_lock_memory_privilege(void)
+{
+    PRIVILEGE_SET privs;
+    HANDLE token;
+    BOOLEAN ret = FALSE;
+
+    if (NtOpenThreadToken( GetCurrentThread(), TOKEN_QUERY, TRUE, &token ) &&
+        NtOpenProcessToken( NtCurrentProcess(), TOKEN_QUERY, &token ))
+        return FALSE;
+
+    privs.PrivilegeCount = 1;
+    privs.Control = PRIVILEGE_SET_ALL_NECESSARY;
+    privs.Privilege[0].Luid.LowPart = SE_LOCK_MEMORY_PRIVILEGE;
+    privs.Privilege[0].Luid.HighPart = 0;
+    privs.Privilege[0].Attributes = 0;
+    if (NtPrivilegeCheck( token, &privs, &ret )) ret = FALSE;
+    NtClose( token );
+    return ret;
+}
+
+
 /***********************************************************************
  *           virtual_init
  */
@@ -1325,6 +1406,7 @@ void virtual_init(void)
             preload_reserve_end = (void *)end;
         }
     }
+    init_large_page_size();
 
     /* try to find space in a reserved area for the virtual heap */
     if (!wine_mmap_enum_reserved_areas( alloc_virtual_heap, &heap_base, 1 ))
@@ -1872,6 +1954,13 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG zero_
 
     if (!size) return STATUS_INVALID_PARAMETER;
 
+    if (type & MEM_LARGE_PAGES)
+    {
+        if (!large_page_size) return STATUS_NOT_SUPPORTED;
+        if (size & (large_page_size - 1)) return STATUS_INVALID_PARAMETER;
+        if (!check_lock_memory_privilege()) return STATUS_PRIVILEGE_NOT_HELD;
+    }
+
     if (process != NtCurrentProcess())
     {
         apc_call_t call;
@@ -1942,12 +2031,20 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG zero_
     /* Compute the alloc type flags */
 
     if (!(type & (MEM_COMMIT | MEM_RESERVE | MEM_RESET)) ||
-        (type & ~(MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET)))
+        (type & ~(MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET | MEM_LARGE_PAGES)))
     {
         WARN("called with wrong alloc type flags (%08x) !\n", type);
         return STATUS_INVALID_PARAMETER;
     }
 
+    if (type & MEM_LARGE_PAGES)
+    {
+        /* large pages must be reserved and committed in one go */
+        if ((type & (MEM_COMMIT | MEM_RESERVE)) != (MEM_COMMIT | MEM_RESERVE))
+            return STATUS_INVALID_PARAMETER;
+        if (!base) mask |= large_page_size - 1;
+    }
+
     /* Reserve the memory */
 
     if (use_locks) server_enter_uninterrupted_section( &csVirtual, &sigset );
@@ -1956,7 +2053,11 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG zero_
     {
         if (type & MEM_WRITE_WATCH) vprot |= VPROT_WRITEWATCH;
         status = map_view( &view, base, size, mask, type & MEM_TOP_DOWN, vprot );
-        if (status == STATUS_SUCCESS) base = view->base;
+        if (status == STATUS_SUCCESS)
+        {
+            base = view->base;
+            if (type & MEM_LARGE_PAGES) set_large_pages( base, size );
+        }
     }
     else if (type & MEM_RESET)
     {
@@ -2466,11 +2567,20 @@ NTSTATUS WINAPI NtCreateSection( HANDLE *handle, ACCESS_MASK access, const OBJEC
     /* Check parameters */
 
     if ((ret = get_vprot_flags( protect, &vprot, sec_flags & SEC_IMAGE ))) return ret;
+    if (sec_flags & SEC_LARGE_PAGES)
+    {
+        /* only committed, pagefile backed sections can use large pages */
+        if (!large_page_size) return STATUS_NOT_SUPPORTED;
+        if (file || (sec_flags & SEC_RESERVE) || !size || (size->QuadPart & (large_page_size - 1)))
+            return STATUS_INVALID_PARAMETER;
+        if (!check_lock_memory_privilege()) return STATUS_PRIVILEGE_NOT_HELD;
+    }
     if ((ret = alloc_object_attributes( attr, &objattr, &len ))) return ret;
 
     if (!(sec_flags & SEC_RESERVE)) vprot |= VPROT_COMMITTED;
     if (sec_flags & SEC_NOCACHE) vprot |= VPROT_NOCACHE;
     if (sec_flags & SEC_IMAGE) vprot |= VPROT_IMAGE;
+    if (sec_flags & SEC_LARGE_PAGES) vprot |= VPROT_LARGE_PAGES;
 
     /* Create the server object */
 
@@ -2697,6 +2807,7 @@ NTSTATUS WINAPI NtMapViewOfSection( HANDLE handle, HANDLE process, PVOID *addr_p
         view->mapping = dup_mapping;
         view->map_protect = map_vprot;
         dup_mapping = 0;  /* don't close it */
+        if (map_vprot & VPROT_LARGE_PAGES) set_large_pages( view->base, size );
     }
     else
     {
@@ -2798,6 +2909,61 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
 }
 
 
+/***********************************************************************
+ *             NtSetInformationVirtualMemory   (NTDLL.@)
+ *             ZwSetInformationVirtualMemory   (NTDLL.@)
+ */
+NTSTATUS WINAPI NtSetInformationVirtualMemory( HANDLE process, VIRTUAL_MEMORY_INFORMATION_CLASS info_class,
+                                               ULONG_PTR count, PMEMORY_RANGE_ENTRY addresses,
+                                               PVOID ptr, ULONG size )
+{
+    ULONG_PTR i;
+
+    TRACE( "%p %d %lu %p %p %u\n", process, info_class, count, addresses, ptr, size );
+
+    switch (info_class)
+    {
+    case VmPrefetchInformation:
+        if (!ptr) return STATUS_INVALID_PARAMETER_5;
+        if (size != sizeof(ULONG)) return STATUS_INVALID_PARAMETER_6;
+        if (*(ULONG *)ptr) return STATUS_INVALID_PARAMETER_5;
+        if (!count) return STATUS_INVALID_PARAMETER_3;
+        if (!addresses) return STATUS_ACCESS_VIOLATION;
+
+        if (process != NtCurrentProcess())
+        {
+            PROCESS_BASIC_INFORMATION pbi;
+            NTSTATUS status = NtQueryInformationProcess( process, ProcessBasicInformation,
+                                                         &pbi, sizeof(pbi), NULL );
+
+            if (status) return status;
+            /* the pages of another process can't be read ahead from here */
+            if (pbi.UniqueProcessId != HandleToULong( NtCurrentTeb()->ClientId.UniqueProcess ))
+            {
+                FIXME( "prefetch for process %p not supported\n", process );
+                return STATUS_NOT_SUPPORTED;
+            }
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            char *base = ROUND_ADDR( addresses[i].VirtualAddress, page_mask );
+            SIZE_T len = ROUND_SIZE( addresses[i].VirtualAddress, addresses[i].NumberOfBytes );
+
+            if (!len) continue;
+            /* this starts read-ahead on file mappings; unmapped ranges are ignored */
+            madvise( base, len, MADV_WILLNEED );
+        }
+        return STATUS_SUCCESS;
+
+    default:
+        FIXME( "(%p,%d,%lu,%p,%p,%u) Unknown information class\n",
+               process, info_class, count, addresses, ptr, size );
+        return STATUS_INVALID_PARAMETER_2;
+    }
+}
+
+
 /***********************************************************************
  *             NtGetWriteWatch   (NTDLL.@)
  *             ZwGetWriteWatch   (NTDLL.@)
@@ -1100,7 +1100,6 @@ static SECURITY_STATUS SEC_ENTRY schan_EncryptMessage(PCtxtHandle context_handle
     SecBuffer *buffer;
     SIZE_T data_size;
     SIZE_T length;
-    char *data;
     int idx;
 
     TRACE("context_handle %p, quality %d, message %p, message_seq_no %d\n",
@@ -1120,8 +1119,6 @@ static SECURITY_STATUS SEC_ENTRY schan_EncryptMessage(PCtxtHandle context_handle
     buffer = &message->pBuffers[idx];
 
     data_size = buffer->cbBuffer;
-    data = HeapAlloc(GetProcessHeap(), 0, data_size);
-    memcpy(data, buffer->pvBuffer, data_size);
 
     transport.ctx = ctx;
     init_schan_buffers(&transport.in, NULL, NULL);
@@ -1131,8 +1128,9 @@ static SECURITY_STATUS SEC_ENTRY schan_EncryptMessage(PCtxtHandle context_handle
         init_schan_buffers(&transport.out, message, schan_encrypt_message_get_next_buffer_token);
     schan_imp_set_session_transport(ctx->session, &transport);
 
+    /* the record is written over the data buffer, schan_imp_send takes care of that */
     length = data_size;
-    status = schan_imp_send(ctx->session, data, &length);
+    status = schan_imp_send(ctx->session, buffer->pvBuffer, &length);
 
     TRACE("Sent %ld bytes.\n", length);
 
@@ -1141,7 +1139,6 @@ static SECURITY_STATUS SEC_ENTRY schan_EncryptMessage(PCtxtHandle context_handle
 
     b = &transport.out;
     b->desc->pBuffers[b->current_buffer_idx].cbBuffer = b->offset;
-    HeapFree(GetProcessHeap(), 0, data);
 
     TRACE("Returning %#x.\n", status);
 
@@ -1219,7 +1216,6 @@ static SECURITY_STATUS SEC_ENTRY schan_DecryptMessage(PCtxtHandle context_handle
     struct schan_context *ctx;
     SecBuffer *buffer;
     SIZE_T data_size;
-    char *data;
     unsigned expected_size;
     SSIZE_T received = 0;
     int idx;
@@ -1256,8 +1252,9 @@ static SECURITY_STATUS SEC_ENTRY schan_DecryptMessage(PCtxtHandle context_handle
         return SEC_E_INCOMPLETE_MESSAGE;
     }
 
+    /* The whole record is pulled before any plaintext is returned, so it
+     * can be decrypted in place behind the record header. */
     data_size = expected_size - 5;
-    data = HeapAlloc(GetProcessHeap(), 0, data_size);
 
     transport.ctx = ctx;
     init_schan_buffers(&transport.in, message, schan_decrypt_message_get_next_buffer);
@@ -1268,14 +1265,13 @@ static SECURITY_STATUS SEC_ENTRY schan_DecryptMessage(PCtxtHandle context_handle
     while (received < data_size)
     {
         SIZE_T length = data_size - received;
-        SECURITY_STATUS status = schan_imp_recv(ctx->session, data + received, &length);
+        SECURITY_STATUS status = schan_imp_recv(ctx->session, buf_ptr + 5 + received, &length);
 
         if (status == SEC_I_CONTINUE_NEEDED)
             break;
 
         if (status != SEC_E_OK)
         {
-            HeapFree(GetProcessHeap(), 0, data);
             ERR("Returning %x\n", status);
             return status;
         }
@@ -1288,9 +1284,6 @@ static SECURITY_STATUS SEC_ENTRY schan_DecryptMessage(PCtxtHandle context_handle
 
     TRACE("Received %ld bytes\n", received);
 
-    memcpy(buf_ptr + 5, data, received);
-    HeapFree(GetProcessHeap(), 0, data);
-
     schan_decrypt_fill_buffer(message, SECBUFFER_DATA,
         buf_ptr + 5, received);
 
@@ -402,7 +402,19 @@ SECURITY_STATUS schan_imp_send(schan_imp_session session, const void *buffer,
                                SIZE_T *length)
 {
     gnutls_session_t s = (gnutls_session_t)session;
+    SECURITY_STATUS status;
     SSIZE_T ret, total = 0;
+    char *copy = NULL;
+
+    /* A record is encrypted before it is pushed, so a single record may be
+     * encrypted in place. Data spanning several records would get overwritten
+     * by the first one, so it has to be copied. */
+    if (*length > pgnutls_record_get_max_size(s))
+    {
+        if (!(copy = HeapAlloc(GetProcessHeap(), 0, *length))) return SEC_E_INSUFFICIENT_MEMORY;
+        memcpy(copy, buffer, *length);
+        buffer = copy;
+    }
 
     for (;;)
     {
@@ -411,7 +423,11 @@ SECURITY_STATUS schan_imp_send(schan_imp_session session, const void *buffer,
         {
             total += ret;
             TRACE( "sent %ld now %ld/%ld\n", ret, total, *length );
-            if (total == *length) return SEC_E_OK;
+            if (total == *length)
+            {
+                status = SEC_E_OK;
+                break;
+            }
         }
         else if (ret == GNUTLS_E_AGAIN)
         {
@@ -419,14 +435,19 @@ SECURITY_STATUS schan_imp_send(schan_imp_session session, const void *buffer,
             SIZE_T count = 0;
 
             if (schan_get_buffer(t, &t->out, &count)) continue;
-            return SEC_I_CONTINUE_NEEDED;
+            status = SEC_I_CONTINUE_NEEDED;
+            break;
         }
         else
         {
             pgnutls_perror(ret);
-            return SEC_E_INTERNAL_ERROR;
+            status = SEC_E_INTERNAL_ERROR;
+            break;
         }
     }
+
+    HeapFree(GetProcessHeap(), 0, copy);
+    return status;
 }
 
 SECURITY_STATUS schan_imp_recv(schan_imp_session session, void *buffer,
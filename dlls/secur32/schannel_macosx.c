@@ -942,11 +942,19 @@ SECURITY_STATUS schan_imp_send(schan_imp_session session, const void *buffer,
                                SIZE_T *length)
 {
     struct mac_session* s = (struct mac_session*)session;
+    void *copy;
     int status;
 
     TRACE("(%p/%p, %p, %p/%lu)\n", s, s->context, buffer, length, *length);
 
-    status = SSLWrite(s->context, buffer, *length, length);
+    /* Secure Transport may split the data into several records, which are
+     * written over the data as soon as they are encrypted */
+    if (!(copy = HeapAlloc(GetProcessHeap(), 0, *length)))
+        return SEC_E_INSUFFICIENT_MEMORY;
+    memcpy(copy, buffer, *length);
+
+    status = SSLWrite(s->context, copy, *length, length);
+    HeapFree(GetProcessHeap(), 0, copy);
     if (status == noErr)
         TRACE("Wrote %lu bytes\n", *length);
     else if (status == errSSLWouldBlock)
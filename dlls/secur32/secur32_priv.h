@@ -255,6 +255,9 @@ extern SECURITY_STATUS schan_imp_get_connection_info(schan_imp_session session,
                                                      SecPkgContext_ConnectionInfo *info) DECLSPEC_HIDDEN;
 extern SECURITY_STATUS schan_imp_get_session_peer_certificate(schan_imp_session session, HCERTSTORE,
                                                               PCCERT_CONTEXT *cert) DECLSPEC_HIDDEN;
+/* The buffer passed to schan_imp_send may be overwritten by the records
+ * written to the transport, and schan_imp_recv may be asked to decrypt into
+ * the transport input buffer behind the record being read. */
 extern SECURITY_STATUS schan_imp_send(schan_imp_session session, const void *buffer,
                                       SIZE_T *length) DECLSPEC_HIDDEN;
 extern SECURITY_STATUS schan_imp_recv(schan_imp_session session, void *buffer,
@@ -20,6 +20,13 @@
 
 #include <stdarg.h>
 
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define USE_SSE2_CONVERTERS
+#define SSE2_FUNC __attribute__((__target__("sse2")))
+#include <emmintrin.h>
+#endif
+
 #define COBJMACROS
 
 #include "windef.h"
@@ -82,9 +89,344 @@ static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
 }
 
+/* Row conversion functions for the common format pairs. Functions converting between
+ * formats of the same size have to work in place. */
+typedef void (*convert_row_func)(BYTE *dst, const BYTE *src, UINT width);
+
+static void convert_gray8_to_bgra(BYTE *dst, const BYTE *src, UINT width)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x;
+
+    for (x = 0; x < width; x++) pixel[x] = 0xff000000 | src[x] << 16 | src[x] << 8 | src[x];
+}
+
+static void convert_bgr24_to_bgra(BYTE *dst, const BYTE *src, UINT width)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 3)
+        pixel[x] = 0xff000000 | src[2] << 16 | src[1] << 8 | src[0];
+}
+
+static void convert_rgb24_to_bgra(BYTE *dst, const BYTE *src, UINT width)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 3)
+        pixel[x] = 0xff000000 | src[0] << 16 | src[1] << 8 | src[2];
+}
+
+static void convert_bgrx_to_bgra(BYTE *dst, const BYTE *src, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++) dst[x * 4 + 3] = 0xff;
+}
+
+/* 16-bit samples are stored most significant byte first */
+static void convert_rgb48_to_bgra(BYTE *dst, const BYTE *src, UINT width)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 6)
+        pixel[x] = 0xff000000 | src[0] << 16 | src[2] << 8 | src[4];
+}
+
+static void convert_rgba64_to_bgra(BYTE *dst, const BYTE *src, UINT width)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 8)
+        pixel[x] = src[6] << 24 | src[0] << 16 | src[2] << 8 | src[4];
+}
+
+static void convert_bgra_to_pbgra(BYTE *dst, const BYTE *src, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 4, dst += 4)
+    {
+        BYTE alpha = src[3];
+
+        if (alpha != 255)
+        {
+            dst[0] = src[0] * alpha / 255;
+            dst[1] = src[1] * alpha / 255;
+            dst[2] = src[2] * alpha / 255;
+        }
+        else if (dst != src) *(DWORD *)dst = *(const DWORD *)src;
+        dst[3] = alpha;
+    }
+}
+
+static void convert_bgr24_swap(BYTE *dst, const BYTE *src, UINT width)
+{
+    UINT x;
+    BYTE temp;
+
+    for (x = 0; x < width; x++, src += 3, dst += 3)
+    {
+        temp = src[0];
+        dst[1] = src[1];
+        dst[0] = src[2];
+        dst[2] = temp;
+    }
+}
+
+static void convert_bgra_to_bgr24(BYTE *dst, const BYTE *src, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 4, dst += 3)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+    }
+}
+
+static void convert_bgra_to_rgb24(BYTE *dst, const BYTE *src, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 4, dst += 3)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+    }
+}
+
+#ifdef USE_SSE2_CONVERTERS
+
+static BOOL use_sse2;
+
+static SSE2_FUNC void convert_gray8_to_bgra_sse2(BYTE *dst, const BYTE *src, UINT width)
+{
+    const __m128i alpha = _mm_set1_epi16(0xff00);
+    UINT x;
+
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        __m128i gray = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i gg_lo = _mm_unpacklo_epi8(gray, gray), gg_hi = _mm_unpackhi_epi8(gray, gray);
+        __m128i ga_lo = _mm_or_si128(_mm_unpacklo_epi8(gray, _mm_setzero_si128()), alpha);
+        __m128i ga_hi = _mm_or_si128(_mm_unpackhi_epi8(gray, _mm_setzero_si128()), alpha);
+
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_unpacklo_epi16(gg_lo, ga_lo));
+        _mm_storeu_si128((__m128i *)(dst + x * 4 + 16), _mm_unpackhi_epi16(gg_lo, ga_lo));
+        _mm_storeu_si128((__m128i *)(dst + x * 4 + 32), _mm_unpacklo_epi16(gg_hi, ga_hi));
+        _mm_storeu_si128((__m128i *)(dst + x * 4 + 48), _mm_unpackhi_epi16(gg_hi, ga_hi));
+    }
+    convert_gray8_to_bgra(dst + x * 4, src + x, width - x);
+}
+
+static SSE2_FUNC void convert_bgrx_to_bgra_sse2(BYTE *dst, const BYTE *src, UINT width)
+{
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(src + x * 4));
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_or_si128(pixels, alpha));
+    }
+    convert_bgrx_to_bgra(dst + x * 4, src + x * 4, width - x);
+}
+
+static SSE2_FUNC void convert_rgba64_to_bgra_sse2(BYTE *dst, const BYTE *src, UINT width)
+{
+    const __m128i mask = _mm_set1_epi16(0xff);
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src + x * 8));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + x * 8 + 16));
+
+        /* keep the first byte of each sample and swap red and blue */
+        lo = _mm_and_si128(lo, mask);
+        hi = _mm_and_si128(hi, mask);
+        lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+        hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_packus_epi16(lo, hi));
+    }
+    convert_rgba64_to_bgra(dst + x * 4, src + x * 8, width - x);
+}
+
+/* x * alpha / 255 rounded down, computed as (t + 1 + (t >> 8)) >> 8 with t = x * alpha */
+static SSE2_FUNC __m128i premultiply_epu16(__m128i pixels)
+{
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+    __m128i t = _mm_mullo_epi16(pixels, alpha);
+
+    t = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, _mm_set1_epi16(1)), _mm_srli_epi16(t, 8)), 8);
+    /* keep the original alpha */
+    return _mm_or_si128(_mm_andnot_si128(_mm_set_epi16(0xffff,0,0,0,0xffff,0,0,0), t),
+                        _mm_and_si128(_mm_set_epi16(0xffff,0,0,0,0xffff,0,0,0), pixels));
+}
+
+static SSE2_FUNC void convert_bgra_to_pbgra_sse2(BYTE *dst, const BYTE *src, UINT width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(src + x * 4));
+        __m128i lo = premultiply_epu16(_mm_unpacklo_epi8(pixels, zero));
+        __m128i hi = premultiply_epu16(_mm_unpackhi_epi8(pixels, zero));
+
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_packus_epi16(lo, hi));
+    }
+    convert_bgra_to_pbgra(dst + x * 4, src + x * 4, width - x);
+}
+
+#endif /* USE_SSE2_CONVERTERS */
+
+struct row_converter
+{
+    enum pixelformat src, dst;
+    UINT src_bpp, dst_bpp;
+    convert_row_func convert;
+#ifdef USE_SSE2_CONVERTERS
+    convert_row_func convert_sse2;
+#endif
+};
+
+#ifdef USE_SSE2_CONVERTERS
+#define ROW_CONVERTER(src, dst, src_bpp, dst_bpp, func, func_sse2) \
+    { src, dst, src_bpp, dst_bpp, func, func_sse2 }
+#else
+#define ROW_CONVERTER(src, dst, src_bpp, dst_bpp, func, func_sse2) \
+    { src, dst, src_bpp, dst_bpp, func }
+#endif
+
+static const struct row_converter row_converters[] =
+{
+    ROW_CONVERTER(format_8bppGray, format_32bppBGRA, 8, 32, convert_gray8_to_bgra, convert_gray8_to_bgra_sse2),
+    ROW_CONVERTER(format_24bppBGR, format_32bppBGRA, 24, 32, convert_bgr24_to_bgra, NULL),
+    ROW_CONVERTER(format_24bppRGB, format_32bppBGRA, 24, 32, convert_rgb24_to_bgra, NULL),
+    ROW_CONVERTER(format_32bppBGR, format_32bppBGRA, 32, 32, convert_bgrx_to_bgra, convert_bgrx_to_bgra_sse2),
+    ROW_CONVERTER(format_48bppRGB, format_32bppBGRA, 48, 32, convert_rgb48_to_bgra, NULL),
+    ROW_CONVERTER(format_64bppRGBA, format_32bppBGRA, 64, 32, convert_rgba64_to_bgra, convert_rgba64_to_bgra_sse2),
+    ROW_CONVERTER(format_32bppBGRA, format_32bppPBGRA, 32, 32, convert_bgra_to_pbgra, convert_bgra_to_pbgra_sse2),
+    ROW_CONVERTER(format_24bppRGB, format_24bppBGR, 24, 24, convert_bgr24_swap, NULL),
+    ROW_CONVERTER(format_24bppBGR, format_24bppRGB, 24, 24, convert_bgr24_swap, NULL),
+    ROW_CONVERTER(format_32bppBGR, format_24bppBGR, 32, 24, convert_bgra_to_bgr24, NULL),
+    ROW_CONVERTER(format_32bppBGRA, format_24bppBGR, 32, 24, convert_bgra_to_bgr24, NULL),
+    ROW_CONVERTER(format_32bppPBGRA, format_24bppBGR, 32, 24, convert_bgra_to_bgr24, NULL),
+    ROW_CONVERTER(format_32bppBGR, format_24bppRGB, 32, 24, convert_bgra_to_rgb24, NULL),
+    ROW_CONVERTER(format_32bppBGRA, format_24bppRGB, 32, 24, convert_bgra_to_rgb24, NULL),
+    ROW_CONVERTER(format_32bppPBGRA, format_24bppRGB, 32, 24, convert_bgra_to_rgb24, NULL),
+};
+
+static convert_row_func get_row_converter(enum pixelformat src, enum pixelformat dst, UINT *src_bpp, UINT *dst_bpp)
+{
+    UINT i;
+
+    for (i = 0; i < sizeof(row_converters) / sizeof(row_converters[0]); i++)
+    {
+        if (row_converters[i].src != src || row_converters[i].dst != dst) continue;
+        *src_bpp = row_converters[i].src_bpp;
+        *dst_bpp = row_converters[i].dst_bpp;
+#ifdef USE_SSE2_CONVERTERS
+        if (use_sse2 && row_converters[i].convert_sse2) return row_converters[i].convert_sse2;
+#endif
+        return row_converters[i].convert;
+    }
+    return NULL;
+}
+
+/* Convert the source rectangle one row at a time. When the source pixels are not larger
+ * than the destination ones, the source is read straight into the destination buffer
+ * and each row is converted in place, starting from its end if the pixels grow.
+ * Otherwise the source is read in strips of a few rows. */
+static HRESULT copypixels_convert_rows(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, UINT src_bpp, UINT dst_bpp, convert_row_func convert)
+{
+    UINT src_size = src_bpp / 8, dst_size = dst_bpp / 8;
+    HRESULT hr = S_OK;
+    INT y;
+
+    if (!prc || !prc->Width || !prc->Height) return S_OK;
+
+    /* the source rows are read into the buffer before being expanded in place */
+    if (prc->Width < 0 || prc->Height < 0 ||
+        cbStride < (ULONGLONG)prc->Width * dst_size ||
+        cbBufferSize < (ULONGLONG)cbStride * (prc->Height - 1) + (ULONGLONG)prc->Width * dst_size)
+        return E_INVALIDARG;
+
+    if (src_size <= dst_size)
+    {
+        BYTE chunk[1024];
+        UINT count, x, step = sizeof(chunk) / src_size;
+
+        hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
+        if (FAILED(hr)) return hr;
+
+        for (y = 0; y < prc->Height; y++)
+        {
+            BYTE *row = pbBuffer + cbStride * y;
+
+            if (src_size == dst_size)
+            {
+                convert(row, row, prc->Width);
+                continue;
+            }
+            for (x = prc->Width; x > 0; x -= count)
+            {
+                count = min(x, step);
+                memcpy(chunk, row + (x - count) * src_size, count * src_size);
+                convert(row + (x - count) * dst_size, chunk, count);
+            }
+        }
+    }
+    else
+    {
+        UINT srcstride = prc->Width * src_size, rows = max(1, 65536 / srcstride);
+        BYTE *srcdata;
+        WICRect rc;
+
+        rows = min(rows, prc->Height);
+        if (!(srcdata = HeapAlloc(GetProcessHeap(), 0, srcstride * rows))) return E_OUTOFMEMORY;
+
+        rc.X = prc->X;
+        rc.Width = prc->Width;
+        for (y = 0; y < prc->Height; y += rc.Height)
+        {
+            INT i;
+
+            rc.Y = prc->Y + y;
+            rc.Height = min(rows, prc->Height - y);
+            hr = IWICBitmapSource_CopyPixels(This->source, &rc, srcstride, srcstride * rc.Height, srcdata);
+            if (FAILED(hr)) break;
+
+            for (i = 0; i < rc.Height; i++)
+                convert(pbBuffer + cbStride * (y + i), srcdata + srcstride * i, prc->Width);
+        }
+
+        HeapFree(GetProcessHeap(), 0, srcdata);
+        if (FAILED(hr)) return hr;
+    }
+
+    return S_OK;
+}
+
 static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
+    convert_row_func convert;
+    UINT src_bpp, dst_bpp;
+
+    if ((convert = get_row_converter(source_format, format_32bppBGRA, &src_bpp, &dst_bpp)))
+        return copypixels_convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, src_bpp, dst_bpp, convert);
+
     switch (source_format)
     {
     case format_1bppIndexed:
@@ -278,48 +620,6 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             return res;
         }
         return S_OK;
-    case format_8bppGray:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                    {
-                        *dstpixel++ = 0xff000000|(*srcbyte<<16)|(*srcbyte<<8)|*srcbyte;
-                        srcbyte++;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
     case format_8bppIndexed:
         if (prc)
         {
@@ -559,112 +859,6 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             return res;
         }
         return S_OK;
-    case format_24bppBGR:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-
-            srcstride = 3 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
-    case format_24bppRGB:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
-
-            srcstride = 3 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
-    case format_32bppBGR:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (FAILED(res)) return res;
-
-            /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
-        }
-        return S_OK;
     case format_32bppBGRA:
         if (prc)
             return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
@@ -691,95 +885,6 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 }
         }
         return S_OK;
-    case format_48bppRGB:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = 6 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        BYTE red, green, blue;
-                        red = *srcpixel++; srcpixel++;
-                        green = *srcpixel++; srcpixel++;
-                        blue = *srcpixel++; srcpixel++;
-                        *dstpixel++=0xff000000|red<<16|green<<8|blue;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
-    case format_64bppRGBA:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = 8 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        BYTE red, green, blue, alpha;
-                        red = *srcpixel++; srcpixel++;
-                        green = *srcpixel++; srcpixel++;
-                        blue = *srcpixel++; srcpixel++;
-                        alpha = *srcpixel++; srcpixel++;
-                        *dstpixel++=alpha<<24|red<<16|green<<8|blue;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
     case format_32bppCMYK:
         if (prc)
         {
@@ -822,9 +927,33 @@ static HRESULT copypixels_to_32bppBGR(struct FormatConverter *This, const WICRec
     }
 }
 
+static BOOL is_opaque_format(enum pixelformat format)
+{
+    switch (format)
+    {
+    case format_BlackWhite:
+    case format_2bppGray:
+    case format_4bppGray:
+    case format_8bppGray:
+    case format_16bppGray:
+    case format_16bppBGR555:
+    case format_16bppBGR565:
+    case format_24bppBGR:
+    case format_24bppRGB:
+    case format_32bppBGR:
+    case format_48bppRGB:
+    case format_32bppCMYK:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
 static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
+    convert_row_func convert;
+    UINT src_bpp, dst_bpp;
     HRESULT hr;
 
     switch (source_format)
@@ -833,23 +962,19 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
         if (prc)
             return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
         return S_OK;
+    case format_32bppBGRA:
+        convert = get_row_converter(source_format, format_32bppPBGRA, &src_bpp, &dst_bpp);
+        return copypixels_convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, src_bpp, dst_bpp, convert);
     default:
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
-        if (SUCCEEDED(hr) && prc)
+        /* premultiplying doesn't change opaque pixels */
+        if (SUCCEEDED(hr) && prc && !is_opaque_format(source_format))
         {
-            INT x, y;
+            INT y;
 
+            convert = get_row_converter(format_32bppBGRA, format_32bppPBGRA, &src_bpp, &dst_bpp);
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
+                convert(pbBuffer + cbStride * y, pbBuffer + cbStride * y, prc->Width);
         }
         return hr;
     }
@@ -858,64 +983,17 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
 static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
+    convert_row_func convert;
+    UINT src_bpp, dst_bpp;
+
+    if ((convert = get_row_converter(source_format, format_24bppBGR, &src_bpp, &dst_bpp)))
+        return copypixels_convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, src_bpp, dst_bpp, convert);
 
     switch (source_format)
     {
     case format_24bppBGR:
-    case format_24bppRGB:
         if (prc)
-        {
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (SUCCEEDED(hr) && source_format == format_24bppRGB)
-              reverse_bgr8(3, pbBuffer, prc->Width, prc->Height, cbStride);
-            return hr;
-        }
-        return S_OK;
-    case format_32bppBGR:
-    case format_32bppBGRA:
-    case format_32bppPBGRA:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-
-            srcstride = 4 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
+            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
         return S_OK;
     default:
         FIXME("Unimplemented conversion path!\n");
@@ -926,66 +1004,17 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
 static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
+    convert_row_func convert;
+    UINT src_bpp, dst_bpp;
+
+    if ((convert = get_row_converter(source_format, format_24bppRGB, &src_bpp, &dst_bpp)))
+        return copypixels_convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, src_bpp, dst_bpp, convert);
 
     switch (source_format)
     {
-    case format_24bppBGR:
     case format_24bppRGB:
         if (prc)
-        {
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (SUCCEEDED(hr) && source_format == format_24bppBGR)
-              reverse_bgr8(3, pbBuffer, prc->Width, prc->Height, cbStride);
-            return hr;
-        }
-        return S_OK;
-    case format_32bppBGR:
-    case format_32bppBGRA:
-    case format_32bppPBGRA:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-
-            srcstride = 4 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-
-                reverse_bgr8(3, pbBuffer, prc->Width, prc->Height, cbStride);
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
+            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
         return S_OK;
     default:
         FIXME("Unimplemented conversion path!\n");
@@ -1279,6 +1308,10 @@ HRESULT FormatConverter_CreateInstance(REFIID iid, void** ppv)
 
     *ppv = NULL;
 
+#ifdef USE_SSE2_CONVERTERS
+    use_sse2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#endif
+
     This = HeapAlloc(GetProcessHeap(), 0, sizeof(FormatConverter));
     if (!This) return E_OUTOFMEMORY;
 
@@ -19,6 +19,14 @@
 #include "config.h"
 
 #include <stdarg.h>
+#include <math.h>
+
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define USE_SSE2_FILTERS
+#define SSE2_FUNC __attribute__((__target__("sse2")))
+#include <emmintrin.h>
+#endif
 
 #define COBJMACROS
 
@@ -32,6 +40,14 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+struct scaler_filter
+{
+    UINT *start;        /* first source pixel for each destination pixel */
+    UINT *count;        /* number of source pixels for each destination pixel */
+    float *weights;     /* max_count weights for each destination pixel */
+    UINT max_count;
+};
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -42,6 +58,15 @@ typedef struct BitmapScaler {
     UINT bpp;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    /* filtered modes */
+    UINT channels;
+    struct scaler_filter filter_x, filter_y;
+    float *rows;        /* horizontally filtered source rows, indexed by row % filter_y.max_count */
+    INT *row_index;     /* source row held in each entry of rows, -1 if none */
+    const float **row_ptrs;
+    UINT rows_x, rows_width; /* destination columns held in rows */
+    UINT rows_src_x, rows_src_width; /* source columns needed for them */
+    BYTE *src_line;
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
@@ -50,6 +75,300 @@ static inline BitmapScaler *impl_from_IWICBitmapScaler(IWICBitmapScaler *iface)
     return CONTAINING_RECORD(iface, BitmapScaler, IWICBitmapScaler_iface);
 }
 
+static void free_filter(struct scaler_filter *filter)
+{
+    HeapFree(GetProcessHeap(), 0, filter->start);
+    HeapFree(GetProcessHeap(), 0, filter->count);
+    HeapFree(GetProcessHeap(), 0, filter->weights);
+}
+
+static float linear_kernel(float x)
+{
+    x = fabsf(x);
+    return x < 1.0f ? 1.0f - x : 0.0f;
+}
+
+/* Catmull-Rom spline */
+static float cubic_kernel(float x)
+{
+    x = fabsf(x);
+    if (x < 1.0f) return (1.5f * x - 2.5f) * x * x + 1.0f;
+    if (x < 2.0f) return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+    return 0.0f;
+}
+
+/* Compute the source pixels and weights contributing to each destination pixel along one
+ * axis. Linear and cubic filters are widened when shrinking so that every source pixel
+ * contributes, Fant weights each source pixel by the part of it that the destination
+ * pixel covers. */
+static HRESULT init_filter(struct scaler_filter *filter, UINT src_size, UINT dst_size,
+    WICBitmapInterpolationMode mode)
+{
+    double scale = (double)src_size / dst_size;
+    double filter_scale = max(scale, 1.0);
+    double radius, center, lo, hi;
+    float sum, *weights;
+    INT first, last, i;
+    UINT x, j;
+
+    if (!src_size || !dst_size) return E_INVALIDARG;
+
+    if (mode == WICBitmapInterpolationModeFant)
+        radius = scale / 2.0;
+    else if (mode == WICBitmapInterpolationModeCubic)
+        radius = 2.0 * filter_scale;
+    else
+        radius = filter_scale;
+
+    filter->max_count = (UINT)ceil(radius * 2.0) + 2;
+    filter->start = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(UINT));
+    filter->count = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(UINT));
+    filter->weights = HeapAlloc(GetProcessHeap(), 0, dst_size * filter->max_count * sizeof(float));
+    if (!filter->start || !filter->count || !filter->weights)
+        return E_OUTOFMEMORY;
+
+    for (x = 0; x < dst_size; x++)
+    {
+        weights = filter->weights + x * filter->max_count;
+
+        if (mode == WICBitmapInterpolationModeFant)
+        {
+            lo = x * scale;
+            hi = (x + 1) * scale;
+            first = (INT)floor(lo);
+            last = (INT)ceil(hi) - 1;
+        }
+        else
+        {
+            center = (x + 0.5) * scale - 0.5;
+            first = (INT)ceil(center - radius);
+            last = (INT)floor(center + radius);
+        }
+        first = max(first, 0);
+        last = min(last, (INT)src_size - 1);
+        last = min(last, first + (INT)filter->max_count - 1);
+
+        sum = 0.0f;
+        for (i = first; i <= last; i++)
+        {
+            if (mode == WICBitmapInterpolationModeFant)
+                weights[i - first] = min(hi, i + 1.0) - max(lo, (double)i);
+            else if (mode == WICBitmapInterpolationModeCubic)
+                weights[i - first] = cubic_kernel((i - center) / filter_scale);
+            else
+                weights[i - first] = linear_kernel((i - center) / filter_scale);
+            sum += weights[i - first];
+        }
+
+        if (last < first || sum == 0.0f)
+        {
+            /* can only happen on the edges, use the nearest pixel */
+            first = min((INT)(x * scale), (INT)src_size - 1);
+            last = first;
+            weights[0] = sum = 1.0f;
+        }
+
+        filter->start[x] = first;
+        filter->count[x] = last - first + 1;
+        for (j = 0; j < filter->count[x]; j++) weights[j] /= sum;
+    }
+
+    return S_OK;
+}
+
+static void filter_row(const struct scaler_filter *filter, UINT x, UINT width, UINT channels,
+    const BYTE *src, UINT src_x, float *dst)
+{
+    UINT i, j, c;
+
+    for (i = 0; i < width; i++)
+    {
+        const float *weights = filter->weights + (x + i) * filter->max_count;
+        const BYTE *pixel = src + (filter->start[x + i] - src_x) * channels;
+
+        for (c = 0; c < channels; c++)
+        {
+            float sum = 0.0f;
+            for (j = 0; j < filter->count[x + i]; j++)
+                sum += weights[j] * pixel[j * channels + c];
+            *dst++ = sum;
+        }
+    }
+}
+
+/* combine the values from start to end of the rows */
+static void combine_rows(const float **rows, const float *weights, UINT count, UINT start, UINT end, BYTE *dst)
+{
+    UINT i, j;
+
+    for (i = start; i < end; i++)
+    {
+        float sum = 0.0f;
+        for (j = 0; j < count; j++) sum += weights[j] * rows[j][i];
+        dst[i] = sum <= 0.0f ? 0 : sum >= 255.0f ? 255 : (BYTE)(sum + 0.5f);
+    }
+}
+
+#ifdef USE_SSE2_FILTERS
+
+static BOOL use_sse2;
+
+static SSE2_FUNC void filter_row_32_sse2(const struct scaler_filter *filter, UINT x, UINT width,
+    const BYTE *src, UINT src_x, float *dst)
+{
+    __m128i zero = _mm_setzero_si128();
+    UINT i, j;
+
+    for (i = 0; i < width; i++, dst += 4)
+    {
+        const float *weights = filter->weights + (x + i) * filter->max_count;
+        const BYTE *pixel = src + (filter->start[x + i] - src_x) * 4;
+        __m128 sum = _mm_setzero_ps();
+
+        for (j = 0; j < filter->count[x + i]; j++, pixel += 4)
+        {
+            __m128i value = _mm_cvtsi32_si128(*(const int *)pixel);
+
+            value = _mm_unpacklo_epi16(_mm_unpacklo_epi8(value, zero), zero);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(value), _mm_set1_ps(weights[j])));
+        }
+        _mm_storeu_ps(dst, sum);
+    }
+}
+
+static SSE2_FUNC void combine_rows_sse2(const float **rows, const float *weights, UINT count,
+    UINT size, BYTE *dst)
+{
+    UINT i, j;
+
+    for (i = 0; i + 4 <= size; i += 4)
+    {
+        __m128 sum = _mm_setzero_ps();
+        __m128i value;
+
+        for (j = 0; j < count; j++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[j] + i), _mm_set1_ps(weights[j])));
+
+        value = _mm_cvtps_epi32(sum);
+        value = _mm_packs_epi32(value, value);
+        value = _mm_packus_epi16(value, value);
+        *(int *)(dst + i) = _mm_cvtsi128_si32(value);
+    }
+    combine_rows(rows, weights, count, i, size, dst);
+}
+
+#endif /* USE_SSE2_FILTERS */
+
+/* return the horizontally filtered source row, reading it from the source if needed */
+static HRESULT get_filtered_row(BitmapScaler *This, UINT row, const float **ret)
+{
+    UINT index = row % This->filter_y.max_count;
+    float *dst = This->rows + index * This->rows_width * This->channels;
+    WICRect rc;
+    HRESULT hr;
+
+    if (This->row_index[index] != row)
+    {
+        rc.X = This->rows_src_x;
+        rc.Y = row;
+        rc.Width = This->rows_src_width;
+        rc.Height = 1;
+        hr = IWICBitmapSource_CopyPixels(This->source, &rc, This->rows_src_width * This->channels,
+            This->rows_src_width * This->channels, This->src_line);
+        if (FAILED(hr))
+        {
+            This->row_index[index] = -1;
+            return hr;
+        }
+
+#ifdef USE_SSE2_FILTERS
+        if (use_sse2 && This->channels == 4)
+            filter_row_32_sse2(&This->filter_x, This->rows_x, This->rows_width, This->src_line,
+                This->rows_src_x, dst);
+        else
+#endif
+        filter_row(&This->filter_x, This->rows_x, This->rows_width, This->channels, This->src_line,
+            This->rows_src_x, dst);
+        This->row_index[index] = row;
+    }
+
+    *ret = dst;
+    return S_OK;
+}
+
+/* Produce the destination rows one at a time from the source rows they need. The filtered
+ * source rows are kept between calls, so copying the image one scanline at a time from top
+ * to bottom reads each source row once. */
+static HRESULT Filter_CopyPixels(BitmapScaler *This, const WICRect *dest_rect, UINT stride, BYTE *buffer)
+{
+    const float **rows = This->row_ptrs;
+    UINT x, y, i, end;
+    HRESULT hr;
+
+    if (!dest_rect->Width || !dest_rect->Height) return S_OK;
+
+    if (!This->rows || This->rows_x != dest_rect->X || This->rows_width != dest_rect->Width)
+    {
+        HeapFree(GetProcessHeap(), 0, This->rows);
+        HeapFree(GetProcessHeap(), 0, This->src_line);
+
+        This->rows_x = dest_rect->X;
+        This->rows_width = dest_rect->Width;
+        This->rows_src_x = This->filter_x.start[dest_rect->X];
+        end = This->rows_src_x;
+        for (x = dest_rect->X; x < dest_rect->X + dest_rect->Width; x++)
+            end = max(end, This->filter_x.start[x] + This->filter_x.count[x]);
+        This->rows_src_width = end - This->rows_src_x;
+
+        This->rows = HeapAlloc(GetProcessHeap(), 0, This->filter_y.max_count * dest_rect->Width *
+            This->channels * sizeof(float));
+        This->src_line = HeapAlloc(GetProcessHeap(), 0, This->rows_src_width * This->channels);
+        for (i = 0; i < This->filter_y.max_count; i++) This->row_index[i] = -1;
+
+        if (!This->rows || !This->src_line)
+        {
+            HeapFree(GetProcessHeap(), 0, This->rows);
+            This->rows = NULL;
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    for (y = dest_rect->Y; y < dest_rect->Y + dest_rect->Height; y++, buffer += stride)
+    {
+        UINT first = This->filter_y.start[y], count = This->filter_y.count[y];
+        const float *weights = This->filter_y.weights + y * This->filter_y.max_count;
+
+        for (i = 0; i < count; i++)
+            if (FAILED(hr = get_filtered_row(This, first + i, &rows[i]))) return hr;
+
+#ifdef USE_SSE2_FILTERS
+        if (use_sse2)
+            combine_rows_sse2(rows, weights, count, dest_rect->Width * This->channels, buffer);
+        else
+#endif
+        combine_rows(rows, weights, count, 0, dest_rect->Width * This->channels, buffer);
+    }
+
+    return S_OK;
+}
+
+/* formats that can be filtered one byte channel at a time */
+static UINT get_filter_channels(const WICPixelFormatGUID *format)
+{
+    if (IsEqualGUID(format, &GUID_WICPixelFormat32bppBGRA) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat32bppPBGRA) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat32bppBGR) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat32bppRGBA) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat32bppPRGBA))
+        return 4;
+    if (IsEqualGUID(format, &GUID_WICPixelFormat24bppBGR) ||
+        IsEqualGUID(format, &GUID_WICPixelFormat24bppRGB))
+        return 3;
+    if (IsEqualGUID(format, &GUID_WICPixelFormat8bppGray))
+        return 1;
+    return 0;
+}
+
 static HRESULT WINAPI BitmapScaler_QueryInterface(IWICBitmapScaler *iface, REFIID iid,
     void **ppv)
 {
@@ -96,6 +415,12 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        free_filter(&This->filter_x);
+        free_filter(&This->filter_y);
+        HeapFree(GetProcessHeap(), 0, This->rows);
+        HeapFree(GetProcessHeap(), 0, This->row_index);
+        HeapFree(GetProcessHeap(), 0, This->row_ptrs);
+        HeapFree(GetProcessHeap(), 0, This->src_line);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -244,6 +569,12 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
         goto end;
     }
 
+    if (This->channels)
+    {
+        hr = Filter_CopyPixels(This, &dest_rect, cbStride, pbBuffer);
+        goto end;
+    }
+
     /* MSDN recommends calling CopyPixels once for each scanline from top to
      * bottom, and claims codecs optimize for this. Ideally, when called in this
      * way, we should avoid requesting a scanline from the source more than
@@ -331,10 +662,47 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
         hr = get_pixelformat_bpp(&src_pixelformat, &This->bpp);
     }
 
+    if (SUCCEEDED(hr) && mode != WICBitmapInterpolationModeNearestNeighbor &&
+        !get_filter_channels(&src_pixelformat))
+    {
+        FIXME("mode %i not supported for format %s\n", mode, debugstr_guid(&src_pixelformat));
+        mode = WICBitmapInterpolationModeNearestNeighbor;
+    }
+
     if (SUCCEEDED(hr))
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+            This->channels = get_filter_channels(&src_pixelformat);
+            hr = init_filter(&This->filter_x, This->src_width, This->width, mode);
+            if (SUCCEEDED(hr))
+                hr = init_filter(&This->filter_y, This->src_height, This->height, mode);
+            if (SUCCEEDED(hr) &&
+                (!(This->row_index = HeapAlloc(GetProcessHeap(), 0, This->filter_y.max_count * sizeof(INT))) ||
+                 !(This->row_ptrs = HeapAlloc(GetProcessHeap(), 0, This->filter_y.max_count * sizeof(float *)))))
+                hr = E_OUTOFMEMORY;
+            if (FAILED(hr))
+            {
+                free_filter(&This->filter_x);
+                free_filter(&This->filter_y);
+                memset(&This->filter_x, 0, sizeof(This->filter_x));
+                memset(&This->filter_y, 0, sizeof(This->filter_y));
+                HeapFree(GetProcessHeap(), 0, This->row_index);
+                HeapFree(GetProcessHeap(), 0, This->row_ptrs);
+                This->row_index = NULL;
+                This->row_ptrs = NULL;
+                This->channels = 0;
+                break;
+            }
+#ifdef USE_SSE2_FILTERS
+            use_sse2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#endif
+            IWICBitmapSource_AddRef(pISource);
+            This->source = pISource;
+            break;
         default:
             FIXME("unsupported mode %i\n", mode);
             /* fall-through */
@@ -390,6 +758,15 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    This->channels = 0;
+    memset(&This->filter_x, 0, sizeof(This->filter_x));
+    memset(&This->filter_y, 0, sizeof(This->filter_y));
+    This->rows = NULL;
+    This->row_index = NULL;
+    This->row_ptrs = NULL;
+    This->rows_x = This->rows_width = 0;
+    This->rows_src_x = This->rows_src_width = 0;
+    This->src_line = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -19,6 +19,7 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <math.h>
 
@@ -972,6 +973,102 @@ static void test_clipper(void)
     IWICBitmapClipper_Release(clipper);
 }
 
+static void test_scaler_filters(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant
+    };
+    BYTE src[8 * 8 * 4], full[4 * 4 * 4], line[4 * 4], big[20 * 20 * 4];
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    WICRect rect;
+    HRESULT hr;
+    UINT i, x, y, c, width, height;
+    int sum;
+
+    for (i = 0; i < sizeof(src); i++) src[i] = (i * 37 + i / 32 * 11) & 0xff;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 8, 8, &GUID_WICPixelFormat32bppBGRA,
+        8 * 4, sizeof(src), src, &bitmap);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+    {
+        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+        ok(hr == S_OK, "got 0x%08x\n", hr);
+
+        hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 4, 4, modes[i]);
+        ok(hr == S_OK, "%u: got 0x%08x\n", modes[i], hr);
+
+        width = height = 0;
+        hr = IWICBitmapScaler_GetSize(scaler, &width, &height);
+        ok(hr == S_OK, "got 0x%08x\n", hr);
+        ok(width == 4 && height == 4, "got %ux%u\n", width, height);
+
+        hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 4 * 4, sizeof(full), full);
+        ok(hr == S_OK, "%u: got 0x%08x\n", modes[i], hr);
+
+        /* halving an image averages 2x2 blocks */
+        if (modes[i] == WICBitmapInterpolationModeFant)
+        {
+            for (y = 0; y < 4; y++)
+                for (x = 0; x < 4; x++)
+                    for (c = 0; c < 4; c++)
+                    {
+                        sum = src[(y * 2 * 8 + x * 2) * 4 + c] + src[(y * 2 * 8 + x * 2 + 1) * 4 + c] +
+                              src[((y * 2 + 1) * 8 + x * 2) * 4 + c] + src[((y * 2 + 1) * 8 + x * 2 + 1) * 4 + c];
+                        ok(abs(full[(y * 4 + x) * 4 + c] * 4 - sum) <= 4, "%u,%u,%u: got %u, expected %u\n",
+                           x, y, c, full[(y * 4 + x) * 4 + c], (sum + 2) / 4);
+                    }
+        }
+
+        /* copying one scanline at a time, or part of it, gives the same result */
+        for (y = 0; y < 4; y++)
+        {
+            rect.X = 1;
+            rect.Y = y;
+            rect.Width = 2;
+            rect.Height = 1;
+            hr = IWICBitmapScaler_CopyPixels(scaler, &rect, 2 * 4, sizeof(line), line);
+            ok(hr == S_OK, "%u: got 0x%08x\n", modes[i], hr);
+            ok(!memcmp(line, full + (y * 4 + 1) * 4, 2 * 4), "%u: line %u differs\n", modes[i], y);
+        }
+
+        IWICBitmapScaler_Release(scaler);
+    }
+
+    IWICBitmap_Release(bitmap);
+
+    /* a flat image stays flat when enlarged */
+    for (i = 0; i < sizeof(src); i++) src[i] = 0x80 + (i % 4) * 0x10;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 8, 8, &GUID_WICPixelFormat32bppBGRA,
+        8 * 4, sizeof(src), src, &bitmap);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+    {
+        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+        ok(hr == S_OK, "got 0x%08x\n", hr);
+
+        hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 20, 20, modes[i]);
+        ok(hr == S_OK, "%u: got 0x%08x\n", modes[i], hr);
+
+        hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 20 * 4, sizeof(big), big);
+        ok(hr == S_OK, "%u: got 0x%08x\n", modes[i], hr);
+        for (x = 0; x < sizeof(big); x++)
+            if (abs(big[x] - src[x % 4]) > 1) break;
+        ok(x == sizeof(big), "%u: wrong value at %u\n", modes[i], x);
+
+        IWICBitmapScaler_Release(scaler);
+    }
+
+    IWICBitmap_Release(bitmap);
+}
+
 START_TEST(bitmap)
 {
     HRESULT hr;
@@ -988,6 +1085,7 @@ START_TEST(bitmap)
     test_CreateBitmapFromHICON();
     test_CreateBitmapFromHBITMAP();
     test_clipper();
+    test_scaler_filters();
 
     IWICImagingFactory_Release(factory);
 
@@ -295,6 +295,74 @@ static const BYTE bits_32bppBGRA[] = {
 static const struct bitmap_data testdata_32bppBGRA = {
     &GUID_WICPixelFormat32bppBGRA, 32, bits_32bppBGRA, 4, 2, 96.0, 96.0};
 
+static const BYTE bits_8bppGray[] = {
+    0, 1, 127, 128,
+    200, 254, 255, 42};
+static const struct bitmap_data testdata_8bppGray = {
+    &GUID_WICPixelFormat8bppGray, 8, bits_8bppGray, 4, 2, 96.0, 96.0};
+
+static const BYTE bits_8bppGray_32bppBGRA[] = {
+    0,0,0,255, 1,1,1,255, 127,127,127,255, 128,128,128,255,
+    200,200,200,255, 254,254,254,255, 255,255,255,255, 42,42,42,255};
+static const struct bitmap_data testdata_8bppGray_32bppBGRA = {
+    &GUID_WICPixelFormat32bppBGRA, 32, bits_8bppGray_32bppBGRA, 4, 2, 96.0, 96.0};
+
+static const BYTE bits_8bppGray_wide[] = {
+    0, 13, 26, 39, 52, 65, 78, 91, 104, 117,
+    130, 143, 156, 169, 182, 195, 208, 221, 234, 247,
+    101, 114, 127, 140, 153, 166, 179, 192, 205, 218,
+    231, 244, 1, 14, 27, 40, 53, 66, 79, 255};
+static const struct bitmap_data testdata_8bppGray_wide = {
+    &GUID_WICPixelFormat8bppGray, 8, bits_8bppGray_wide, 20, 2, 96.0, 96.0};
+
+static const BYTE bits_8bppGray_wide_32bppBGRA[] = {
+    0,0,0,255, 13,13,13,255, 26,26,26,255, 39,39,39,255,
+    52,52,52,255, 65,65,65,255, 78,78,78,255, 91,91,91,255,
+    104,104,104,255, 117,117,117,255, 130,130,130,255, 143,143,143,255,
+    156,156,156,255, 169,169,169,255, 182,182,182,255, 195,195,195,255,
+    208,208,208,255, 221,221,221,255, 234,234,234,255, 247,247,247,255,
+    101,101,101,255, 114,114,114,255, 127,127,127,255, 140,140,140,255,
+    153,153,153,255, 166,166,166,255, 179,179,179,255, 192,192,192,255,
+    205,205,205,255, 218,218,218,255, 231,231,231,255, 244,244,244,255,
+    1,1,1,255, 14,14,14,255, 27,27,27,255, 40,40,40,255,
+    53,53,53,255, 66,66,66,255, 79,79,79,255, 255,255,255,255};
+static const struct bitmap_data testdata_8bppGray_wide_32bppBGRA = {
+    &GUID_WICPixelFormat32bppBGRA, 32, bits_8bppGray_wide_32bppBGRA, 20, 2, 96.0, 96.0};
+
+static const BYTE bits_64bppRGBA[] = {
+    255,255,0,0,0,0,255,255, 0,0,255,255,0,0,128,128,
+    0,0,0,0,255,255,0,0, 18,18,52,52,86,86,120,120,
+    200,200,100,100,50,50,255,255, 1,1,2,2,3,3,4,4,
+    255,255,255,255,255,255,255,255, 0,0,0,0,0,0,255,255,
+    17,17,34,34,51,51,68,68, 85,85,102,102,119,119,136,136,
+    153,153,170,170,187,187,204,204, 221,221,238,238,255,255,1,1};
+static const struct bitmap_data testdata_64bppRGBA = {
+    &GUID_WICPixelFormat64bppRGBA, 64, bits_64bppRGBA, 6, 2, 96.0, 96.0};
+
+static const BYTE bits_64bppRGBA_32bppBGRA[] = {
+    0,0,255,255, 0,255,0,128, 255,0,0,0, 86,52,18,120, 50,100,200,255, 3,2,1,4,
+    255,255,255,255, 0,0,0,255, 51,34,17,68, 119,102,85,136, 187,170,153,204, 255,238,221,1};
+static const struct bitmap_data testdata_64bppRGBA_32bppBGRA = {
+    &GUID_WICPixelFormat32bppBGRA, 32, bits_64bppRGBA_32bppBGRA, 6, 2, 96.0, 96.0};
+
+static const BYTE bits_32bppBGRA_alpha[] = {
+    255,0,0,255, 0,255,0,0, 0,0,255,255, 10,20,30,0,
+    0,255,255,0, 255,0,255,255, 255,255,0,0, 255,255,255,255};
+static const struct bitmap_data testdata_32bppBGRA_alpha = {
+    &GUID_WICPixelFormat32bppBGRA, 32, bits_32bppBGRA_alpha, 4, 2, 96.0, 96.0};
+
+static const BYTE bits_32bppPBGRA[] = {
+    255,0,0,255, 0,0,0,0, 0,0,255,255, 0,0,0,0,
+    0,0,0,0, 255,0,255,255, 0,0,0,0, 255,255,255,255};
+static const struct bitmap_data testdata_32bppPBGRA = {
+    &GUID_WICPixelFormat32bppPBGRA, 32, bits_32bppPBGRA, 4, 2, 96.0, 96.0};
+
+static const BYTE bits_24bppBGR_32bppPBGRA[] = {
+    255,0,0,255, 0,255,0,255, 0,0,255,255, 0,0,0,255,
+    0,255,255,255, 255,0,255,255, 255,255,0,255, 255,255,255,255};
+static const struct bitmap_data testdata_24bppBGR_32bppPBGRA = {
+    &GUID_WICPixelFormat32bppPBGRA, 32, bits_24bppBGR_32bppPBGRA, 4, 2, 96.0, 96.0};
+
 static void test_conversion(const struct bitmap_data *src, const struct bitmap_data *dst, const char *name, BOOL todo)
 {
     BitmapTestSrc *src_obj;
@@ -717,6 +785,59 @@ static const struct setting png_interlace_settings[] = {
     {NULL}
 };
 
+static void test_conversion_rects(void)
+{
+    BitmapTestSrc *src_obj;
+    IWICBitmapSource *dst_bitmap;
+    BYTE buffer[64];
+    WICRect rc;
+    HRESULT hr;
+
+    /* shrinking pixels */
+    CreateTestBitmap(&testdata_32bppBGRA, &src_obj);
+    hr = WICConvertBitmapSource(&GUID_WICPixelFormat24bppBGR, &src_obj->IWICBitmapSource_iface, &dst_bitmap);
+    ok(hr == S_OK, "WICConvertBitmapSource failed, hr=%x\n", hr);
+
+    rc.X = rc.Y = 0;
+    rc.Width = 0;
+    rc.Height = 2;
+    hr = IWICBitmapSource_CopyPixels(dst_bitmap, &rc, 12, sizeof(buffer), buffer);
+    ok(hr == S_OK, "CopyPixels failed, hr=%x\n", hr);
+
+    rc.Width = 4;
+    hr = IWICBitmapSource_CopyPixels(dst_bitmap, &rc, 8, sizeof(buffer), buffer);
+    ok(hr == E_INVALIDARG, "got %x\n", hr);
+    hr = IWICBitmapSource_CopyPixels(dst_bitmap, &rc, 12, 23, buffer);
+    ok(hr == E_INVALIDARG, "got %x\n", hr);
+    hr = IWICBitmapSource_CopyPixels(dst_bitmap, &rc, 12, 24, buffer);
+    ok(hr == S_OK, "CopyPixels failed, hr=%x\n", hr);
+
+    IWICBitmapSource_Release(dst_bitmap);
+    DeleteTestBitmap(src_obj);
+
+    /* growing pixels, converted in place in the buffer */
+    CreateTestBitmap(&testdata_24bppBGR, &src_obj);
+    hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppPBGRA, &src_obj->IWICBitmapSource_iface, &dst_bitmap);
+    ok(hr == S_OK, "WICConvertBitmapSource failed, hr=%x\n", hr);
+
+    rc.Width = 0;
+    hr = IWICBitmapSource_CopyPixels(dst_bitmap, &rc, 16, sizeof(buffer), buffer);
+    ok(hr == S_OK, "CopyPixels failed, hr=%x\n", hr);
+
+    rc.Width = 4;
+    hr = IWICBitmapSource_CopyPixels(dst_bitmap, &rc, 12, sizeof(buffer), buffer);
+    ok(hr == E_INVALIDARG, "got %x\n", hr);
+    memset(buffer, 0xcc, sizeof(buffer));
+    hr = IWICBitmapSource_CopyPixels(dst_bitmap, &rc, 16, 31, buffer);
+    ok(hr == E_INVALIDARG, "got %x\n", hr);
+    ok(buffer[31] == 0xcc, "buffer overrun\n");
+    hr = IWICBitmapSource_CopyPixels(dst_bitmap, &rc, 16, 32, buffer);
+    ok(hr == S_OK, "CopyPixels failed, hr=%x\n", hr);
+
+    IWICBitmapSource_Release(dst_bitmap);
+    DeleteTestBitmap(src_obj);
+}
+
 START_TEST(converter)
 {
     CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
@@ -733,9 +854,15 @@ START_TEST(converter)
 
     test_conversion(&testdata_32bppBGR, &testdata_24bppRGB, "32bppBGR -> 24bppRGB", FALSE);
     test_conversion(&testdata_24bppRGB, &testdata_32bppBGR, "24bppRGB -> 32bppBGR", FALSE);
+    test_conversion(&testdata_8bppGray, &testdata_8bppGray_32bppBGRA, "8bppGray -> 32bppBGRA", FALSE);
+    test_conversion(&testdata_8bppGray_wide, &testdata_8bppGray_wide_32bppBGRA, "wide 8bppGray -> 32bppBGRA", FALSE);
+    test_conversion(&testdata_64bppRGBA, &testdata_64bppRGBA_32bppBGRA, "64bppRGBA -> 32bppBGRA", FALSE);
+    test_conversion(&testdata_32bppBGRA_alpha, &testdata_32bppPBGRA, "32bppBGRA -> 32bppPBGRA", FALSE);
+    test_conversion(&testdata_24bppBGR, &testdata_24bppBGR_32bppPBGRA, "24bppBGR -> 32bppPBGRA", FALSE);
 
     test_invalid_conversion();
     test_default_converter();
+    test_conversion_rects();
 
     test_encoder(&testdata_32bppBGR, &CLSID_WICBmpEncoder,
                  &testdata_32bppBGR, &CLSID_WICBmpDecoder, "BMP encoder 32bppBGR");
@@ -311,6 +311,20 @@ BOOL netconn_connected( netconn_t *conn )
     return (conn->socket != -1);
 }
 
+/* an idle keep-alive connection must not have anything to read; data or a
+ * hangup means the server has closed it or is out of sync with us */
+BOOL netconn_is_alive( netconn_t *conn )
+{
+    struct pollfd pfd;
+
+    if (!netconn_connected( conn )) return FALSE;
+    if (conn->secure && (conn->extra_len || conn->peek_len)) return FALSE;
+
+    pfd.fd = conn->socket;
+    pfd.events = POLLIN;
+    return !poll( &pfd, 1, 0 );
+}
+
 BOOL netconn_create( netconn_t *conn, int domain, int type, int protocol )
 {
     if ((conn->socket = socket( domain, type, protocol )) == -1)
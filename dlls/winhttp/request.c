@@ -187,84 +187,49 @@ static task_header_t *dequeue_task( request_t *request )
     TRACE("%u tasks queued\n", list_count( &request->task_queue ));
     task = LIST_ENTRY( list_head( &request->task_queue ), task_header_t, entry );
     if (task) list_remove( &task->entry );
+    else request->task_running = FALSE;
     LeaveCriticalSection( &request->task_cs );
 
     TRACE("returning task %p\n", task);
     return task;
 }
 
-static DWORD CALLBACK task_proc( LPVOID param )
+/* runs the tasks of a request in order; at most one is active per request */
+static void CALLBACK task_proc( TP_CALLBACK_INSTANCE *instance, void *ctx )
 {
-    request_t *request = param;
-    HANDLE handles[2];
+    request_t *request = ctx;
+    task_header_t *task;
 
-    handles[0] = request->task_wait;
-    handles[1] = request->task_cancel;
-    for (;;)
+    while ((task = dequeue_task( request )))
     {
-        DWORD err = WaitForMultipleObjects( 2, handles, FALSE, INFINITE );
-        switch (err)
-        {
-        case WAIT_OBJECT_0:
-        {
-            task_header_t *task;
-            while ((task = dequeue_task( request )))
-            {
-                task->proc( task );
-                release_object( &task->request->hdr );
-                heap_free( task );
-            }
-            break;
-        }
-        case WAIT_OBJECT_0 + 1:
-            TRACE("exiting\n");
-            CloseHandle( request->task_cancel );
-            CloseHandle( request->task_wait );
-            request->task_cs.DebugInfo->Spare[0] = 0;
-            DeleteCriticalSection( &request->task_cs );
-            request->hdr.vtbl->destroy( &request->hdr );
-            return 0;
-
-        default:
-            ERR("wait failed %u (%u)\n", err, GetLastError());
-            break;
-        }
+        task->proc( task );
+        release_object( &task->request->hdr );
+        heap_free( task );
     }
-    return 0;
+    release_object( &request->hdr );
 }
 
 static BOOL queue_task( task_header_t *task )
 {
     request_t *request = task->request;
+    BOOL ret = TRUE;
 
-    if (!request->task_thread)
+    EnterCriticalSection( &request->task_cs );
+    TRACE("queueing task %p\n", task );
+    list_add_tail( &request->task_queue, &task->entry );
+    if (!request->task_running)
     {
-        if (!(request->task_wait = CreateEventW( NULL, FALSE, FALSE, NULL ))) return FALSE;
-        if (!(request->task_cancel = CreateEventW( NULL, FALSE, FALSE, NULL )))
-        {
-            CloseHandle( request->task_wait );
-            request->task_wait = NULL;
-            return FALSE;
-        }
-        if (!(request->task_thread = CreateThread( NULL, 0, task_proc, request, 0, NULL )))
+        /* the pool callback keeps the request alive until the queue drains */
+        addref_object( &request->hdr );
+        if ((ret = TrySubmitThreadpoolCallback( task_proc, request, NULL ))) request->task_running = TRUE;
+        else
         {
-            CloseHandle( request->task_wait );
-            request->task_wait = NULL;
-            CloseHandle( request->task_cancel );
-            request->task_cancel = NULL;
-            return FALSE;
+            list_remove( &task->entry );
+            release_object( &request->hdr );
         }
-        InitializeCriticalSection( &request->task_cs );
-        request->task_cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": request.task_cs");
     }
-
-    EnterCriticalSection( &request->task_cs );
-    TRACE("queueing task %p\n", task );
-    list_add_tail( &request->task_queue, &task->entry );
     LeaveCriticalSection( &request->task_cs );
-
-    SetEvent( request->task_wait );
-    return TRUE;
+    return ret;
 }
 
 static void free_header( header_t *header )
@@ -995,6 +960,111 @@ static WCHAR *addr_to_str( struct sockaddr *addr )
     return strdupAW( buf );
 }
 
+#define KEEP_ALIVE_TIMEOUT 60000 /* idle time after which a pooled connection is closed */
+
+struct pooled_connection
+{
+    struct list entry;
+    WCHAR *hostname;    /* final destination, differs from servername when tunneling through a proxy */
+    WCHAR *servername;
+    INTERNET_PORT serverport;
+    ULONGLONG keep_until;
+    netconn_t netconn;
+};
+
+static INTERNET_PORT get_server_port( request_t *request )
+{
+    connect_t *connect = request->connect;
+
+    if (connect->serverport) return connect->serverport;
+    return (request->hdr.flags & WINHTTP_FLAG_SECURE) ? 443 : 80;
+}
+
+static BOOL match_pooled_connection( struct pooled_connection *conn, request_t *request, INTERNET_PORT port )
+{
+    connect_t *connect = request->connect;
+    BOOL secure = (request->hdr.flags & WINHTTP_FLAG_SECURE) != 0;
+
+    if (conn->serverport != port || conn->netconn.secure != secure) return FALSE;
+    /* a connection verified with relaxed certificate checks must not be handed to a stricter request */
+    if (secure && conn->netconn.security_flags != request->netconn.security_flags) return FALSE;
+    return !strcmpiW( conn->servername, connect->servername ) && !strcmpiW( conn->hostname, connect->hostname );
+}
+
+static void free_pooled_connection( struct pooled_connection *conn )
+{
+    list_remove( &conn->entry );
+    netconn_close( &conn->netconn );
+    heap_free( conn->hostname );
+    heap_free( conn->servername );
+    heap_free( conn );
+}
+
+/* caller must hold the session lock */
+static void expire_pooled_connections( session_t *session )
+{
+    struct pooled_connection *conn, *next;
+    ULONGLONG now = GetTickCount64();
+
+    LIST_FOR_EACH_ENTRY_SAFE( conn, next, &session->connection_pool, struct pooled_connection, entry )
+    {
+        if (conn->keep_until > now) continue;
+        TRACE("closing idle connection to %s:%u\n", debugstr_w(conn->servername), conn->serverport);
+        free_pooled_connection( conn );
+    }
+}
+
+void free_connection_pool( session_t *session )
+{
+    struct pooled_connection *conn, *next;
+
+    EnterCriticalSection( &session->cs );
+    LIST_FOR_EACH_ENTRY_SAFE( conn, next, &session->connection_pool, struct pooled_connection, entry )
+    {
+        free_pooled_connection( conn );
+    }
+    LeaveCriticalSection( &session->cs );
+}
+
+/* take over an idle connection to the server from the session pool */
+static BOOL get_pooled_connection( request_t *request, INTERNET_PORT port )
+{
+    session_t *session = request->connect->session;
+    struct pooled_connection *conn, *next;
+    DWORD security_flags = request->netconn.security_flags;
+    BOOL ret = FALSE;
+
+    EnterCriticalSection( &session->cs );
+    expire_pooled_connections( session );
+    LIST_FOR_EACH_ENTRY_SAFE( conn, next, &session->connection_pool, struct pooled_connection, entry )
+    {
+        if (!match_pooled_connection( conn, request, port )) continue;
+        if (!netconn_is_alive( &conn->netconn ))
+        {
+            TRACE("connection to %s:%u closed while idle\n", debugstr_w(conn->servername), port);
+            free_pooled_connection( conn );
+            continue;
+        }
+        list_remove( &conn->entry );
+        request->netconn = conn->netconn;
+        request->netconn.security_flags = security_flags;
+        heap_free( conn->hostname );
+        heap_free( conn->servername );
+        heap_free( conn );
+        ret = TRUE;
+        break;
+    }
+    LeaveCriticalSection( &session->cs );
+
+    if (ret)
+    {
+        TRACE("reusing connection to %s:%u\n", debugstr_w(request->connect->servername), port);
+        netconn_set_timeout( &request->netconn, TRUE, request->send_timeout );
+        netconn_set_timeout( &request->netconn, FALSE, request->recv_timeout );
+    }
+    return ret;
+}
+
 static BOOL open_connection( request_t *request )
 {
     connect_t *connect;
@@ -1003,11 +1073,14 @@ static BOOL open_connection( request_t *request )
     socklen_t slen;
     struct sockaddr *saddr;
     DWORD len;
+    BOOL reused = TRUE;
 
     if (netconn_connected( &request->netconn )) goto done;
 
     connect = request->connect;
-    port = connect->serverport ? connect->serverport : (request->hdr.flags & WINHTTP_FLAG_SECURE ? 443 : 80);
+    port = get_server_port( request );
+    if (get_pooled_connection( request, port )) goto done;
+    reused = FALSE;
     saddr = (struct sockaddr *)&connect->sockaddr;
     slen = sizeof(struct sockaddr);
 
@@ -1067,6 +1140,8 @@ done:
     request->read_chunked = FALSE;
     request->read_chunked_size = ~0u;
     request->read_chunked_eof = FALSE;
+    request->response_received = FALSE;
+    request->retry_on_close = reused;
     heap_free( addressW );
     return TRUE;
 }
@@ -1193,6 +1268,8 @@ static BOOL send_request( request_t *request, LPCWSTR headers, DWORD headers_len
         request->optional_len = optional_len;
         len += optional_len;
     }
+    /* data sent later with WinHttpWriteData can't be replayed on a new connection */
+    if (total_len > optional_len) request->retry_on_close = FALSE;
     send_callback( &request->hdr, WINHTTP_CALLBACK_STATUS_REQUEST_SENT, &len, sizeof(len) );
 
 end:
@@ -1932,6 +2009,9 @@ static BOOL read_more_data( request_t *request, int maxlen, BOOL notify )
 
     if (notify) send_callback( &request->hdr, WINHTTP_CALLBACK_STATUS_RESPONSE_RECEIVED, &len, sizeof(len) );
 
+    /* the server may have processed the request unless it closed the connection before replying */
+    if (len || (!ret && get_last_error() != WSAECONNRESET)) request->retry_on_close = FALSE;
+
     request->read_size += len;
     return ret;
 }
@@ -2184,22 +2264,90 @@ static BOOL read_reply( request_t *request )
     return TRUE;
 }
 
-static void finished_reading( request_t *request )
+static BOOL connection_keep_alive( request_t *request )
 {
     static const WCHAR closeW[] = {'c','l','o','s','e',0};
 
-    BOOL close = FALSE;
     WCHAR connection[20];
     DWORD size = sizeof(connection);
 
-    if (request->hdr.disable_flags & WINHTTP_DISABLE_KEEP_ALIVE) close = TRUE;
-    else if (query_headers( request, WINHTTP_QUERY_CONNECTION, NULL, connection, &size, NULL ) ||
-             query_headers( request, WINHTTP_QUERY_PROXY_CONNECTION, NULL, connection, &size, NULL ))
+    if (request->hdr.disable_flags & WINHTTP_DISABLE_KEEP_ALIVE) return FALSE;
+    if (query_headers( request, WINHTTP_QUERY_CONNECTION, NULL, connection, &size, NULL ) ||
+        query_headers( request, WINHTTP_QUERY_PROXY_CONNECTION, NULL, connection, &size, NULL ))
+    {
+        return strcmpiW( connection, closeW ) != 0;
+    }
+    return strcmpW( request->version, http1_0 ) != 0;
+}
+
+static void finished_reading( request_t *request )
+{
+    if (!connection_keep_alive( request )) close_connection( request );
+}
+
+/* hand an idle keep-alive connection over to the session pool */
+static BOOL cache_connection( request_t *request )
+{
+    connect_t *connect = request->connect;
+    session_t *session = connect->session;
+    struct pooled_connection *conn, *cursor;
+    INTERNET_PORT port = get_server_port( request );
+    DWORD count = 0;
+
+    if (!request->response_received || !end_of_read_data( request )) return FALSE;
+
+    /* skip the empty line terminating the trailers of a chunked response */
+    if (request->read_chunked && request->read_size == 2 &&
+        !memcmp( request->read_buf + request->read_pos, "\r\n", 2 )) remove_data( request, 2 );
+
+    if (request->read_size || !connection_keep_alive( request ) || !netconn_is_alive( &request->netconn ))
+        return FALSE;
+
+    if (!(conn = heap_alloc( sizeof(*conn) ))) return FALSE;
+    conn->hostname = strdupW( connect->hostname );
+    conn->servername = strdupW( connect->servername );
+    if (!conn->hostname || !conn->servername)
     {
-        if (!strcmpiW( connection, closeW )) close = TRUE;
+        heap_free( conn->hostname );
+        heap_free( conn->servername );
+        heap_free( conn );
+        return FALSE;
     }
-    else if (!strcmpW( request->version, http1_0 )) close = TRUE;
-    if (close) close_connection( request );
+    conn->serverport = port;
+    conn->keep_until = GetTickCount64() + KEEP_ALIVE_TIMEOUT;
+    conn->netconn = request->netconn;
+
+    EnterCriticalSection( &session->cs );
+    expire_pooled_connections( session );
+    LIST_FOR_EACH_ENTRY( cursor, &session->connection_pool, struct pooled_connection, entry )
+    {
+        if (match_pooled_connection( cursor, request, port )) count++;
+    }
+    if (count < session->max_conns_per_server)
+    {
+        /* most recently used connections go first, they are the least likely to have timed out */
+        list_add_head( &session->connection_pool, &conn->entry );
+        netconn_init( &request->netconn );
+        request->netconn.security_flags = conn->netconn.security_flags;
+    }
+    LeaveCriticalSection( &session->cs );
+
+    if (netconn_connected( &request->netconn ))
+    {
+        TRACE("too many idle connections to %s:%u\n", debugstr_w(connect->servername), port);
+        heap_free( conn->hostname );
+        heap_free( conn->servername );
+        heap_free( conn );
+        return FALSE;
+    }
+    TRACE("keeping connection to %s:%u alive\n", debugstr_w(connect->servername), port);
+    return TRUE;
+}
+
+void release_connection( request_t *request )
+{
+    if (!netconn_connected( &request->netconn )) return;
+    if (!cache_connection( request )) close_connection( request );
 }
 
 static BOOL read_data( request_t *request, void *buffer, DWORD size, DWORD *read, BOOL async )
@@ -2389,16 +2537,27 @@ end:
 
 static BOOL receive_response( request_t *request, BOOL async )
 {
-    BOOL ret;
+    BOOL ret, retried = FALSE;
     DWORD size, query, status;
 
     for (;;)
     {
         if (!(ret = read_reply( request )))
         {
+            if (request->retry_on_close && !retried)
+            {
+                TRACE("reused connection was closed by the server, retrying\n");
+                close_connection( request );
+                retried = TRUE;
+                ret = send_request( request, NULL, 0, request->optional, request->optional_len, 0, 0, FALSE );
+                request->retry_on_close = FALSE;
+                if (ret) continue;
+                break;
+            }
             set_last_error( ERROR_WINHTTP_INVALID_SERVER_RESPONSE );
             break;
         }
+        request->response_received = TRUE;
         size = sizeof(DWORD);
         query = WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER;
         if (!(ret = query_headers( request, query, NULL, &status, &size, NULL ))) break;
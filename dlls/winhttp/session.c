@@ -98,6 +98,7 @@ static void session_destroy( object_header_t *hdr )
 
     TRACE("%p\n", session);
 
+    free_connection_pool( session );
     if (session->unload_event) SetEvent( session->unload_event );
 
     LIST_FOR_EACH_SAFE( item, next, &session->cookie_cache )
@@ -110,6 +111,8 @@ static void session_destroy( object_header_t *hdr )
     heap_free( session->proxy_bypass );
     heap_free( session->proxy_username );
     heap_free( session->proxy_password );
+    session->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &session->cs );
     heap_free( session );
 }
 
@@ -148,6 +151,16 @@ static BOOL session_query_option( object_header_t *hdr, DWORD option, LPVOID buf
         *(DWORD *)buffer = session->recv_timeout;
         *buflen = sizeof(DWORD);
         return TRUE;
+    case WINHTTP_OPTION_MAX_CONNS_PER_SERVER:
+        if (!buffer || *buflen < sizeof(DWORD))
+        {
+            *buflen = sizeof(DWORD);
+            set_last_error( ERROR_INSUFFICIENT_BUFFER );
+            return FALSE;
+        }
+        *(DWORD *)buffer = session->max_conns_per_server;
+        *buflen = sizeof(DWORD);
+        return TRUE;
     default:
         FIXME("unimplemented option %u\n", option);
         set_last_error( ERROR_INVALID_PARAMETER );
@@ -198,6 +211,24 @@ static BOOL session_set_option( object_header_t *hdr, DWORD option, LPVOID buffe
     case WINHTTP_OPTION_RECEIVE_TIMEOUT:
         session->recv_timeout = *(DWORD *)buffer;
         return TRUE;
+    case WINHTTP_OPTION_MAX_CONNS_PER_SERVER:
+    {
+        DWORD max;
+
+        if (buflen != sizeof(max))
+        {
+            set_last_error( ERROR_INSUFFICIENT_BUFFER );
+            return FALSE;
+        }
+        if (!(max = *(DWORD *)buffer))
+        {
+            set_last_error( ERROR_INVALID_PARAMETER );
+            return FALSE;
+        }
+        TRACE("WINHTTP_OPTION_MAX_CONNS_PER_SERVER: %u\n", max);
+        session->max_conns_per_server = max;
+        return TRUE;
+    }
     case WINHTTP_OPTION_CONFIGURE_PASSPORT_AUTH:
         FIXME("WINHTTP_OPTION_CONFIGURE_PASSPORT_AUTH: 0x%x\n", *(DWORD *)buffer);
         return TRUE;
@@ -242,6 +273,10 @@ HINTERNET WINAPI WinHttpOpen( LPCWSTR agent, DWORD access, LPCWSTR proxy, LPCWST
     session->send_timeout = DEFAULT_SEND_TIMEOUT;
     session->recv_timeout = DEFAULT_RECEIVE_TIMEOUT;
     list_init( &session->cookie_cache );
+    list_init( &session->connection_pool );
+    session->max_conns_per_server = INFINITE;
+    InitializeCriticalSection( &session->cs );
+    session->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": session.cs");
 
     if (agent && !(session->agent = strdupW( agent ))) goto end;
     if (access == WINHTTP_ACCESS_TYPE_DEFAULT_PROXY)
@@ -567,16 +602,6 @@ static void request_destroy( object_header_t *hdr )
 
     TRACE("%p\n", request);
 
-    if (request->task_thread)
-    {
-        /* Signal to the task proc to quit.  It will call
-           this again when it does. */
-        HANDLE thread = request->task_thread;
-        request->task_thread = 0;
-        SetEvent( request->task_cancel );
-        CloseHandle( thread );
-        return;
-    }
     release_object( &request->connect->hdr );
 
     destroy_authinfo( request->authinfo );
@@ -603,6 +628,8 @@ static void request_destroy( object_header_t *hdr )
             heap_free( request->creds[i][j].password );
         }
     }
+    request->task_cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &request->task_cs );
     heap_free( request );
 }
 
@@ -1087,6 +1114,8 @@ HINTERNET WINAPI WinHttpOpenRequest( HINTERNET hconnect, LPCWSTR verb, LPCWSTR o
     request->hdr.redirect_policy = connect->hdr.redirect_policy;
     list_init( &request->hdr.children );
     list_init( &request->task_queue );
+    InitializeCriticalSection( &request->task_cs );
+    request->task_cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": request.task_cs");
 
     addref_object( &connect->hdr );
     request->connect = connect;
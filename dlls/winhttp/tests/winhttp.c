@@ -2025,6 +2025,12 @@ static const char headmsg[] =
 "Content-Length: 100\r\n"
 "\r\n";
 
+static const char keepalivemsg[] =
+"HTTP/1.1 200 OK\r\n"
+"Connection: Keep-Alive\r\n"
+"Content-Length: 1\r\n"
+"\r\n";
+
 static const char unauthorized[] = "Unauthorized";
 static const char hello_world[] = "Hello World";
 
@@ -2044,7 +2050,7 @@ static DWORD CALLBACK server_thread(LPVOID param)
     struct sockaddr_in sa;
     char buffer[0x100];
     WSADATA wsaData;
-    int last_request = 0;
+    int last_request = 0, keepalive_count = 0;
 
     WSAStartup(MAKEWORD(1,1), &wsaData);
 
@@ -2068,7 +2074,11 @@ static DWORD CALLBACK server_thread(LPVOID param)
     SetEvent(si->event);
     do
     {
-        if (c == -1) c = accept(s, NULL, NULL);
+        if (c == -1)
+        {
+            c = accept(s, NULL, NULL);
+            keepalive_count = 0;
+        }
 
         memset(buffer, 0, sizeof buffer);
         for(i = 0; i < sizeof buffer - 1; i++)
@@ -2148,6 +2158,14 @@ static DWORD CALLBACK server_thread(LPVOID param)
             if (!strstr(buffer, "Cookie: name=value\r\n")) send(c, cookiemsg, sizeof(cookiemsg) - 1, 0);
             else send(c, notokmsg, sizeof(notokmsg) - 1, 0);
         }
+        if (strstr(buffer, "GET /keepalive"))
+        {
+            /* number of requests served on this connection */
+            char count = '0' + ++keepalive_count % 10;
+            send(c, keepalivemsg, sizeof keepalivemsg - 1, 0);
+            send(c, &count, 1, 0);
+            continue;
+        }
         if (strstr(buffer, "GET /quit"))
         {
             send(c, okmsg, sizeof okmsg - 1, 0);
@@ -2791,6 +2809,92 @@ static void test_multiple_reads(int port)
     WinHttpCloseHandle(ses);
 }
 
+static void test_keep_alive(int port)
+{
+    static const WCHAR keepaliveW[] = {'/','k','e','e','p','a','l','i','v','e',0};
+    HINTERNET ses, con, req;
+    DWORD max, size, count;
+    char buffer[4];
+    BOOL ret;
+    int i;
+
+    ses = WinHttpOpen(test_useragent, WINHTTP_ACCESS_TYPE_NO_PROXY, NULL, NULL, 0);
+    ok(ses != NULL, "failed to open session %u\n", GetLastError());
+
+    max = 0;
+    SetLastError(0xdeadbeef);
+    ret = WinHttpSetOption(ses, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &max, sizeof(max));
+    ok(!ret, "expected failure\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "got %u\n", GetLastError());
+
+    max = 2;
+    ret = WinHttpSetOption(ses, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &max, sizeof(max));
+    ok(ret, "failed to set option %u\n", GetLastError());
+
+    max = 0;
+    size = sizeof(max);
+    ret = WinHttpQueryOption(ses, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &max, &size);
+    ok(ret, "failed to query option %u\n", GetLastError());
+    ok(max == 2, "got %u\n", max);
+    ok(size == sizeof(max), "got %u\n", size);
+
+    con = WinHttpConnect(ses, localhostW, port, 0);
+    ok(con != NULL, "failed to open a connection %u\n", GetLastError());
+
+    /* requests made with separate handles share the connection once the response has been read */
+    for (i = 0; i < 3; i++)
+    {
+        req = WinHttpOpenRequest(con, NULL, keepaliveW, NULL, NULL, NULL, 0);
+        ok(req != NULL, "failed to open a request %u\n", GetLastError());
+
+        ret = WinHttpSendRequest(req, NULL, 0, NULL, 0, 0, 0);
+        ok(ret, "failed to send request %u\n", GetLastError());
+
+        ret = WinHttpReceiveResponse(req, NULL);
+        ok(ret, "failed to receive response %u\n", GetLastError());
+
+        count = 0;
+        memset(buffer, 0, sizeof(buffer));
+        ret = WinHttpReadData(req, buffer, sizeof(buffer), &count);
+        ok(ret, "failed to read data %u\n", GetLastError());
+        ok(count == 1, "got %u\n", count);
+        ok(buffer[0] == '1' + i, "%d: got %s\n", i, buffer);
+
+        WinHttpCloseHandle(req);
+    }
+
+    /* a connection with unread data can't be reused */
+    req = WinHttpOpenRequest(con, NULL, keepaliveW, NULL, NULL, NULL, 0);
+    ok(req != NULL, "failed to open a request %u\n", GetLastError());
+
+    ret = WinHttpSendRequest(req, NULL, 0, NULL, 0, 0, 0);
+    ok(ret, "failed to send request %u\n", GetLastError());
+
+    ret = WinHttpReceiveResponse(req, NULL);
+    ok(ret, "failed to receive response %u\n", GetLastError());
+    WinHttpCloseHandle(req);
+
+    req = WinHttpOpenRequest(con, NULL, keepaliveW, NULL, NULL, NULL, 0);
+    ok(req != NULL, "failed to open a request %u\n", GetLastError());
+
+    ret = WinHttpSendRequest(req, NULL, 0, NULL, 0, 0, 0);
+    ok(ret, "failed to send request %u\n", GetLastError());
+
+    ret = WinHttpReceiveResponse(req, NULL);
+    ok(ret, "failed to receive response %u\n", GetLastError());
+
+    count = 0;
+    memset(buffer, 0, sizeof(buffer));
+    ret = WinHttpReadData(req, buffer, sizeof(buffer), &count);
+    ok(ret, "failed to read data %u\n", GetLastError());
+    ok(count == 1, "got %u\n", count);
+    ok(buffer[0] == '1', "got %s\n", buffer);
+
+    WinHttpCloseHandle(req);
+    WinHttpCloseHandle(con);
+    WinHttpCloseHandle(ses);
+}
+
 static void test_cookies( int port )
 {
     static const WCHAR cookieW[] = {'/','c','o','o','k','i','e',0};
@@ -4226,6 +4330,7 @@ START_TEST (winhttp)
     test_basic_authentication(si.port);
     test_bad_header(si.port);
     test_multiple_reads(si.port);
+    test_keep_alive(si.port);
     test_cookies(si.port);
 
     /* send the basic request again to shutdown the server thread */
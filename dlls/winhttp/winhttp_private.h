@@ -111,6 +111,9 @@ typedef struct
     LPWSTR proxy_password;
     struct list cookie_cache;
     HANDLE unload_event;
+    CRITICAL_SECTION cs;
+    struct list connection_pool; /* idle keep-alive connections */
+    DWORD max_conns_per_server;
 } session_t;
 
 typedef struct
@@ -202,6 +205,8 @@ typedef struct
     BOOL  read_chunked;   /* are we reading in chunked mode? */
     BOOL  read_chunked_eof;  /* end of stream in chunked mode */
     BOOL  read_chunked_size; /* chunk size remaining */
+    BOOL  response_received; /* headers of the current response have been read */
+    BOOL  retry_on_close;    /* resend the request if a reused connection turns out to be closed */
     DWORD read_pos;       /* current read position in read_buf */
     DWORD read_size;      /* valid data size in read_buf */
     char  read_buf[8192]; /* buffer for already read but not returned data */
@@ -211,9 +216,7 @@ typedef struct
     DWORD num_accept_types;
     struct authinfo *authinfo;
     struct authinfo *proxy_authinfo;
-    HANDLE task_wait;
-    HANDLE task_cancel;
-    HANDLE task_thread;
+    BOOL task_running; /* a thread pool callback is processing the task queue */
     struct list task_queue;
     CRITICAL_SECTION task_cs;
     struct
@@ -280,12 +283,15 @@ void set_last_error( DWORD ) DECLSPEC_HIDDEN;
 DWORD get_last_error( void ) DECLSPEC_HIDDEN;
 void send_callback( object_header_t *, DWORD, LPVOID, DWORD ) DECLSPEC_HIDDEN;
 void close_connection( request_t * ) DECLSPEC_HIDDEN;
+void release_connection( request_t * ) DECLSPEC_HIDDEN;
+void free_connection_pool( session_t * ) DECLSPEC_HIDDEN;
 
 BOOL netconn_close( netconn_t * ) DECLSPEC_HIDDEN;
 BOOL netconn_connect( netconn_t *, const struct sockaddr *, unsigned int, int ) DECLSPEC_HIDDEN;
 BOOL netconn_connected( netconn_t * ) DECLSPEC_HIDDEN;
 BOOL netconn_create( netconn_t *, int, int, int ) DECLSPEC_HIDDEN;
 BOOL netconn_init( netconn_t * ) DECLSPEC_HIDDEN;
+BOOL netconn_is_alive( netconn_t * ) DECLSPEC_HIDDEN;
 void netconn_unload( void ) DECLSPEC_HIDDEN;
 ULONG netconn_query_data_available( netconn_t * ) DECLSPEC_HIDDEN;
 BOOL netconn_recv( netconn_t *, void *, size_t, int, int * ) DECLSPEC_HIDDEN;
@@ -73,11 +73,12 @@ typedef struct
     SecPkgContext_StreamSizes ssl_sizes;
     server_t *server;
     char *ssl_buf;
-    char *extra_buf;
+    char *ssl_send_buf; /* records are encrypted there so that ssl_buf content is kept */
+    char *extra_buf; /* undecrypted data, points into ssl_buf */
     size_t extra_len;
-    char *peek_msg;
-    char *peek_msg_mem;
+    char *peek_msg; /* decrypted data not yet returned, points into ssl_buf */
     size_t peek_len;
+    SECURITY_STATUS ssl_status; /* status of a record decrypted ahead, handled once peek_msg has been read */
     DWORD security_flags;
     BOOL mask_errors;
 
@@ -383,13 +383,13 @@ void free_netconn(netconn_t *netconn)
     server_release(netconn->server);
 
     if (netconn->secure) {
-        heap_free(netconn->peek_msg_mem);
-        netconn->peek_msg_mem = NULL;
         netconn->peek_msg = NULL;
         netconn->peek_len = 0;
         heap_free(netconn->ssl_buf);
         netconn->ssl_buf = NULL;
-        heap_free(netconn->extra_buf);
+        heap_free(netconn->ssl_send_buf);
+        netconn->ssl_send_buf = NULL;
+        netconn->ssl_status = SEC_E_OK;
         netconn->extra_buf = NULL;
         netconn->extra_len = 0;
         if (SecIsValidHandle(&netconn->ssl_ctx))
@@ -559,7 +559,9 @@ static DWORD netcon_secure_connect_setup(netconn_t *connection, BOOL compat_mode
 
             connection->ssl_buf = heap_alloc(connection->ssl_sizes.cbHeader + connection->ssl_sizes.cbMaximumMessage
                     + connection->ssl_sizes.cbTrailer);
-            if(!connection->ssl_buf) {
+            connection->ssl_send_buf = heap_alloc(connection->ssl_sizes.cbHeader + connection->ssl_sizes.cbMaximumMessage
+                    + connection->ssl_sizes.cbTrailer);
+            if(!connection->ssl_buf || !connection->ssl_send_buf) {
                 res = GetLastError();
                 break;
             }
@@ -572,6 +574,8 @@ static DWORD netcon_secure_connect_setup(netconn_t *connection, BOOL compat_mode
         WARN("Failed to establish SSL connection: %08x (%u)\n", status, res);
         heap_free(connection->ssl_buf);
         connection->ssl_buf = NULL;
+        heap_free(connection->ssl_send_buf);
+        connection->ssl_send_buf = NULL;
         return res ? res : ERROR_INTERNET_SECURITY_CHANNEL_ERROR;
     }
 
@@ -633,9 +637,9 @@ DWORD NETCON_secure_connect(netconn_t *connection, server_t *server)
 static BOOL send_ssl_chunk(netconn_t *conn, const void *msg, size_t size)
 {
     SecBuffer bufs[4] = {
-        {conn->ssl_sizes.cbHeader, SECBUFFER_STREAM_HEADER, conn->ssl_buf},
-        {size,  SECBUFFER_DATA, conn->ssl_buf+conn->ssl_sizes.cbHeader},
-        {conn->ssl_sizes.cbTrailer, SECBUFFER_STREAM_TRAILER, conn->ssl_buf+conn->ssl_sizes.cbHeader+size},
+        {conn->ssl_sizes.cbHeader, SECBUFFER_STREAM_HEADER, conn->ssl_send_buf},
+        {size,  SECBUFFER_DATA, conn->ssl_send_buf+conn->ssl_sizes.cbHeader},
+        {conn->ssl_sizes.cbTrailer, SECBUFFER_STREAM_TRAILER, conn->ssl_send_buf+conn->ssl_sizes.cbHeader+size},
         {0, SECBUFFER_EMPTY, NULL}
     };
     SecBufferDesc buf_desc = {SECBUFFER_VERSION, sizeof(bufs)/sizeof(*bufs), bufs};
@@ -648,7 +652,7 @@ static BOOL send_ssl_chunk(netconn_t *conn, const void *msg, size_t size)
         return FALSE;
     }
 
-    if(sock_send(conn->socket, conn->ssl_buf, bufs[0].cbBuffer+bufs[1].cbBuffer+bufs[2].cbBuffer, 0) < 1) {
+    if(sock_send(conn->socket, conn->ssl_send_buf, bufs[0].cbBuffer+bufs[1].cbBuffer+bufs[2].cbBuffer, 0) < 1) {
         WARN("send failed\n");
         return FALSE;
     }
@@ -693,22 +697,71 @@ DWORD NETCON_send(netconn_t *connection, const void *msg, size_t len, int flags,
     }
 }
 
+/* returns TRUE if buf starts with a complete TLS application data record */
+static BOOL is_complete_ssl_data_record(const BYTE *buf, SIZE_T len)
+{
+    return len >= 5 && buf[0] == 23 /* application_data */ && len >= 5 + ((buf[3] << 8) | buf[4]);
+}
+
+static void set_ssl_extra(netconn_t *conn, const SecBuffer *bufs, unsigned int count)
+{
+    unsigned int i;
+
+    conn->extra_buf = NULL;
+    conn->extra_len = 0;
+    for(i=0; i < count; i++) {
+        if(bufs[i].BufferType == SECBUFFER_EXTRA) {
+            conn->extra_buf = bufs[i].pvBuffer;
+            conn->extra_len = bufs[i].cbBuffer;
+        }
+    }
+}
+
+/* handles the DecryptMessage statuses that end the read of a record */
+static DWORD ssl_decrypt_status(SECURITY_STATUS res, BOOL *eof)
+{
+    switch(res) {
+    case SEC_I_CONTEXT_EXPIRED:
+        TRACE("context expired\n");
+        *eof = TRUE;
+        return ERROR_SUCCESS;
+    case SEC_I_RENEGOTIATE:
+        FIXME("renegotiation not supported\n");
+        return ERROR_INTERNET_CONNECTION_ABORTED;
+    default:
+        WARN("failed: %08x\n", res);
+        return ERROR_INTERNET_CONNECTION_ABORTED;
+    }
+}
+
+/* Decrypts in place in ssl_buf. Undecrypted data and decrypted data that did
+ * not fit into buf are left there until the next call, which is only made
+ * once the latter has been read. Records are encrypted in ssl_send_buf, so
+ * sending doesn't overwrite them. */
 static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, BOOL blocking, SIZE_T *ret_size, BOOL *eof)
 {
     const SIZE_T ssl_buf_size = conn->ssl_sizes.cbHeader+conn->ssl_sizes.cbMaximumMessage+conn->ssl_sizes.cbTrailer;
     SecBuffer bufs[4];
     SecBufferDesc buf_desc = {SECBUFFER_VERSION, sizeof(bufs)/sizeof(*bufs), bufs};
     SSIZE_T size, buf_len = 0;
+    SIZE_T copied = 0;
     int i;
     SECURITY_STATUS res;
 
     assert(conn->extra_len < ssl_buf_size);
+    assert(!conn->peek_len);
+
+    if(conn->ssl_status != SEC_E_OK) {
+        res = conn->ssl_status;
+        conn->ssl_status = SEC_E_OK;
+        *ret_size = 0;
+        return ssl_decrypt_status(res, eof);
+    }
 
     if(conn->extra_len) {
-        memcpy(conn->ssl_buf, conn->extra_buf, conn->extra_len);
+        memmove(conn->ssl_buf, conn->extra_buf, conn->extra_len);
         buf_len = conn->extra_len;
         conn->extra_len = 0;
-        heap_free(conn->extra_buf);
         conn->extra_buf = NULL;
     }
 
@@ -746,10 +799,6 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, BOOL blo
         switch(res) {
         case SEC_E_OK:
             break;
-        case SEC_I_CONTEXT_EXPIRED:
-            TRACE("context expired\n");
-            *eof = TRUE;
-            return ERROR_SUCCESS;
         case SEC_E_INCOMPLETE_MESSAGE:
             assert(buf_len < ssl_buf_size);
 
@@ -759,13 +808,8 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, BOOL blo
                 if(size < 0 && WSAGetLastError() == WSAEWOULDBLOCK) {
                     TRACE("would block\n");
 
-                    /* FIXME: Optimize extra_buf usage. */
-                    conn->extra_buf = heap_alloc(buf_len);
-                    if(!conn->extra_buf)
-                        return ERROR_NOT_ENOUGH_MEMORY;
-
+                    conn->extra_buf = conn->ssl_buf;
                     conn->extra_len = buf_len;
-                    memcpy(conn->extra_buf, conn->ssl_buf, conn->extra_len);
                     return WSAEWOULDBLOCK;
                 }
 
@@ -775,39 +819,53 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, BOOL blo
             buf_len += size;
             continue;
         default:
-            WARN("failed: %08x\n", res);
-            return ERROR_INTERNET_CONNECTION_ABORTED;
+            *ret_size = 0;
+            return ssl_decrypt_status(res, eof);
         }
     } while(res != SEC_E_OK);
 
-    for(i=0; i < sizeof(bufs)/sizeof(*bufs); i++) {
-        if(bufs[i].BufferType == SECBUFFER_DATA) {
-            size = min(buf_size, bufs[i].cbBuffer);
-            memcpy(buf, bufs[i].pvBuffer, size);
-            if(size < bufs[i].cbBuffer) {
-                assert(!conn->peek_len);
-                conn->peek_msg_mem = conn->peek_msg = heap_alloc(bufs[i].cbBuffer - size);
-                if(!conn->peek_msg)
-                    return ERROR_NOT_ENOUGH_MEMORY;
-                conn->peek_len = bufs[i].cbBuffer-size;
-                memcpy(conn->peek_msg, (char*)bufs[i].pvBuffer+size, conn->peek_len);
+    for(;;) {
+        set_ssl_extra(conn, bufs, sizeof(bufs)/sizeof(*bufs));
+
+        for(i=0; i < sizeof(bufs)/sizeof(*bufs); i++) {
+            if(bufs[i].BufferType == SECBUFFER_DATA) {
+                size = min(buf_size - copied, bufs[i].cbBuffer);
+                memcpy((BYTE*)buf + copied, bufs[i].pvBuffer, size);
+                copied += size;
+                if(size < bufs[i].cbBuffer) {
+                    conn->peek_msg = (char*)bufs[i].pvBuffer + size;
+                    conn->peek_len = bufs[i].cbBuffer - size;
+                }
             }
-
-            *ret_size = size;
         }
-    }
 
-    for(i=0; i < sizeof(bufs)/sizeof(*bufs); i++) {
-        if(bufs[i].BufferType == SECBUFFER_EXTRA) {
-            conn->extra_buf = heap_alloc(bufs[i].cbBuffer);
-            if(!conn->extra_buf)
-                return ERROR_NOT_ENOUGH_MEMORY;
+        /* decrypt records that were received along with this one as long as
+         * there is space left in buf */
+        if(conn->peek_len || copied == buf_size
+                || !is_complete_ssl_data_record((BYTE*)conn->extra_buf, conn->extra_len))
+            break;
 
-            conn->extra_len = bufs[i].cbBuffer;
-            memcpy(conn->extra_buf, bufs[i].pvBuffer, conn->extra_len);
+        memset(bufs, 0, sizeof(bufs));
+        bufs[0].BufferType = SECBUFFER_DATA;
+        bufs[0].cbBuffer = conn->extra_len;
+        bufs[0].pvBuffer = conn->extra_buf;
+
+        res = DecryptMessage(&conn->ssl_ctx, &buf_desc, 0, NULL);
+        if(res != SEC_E_OK) {
+            conn->extra_buf = NULL;
+            conn->extra_len = 0;
+            if(!copied) {
+                *ret_size = 0;
+                return ssl_decrypt_status(res, eof);
+            }
+
+            /* return what was already decrypted, the status is handled by the next call */
+            conn->ssl_status = res;
+            break;
         }
     }
 
+    *ret_size = copied;
     return ERROR_SUCCESS;
 }
 
@@ -840,10 +898,8 @@ DWORD NETCON_recv(netconn_t *connection, void *buf, size_t len, BOOL blocking, i
             connection->peek_len -= size;
             connection->peek_msg += size;
 
-            if(!connection->peek_len) {
-                heap_free(connection->peek_msg_mem);
-                connection->peek_msg_mem = connection->peek_msg = NULL;
-            }
+            if(!connection->peek_len)
+                connection->peek_msg = NULL;
 
             *recvd = size;
             return ERROR_SUCCESS;
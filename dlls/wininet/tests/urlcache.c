@@ -1100,6 +1100,100 @@ static void test_trailing_slash(void)
     DeleteFileA(filename);
 }
 
+#define CONCURRENT_URLS      8
+#define CONCURRENT_THREADS   4
+#define CONCURRENT_LOOKUPS   500
+
+static LONG concurrent_done;
+static DWORD concurrent_size[CONCURRENT_URLS];
+
+static void get_concurrent_url(char *url, unsigned int i)
+{
+    sprintf(url, "Visited: http://concurrent.cache.com/%u", i);
+}
+
+static DWORD WINAPI lookup_thread(void *arg)
+{
+    char url[64], buf[sizeof(INTERNET_CACHE_ENTRY_INFOA) + 16];
+    INTERNET_CACHE_ENTRY_INFOA *info = (void*)buf;
+    unsigned int i, j, k, failures = 0, overruns = 0;
+    DWORD size;
+    BOOL ret;
+
+    for(i = 0; i < CONCURRENT_LOOKUPS * CONCURRENT_URLS; i++) {
+        j = i % CONCURRENT_URLS;
+        get_concurrent_url(url, j);
+
+        size = 0;
+        SetLastError(0xdeadbeef);
+        ret = GetUrlCacheEntryInfoA(url, NULL, &size);
+        if(ret || GetLastError() != ERROR_INSUFFICIENT_BUFFER || size != concurrent_size[j])
+            failures++;
+
+        /* the buffer is too small for the url, nothing past the given size may be written */
+        memset(buf, 0xcc, sizeof(buf));
+        size = sizeof(*info);
+        SetLastError(0xdeadbeef);
+        ret = GetUrlCacheEntryInfoA(url, info, &size);
+        if(ret || GetLastError() != ERROR_INSUFFICIENT_BUFFER || size != concurrent_size[j])
+            failures++;
+        for(k = sizeof(*info); k < sizeof(buf); k++)
+            if(buf[k] != (char)0xcc) break;
+        if(k < sizeof(buf))
+            overruns++;
+    }
+    ok(!failures, "%u of %u lookups failed\n", failures, 2 * i);
+    ok(!overruns, "%u lookups wrote past the buffer\n", overruns);
+
+    InterlockedIncrement(&concurrent_done);
+    return 0;
+}
+
+static void test_concurrent_lookups(void)
+{
+    static const FILETIME filetime_zero;
+    static const char writer_url[] = "Visited: http://concurrent.cache.com/writer";
+    HANDLE threads[CONCURRENT_THREADS];
+    char url[64];
+    unsigned int i;
+    BOOL ret;
+
+    for(i = 0; i < CONCURRENT_URLS; i++) {
+        get_concurrent_url(url, i);
+        ret = CommitUrlCacheEntryA(url, NULL, filetime_zero, filetime_zero,
+                NORMAL_CACHE_ENTRY, NULL, 0, "html", NULL);
+        ok(ret, "CommitUrlCacheEntry failed with error %d\n", GetLastError());
+
+        concurrent_size[i] = 0;
+        ret = GetUrlCacheEntryInfoA(url, NULL, &concurrent_size[i]);
+        ok(!ret && GetLastError() == ERROR_INSUFFICIENT_BUFFER,
+           "GetUrlCacheEntryInfo returned %x with error %d\n", ret, GetLastError());
+        ok(concurrent_size[i] > sizeof(INTERNET_CACHE_ENTRY_INFOA), "got size %u\n", concurrent_size[i]);
+    }
+
+    for(i = 0; i < CONCURRENT_THREADS; i++)
+        threads[i] = CreateThread(NULL, 0, lookup_thread, NULL, 0, NULL);
+
+    /* keep modifying the index while the lookups are running */
+    while(concurrent_done < CONCURRENT_THREADS) {
+        ret = CommitUrlCacheEntryA(writer_url, NULL, filetime_zero, filetime_zero,
+                NORMAL_CACHE_ENTRY, NULL, 0, "html", NULL);
+        ok(ret, "CommitUrlCacheEntry failed with error %d\n", GetLastError());
+        ret = DeleteUrlCacheEntryA(writer_url);
+        ok(ret, "DeleteUrlCacheEntry failed with error %d\n", GetLastError());
+    }
+
+    WaitForMultipleObjects(CONCURRENT_THREADS, threads, TRUE, INFINITE);
+    for(i = 0; i < CONCURRENT_THREADS; i++)
+        CloseHandle(threads[i]);
+
+    for(i = 0; i < CONCURRENT_URLS; i++) {
+        get_concurrent_url(url, i);
+        ret = DeleteUrlCacheEntryA(url);
+        ok(ret, "DeleteUrlCacheEntry failed with error %d\n", GetLastError());
+    }
+}
+
 START_TEST(urlcache)
 {
     HMODULE hdll;
@@ -1124,4 +1218,5 @@ START_TEST(urlcache)
     test_FindCloseUrlCache();
     test_GetDiskInfoA();
     test_trailing_slash();
+    test_concurrent_lookups();
 }
@@ -46,6 +46,7 @@
 #include "internet.h"
 
 #include "wine/unicode.h"
+#include "wine/exception.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(wininet);
@@ -83,6 +84,7 @@ static const char urlcache_ver[] = "0.2012001";
 #define CACHE_CONTAINER_NO_SUBDIR   0xFE
 
 #define CACHE_HEADER_DATA_ROOT_LEAK_OFFSET 0x16
+#define CACHE_HEADER_DATA_GENERATION       0x20 /* wine specific, odd while the index is being modified */
 
 #define FILETIME_SECOND 10000000
 
@@ -189,6 +191,9 @@ typedef struct
     DWORD file_size; /* size of file when mapping was opened */
     HANDLE mutex; /* handle of mutex */
     DWORD default_entry_type;
+    SRWLOCK read_lock; /* protects read_view against being unmapped */
+    urlcache_header *read_view; /* view used for lookups without taking the mutex */
+    DWORD read_view_size; /* size of file when read_view was mapped */
 } cache_container;
 
 typedef struct
@@ -684,6 +689,14 @@ static DWORD cache_container_open_index(cache_container *container, DWORD blocks
  */
 static void cache_container_close_index(cache_container *pContainer)
 {
+    AcquireSRWLockExclusive(&pContainer->read_lock);
+    if (pContainer->read_view)
+    {
+        UnmapViewOfFile(pContainer->read_view);
+        pContainer->read_view = NULL;
+    }
+    ReleaseSRWLockExclusive(&pContainer->read_lock);
+
     CloseHandle(pContainer->mapping);
     pContainer->mapping = NULL;
 }
@@ -702,6 +715,9 @@ static BOOL cache_containers_add(const char *cache_prefix, LPCWSTR path,
     pContainer->mapping = NULL;
     pContainer->file_size = 0;
     pContainer->default_entry_type = default_entry_type;
+    InitializeSRWLock(&pContainer->read_lock);
+    pContainer->read_view = NULL;
+    pContainer->read_view_size = 0;
 
     pContainer->path = heap_strdupW(path);
     if (!pContainer->path)
@@ -886,6 +902,27 @@ static BOOL cache_containers_enum(char *search_pattern, DWORD index, cache_conta
     return FALSE;
 }
 
+/* The generation stored in the index header is odd while some thread,
+ * possibly in another process, holds the index lock. Lookups done without
+ * the lock compare it before and after reading the index and retry with
+ * the lock taken if it has changed. */
+static inline DWORD urlcache_get_generation(urlcache_header *header)
+{
+    return InterlockedCompareExchange((LONG*)&header->options[CACHE_HEADER_DATA_GENERATION], 0, 0);
+}
+
+static inline void urlcache_begin_write(urlcache_header *header)
+{
+    DWORD generation = header->options[CACHE_HEADER_DATA_GENERATION];
+    InterlockedExchange((LONG*)&header->options[CACHE_HEADER_DATA_GENERATION], generation | 1);
+}
+
+static inline void urlcache_end_write(urlcache_header *header)
+{
+    DWORD generation = header->options[CACHE_HEADER_DATA_GENERATION];
+    InterlockedExchange((LONG*)&header->options[CACHE_HEADER_DATA_GENERATION], (generation | 1) + 1);
+}
+
 /***********************************************************************
  *           cache_container_lock_index (Internal)
  *
@@ -946,7 +983,8 @@ static urlcache_header* cache_container_lock_index(cache_container *pContainer)
     {
         TRACE("Directory[%d] = \"%.8s\"\n", index, pHeader->directory_data[index].name);
     }
-    
+
+    urlcache_begin_write(pHeader);
     return pHeader;
 }
 
@@ -956,11 +994,31 @@ static urlcache_header* cache_container_lock_index(cache_container *pContainer)
  */
 static BOOL cache_container_unlock_index(cache_container *pContainer, urlcache_header *pHeader)
 {
+    urlcache_end_write(pHeader);
+
     /* release mutex */
     ReleaseMutex(pContainer->mutex);
     return UnmapViewOfFile(pHeader);
 }
 
+/* Caller must hold container lock */
+static void cache_container_update_read_view(cache_container *container)
+{
+    urlcache_header *view;
+
+    if (container->read_view && container->read_view_size == container->file_size)
+        return;
+
+    view = MapViewOfFile(container->mapping, FILE_MAP_WRITE, 0, 0, 0);
+
+    AcquireSRWLockExclusive(&container->read_lock);
+    if (container->read_view)
+        UnmapViewOfFile(container->read_view);
+    container->read_view = view;
+    container->read_view_size = container->file_size;
+    ReleaseSRWLockExclusive(&container->read_lock);
+}
+
 /***********************************************************************
  *           urlcache_create_file_pathW (Internal)
  *
@@ -1513,6 +1571,7 @@ static BOOL urlcache_find_hash_entry(const urlcache_header *pHeader, LPCSTR lpsz
      */
     DWORD key = urlcache_hash_key(lpszUrl);
     DWORD offset = (key & (HASHTABLE_NUM_ENTRIES-1)) * HASHTABLE_BLOCKSIZE;
+    DWORD index_size = pHeader->size;
     entry_hash_table* pHashEntry;
     DWORD id = 0;
 
@@ -1522,6 +1581,13 @@ static BOOL urlcache_find_hash_entry(const urlcache_header *pHeader, LPCSTR lpsz
          pHashEntry; pHashEntry = urlcache_get_hash_table(pHeader, pHashEntry->next))
     {
         int i;
+        /* a corrupted index or one read while being modified may contain a loop */
+        if ((LPBYTE)pHashEntry - (LPBYTE)pHeader > index_size - sizeof(*pHashEntry) ||
+            id >= index_size / sizeof(*pHashEntry))
+        {
+            ERR("Error: hash table chain is corrupted\n");
+            break;
+        }
         if (pHashEntry->id != id++)
         {
             ERR("Error: not right hash table number (%d) expected %d\n", pHashEntry->id, id);
@@ -1771,12 +1837,88 @@ static BOOL urlcache_hash_entry_is_locked(struct hash_entry *hash_entry, entry_u
     return TRUE;
 }
 
+static DWORD urlcache_find_entry_info(cache_container *container, const urlcache_header *header,
+        const char *url, void *entry_info, DWORD *size, DWORD flags, BOOL unicode)
+{
+    struct hash_entry *hash_entry;
+    const entry_url *url_entry;
+    DWORD error;
+
+    if(!urlcache_find_hash_entry(header, url, &hash_entry)) {
+        WARN("entry %s not found!\n", debugstr_a(url));
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    url_entry = (const entry_url*)((LPBYTE)header + hash_entry->offset);
+    if(url_entry->header.signature != URL_SIGNATURE) {
+        FIXME("Trying to retrieve entry of unknown format %s\n",
+                debugstr_an((LPCSTR)&url_entry->header.signature, sizeof(DWORD)));
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    TRACE("Found URL: %s\n", debugstr_a((LPCSTR)url_entry + url_entry->url_off));
+    TRACE("Header info: %s\n", debugstr_an((LPCSTR)url_entry +
+                url_entry->header_info_off, url_entry->header_info_size));
+
+    if((flags & GET_INSTALLED_ENTRY) && !(url_entry->cache_entry_type & INSTALLED_CACHE_ENTRY))
+        return ERROR_FILE_NOT_FOUND;
+
+    if(size) {
+        if(!entry_info)
+            *size = 0;
+
+        error = urlcache_copy_entry(container, header, entry_info, size, url_entry, unicode);
+        if(error != ERROR_SUCCESS)
+            return error;
+        if(url_entry->local_name_off)
+            TRACE("Local File Name: %s\n", debugstr_a((LPCSTR)url_entry + url_entry->local_name_off));
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/* Looks the entry up in the read view without taking the index lock.
+ * Returns FALSE if the index was modified meanwhile or the view is out of
+ * date, in which case the lookup has to be repeated with the lock held. */
+static BOOL urlcache_find_entry_info_unlocked(cache_container *container, const char *url,
+        void *entry_info, DWORD *size, DWORD flags, BOOL unicode, DWORD *error)
+{
+    urlcache_header *header;
+    DWORD generation, local_size = 0;
+    BOOL ret = FALSE;
+
+    AcquireSRWLockShared(&container->read_lock);
+
+    header = container->read_view;
+    if(header) {
+        generation = urlcache_get_generation(header);
+        if(!(generation & 1) && header->size == container->read_view_size) {
+            /* the size is only reported if the index didn't change meanwhile */
+            if(size) local_size = *size;
+            __TRY
+            {
+                *error = urlcache_find_entry_info(container, header, url, entry_info,
+                        size ? &local_size : NULL, flags, unicode);
+                ret = urlcache_get_generation(header) == generation;
+            }
+            __EXCEPT_PAGE_FAULT
+            {
+                /* the index was changed under us */
+                ret = FALSE;
+            }
+            __ENDTRY
+        }
+    }
+
+    ReleaseSRWLockShared(&container->read_lock);
+    if(ret && size) *size = local_size;
+    return ret;
+}
+
 static BOOL urlcache_get_entry_info(const char *url, void *entry_info,
         DWORD *size, DWORD flags, BOOL unicode)
 {
     urlcache_header *header;
-    struct hash_entry *hash_entry;
-    const entry_url *url_entry;
     cache_container *container;
     DWORD error;
 
@@ -1797,50 +1939,19 @@ static BOOL urlcache_get_entry_info(const char *url, void *entry_info,
         return FALSE;
     }
 
-    if(!(header = cache_container_lock_index(container)))
-        return FALSE;
+    if(!urlcache_find_entry_info_unlocked(container, url, entry_info, size, flags, unicode, &error)) {
+        if(!(header = cache_container_lock_index(container)))
+            return FALSE;
 
-    if(!urlcache_find_hash_entry(header, url, &hash_entry)) {
+        error = urlcache_find_entry_info(container, header, url, entry_info, size, flags, unicode);
+        cache_container_update_read_view(container);
         cache_container_unlock_index(container, header);
-        WARN("entry %s not found!\n", debugstr_a(url));
-        SetLastError(ERROR_FILE_NOT_FOUND);
-        return FALSE;
     }
 
-    url_entry = (const entry_url*)((LPBYTE)header + hash_entry->offset);
-    if(url_entry->header.signature != URL_SIGNATURE) {
-        cache_container_unlock_index(container, header);
-        FIXME("Trying to retrieve entry of unknown format %s\n",
-                debugstr_an((LPCSTR)&url_entry->header.signature, sizeof(DWORD)));
-        SetLastError(ERROR_FILE_NOT_FOUND);
-        return FALSE;
-    }
-
-    TRACE("Found URL: %s\n", debugstr_a((LPCSTR)url_entry + url_entry->url_off));
-    TRACE("Header info: %s\n", debugstr_an((LPCSTR)url_entry +
-                url_entry->header_info_off, url_entry->header_info_size));
-
-    if((flags & GET_INSTALLED_ENTRY) && !(url_entry->cache_entry_type & INSTALLED_CACHE_ENTRY)) {
-        cache_container_unlock_index(container, header);
-        SetLastError(ERROR_FILE_NOT_FOUND);
+    if(error != ERROR_SUCCESS) {
+        SetLastError(error);
         return FALSE;
     }
-
-    if(size) {
-        if(!entry_info)
-            *size = 0;
-
-        error = urlcache_copy_entry(container, header, entry_info, size, url_entry, unicode);
-        if(error != ERROR_SUCCESS) {
-            cache_container_unlock_index(container, header);
-            SetLastError(error);
-            return FALSE;
-        }
-        if(url_entry->local_name_off)
-            TRACE("Local File Name: %s\n", debugstr_a((LPCSTR)url_entry + url_entry->local_name_off));
-    }
-
-    cache_container_unlock_index(container, header);
     return TRUE;
 }
 
@@ -2383,8 +2494,17 @@ BOOL WINAPI FreeUrlCacheSpaceW(LPCWSTR cache_path, DWORD size, DWORD filter)
             {
                 BOOL ret_del;
 
+                urlcache_header *header;
+
                 WaitForSingleObject(container->mutex, INFINITE);
 
+                /* other processes may still do lookups in the old index,
+                 * leave it marked as being modified so they take the lock */
+                if(container->mapping && (header = MapViewOfFile(container->mapping, FILE_MAP_WRITE, 0, 0, 0))) {
+                    urlcache_begin_write(header);
+                    UnmapViewOfFile(header);
+                }
+
                 /* unlock, delete, recreate and lock cache */
                 cache_container_close_index(container);
                 ret_del = cache_container_delete_dir(container->path);
@@ -131,6 +131,12 @@
 #ifdef HAVE_SYS_TIME_H
 # include <sys/time.h>
 #endif
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 
 #define NONAMELESSUNION
 #define NONAMELESSSTRUCT
@@ -158,6 +164,7 @@
 #include "wine/debug.h"
 #include "wine/exception.h"
 #include "wine/unicode.h"
+#include "wine/list.h"
 
 #if defined(linux) && !defined(IP_UNICAST_IF)
 #define IP_UNICAST_IF 50
@@ -499,6 +506,11 @@ struct ws2_async
     DWORD                               flags;
     DWORD                              *lpFlags;
     WSABUF                             *control;
+    struct list                         entry;        /* entry in pending_dgram_reads */
+    DWORD                               thread;       /* thread that queued the batched read */
+    BOOL                                batched;      /* datagram read that can be batched with others */
+    BOOL                                batch_done;   /* data received by another read of the batch */
+    int                                 batch_result;
     unsigned int                        n_iovecs;
     unsigned int                        first_iovec;
     struct iovec                        iovec[1];
@@ -518,18 +530,27 @@ struct ws2_accept_async
     struct ws2_async    *read;
 };
 
+struct ws2_transmit_element
+{
+    HANDLE        file;     /* NULL for memory elements */
+    char         *buffer;
+    LARGE_INTEGER offset;   /* file offset, or FILE_USE_FILE_POINTER_POSITION */
+    ULONGLONG     length;   /* bytes left to send */
+    BOOL          eop;      /* end of packet, don't merge with the following elements */
+};
+
 struct ws2_transmitfile_async
 {
-    struct ws2_async_io   io;
-    char                  *buffer;
-    HANDLE                file;
-    DWORD                 file_read;
-    DWORD                 file_bytes;
-    DWORD                 bytes_per_send;
-    TRANSMIT_FILE_BUFFERS buffers;
-    DWORD                 flags;
-    LARGE_INTEGER         offset;
-    struct ws2_async      write;
+    struct ws2_async_io          io;
+    char                        *buffer;   /* bounce buffer for files that can't be sent directly */
+    struct ws2_transmit_element *elements;
+    DWORD                        count;
+    DWORD                        current;
+    DWORD                        bytes_per_send;
+    DWORD                        flags;
+    int                          send_flags;
+    BOOL                         use_sendfile;
+    struct ws2_async             write;
 };
 
 static struct ws2_async_io *async_io_freelist;
@@ -1181,6 +1202,8 @@ static void free_per_thread_data(void)
 /***********************************************************************
  *		DllMain (WS2_32.init)
  */
+static void WS2_remove_dgram_reads( HANDLE socket, DWORD thread );
+
 BOOL WINAPI DllMain(HINSTANCE hInstDLL, DWORD fdwReason, LPVOID fImpLoad)
 {
     TRACE("%p 0x%x %p\n", hInstDLL, fdwReason, fImpLoad);
@@ -1193,6 +1216,7 @@ BOOL WINAPI DllMain(HINSTANCE hInstDLL, DWORD fdwReason, LPVOID fImpLoad)
         DeleteCriticalSection(&csWSgetXXXbyYYY);
         break;
     case DLL_THREAD_DETACH:
+        WS2_remove_dgram_reads( 0, GetCurrentThreadId() );
         free_per_thread_data();
         break;
     }
@@ -2262,6 +2286,185 @@ static int WS2_recv( int fd, struct ws2_async *wsa, int flags )
     return n;
 }
 
+/* overlapped datagram reads waiting for data, in the order they were queued */
+static struct list pending_dgram_reads = LIST_INIT( pending_dgram_reads );
+
+static CRITICAL_SECTION dgram_read_section;
+static CRITICAL_SECTION_DEBUG dgram_read_section_debug =
+{
+    0, 0, &dgram_read_section,
+    { &dgram_read_section_debug.ProcessLocksList, &dgram_read_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": dgram_read_section") }
+};
+static CRITICAL_SECTION dgram_read_section = { &dgram_read_section_debug, -1, 0, 0, 0, 0 };
+
+#define MAX_BATCHED_READS 16
+
+/***********************************************************************
+ *              WS2_dequeue_dgram_read  (INTERNAL)
+ *
+ * Remove an overlapped read from the batches of its socket.
+ * Returns TRUE if data was already received for it.
+ */
+static BOOL WS2_dequeue_dgram_read( struct ws2_async *wsa, int *result )
+{
+    BOOL done;
+
+    EnterCriticalSection( &dgram_read_section );
+    if (!wsa->batched) done = FALSE;
+    else if ((done = wsa->batch_done)) *result = wsa->batch_result;
+    else list_remove( &wsa->entry );
+    wsa->batched = FALSE;
+    LeaveCriticalSection( &dgram_read_section );
+    return done;
+}
+
+/***********************************************************************
+ *              WS2_remove_dgram_reads  (INTERNAL)
+ *
+ * Stop batching the reads of a socket being closed or of a thread
+ * exiting, their asyncs complete through the normal path if at all.
+ */
+static void WS2_remove_dgram_reads( HANDLE socket, DWORD thread )
+{
+    struct ws2_async *wsa, *next;
+
+    EnterCriticalSection( &dgram_read_section );
+    LIST_FOR_EACH_ENTRY_SAFE( wsa, next, &pending_dgram_reads, struct ws2_async, entry )
+    {
+        if (socket ? wsa->hSocket != socket : wsa->thread != thread) continue;
+        list_remove( &wsa->entry );
+        wsa->batched = FALSE;
+    }
+    LeaveCriticalSection( &dgram_read_section );
+}
+
+#ifdef HAVE_RECVMMSG
+/***********************************************************************
+ *              WS2_recv_batch          (INTERNAL)
+ *
+ * Receive datagrams for all the queued reads of a socket with a single
+ * recvmmsg() call, in the order the reads were queued.
+ */
+static int WS2_recv_batch( int fd, struct ws2_async *wsa )
+{
+    struct mmsghdr msgs[MAX_BATCHED_READS];
+    union generic_unix_sockaddr addrs[MAX_BATCHED_READS];
+    struct ws2_async *batch[MAX_BATCHED_READS], *other;
+    client_ptr_t iosbs[MAX_BATCHED_READS], woken[MAX_BATCHED_READS];
+    int i, j, n, count = 0, result = -1;
+    data_size_t woken_count = 0;
+
+    EnterCriticalSection( &dgram_read_section );
+
+    if (wsa->batch_done)
+    {
+        LeaveCriticalSection( &dgram_read_section );
+        wsa->batched = FALSE;
+        return wsa->batch_result;
+    }
+
+    /* the handle may have been reused for another socket, the server tells which reads are still
+     * queued on this one and wakes them so that they complete with the data received for them */
+    LIST_FOR_EACH_ENTRY( other, &pending_dgram_reads, struct ws2_async, entry )
+    {
+        if (other == wsa || other->hSocket != wsa->hSocket) continue;
+        iosbs[count++] = wine_server_client_ptr( other->user_overlapped ?
+                                                 (void *)other->user_overlapped : &other->local_iosb );
+        if (count == MAX_BATCHED_READS - 1) break;
+    }
+    if (count)
+    {
+        /* asyncs may run during the server call, it must not be made with the batches locked */
+        LeaveCriticalSection( &dgram_read_section );
+        SERVER_START_REQ( wake_socket_reads )
+        {
+            req->handle = wine_server_obj_handle( wsa->hSocket );
+            wine_server_add_data( req, iosbs, count * sizeof(iosbs[0]) );
+            wine_server_set_reply( req, woken, sizeof(woken) );
+            if (!wine_server_call( req )) woken_count = wine_server_reply_size( reply ) / sizeof(woken[0]);
+        }
+        SERVER_END_REQ;
+        EnterCriticalSection( &dgram_read_section );
+
+        /* another thread may have received our data or stopped batching in the meantime */
+        if (wsa->batch_done)
+        {
+            LeaveCriticalSection( &dgram_read_section );
+            wsa->batched = FALSE;
+            return wsa->batch_result;
+        }
+        if (!wsa->batched)
+        {
+            LeaveCriticalSection( &dgram_read_section );
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+
+    /* the woken reads completed or dequeued since then are no longer in the list */
+    count = 0;
+    LIST_FOR_EACH_ENTRY( other, &pending_dgram_reads, struct ws2_async, entry )
+    {
+        struct msghdr *hdr = &msgs[count].msg_hdr;
+
+        if (other->hSocket != wsa->hSocket) continue;
+        if (other != wsa)
+        {
+            client_ptr_t iosb = wine_server_client_ptr( other->user_overlapped ?
+                                                        (void *)other->user_overlapped : &other->local_iosb );
+            for (j = 0; j < woken_count; j++) if (woken[j] == iosb) break;
+            if (j == woken_count) continue;
+        }
+
+        hdr->msg_name       = other->addr ? &addrs[count] : NULL;
+        hdr->msg_namelen    = other->addr ? sizeof(addrs[count]) : 0;
+        hdr->msg_iov        = other->iovec + other->first_iovec;
+        hdr->msg_iovlen     = other->n_iovecs - other->first_iovec;
+        hdr->msg_control    = NULL;
+        hdr->msg_controllen = 0;
+        hdr->msg_flags      = 0;
+        batch[count++] = other;
+        if (count == MAX_BATCHED_READS) break;
+    }
+
+    while ((n = recvmmsg( fd, msgs, count, 0, NULL )) == -1 && errno == EINTR)
+        ;
+
+    if (n == -1)
+    {
+        if (errno != EAGAIN)
+        {
+            list_remove( &wsa->entry );
+            wsa->batched = FALSE;
+        }
+        LeaveCriticalSection( &dgram_read_section );
+        return -1;
+    }
+
+    /* the woken reads that got no data go back to waiting when their callback runs */
+    TRACE( "received %d datagrams for %d reads\n", n, count );
+    for (i = 0; i < n; i++)
+    {
+        other = batch[i];
+        if (other->addr && msgs[i].msg_hdr.msg_namelen)
+            ws_sockaddr_u2ws( &addrs[i].addr, other->addr, other->addrlen.ptr );
+        other->batch_result = msgs[i].msg_len;
+        other->batch_done = TRUE;
+        list_remove( &other->entry );
+        if (other == wsa)
+        {
+            result = other->batch_result;
+            wsa->batched = FALSE;
+        }
+    }
+    LeaveCriticalSection( &dgram_read_section );
+
+    if (result == -1) errno = EAGAIN;
+    return result;
+}
+#endif
+
 /***********************************************************************
  *              WS2_async_recv          (INTERNAL)
  *
@@ -2273,13 +2476,30 @@ static NTSTATUS WS2_async_recv( void *user, IO_STATUS_BLOCK *iosb,
     struct ws2_async *wsa = user;
     int result = 0, fd;
 
-    switch (status)
+    if (wsa->batched && RtlIsCriticalSectionLockedByThread( &dgram_read_section ))
+    {
+        /* we may have interrupted this thread while it was updating the batches, try again later,
+         * unless the data was already received by another read as nothing would wake us again */
+        if (!wsa->batch_done) return STATUS_PENDING;
+        wsa->batched = FALSE;
+        result = wsa->batch_result;
+        status = STATUS_SUCCESS;
+    }
+    else switch (status)
     {
     case STATUS_ALERTED:
         if ((status = wine_server_handle_to_fd( wsa->hSocket, FILE_READ_DATA, &fd, NULL ) ))
+        {
+            if (WS2_dequeue_dgram_read( wsa, &result )) status = STATUS_SUCCESS;
             break;
+        }
 
-        result = WS2_recv( fd, wsa, convert_flags(wsa->flags) );
+#ifdef HAVE_RECVMMSG
+        if (wsa->batched)
+            result = WS2_recv_batch( fd, wsa );
+        else
+#endif
+            result = WS2_recv( fd, wsa, convert_flags(wsa->flags) );
         wine_server_release_fd( wsa->hSocket, fd );
         if (result >= 0)
         {
@@ -2300,6 +2520,10 @@ static NTSTATUS WS2_async_recv( void *user, IO_STATUS_BLOCK *iosb,
             }
         }
         break;
+    default:
+        /* data already received by another read is not lost on cancellation */
+        if (WS2_dequeue_dgram_read( wsa, &result )) status = STATUS_SUCCESS;
+        break;
     }
     if (status != STATUS_PENDING)
     {
@@ -2348,6 +2572,9 @@ static NTSTATUS WS2_async_accept( void *user, IO_STATUS_BLOCK *iosb,
                                   NTSTATUS status, void **apc, void **arg )
 {
     struct ws2_accept_async *wsa = user;
+    union generic_unix_sockaddr uaddr;
+    char addrs[2 * sizeof(uaddr)];
+    data_size_t local_len = 0, addrs_len = 0;
     int len;
     char *addr;
 
@@ -2359,7 +2586,10 @@ static NTSTATUS WS2_async_accept( void *user, IO_STATUS_BLOCK *iosb,
         {
             req->lhandle = wine_server_obj_handle( wsa->listen_socket );
             req->ahandle = wine_server_obj_handle( wsa->accept_socket );
+            wine_server_set_reply( req, addrs, sizeof(addrs) );
             status = wine_server_call( req );
+            local_len = reply->local_len;
+            addrs_len = wine_server_reply_size( reply );
         }
         SERVER_END_REQ;
 
@@ -2380,16 +2610,33 @@ static NTSTATUS WS2_async_accept( void *user, IO_STATUS_BLOCK *iosb,
 
     /* WS2 Spec says size param is extra 16 bytes long...what do we put in it? */
     addr = ((char *)wsa->buf) + wsa->data_len;
-    len = wsa->local_len - sizeof(int);
-    WS_getsockname(HANDLE2SOCKET(wsa->accept_socket),
-                   (struct WS_sockaddr *)(addr + sizeof(int)), &len);
-    *(int *)addr = len;
+    if (local_len && local_len < addrs_len)
+    {
+        /* the server returned both addresses along with the accepted socket */
+        memcpy( &uaddr, addrs, local_len );
+        len = wsa->local_len - sizeof(int);
+        ws_sockaddr_u2ws( &uaddr.addr, (struct WS_sockaddr *)(addr + sizeof(int)), &len );
+        *(int *)addr = len;
+
+        addr += wsa->local_len;
+        memcpy( &uaddr, addrs + local_len, addrs_len - local_len );
+        len = wsa->remote_len - sizeof(int);
+        ws_sockaddr_u2ws( &uaddr.addr, (struct WS_sockaddr *)(addr + sizeof(int)), &len );
+        *(int *)addr = len;
+    }
+    else
+    {
+        len = wsa->local_len - sizeof(int);
+        WS_getsockname(HANDLE2SOCKET(wsa->accept_socket),
+                       (struct WS_sockaddr *)(addr + sizeof(int)), &len);
+        *(int *)addr = len;
 
-    addr += wsa->local_len;
-    len = wsa->remote_len - sizeof(int);
-    WS_getpeername(HANDLE2SOCKET(wsa->accept_socket),
-                   (struct WS_sockaddr *)(addr + sizeof(int)), &len);
-    *(int *)addr = len;
+        addr += wsa->local_len;
+        len = wsa->remote_len - sizeof(int);
+        WS_getpeername(HANDLE2SOCKET(wsa->accept_socket),
+                       (struct WS_sockaddr *)(addr + sizeof(int)), &len);
+        *(int *)addr = len;
+    }
 
     if (!wsa->read)
         goto finish;
@@ -2760,6 +3007,7 @@ static BOOL WINAPI WS2_AcceptEx(SOCKET listener, SOCKET acceptor, PVOID dest, DW
         wsa->read->n_iovecs    = 1;
         wsa->read->first_iovec = 0;
         wsa->read->completion_func = NULL;
+        wsa->read->batched     = FALSE;
         wsa->read->iovec[0].iov_base = wsa->buf;
         wsa->read->iovec[0].iov_len  = wsa->data_len;
     }
@@ -2834,6 +3082,84 @@ static NTSTATUS WS2_ReadFile(HANDLE hFile, PIO_STATUS_BLOCK io_status, char* buf
     return status;
 }
 
+/***********************************************************************
+ *     WS2_transmit_data_follows        (INTERNAL)
+ *
+ * Check whether more data is to be sent in the same packet after the given element.
+ */
+static BOOL WS2_transmit_data_follows( const struct ws2_transmitfile_async *wsa, DWORD index )
+{
+    if (wsa->elements[index].eop) return FALSE;
+    while (++index < wsa->count)
+    {
+        if (wsa->elements[index].length) return TRUE;
+        if (wsa->elements[index].eop) break;
+    }
+    return FALSE;
+}
+
+/***********************************************************************
+ *     WS2_transmit_queue               (INTERNAL)
+ *
+ * Queue a buffer for the next send operation.
+ */
+static void WS2_transmit_queue( struct ws2_transmitfile_async *wsa, char *buffer, ULONG length, BOOL more )
+{
+    wsa->write.first_iovec       = 0;
+    wsa->write.n_iovecs          = 1;
+    wsa->write.iovec[0].iov_base = buffer;
+    wsa->write.iovec[0].iov_len  = length;
+    wsa->send_flags              = 0;
+#ifdef MSG_MORE
+    if (more) wsa->send_flags = MSG_MORE;
+#endif
+}
+
+/***********************************************************************
+ *     WS2_transmitfile_sendfile        (INTERNAL)
+ *
+ * Send the current file element directly from the file to the socket.
+ */
+static NTSTATUS WS2_transmitfile_sendfile( int fd, struct ws2_transmitfile_async *wsa )
+{
+#ifdef HAVE_SYS_SENDFILE_H
+    struct ws2_transmit_element *element = &wsa->elements[wsa->current];
+    IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)wsa->write.user_overlapped;
+    off_t offset = element->offset.QuadPart;
+    int unix_fd;
+    ssize_t n;
+    NTSTATUS status;
+
+    if ((status = wine_server_handle_to_fd( element->file, FILE_READ_DATA, &unix_fd, NULL )))
+        return status;
+
+    while ((n = sendfile( fd, unix_fd,
+                          element->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION ? &offset : NULL,
+                          min( element->length, 0x7ffff000 ) )) == -1 && errno == EINTR)
+        ;
+    wine_server_release_fd( element->file, unix_fd );
+
+    if (n > 0)
+    {
+        if (iosb) iosb->Information += n;
+        if (element->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+            element->offset.QuadPart += n;
+        element->length -= n;
+        return STATUS_PENDING;
+    }
+    if (!n)
+    {
+        element->length = 0; /* end of file, continue on to the next element */
+        return STATUS_PENDING;
+    }
+    if (errno == EAGAIN) return STATUS_PENDING;
+    if (errno != EINVAL && errno != ENOSYS && errno != EOVERFLOW) return wsaErrStatus();
+    TRACE( "sendfile not supported for %p, falling back to read/send\n", element->file );
+#endif
+    wsa->use_sendfile = FALSE;
+    return STATUS_NOT_SUPPORTED;
+}
+
 /***********************************************************************
  *     WS2_transmitfile_getbuffer       (INTERNAL)
  *
@@ -2845,62 +3171,49 @@ static NTSTATUS WS2_transmitfile_getbuffer( int fd, struct ws2_transmitfile_asyn
     if (wsa->write.first_iovec < wsa->write.n_iovecs)
         return STATUS_PENDING;
 
-    /* process the header (if applicable) */
-    if (wsa->buffers.Head)
-    {
-        wsa->write.first_iovec       = 0;
-        wsa->write.n_iovecs          = 1;
-        wsa->write.iovec[0].iov_base = wsa->buffers.Head;
-        wsa->write.iovec[0].iov_len  = wsa->buffers.HeadLength;
-        wsa->buffers.Head            = NULL;
-        return STATUS_PENDING;
-    }
-
-    /* process the main file */
-    if (wsa->file)
+    for (; wsa->current < wsa->count; wsa->current++)
     {
+        struct ws2_transmit_element *element = &wsa->elements[wsa->current];
         DWORD bytes_per_send = wsa->bytes_per_send;
         IO_STATUS_BLOCK iosb;
         NTSTATUS status;
 
+        if (!element->length) continue;
+
+        /* process a memory buffer */
+        if (!element->file)
+        {
+            WS2_transmit_queue( wsa, element->buffer, element->length,
+                                WS2_transmit_data_follows( wsa, wsa->current ) );
+            element->length = 0;
+            return STATUS_PENDING;
+        }
+
+        /* process a file, directly if possible */
+        if (wsa->use_sendfile)
+        {
+            status = WS2_transmitfile_sendfile( fd, wsa );
+            if (status != STATUS_NOT_SUPPORTED) return status;
+        }
+
         iosb.Information = 0;
-        /* when the size of the transfer is limited ensure that we don't go past that limit */
-        if (wsa->file_bytes != 0)
-            bytes_per_send = min(bytes_per_send, wsa->file_bytes - wsa->file_read);
-        status = WS2_ReadFile( wsa->file, &iosb, wsa->buffer, bytes_per_send, &wsa->offset );
-        if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
-            wsa->offset.QuadPart += iosb.Information;
+        /* ensure that we don't go past the end of the element */
+        bytes_per_send = min( bytes_per_send, element->length );
+        status = WS2_ReadFile( element->file, &iosb, wsa->buffer, bytes_per_send, &element->offset );
+        if (element->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+            element->offset.QuadPart += iosb.Information;
         if (status == STATUS_END_OF_FILE)
-            wsa->file = NULL; /* continue on to the footer */
+            element->length = 0; /* continue on to the next element */
         else if (status != STATUS_SUCCESS)
             return status;
-        else
+        else if (iosb.Information)
         {
-            if (iosb.Information)
-            {
-                wsa->write.first_iovec       = 0;
-                wsa->write.n_iovecs          = 1;
-                wsa->write.iovec[0].iov_base = wsa->buffer;
-                wsa->write.iovec[0].iov_len  = iosb.Information;
-                wsa->file_read += iosb.Information;
-            }
-
-            if (wsa->file_bytes != 0 && wsa->file_read >= wsa->file_bytes)
-                wsa->file = NULL;
-
+            element->length -= iosb.Information;
+            WS2_transmit_queue( wsa, wsa->buffer, iosb.Information,
+                                element->length || WS2_transmit_data_follows( wsa, wsa->current ) );
             return STATUS_PENDING;
         }
-    }
-
-    /* send the footer (if applicable) */
-    if (wsa->buffers.Tail)
-    {
-        wsa->write.first_iovec       = 0;
-        wsa->write.n_iovecs          = 1;
-        wsa->write.iovec[0].iov_base = wsa->buffers.Tail;
-        wsa->write.iovec[0].iov_len  = wsa->buffers.TailLength;
-        wsa->buffers.Tail            = NULL;
-        return STATUS_PENDING;
+        else element->length = 0;
     }
 
     return STATUS_SUCCESS;
@@ -2916,12 +3229,12 @@ static NTSTATUS WS2_transmitfile_base( int fd, struct ws2_transmitfile_async *ws
     NTSTATUS status;
 
     status = WS2_transmitfile_getbuffer( fd, wsa );
-    if (status == STATUS_PENDING)
+    if (status == STATUS_PENDING && wsa->write.first_iovec < wsa->write.n_iovecs)
     {
         IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)wsa->write.user_overlapped;
         int n;
 
-        n = WS2_send( fd, &wsa->write, convert_flags(wsa->write.flags) );
+        n = WS2_send( fd, &wsa->write, convert_flags(wsa->write.flags) | wsa->send_flags );
         if (n >= 0)
         {
             if (iosb) iosb->Information += n;
@@ -2961,21 +3274,53 @@ static NTSTATUS WS2_async_transmitfile( void *user, IO_STATUS_BLOCK *iosb,
 }
 
 /***********************************************************************
- *     TransmitFile
+ *     WS2_transmit_init_file           (INTERNAL)
+ *
+ * Determine how much of a file is to be sent, a zero length meaning up to the end of the file.
  */
-static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD bytes_per_send,
-                                     LPOVERLAPPED overlapped, LPTRANSMIT_FILE_BUFFERS buffers,
-                                     DWORD flags )
+static NTSTATUS WS2_transmit_init_file( struct ws2_transmit_element *element, ULONG length )
+{
+    struct stat st;
+    off_t start;
+    int unix_fd;
+    NTSTATUS status;
+
+    if ((status = wine_server_handle_to_fd( element->file, FILE_READ_DATA, &unix_fd, NULL )))
+        return status;
+
+    if (element->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+        start = element->offset.QuadPart;
+    else
+        start = lseek( unix_fd, 0, SEEK_CUR );
+
+    if (start == -1 || fstat( unix_fd, &st ) == -1)
+        status = wsaErrStatus();
+    else if (S_ISREG(st.st_mode))
+    {
+        element->length = st.st_size > start ? st.st_size - start : 0;
+        if (length) element->length = min( element->length, length );
+    }
+    else element->length = length ? length : ~(ULONGLONG)0;
+
+    wine_server_release_fd( element->file, unix_fd );
+    return status;
+}
+
+/***********************************************************************
+ *     WS2_transmit                     (INTERNAL)
+ *
+ * Shared implementation of TransmitFile and TransmitPackets.
+ */
+static BOOL WS2_transmit( SOCKET s, const TRANSMIT_PACKETS_ELEMENT *elements, DWORD count,
+                          DWORD bytes_per_send, LPOVERLAPPED overlapped, DWORD flags )
 {
     union generic_unix_sockaddr uaddr;
     unsigned int uaddrlen = sizeof(uaddr);
     struct ws2_transmitfile_async *wsa;
     NTSTATUS status;
+    DWORD i;
     int fd;
 
-    TRACE("(%lx, %p, %d, %d, %p, %p, %d)\n", s, h, file_bytes, bytes_per_send, overlapped,
-            buffers, flags );
-
     fd = get_sock_fd( s, FILE_WRITE_DATA, NULL );
     if (fd == -1)
     {
@@ -2991,35 +3336,44 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     if (flags)
         FIXME("Flags are not currently supported (0x%x).\n", flags);
 
-    if (h && GetFileType( h ) != FILE_TYPE_DISK)
+    for (i = 0; i < count; i++)
     {
-        FIXME("Non-disk file handles are not currently supported.\n");
-        release_sock_fd( s, fd );
-        WSASetLastError( WSAEOPNOTSUPP );
-        return FALSE;
+        switch (elements[i].dwElFlags & (TP_ELEMENT_MEMORY | TP_ELEMENT_FILE))
+        {
+        case TP_ELEMENT_MEMORY:
+            break;
+        case TP_ELEMENT_FILE:
+            if (GetFileType( elements[i].u.s.hFile ) == FILE_TYPE_DISK) break;
+            FIXME("Non-disk file handles are not currently supported.\n");
+            release_sock_fd( s, fd );
+            WSASetLastError( WSAEOPNOTSUPP );
+            return FALSE;
+        default:
+            release_sock_fd( s, fd );
+            WSASetLastError( WSAEINVAL );
+            return FALSE;
+        }
     }
 
     /* set reasonable defaults when requested */
     if (!bytes_per_send)
         bytes_per_send = (1 << 16); /* Depends on OS version: PAGE_SIZE, 2*PAGE_SIZE, or 2^16 */
 
-    if (!(wsa = (struct ws2_transmitfile_async *)alloc_async_io( sizeof(*wsa) + bytes_per_send )))
+    if (!(wsa = (struct ws2_transmitfile_async *)alloc_async_io( sizeof(*wsa) + count * sizeof(*wsa->elements)
+                                                                 + bytes_per_send )))
     {
         release_sock_fd( s, fd );
         WSASetLastError( WSAEFAULT );
         return FALSE;
     }
-    if (buffers)
-        wsa->buffers = *buffers;
-    else
-        memset(&wsa->buffers, 0x0, sizeof(wsa->buffers));
-    wsa->buffer                = (char *)(wsa + 1);
-    wsa->file                  = h;
-    wsa->file_read             = 0;
-    wsa->file_bytes            = file_bytes;
+    wsa->elements              = (struct ws2_transmit_element *)(wsa + 1);
+    wsa->buffer                = (char *)(wsa->elements + count);
+    wsa->count                 = count;
+    wsa->current               = 0;
     wsa->bytes_per_send        = bytes_per_send;
     wsa->flags                 = flags;
-    wsa->offset.QuadPart       = FILE_USE_FILE_POINTER_POSITION;
+    wsa->send_flags            = 0;
+    wsa->use_sendfile          = (_get_fd_type( fd ) == SOCK_STREAM);
     wsa->write.hSocket         = SOCKET2HANDLE(s);
     wsa->write.addr            = NULL;
     wsa->write.addrlen.val     = 0;
@@ -3029,13 +3383,38 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     wsa->write.n_iovecs        = 0;
     wsa->write.first_iovec     = 0;
     wsa->write.user_overlapped = overlapped;
+
+    for (i = 0; i < count; i++)
+    {
+        struct ws2_transmit_element *element = &wsa->elements[i];
+
+        element->eop = (elements[i].dwElFlags & TP_ELEMENT_EOP) != 0;
+        if (elements[i].dwElFlags & TP_ELEMENT_MEMORY)
+        {
+            element->file   = NULL;
+            element->buffer = elements[i].u.pBuffer;
+            element->length = elements[i].cLength;
+            continue;
+        }
+        element->file   = elements[i].u.s.hFile;
+        element->buffer = NULL;
+        element->offset = elements[i].u.s.nFileOffset;
+        if (element->offset.QuadPart == -1)
+            element->offset.QuadPart = FILE_USE_FILE_POINTER_POSITION;
+        if ((status = WS2_transmit_init_file( element, elements[i].cLength )))
+        {
+            HeapFree( GetProcessHeap(), 0, wsa );
+            release_sock_fd( s, fd );
+            WSASetLastError( NtStatusToWSAError(status) );
+            return FALSE;
+        }
+    }
+
     if (overlapped)
     {
         IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)overlapped;
         int status;
 
-        wsa->offset.u.LowPart  = overlapped->u.s.Offset;
-        wsa->offset.u.HighPart = overlapped->u.s.OffsetHigh;
         iosb->u.Status = STATUS_PENDING;
         iosb->Information = 0;
         SERVER_START_REQ( register_async )
@@ -3075,6 +3454,66 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     return (status == STATUS_SUCCESS);
 }
 
+/***********************************************************************
+ *     TransmitFile
+ */
+static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD bytes_per_send,
+                                     LPOVERLAPPED overlapped, LPTRANSMIT_FILE_BUFFERS buffers,
+                                     DWORD flags )
+{
+    TRANSMIT_PACKETS_ELEMENT elements[3];
+    DWORD count = 0;
+
+    TRACE("(%lx, %p, %d, %d, %p, %p, %d)\n", s, h, file_bytes, bytes_per_send, overlapped,
+            buffers, flags );
+
+    if (buffers && buffers->Head)
+    {
+        elements[count].dwElFlags = TP_ELEMENT_MEMORY;
+        elements[count].cLength   = buffers->HeadLength;
+        elements[count].u.pBuffer   = buffers->Head;
+        count++;
+    }
+    if (h)
+    {
+        elements[count].dwElFlags = TP_ELEMENT_FILE;
+        elements[count].cLength   = file_bytes;
+        elements[count].u.s.hFile     = h;
+        if (overlapped)
+        {
+            elements[count].u.s.nFileOffset.u.LowPart  = overlapped->u.s.Offset;
+            elements[count].u.s.nFileOffset.u.HighPart = overlapped->u.s.OffsetHigh;
+        }
+        else elements[count].u.s.nFileOffset.QuadPart = FILE_USE_FILE_POINTER_POSITION;
+        count++;
+    }
+    if (buffers && buffers->Tail)
+    {
+        elements[count].dwElFlags = TP_ELEMENT_MEMORY;
+        elements[count].cLength   = buffers->TailLength;
+        elements[count].u.pBuffer   = buffers->Tail;
+        count++;
+    }
+
+    return WS2_transmit( s, elements, count, bytes_per_send, overlapped, flags );
+}
+
+/***********************************************************************
+ *     TransmitPackets
+ */
+static BOOL WINAPI WS2_TransmitPackets( SOCKET s, LPTRANSMIT_PACKETS_ELEMENT elements, DWORD count,
+                                        DWORD send_size, LPOVERLAPPED overlapped, DWORD flags )
+{
+    TRACE("(%lx, %p, %d, %d, %p, %d)\n", s, elements, count, send_size, overlapped, flags );
+
+    if (count && !elements)
+    {
+        WSASetLastError( WSAEINVAL );
+        return FALSE;
+    }
+    return WS2_transmit( s, elements, count, send_size, overlapped, flags );
+}
+
 /***********************************************************************
  *     GetAcceptExSockaddrs
  */
@@ -3320,6 +3759,7 @@ int WINAPI WS_closesocket(SOCKET s)
         if (fd >= 0)
         {
             release_sock_fd(s, fd);
+            WS2_remove_dgram_reads(SOCKET2HANDLE(s), 0);
             if (CloseHandle(SOCKET2HANDLE(s)))
                 res = 0;
         }
@@ -4786,7 +5226,8 @@ INT WINAPI WSAIoctl(SOCKET s, DWORD code, LPVOID in_buff, DWORD in_size, LPVOID
         }
         else if ( IsEqualGUID(&transmitpackets_guid, in_buff) )
         {
-            FIXME("SIO_GET_EXTENSION_FUNCTION_POINTER: unimplemented TransmitPackets\n");
+            *(LPFN_TRANSMITPACKETS *)out_buff = WS2_TransmitPackets;
+            break;
         }
         else if ( IsEqualGUID(&wsarecvmsg_guid, in_buff) )
         {
@@ -5040,136 +5481,163 @@ int WINAPI WS_recvfrom(SOCKET s, char *buf, INT len, int flags,
         return n;
 }
 
-/* allocate a poll array for the corresponding fd sets */
-static struct pollfd *fd_sets_to_poll( const WS_fd_set *readfds, const WS_fd_set *writefds,
-                                       const WS_fd_set *exceptfds, int *count_ptr )
+/* sockets of the fd sets passed to select(), merged into a single poll array */
+struct select_fds
 {
-    unsigned int i, j = 0, count = 0;
+    unsigned int   nfds;     /* number of distinct sockets in the poll array */
+    unsigned int  *slot;     /* poll array index of each fd set entry */
+    SOCKET        *sockets;  /* socket of each poll array entry */
     struct pollfd *fds;
+};
 
-    if (readfds) count += readfds->fd_count;
-    if (writefds) count += writefds->fd_count;
-    if (exceptfds) count += exceptfds->fd_count;
-    *count_ptr = count;
+struct select_entry
+{
+    SOCKET       s;
+    unsigned int index;
+};
+
+static int compare_select_entries( const void *a, const void *b )
+{
+    const struct select_entry *e1 = a, *e2 = b;
+
+    if (e1->s != e2->s) return e1->s < e2->s ? -1 : 1;
+    return e1->index < e2->index ? -1 : (e1->index > e2->index);
+}
+
+#define SELECT_READ   0x1
+#define SELECT_WRITE  0x2
+#define SELECT_EXCEPT 0x4
+
+/* build the poll array for the corresponding fd sets */
+/* a socket present in several sets (or several times in a set) is only looked up and polled once */
+static BOOL fd_sets_to_poll( const WS_fd_set *readfds, const WS_fd_set *writefds,
+                             const WS_fd_set *exceptfds, struct select_fds *sel )
+{
+    unsigned int i, j = 0, k, nread, nwrite, count;
+    struct select_entry *entries;
+    char *ptr;
+
+    nread  = readfds ? readfds->fd_count : 0;
+    nwrite = writefds ? writefds->fd_count : 0;
+    count  = nread + nwrite + (exceptfds ? exceptfds->fd_count : 0);
     if (!count)
     {
         SetLastError(WSAEINVAL);
-        return NULL;
+        return FALSE;
     }
-    if (!(fds = HeapAlloc( GetProcessHeap(), 0, count * sizeof(fds[0]))))
+    if (!(ptr = HeapAlloc( GetProcessHeap(), 0, count * (sizeof(*sel->fds) + sizeof(*sel->sockets) +
+                                                         sizeof(*sel->slot) + sizeof(*entries)) )))
     {
         SetLastError( ERROR_NOT_ENOUGH_MEMORY );
-        return NULL;
+        return FALSE;
     }
+    sel->nfds    = 0;
+    sel->fds     = (struct pollfd *)ptr;
+    sel->sockets = (SOCKET *)(sel->fds + count);
+    sel->slot    = (unsigned int *)(sel->sockets + count);
+    entries      = (struct select_entry *)(sel->slot + count);
+
     if (readfds)
         for (i = 0; i < readfds->fd_count; i++, j++)
         {
-            fds[j].fd = get_sock_fd( readfds->fd_array[i], FILE_READ_DATA, NULL );
-            if (fds[j].fd == -1) goto failed;
-            fds[j].revents = 0;
-            if (is_fd_bound(fds[j].fd, NULL, NULL) == 1)
-            {
-                fds[j].events = POLLIN;
-            }
-            else
-            {
-                release_sock_fd( readfds->fd_array[i], fds[j].fd );
-                fds[j].fd = -1;
-                fds[j].events = 0;
-            }
+            entries[j].s = readfds->fd_array[i];
+            entries[j].index = j;
         }
     if (writefds)
         for (i = 0; i < writefds->fd_count; i++, j++)
         {
-            fds[j].fd = get_sock_fd( writefds->fd_array[i], FILE_WRITE_DATA, NULL );
-            if (fds[j].fd == -1) goto failed;
-            fds[j].revents = 0;
-            if (is_fd_bound(fds[j].fd, NULL, NULL) == 1 ||
-                _get_fd_type(fds[j].fd) == SOCK_DGRAM)
-            {
-                fds[j].events = POLLOUT;
-            }
-            else
-            {
-                release_sock_fd( writefds->fd_array[i], fds[j].fd );
-                fds[j].fd = -1;
-                fds[j].events = 0;
-            }
+            entries[j].s = writefds->fd_array[i];
+            entries[j].index = j;
         }
     if (exceptfds)
         for (i = 0; i < exceptfds->fd_count; i++, j++)
         {
-            fds[j].fd = get_sock_fd( exceptfds->fd_array[i], 0, NULL );
-            if (fds[j].fd == -1) goto failed;
-            fds[j].revents = 0;
-            if (is_fd_bound(fds[j].fd, NULL, NULL) == 1)
-            {
-                int oob_inlined = 0;
-                socklen_t olen = sizeof(oob_inlined);
+            entries[j].s = exceptfds->fd_array[i];
+            entries[j].index = j;
+        }
+    if (count > 1) qsort( entries, count, sizeof(*entries), compare_select_entries );
 
-                fds[j].events = POLLHUP;
+    for (i = 0; i < count; i = j)
+    {
+        struct pollfd *fd = &sel->fds[sel->nfds];
+        unsigned int sets = 0;
+        DWORD access = 0;
+        int bound;
 
-                /* Check if we need to test for urgent data or not */
-                getsockopt(fds[j].fd, SOL_SOCKET, SO_OOBINLINE, (char*) &oob_inlined, &olen);
-                if (!oob_inlined)
-                    fds[j].events |= POLLPRI;
+        for (j = i; j < count && entries[j].s == entries[i].s; j++)
+        {
+            k = entries[j].index;
+            sel->slot[k] = sel->nfds;
+            if (k < nread)
+            {
+                sets |= SELECT_READ;
+                access |= FILE_READ_DATA;
             }
-            else
+            else if (k < nread + nwrite)
             {
-                release_sock_fd( exceptfds->fd_array[i], fds[j].fd );
-                fds[j].fd = -1;
-                fds[j].events = 0;
+                sets |= SELECT_WRITE;
+                access |= FILE_WRITE_DATA;
             }
+            else sets |= SELECT_EXCEPT;
+        }
+
+        fd->fd = get_sock_fd( entries[i].s, access, NULL );
+        if (fd->fd == -1) goto failed;
+        fd->events = fd->revents = 0;
+        sel->sockets[sel->nfds++] = entries[i].s;
+
+        bound = (is_fd_bound(fd->fd, NULL, NULL) == 1);
+        if ((sets & SELECT_READ) && bound)
+            fd->events |= POLLIN;
+        if ((sets & SELECT_WRITE) && (bound || _get_fd_type(fd->fd) == SOCK_DGRAM))
+            fd->events |= POLLOUT;
+        if ((sets & SELECT_EXCEPT) && bound)
+        {
+            int oob_inlined = 0;
+            socklen_t olen = sizeof(oob_inlined);
+
+            /* POLLHUP is always reported by poll(), here it marks the socket as polled for exceptions */
+            fd->events |= POLLHUP;
+
+            /* Check if we need to test for urgent data or not */
+            getsockopt(fd->fd, SOL_SOCKET, SO_OOBINLINE, (char*) &oob_inlined, &olen);
+            if (!oob_inlined)
+                fd->events |= POLLPRI;
+        }
+        if (!fd->events)
+        {
+            release_sock_fd( entries[i].s, fd->fd );
+            fd->fd = -1;
         }
-    return fds;
+    }
+    return TRUE;
 
 failed:
-    count = j;
-    j = 0;
-    if (readfds)
-        for (i = 0; i < readfds->fd_count && j < count; i++, j++)
-            if (fds[j].fd != -1) release_sock_fd( readfds->fd_array[i], fds[j].fd );
-    if (writefds)
-        for (i = 0; i < writefds->fd_count && j < count; i++, j++)
-            if (fds[j].fd != -1) release_sock_fd( writefds->fd_array[i], fds[j].fd );
-    if (exceptfds)
-        for (i = 0; i < exceptfds->fd_count && j < count; i++, j++)
-            if (fds[j].fd != -1) release_sock_fd( exceptfds->fd_array[i], fds[j].fd );
-    HeapFree( GetProcessHeap(), 0, fds );
-    return NULL;
+    for (i = 0; i < sel->nfds; i++)
+        if (sel->fds[i].fd != -1) release_sock_fd( sel->sockets[i], sel->fds[i].fd );
+    HeapFree( GetProcessHeap(), 0, sel->fds );
+    return FALSE;
 }
 
-/* release the file descriptor obtained in fd_sets_to_poll */
-/* must be called with the original fd_set arrays, before calling get_poll_results */
-static void release_poll_fds( const WS_fd_set *readfds, const WS_fd_set *writefds,
-                              const WS_fd_set *exceptfds, struct pollfd *fds )
+/* release the file descriptors obtained in fd_sets_to_poll */
+/* must be called before calling get_poll_results */
+static void release_poll_fds( struct select_fds *sel )
 {
-    unsigned int i, j = 0;
+    unsigned int i;
 
-    if (readfds)
+    for (i = 0; i < sel->nfds; i++)
     {
-        for (i = 0; i < readfds->fd_count; i++, j++)
-            if (fds[j].fd != -1) release_sock_fd( readfds->fd_array[i], fds[j].fd );
-    }
-    if (writefds)
-    {
-        for (i = 0; i < writefds->fd_count; i++, j++)
-            if (fds[j].fd != -1) release_sock_fd( writefds->fd_array[i], fds[j].fd );
-    }
-    if (exceptfds)
-    {
-        for (i = 0; i < exceptfds->fd_count; i++, j++)
+        struct pollfd *fd = &sel->fds[i];
+
+        if (fd->fd == -1) continue;
+        release_sock_fd( sel->sockets[i], fd->fd );
+        if ((fd->events & POLLHUP) && (fd->revents & POLLHUP))
         {
-            if (fds[j].fd == -1) continue;
-            release_sock_fd( exceptfds->fd_array[i], fds[j].fd );
-            if (fds[j].revents & POLLHUP)
-            {
-                int fd = get_sock_fd( exceptfds->fd_array[i], 0, NULL );
-                if (fd != -1)
-                    release_sock_fd( exceptfds->fd_array[i], fd );
-                else
-                    fds[j].revents = 0;
-            }
+            int unix_fd = get_sock_fd( sel->sockets[i], 0, NULL );
+            if (unix_fd != -1)
+                release_sock_fd( sel->sockets[i], unix_fd );
+            else
+                fd->events &= ~POLLHUP;  /* socket was closed, don't report an exception */
         }
     }
 }
@@ -5203,21 +5671,37 @@ static int do_poll(struct pollfd *pollfds, int count, int timeout)
     return ret;
 }
 
+static inline BOOL poll_read_ready( const struct pollfd *fd )
+{
+    return (fd->events & POLLIN) && (fd->revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL));
+}
+
+static inline BOOL poll_write_ready( const struct pollfd *fd )
+{
+    return (fd->events & POLLOUT) && (fd->revents & POLLOUT) && !(fd->revents & POLLHUP);
+}
+
+static inline BOOL poll_except_ready( const struct pollfd *fd )
+{
+    return (fd->events & POLLHUP) && (fd->revents & (POLLPRI | POLLERR | POLLHUP | POLLNVAL));
+}
+
 /* map the poll results back into the Windows fd sets */
 static int get_poll_results( WS_fd_set *readfds, WS_fd_set *writefds, WS_fd_set *exceptfds,
-                             const struct pollfd *fds )
+                             const struct select_fds *sel )
 {
-    const struct pollfd *poll_writefds  = fds + (readfds ? readfds->fd_count : 0);
-    const struct pollfd *poll_exceptfds = poll_writefds + (writefds ? writefds->fd_count : 0);
+    const unsigned int *read_slot   = sel->slot;
+    const unsigned int *write_slot  = read_slot + (readfds ? readfds->fd_count : 0);
+    const unsigned int *except_slot = write_slot + (writefds ? writefds->fd_count : 0);
     unsigned int i, k, total = 0;
 
     if (readfds)
     {
         for (i = k = 0; i < readfds->fd_count; i++)
         {
-            if (fds[i].revents ||
-                    (readfds == writefds && (poll_writefds[i].revents & POLLOUT) && !(poll_writefds[i].revents & POLLHUP)) ||
-                    (readfds == exceptfds && poll_exceptfds[i].revents))
+            if (poll_read_ready( &sel->fds[read_slot[i]] ) ||
+                    (readfds == writefds && poll_write_ready( &sel->fds[write_slot[i]] )) ||
+                    (readfds == exceptfds && poll_except_ready( &sel->fds[except_slot[i]] )))
                 readfds->fd_array[k++] = readfds->fd_array[i];
         }
         readfds->fd_count = k;
@@ -5227,8 +5711,8 @@ static int get_poll_results( WS_fd_set *readfds, WS_fd_set *writefds, WS_fd_set
     {
         for (i = k = 0; i < writefds->fd_count; i++)
         {
-            if (((poll_writefds[i].revents & POLLOUT) && !(poll_writefds[i].revents & POLLHUP)) ||
-                    (writefds == exceptfds && poll_exceptfds[i].revents))
+            if (poll_write_ready( &sel->fds[write_slot[i]] ) ||
+                    (writefds == exceptfds && poll_except_ready( &sel->fds[except_slot[i]] )))
                 writefds->fd_array[k++] = writefds->fd_array[i];
         }
         writefds->fd_count = k;
@@ -5237,7 +5721,7 @@ static int get_poll_results( WS_fd_set *readfds, WS_fd_set *writefds, WS_fd_set
     if (exceptfds && exceptfds != readfds && exceptfds != writefds)
     {
         for (i = k = 0; i < exceptfds->fd_count; i++)
-            if (poll_exceptfds[i].revents) exceptfds->fd_array[k++] = exceptfds->fd_array[i];
+            if (poll_except_ready( &sel->fds[except_slot[i]] )) exceptfds->fd_array[k++] = exceptfds->fd_array[i];
         exceptfds->fd_count = k;
         total += k;
     }
@@ -5251,24 +5735,24 @@ int WINAPI WS_select(int nfds, WS_fd_set *ws_readfds,
                      WS_fd_set *ws_writefds, WS_fd_set *ws_exceptfds,
                      const struct WS_timeval* ws_timeout)
 {
-    struct pollfd *pollfds;
-    int count, ret, timeout = -1;
+    struct select_fds sel;
+    int ret, timeout = -1;
 
     TRACE("read %p, write %p, excp %p timeout %p\n",
           ws_readfds, ws_writefds, ws_exceptfds, ws_timeout);
 
-    if (!(pollfds = fd_sets_to_poll( ws_readfds, ws_writefds, ws_exceptfds, &count )))
+    if (!fd_sets_to_poll( ws_readfds, ws_writefds, ws_exceptfds, &sel ))
         return SOCKET_ERROR;
 
     if (ws_timeout)
         timeout = (ws_timeout->tv_sec * 1000) + (ws_timeout->tv_usec + 999) / 1000;
 
-    ret = do_poll(pollfds, count, timeout);
-    release_poll_fds( ws_readfds, ws_writefds, ws_exceptfds, pollfds );
+    ret = do_poll(sel.fds, sel.nfds, timeout);
+    release_poll_fds( &sel );
 
     if (ret == -1) SetLastError(wsaErrno());
-    else ret = get_poll_results( ws_readfds, ws_writefds, ws_exceptfds, pollfds );
-    HeapFree( GetProcessHeap(), 0, pollfds );
+    else ret = get_poll_results( ws_readfds, ws_writefds, ws_exceptfds, &sel );
+    HeapFree( GetProcessHeap(), 0, sel.fds );
     return ret;
 }
 
@@ -7492,6 +7976,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     wsa->addr        = lpFrom;
     wsa->addrlen.ptr = lpFromlen;
     wsa->control     = lpControlBuffer;
+    wsa->batched     = FALSE;
     wsa->n_iovecs    = dwBufferCount;
     wsa->first_iovec = 0;
     for (i = 0; i < dwBufferCount; i++)
@@ -7533,6 +8018,11 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
             wsa->user_overlapped = lpOverlapped;
             wsa->completion_func = lpCompletionRoutine;
+#ifdef HAVE_RECVMMSG
+            /* plain datagram reads can be received together with the other ones of the socket */
+            if (n == -1 && !wsa->flags && !wsa->control && _get_fd_type( fd ) == SOCK_DGRAM)
+                wsa->batched = TRUE;
+#endif
             release_sock_fd( s, fd );
 
             if (n == -1)
@@ -7540,6 +8030,14 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                 iosb->u.Status = STATUS_PENDING;
                 iosb->Information = 0;
 
+                if (wsa->batched)
+                {
+                    /* don't let other reads receive data for this one before the server knows about it */
+                    EnterCriticalSection( &dgram_read_section );
+                    wsa->thread = GetCurrentThreadId();
+                    wsa->batch_done = FALSE;
+                    list_add_tail( &pending_dgram_reads, &wsa->entry );
+                }
                 SERVER_START_REQ( register_async )
                 {
                     req->type           = ASYNC_TYPE_READ;
@@ -7553,6 +8051,11 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                 }
                 SERVER_END_REQ;
 
+                if (wsa->batched)
+                {
+                    if (err != STATUS_PENDING) list_remove( &wsa->entry );
+                    LeaveCriticalSection( &dgram_read_section );
+                }
                 if (err != STATUS_PENDING) HeapFree( GetProcessHeap(), 0, wsa );
                 SetLastError(NtStatusToWSAError( err ));
                 return SOCKET_ERROR;
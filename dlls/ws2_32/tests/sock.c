@@ -6488,6 +6488,137 @@ end:
         WSACloseEvent(ov.hEvent);
 }
 
+static void test_WSARecvFrom_overlapped(void)
+{
+    static const int count = 4;
+    SOCKET src, dest;
+    struct sockaddr_in addr, src_addr, from[4];
+    WSAOVERLAPPED ov[4];
+    HANDLE events[4];
+    char bufs[4][16], msg[16];
+    WSABUF wsabufs[4];
+    DWORD flags, bytes, dwret;
+    int i, iret, len, fromlen[4];
+    BOOL bret;
+
+    src = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    dest = WSASocketA(AF_INET, SOCK_DGRAM, IPPROTO_UDP, NULL, 0, WSA_FLAG_OVERLAPPED);
+    if (src == INVALID_SOCKET || dest == INVALID_SOCKET)
+    {
+        skip("failed to create sockets\n");
+        goto end;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    iret = bind(dest, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!iret, "bind failed, error %d\n", WSAGetLastError());
+    iret = bind(src, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!iret, "bind failed, error %d\n", WSAGetLastError());
+    len = sizeof(addr);
+    iret = getsockname(dest, (struct sockaddr *)&addr, &len);
+    ok(!iret, "getsockname failed, error %d\n", WSAGetLastError());
+    len = sizeof(src_addr);
+    iret = getsockname(src, (struct sockaddr *)&src_addr, &len);
+    ok(!iret, "getsockname failed, error %d\n", WSAGetLastError());
+
+    /* queue several reads, they must complete in order with one datagram each */
+    for (i = 0; i < count; i++)
+    {
+        memset(&ov[i], 0, sizeof(ov[i]));
+        ov[i].hEvent = events[i] = CreateEventA(NULL, TRUE, FALSE, NULL);
+        wsabufs[i].len = sizeof(bufs[i]);
+        wsabufs[i].buf = bufs[i];
+        fromlen[i] = sizeof(from[i]);
+        flags = 0;
+        iret = WSARecvFrom(dest, &wsabufs[i], 1, NULL, &flags, (struct sockaddr *)&from[i], &fromlen[i],
+                           &ov[i], NULL);
+        ok(iret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING,
+           "WSARecvFrom returned %d, error %d\n", iret, WSAGetLastError());
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        sprintf(msg, "datagram %d", i);
+        iret = sendto(src, msg, strlen(msg) + 1, 0, (struct sockaddr *)&addr, sizeof(addr));
+        ok(iret == strlen(msg) + 1, "sendto returned %d, error %d\n", iret, WSAGetLastError());
+    }
+
+    dwret = WaitForMultipleObjects(count, events, TRUE, 1000);
+    ok(dwret == WAIT_OBJECT_0, "Waiting for the reads failed with %d + errno %d\n", dwret, GetLastError());
+
+    for (i = 0; i < count; i++)
+    {
+        sprintf(msg, "datagram %d", i);
+        bret = WSAGetOverlappedResult(dest, &ov[i], &bytes, FALSE, &flags);
+        ok(bret, "WSAGetOverlappedResult failed, error %d\n", WSAGetLastError());
+        ok(bytes == strlen(msg) + 1, "read %d: got %d bytes\n", i, bytes);
+        ok(!strcmp(bufs[i], msg), "read %d: got %s\n", i, bufs[i]);
+        ok(fromlen[i] == sizeof(from[i]), "read %d: got address length %d\n", i, fromlen[i]);
+        ok(from[i].sin_port == src_addr.sin_port, "read %d: got port %d\n", i, ntohs(from[i].sin_port));
+    }
+
+    /* reads still queued on a closed socket must not receive the data of a socket reusing its handle */
+    for (i = 0; i < count; i++)
+    {
+        ResetEvent(events[i]);
+        memset(bufs[i], 0, sizeof(bufs[i]));
+        flags = 0;
+        iret = WSARecv(dest, &wsabufs[i], 1, NULL, &flags, &ov[i], NULL);
+        ok(iret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING,
+           "WSARecv returned %d, error %d\n", iret, WSAGetLastError());
+    }
+    closesocket(dest);
+    WaitForMultipleObjects(count, events, TRUE, 1000);
+
+    dest = WSASocketA(AF_INET, SOCK_DGRAM, IPPROTO_UDP, NULL, 0, WSA_FLAG_OVERLAPPED);
+    ok(dest != INVALID_SOCKET, "WSASocketA failed, error %d\n", WSAGetLastError());
+    addr.sin_port = 0;
+    iret = bind(dest, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!iret, "bind failed, error %d\n", WSAGetLastError());
+    len = sizeof(addr);
+    iret = getsockname(dest, (struct sockaddr *)&addr, &len);
+    ok(!iret, "getsockname failed, error %d\n", WSAGetLastError());
+
+    for (i = 0; i < 2; i++)
+    {
+        ResetEvent(events[i]);
+        memset(bufs[i], 0, sizeof(bufs[i]));
+        flags = 0;
+        iret = WSARecv(dest, &wsabufs[i], 1, NULL, &flags, &ov[i], NULL);
+        ok(iret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING,
+           "WSARecv returned %d, error %d\n", iret, WSAGetLastError());
+    }
+    for (i = 0; i < 2; i++)
+    {
+        sprintf(msg, "datagram %d", i);
+        iret = sendto(src, msg, strlen(msg) + 1, 0, (struct sockaddr *)&addr, sizeof(addr));
+        ok(iret == strlen(msg) + 1, "sendto returned %d, error %d\n", iret, WSAGetLastError());
+    }
+
+    dwret = WaitForMultipleObjects(2, events, TRUE, 1000);
+    ok(dwret == WAIT_OBJECT_0, "Waiting for the reads failed with %d + errno %d\n", dwret, GetLastError());
+
+    for (i = 0; i < 2; i++)
+    {
+        sprintf(msg, "datagram %d", i);
+        bret = WSAGetOverlappedResult(dest, &ov[i], &bytes, FALSE, &flags);
+        ok(bret, "WSAGetOverlappedResult failed, error %d\n", WSAGetLastError());
+        ok(bytes == strlen(msg) + 1, "read %d: got %d bytes\n", i, bytes);
+        ok(!strcmp(bufs[i], msg), "read %d: got %s\n", i, bufs[i]);
+    }
+
+    for (i = 0; i < count; i++)
+        CloseHandle(events[i]);
+
+end:
+    if (src != INVALID_SOCKET)
+        closesocket(src);
+    if (dest != INVALID_SOCKET)
+        closesocket(dest);
+}
+
 #define POLL_CLEAR() ix = 0
 #define POLL_SET(s, ev) {fds[ix].fd = s; fds[ix++].events = ev;}
 #define POLL_ISSET(s, rev) poll_isset(fds, ix, s, rev)
@@ -7810,6 +7941,101 @@ end:
         closesocket(connector2);
 }
 
+static void test_AcceptEx_multiple(void)
+{
+    GUID acceptExGuid = WSAID_ACCEPTEX, getAcceptExGuid = WSAID_GETACCEPTEXSOCKADDRS;
+    const DWORD addr_size = sizeof(struct sockaddr_in) + 16;
+    LPFN_ACCEPTEX pAcceptEx = NULL;
+    LPFN_GETACCEPTEXSOCKADDRS pGetAcceptExSockaddrs = NULL;
+    SOCKET listener, acceptors[4], connectors[4];
+    struct sockaddr_in bindAddress, peerAddresses[4], *localAddress, *remoteAddress;
+    OVERLAPPED overlapped[4];
+    HANDLE events[4];
+    char buffers[4][2 * (sizeof(struct sockaddr_in) + 16)];
+    int iret, i, j, socklen, localSize, remoteSize, found;
+    DWORD bytesReturned, dwret;
+    BOOL bret;
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    ok(listener != INVALID_SOCKET, "failed to create listener socket, error %d\n", WSAGetLastError());
+
+    memset(&bindAddress, 0, sizeof(bindAddress));
+    bindAddress.sin_family = AF_INET;
+    bindAddress.sin_addr.s_addr = inet_addr("127.0.0.1");
+    iret = bind(listener, (struct sockaddr *)&bindAddress, sizeof(bindAddress));
+    ok(!iret, "failed to bind, error %d\n", WSAGetLastError());
+    socklen = sizeof(bindAddress);
+    iret = getsockname(listener, (struct sockaddr *)&bindAddress, &socklen);
+    ok(!iret, "failed to get address, error %d\n", WSAGetLastError());
+    iret = listen(listener, 5);
+    ok(!iret, "failed to listen, error %d\n", WSAGetLastError());
+
+    iret = WSAIoctl(listener, SIO_GET_EXTENSION_FUNCTION_POINTER, &acceptExGuid, sizeof(acceptExGuid),
+        &pAcceptEx, sizeof(pAcceptEx), &bytesReturned, NULL, NULL);
+    ok(!iret, "failed to get AcceptEx, error %d\n", WSAGetLastError());
+    iret = WSAIoctl(listener, SIO_GET_EXTENSION_FUNCTION_POINTER, &getAcceptExGuid, sizeof(getAcceptExGuid),
+        &pGetAcceptExSockaddrs, sizeof(pGetAcceptExSockaddrs), &bytesReturned, NULL, NULL);
+    ok(!iret, "failed to get GetAcceptExSockaddrs, error %d\n", WSAGetLastError());
+
+    /* queue several accepts, then connect all clients at once */
+    for (i = 0; i < 4; i++)
+    {
+        acceptors[i] = socket(AF_INET, SOCK_STREAM, 0);
+        ok(acceptors[i] != INVALID_SOCKET, "failed to create socket, error %d\n", WSAGetLastError());
+        memset(&overlapped[i], 0, sizeof(overlapped[i]));
+        overlapped[i].hEvent = events[i] = CreateEventA(NULL, TRUE, FALSE, NULL);
+        bret = pAcceptEx(listener, acceptors[i], buffers[i], 0, addr_size, addr_size,
+                         &bytesReturned, &overlapped[i]);
+        ok(!bret && WSAGetLastError() == ERROR_IO_PENDING, "AcceptEx returned %d, error %d\n",
+           bret, WSAGetLastError());
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        connectors[i] = socket(AF_INET, SOCK_STREAM, 0);
+        ok(connectors[i] != INVALID_SOCKET, "failed to create socket, error %d\n", WSAGetLastError());
+        iret = connect(connectors[i], (struct sockaddr *)&bindAddress, sizeof(bindAddress));
+        ok(!iret, "failed to connect, error %d\n", WSAGetLastError());
+        socklen = sizeof(peerAddresses[i]);
+        iret = getsockname(connectors[i], (struct sockaddr *)&peerAddresses[i], &socklen);
+        ok(!iret, "failed to get address, error %d\n", WSAGetLastError());
+    }
+
+    dwret = WaitForMultipleObjects(4, events, TRUE, 2000);
+    ok(dwret < WAIT_OBJECT_0 + 4, "waiting for the accepts failed: %u\n", dwret);
+
+    found = 0;
+    for (i = 0; i < 4; i++)
+    {
+        bret = GetOverlappedResult((HANDLE)listener, &overlapped[i], &bytesReturned, FALSE);
+        ok(bret, "accept %d failed, error %d\n", i, GetLastError());
+        if (!bret) continue;
+
+        pGetAcceptExSockaddrs(buffers[i], 0, addr_size, addr_size,
+                              (struct sockaddr **)&localAddress, &localSize,
+                              (struct sockaddr **)&remoteAddress, &remoteSize);
+        ok(localAddress->sin_addr.s_addr == bindAddress.sin_addr.s_addr &&
+           localAddress->sin_port == bindAddress.sin_port,
+           "accept %d: got local address %s:%d\n", i, inet_ntoa(localAddress->sin_addr),
+           ntohs(localAddress->sin_port));
+        for (j = 0; j < 4; j++)
+        {
+            if (remoteAddress->sin_addr.s_addr == peerAddresses[j].sin_addr.s_addr &&
+                remoteAddress->sin_port == peerAddresses[j].sin_port)
+                found |= 1 << j;
+        }
+    }
+    ok(found == 0xf, "not all clients were accepted, got mask %#x\n", found);
+
+    for (i = 0; i < 4; i++)
+    {
+        closesocket(connectors[i]);
+        closesocket(acceptors[i]);
+        CloseHandle(events[i]);
+    }
+    closesocket(listener);
+}
+
 #define compare_file(h,s,o) compare_file2(h,s,o,__FILE__,__LINE__)
 
 static void compare_file2(HANDLE handle, SOCKET sock, int offset, const char *file, int line)
@@ -8059,6 +8285,117 @@ cleanup:
     closesocket(server);
 }
 
+static void test_TransmitPackets(void)
+{
+    static const char header_msg[] = "hello world";
+    static const char footer_msg[] = "goodbye!!!";
+    GUID transmitPacketsGuid = WSAID_TRANSMITPACKETS;
+    LPFN_TRANSMITPACKETS pTransmitPackets = NULL;
+    const DWORD file_size = 1024 * 1024;
+    TRANSMIT_PACKETS_ELEMENT elements[3];
+    char path[MAX_PATH], filename[MAX_PATH];
+    HANDLE file = INVALID_HANDLE_VALUE;
+    DWORD num_bytes, total_sent, i, err;
+    SOCKET client, dest;
+    WSAOVERLAPPED ov;
+    char *data, *buf;
+    int iret, received;
+    BOOL bret;
+
+    memset( &ov, 0, sizeof(ov) );
+    data = HeapAlloc( GetProcessHeap(), 0, file_size );
+    buf = HeapAlloc( GetProcessHeap(), 0, file_size + sizeof(header_msg) + sizeof(footer_msg) );
+    for (i = 0; i < file_size; i++) data[i] = i % 251;
+
+    if (tcp_socketpair(&client, &dest))
+    {
+        skip("failed to create sockets\n");
+        goto cleanup;
+    }
+    iret = WSAIoctl(client, SIO_GET_EXTENSION_FUNCTION_POINTER, &transmitPacketsGuid, sizeof(transmitPacketsGuid),
+                    &pTransmitPackets, sizeof(pTransmitPackets), &num_bytes, NULL, NULL);
+    if (iret)
+    {
+        skip("WSAIoctl failed to get TransmitPackets with ret %d + errno %d\n", iret, WSAGetLastError());
+        goto cleanup;
+    }
+
+    GetTempPathA(MAX_PATH, path);
+    GetTempFileNameA(path, "wst", 0, filename);
+    file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                       FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        skip("Unable to create a file to transmit.\n");
+        goto cleanup;
+    }
+    bret = WriteFile(file, data, file_size, &num_bytes, NULL);
+    ok(bret && num_bytes == file_size, "WriteFile failed, error %d\n", GetLastError());
+
+    /* Test TransmitPackets with an invalid element */
+    elements[0].dwElFlags = 0;
+    elements[0].cLength = sizeof(header_msg);
+    elements[0].pBuffer = (void *)header_msg;
+    bret = pTransmitPackets(client, elements, 1, 0, NULL, 0);
+    err = WSAGetLastError();
+    ok(!bret, "TransmitPackets succeeded unexpectedly.\n");
+    ok(err == WSAEINVAL, "TransmitPackets triggered unexpected errno (%d != %d)\n", err, WSAEINVAL);
+
+    /* Test TransmitPackets with memory and part of a file */
+    elements[0].dwElFlags = TP_ELEMENT_MEMORY;
+    elements[1].dwElFlags = TP_ELEMENT_FILE;
+    elements[1].cLength = 100;
+    elements[1].nFileOffset.QuadPart = 10;
+    elements[1].hFile = file;
+    elements[2].dwElFlags = TP_ELEMENT_MEMORY;
+    elements[2].cLength = sizeof(footer_msg);
+    elements[2].pBuffer = (void *)footer_msg;
+    bret = pTransmitPackets(client, elements, 3, 0, NULL, 0);
+    ok(bret, "TransmitPackets failed, error %d\n", WSAGetLastError());
+    for (received = 0; received < sizeof(header_msg) + 100 + sizeof(footer_msg); received += iret)
+    {
+        iret = recv(dest, buf + received, sizeof(header_msg) + 100 + sizeof(footer_msg) - received, 0);
+        ok(iret > 0, "recv failed, error %d\n", WSAGetLastError());
+        if (iret <= 0) break;
+    }
+    ok(!memcmp(buf, header_msg, sizeof(header_msg)), "TransmitPackets header buffer did not match!\n");
+    ok(!memcmp(buf + sizeof(header_msg), data + 10, 100), "TransmitPackets file data did not match!\n");
+    ok(!memcmp(buf + sizeof(header_msg) + 100, footer_msg, sizeof(footer_msg)),
+       "TransmitPackets footer buffer did not match!\n");
+
+    /* Test overlapped TransmitPackets with a whole file, large enough to fill the socket buffers */
+    ov.hEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    elements[1].cLength = 0;
+    elements[1].nFileOffset.QuadPart = 0;
+    bret = pTransmitPackets(client, elements, 3, 0, &ov, 0);
+    err = WSAGetLastError();
+    ok(!bret, "TransmitPackets succeeded unexpectedly.\n");
+    ok(err == ERROR_IO_PENDING, "TransmitPackets triggered unexpected errno (%d != %d)\n", err, ERROR_IO_PENDING);
+    for (received = 0; received < sizeof(header_msg) + file_size + sizeof(footer_msg); received += iret)
+    {
+        iret = recv(dest, buf + received, sizeof(header_msg) + file_size + sizeof(footer_msg) - received, 0);
+        ok(iret > 0, "recv failed, error %d\n", WSAGetLastError());
+        if (iret <= 0) break;
+    }
+    iret = WaitForSingleObject(ov.hEvent, 2000);
+    ok(iret == WAIT_OBJECT_0, "Overlapped TransmitPackets failed.\n");
+    WSAGetOverlappedResult(client, &ov, &total_sent, FALSE, NULL);
+    ok(total_sent == sizeof(header_msg) + file_size + sizeof(footer_msg),
+       "Overlapped TransmitPackets sent an unexpected number of bytes (%d).\n", total_sent);
+    ok(!memcmp(buf, header_msg, sizeof(header_msg)), "TransmitPackets header buffer did not match!\n");
+    ok(!memcmp(buf + sizeof(header_msg), data, file_size), "TransmitPackets file data did not match!\n");
+    ok(!memcmp(buf + sizeof(header_msg) + file_size, footer_msg, sizeof(footer_msg)),
+       "TransmitPackets footer buffer did not match!\n");
+
+cleanup:
+    CloseHandle(file);
+    CloseHandle(ov.hEvent);
+    closesocket(client);
+    closesocket(dest);
+    HeapFree(GetProcessHeap(), 0, buf);
+    HeapFree(GetProcessHeap(), 0, data);
+}
+
 static void test_getpeername(void)
 {
     SOCKET sock;
@@ -9577,6 +9914,7 @@ START_TEST( sock )
     test_WSASendMsg();
     test_WSASendTo();
     test_WSARecv();
+    test_WSARecvFrom_overlapped();
     test_WSAPoll();
 
     test_events(0);
@@ -9584,9 +9922,11 @@ START_TEST( sock )
 
     test_ipv6only();
     test_TransmitFile();
+    test_TransmitPackets();
     test_GetAddrInfoW();
     test_getaddrinfo();
     test_AcceptEx();
+    test_AcceptEx_multiple();
     test_ConnectEx();
 
     test_sioRoutingInterfaceQuery();
@@ -519,6 +519,11 @@ typedef struct tagMEMORYSTATUSEX {
 } MEMORYSTATUSEX, *LPMEMORYSTATUSEX;
 #include <poppack.h>
 
+typedef struct _WIN32_MEMORY_RANGE_ENTRY {
+    PVOID  VirtualAddress;
+    SIZE_T NumberOfBytes;
+} WIN32_MEMORY_RANGE_ENTRY, *PWIN32_MEMORY_RANGE_ENTRY;
+
 typedef enum _MEMORY_RESOURCE_NOTIFICATION_TYPE {
     LowMemoryResourceNotification,
     HighMemoryResourceNotification
@@ -2035,6 +2040,7 @@ WINBASEAPI DWORD       WINAPI GetFullPathNameW(LPCWSTR,DWORD,LPWSTR,LPWSTR*);
 WINBASEAPI BOOL        WINAPI GetHandleInformation(HANDLE,LPDWORD);
 WINADVAPI  BOOL        WINAPI GetKernelObjectSecurity(HANDLE,SECURITY_INFORMATION,PSECURITY_DESCRIPTOR,DWORD,LPDWORD);
 WINADVAPI  DWORD       WINAPI GetLengthSid(PSID);
+WINBASEAPI SIZE_T      WINAPI GetLargePageMinimum(void);
 WINBASEAPI VOID        WINAPI GetLocalTime(LPSYSTEMTIME);
 WINBASEAPI DWORD       WINAPI GetLogicalDrives(void);
 WINBASEAPI UINT        WINAPI GetLogicalDriveStringsA(UINT,LPSTR);
@@ -2372,6 +2378,7 @@ WINBASEAPI VOID        WINAPI OutputDebugStringW(LPCWSTR);
 #define                       OutputDebugString WINELIB_NAME_AW(OutputDebugString)
 WINBASEAPI BOOL        WINAPI PeekNamedPipe(HANDLE,PVOID,DWORD,PDWORD,PDWORD,PDWORD);
 WINBASEAPI BOOL        WINAPI PostQueuedCompletionStatus(HANDLE,DWORD,ULONG_PTR,LPOVERLAPPED);
+WINBASEAPI BOOL        WINAPI PrefetchVirtualMemory(HANDLE,ULONG_PTR,PWIN32_MEMORY_RANGE_ENTRY,ULONG);
 WINBASEAPI DWORD       WINAPI PrepareTape(HANDLE,DWORD,BOOL);
 WINBASEAPI BOOL        WINAPI ProcessIdToSessionId(DWORD,DWORD*);
 WINADVAPI  BOOL        WINAPI PrivilegeCheck(HANDLE,PPRIVILEGE_SET,LPBOOL);
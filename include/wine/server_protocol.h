@@ -1545,6 +1545,9 @@ struct accept_into_socket_request
 struct accept_into_socket_reply
 {
     struct reply_header __header;
+    data_size_t  local_len;
+    /* VARARG(addrs,bytes); */
+    char __pad_12[4];
 };
 
 
@@ -1627,6 +1630,19 @@ struct set_socket_deferred_reply
 };
 
 
+struct wake_socket_reads_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+    /* VARARG(iosbs,uints64); */
+};
+struct wake_socket_reads_reply
+{
+    struct reply_header __header;
+    /* VARARG(woken,uints64); */
+};
+
+
 struct alloc_console_request
 {
     struct request_header __header;
@@ -2125,6 +2141,7 @@ struct create_mapping_reply
 #define VPROT_SYSTEM     0x0200
 #define VPROT_VALLOC     0x0400
 #define VPROT_NOEXEC     0x0800
+#define VPROT_LARGE_PAGES 0x1000
 
 
 
@@ -5412,6 +5429,7 @@ enum request
     REQ_get_socket_info,
     REQ_enable_socket_event,
     REQ_set_socket_deferred,
+    REQ_wake_socket_reads,
     REQ_alloc_console,
     REQ_free_console,
     REQ_get_console_renderer_events,
@@ -5690,6 +5708,7 @@ union generic_request
     struct get_socket_info_request get_socket_info_request;
     struct enable_socket_event_request enable_socket_event_request;
     struct set_socket_deferred_request set_socket_deferred_request;
+    struct wake_socket_reads_request wake_socket_reads_request;
     struct alloc_console_request alloc_console_request;
     struct free_console_request free_console_request;
     struct get_console_renderer_events_request get_console_renderer_events_request;
@@ -5966,6 +5985,7 @@ union generic_reply
     struct get_socket_info_reply get_socket_info_reply;
     struct enable_socket_event_reply enable_socket_event_reply;
     struct set_socket_deferred_reply set_socket_deferred_reply;
+    struct wake_socket_reads_reply wake_socket_reads_reply;
     struct alloc_console_reply alloc_console_reply;
     struct free_console_reply free_console_reply;
     struct get_console_renderer_events_reply get_console_renderer_events_reply;
@@ -6184,6 +6204,6 @@ union generic_reply
     struct terminate_job_reply terminate_job_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 502
+#define SERVER_PROTOCOL_VERSION 506
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
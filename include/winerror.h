@@ -2667,6 +2667,7 @@ static inline HRESULT HRESULT_FROM_WIN32(unsigned int x)
 #define SEC_E_CONTEXT_EXPIRED                              _HRESULT_TYPEDEF_(0x80090317)
 #define SEC_E_INCOMPLETE_MESSAGE                           _HRESULT_TYPEDEF_(0x80090318)
 #define SEC_E_INCOMPLETE_CREDENTIALS                       _HRESULT_TYPEDEF_(0x80090320)
+#define SEC_I_RENEGOTIATE                                  _HRESULT_TYPEDEF_(0x00090321)
 #define SEC_E_BUFFER_TOO_SMALL                             _HRESULT_TYPEDEF_(0x80090321)
 #define SEC_E_WRONG_PRINCIPAL                              _HRESULT_TYPEDEF_(0x80090322)
 #define SEC_E_TIME_SKEW                                    _HRESULT_TYPEDEF_(0x80090324)
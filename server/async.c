@@ -163,7 +163,7 @@ void async_terminate( struct async *async, unsigned int status )
     if (async->status != STATUS_PENDING)
     {
         /* already terminated, just update status */
-        async->status = status;
+        if (status != STATUS_ALERTED) async->status = status;
         return;
     }
 
@@ -365,6 +365,22 @@ int async_wake_up_by( struct async_queue *queue, struct process *process,
     return woken;
 }
 
+/* alert the first async of the queue that is still waiting, even if others are already alerted */
+int async_wake_up_next_waiting( struct async_queue *queue )
+{
+    struct async *async;
+
+    if (!queue) return 0;
+
+    LIST_FOR_EACH_ENTRY( async, &queue->queue, struct async, queue_entry )
+    {
+        if (async->status != STATUS_PENDING) continue;
+        async_terminate( async, STATUS_ALERTED );
+        return 1;
+    }
+    return 0;
+}
+
 /* wake up async operations on the queue */
 void async_wake_up( struct async_queue *queue, unsigned int status )
 {
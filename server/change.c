@@ -93,6 +93,7 @@ struct inotify_event {
 #define IN_CREATE        0x00000100
 #define IN_DELETE        0x00000200
 #define IN_DELETE_SELF   0x00000400
+#define IN_Q_OVERFLOW    0x00004000
 
 #define IN_ISDIR         0x40000000
 
@@ -121,6 +122,9 @@ static void free_inode( struct inode *inode );
 
 static struct fd *inotify_fd;
 
+/* maximum number of records queued on a directory before asking for a rescan */
+#define MAX_CHANGE_RECORDS 8192
+
 struct change_record {
     struct list entry;
     unsigned int cookie;
@@ -139,6 +143,8 @@ struct dir
     int            want_data; /* return change data */
     int            subtree;  /* do we want to watch subdirectories? */
     struct list    change_records;   /* data for the change */
+    unsigned int   record_count;     /* number of queued change records */
+    int            overflow; /* change records were dropped */
     struct list    in_entry; /* entry in the inode dirs list */
     struct inode  *inode;    /* inode of the associated directory */
 };
@@ -401,6 +407,7 @@ static void dir_destroy( struct object *obj )
     }
 
     while ((record = get_first_change_record( dir ))) free( record );
+    dir->record_count = 0;
 
     release_object( dir->fd );
 
@@ -617,6 +624,17 @@ static int inotify_get_poll_events( struct fd *fd )
     return POLLIN;
 }
 
+/* drop all pending records, the client will be told to rescan the directory */
+static void dir_set_overflow( struct dir *dir )
+{
+    struct change_record *record;
+
+    while ((record = get_first_change_record( dir ))) free( record );
+    dir->record_count = 0;
+    dir->overflow = 1;
+    fd_async_wake_up( dir->fd, ASYNC_TYPE_WAIT, STATUS_ALERTED );
+}
+
 static void inotify_do_change_notify( struct dir *dir, unsigned int action,
                                       unsigned int cookie, const char *relpath )
 {
@@ -627,6 +645,25 @@ static void inotify_do_change_notify( struct dir *dir, unsigned int action,
     if (dir->want_data)
     {
         size_t len = strlen(relpath);
+        struct list *tail;
+
+        if (dir->overflow) return;
+
+        /* coalesce repeated modifications of the same file */
+        if (action == FILE_ACTION_MODIFIED && (tail = list_tail( &dir->change_records )))
+        {
+            record = LIST_ENTRY( tail, struct change_record, entry );
+            if (record->event.action == action && record->event.len == len &&
+                !memcmp( record->event.name, relpath, len ))
+                return;
+        }
+
+        if (dir->record_count >= MAX_CHANGE_RECORDS)
+        {
+            dir_set_overflow( dir );
+            return;
+        }
+
         record = malloc( offsetof(struct change_record, event.name[len]) );
         if (!record)
             return;
@@ -637,6 +674,7 @@ static void inotify_do_change_notify( struct dir *dir, unsigned int action,
         record->event.len = len;
 
         list_add_tail( &dir->change_records, &record->entry );
+        if (dir->record_count++) return;  /* already woken up */
     }
 
     fd_async_wake_up( dir->fd, ASYNC_TYPE_WAIT, STATUS_ALERTED );
@@ -839,10 +877,24 @@ static void inotify_notify_all( struct inotify_event *ie )
     }
 }
 
+/* the kernel event queue overflowed, all watches may have missed events */
+static void inotify_notify_overflow(void)
+{
+    struct dir *dir;
+
+    LIST_FOR_EACH_ENTRY( dir, &change_list, struct dir, entry )
+    {
+        if (dir->want_data)
+            dir_set_overflow( dir );
+        else
+            fd_async_wake_up( dir->fd, ASYNC_TYPE_WAIT, STATUS_ALERTED );
+    }
+}
+
 static void inotify_poll_event( struct fd *fd, int event )
 {
     int r, ofs, unix_fd;
-    char buffer[0x1000];
+    char buffer[0x10000];
     struct inotify_event *ie;
 
     unix_fd = get_unix_fd( fd );
@@ -856,6 +908,12 @@ static void inotify_poll_event( struct fd *fd, int event )
     for( ofs = 0; ofs < r - offsetof(struct inotify_event, name); )
     {
         ie = (struct inotify_event*) &buffer[ofs];
+        if (ie->mask & IN_Q_OVERFLOW)
+        {
+            inotify_notify_overflow();
+            ofs += offsetof( struct inotify_event, name[ie->len] );
+            continue;
+        }
         if (!ie->len)
             break;
         ofs += offsetof( struct inotify_event, name[ie->len] );
@@ -1096,6 +1154,8 @@ struct object *create_dir_obj( struct fd *fd, unsigned int access, mode_t mode )
         return NULL;
 
     list_init( &dir->change_records );
+    dir->record_count = 0;
+    dir->overflow = 0;
     dir->filter = 0;
     dir->notified = 0;
     dir->want_data = 0;
@@ -1141,7 +1201,7 @@ DECL_HANDLER(read_directory_changes)
     }
 
     /* if there's already a change in the queue, send it */
-    if (!list_empty( &dir->change_records ))
+    if (!list_empty( &dir->change_records ) || dir->overflow)
         fd_async_wake_up( dir->fd, ASYNC_TYPE_WAIT, STATUS_ALERTED );
 
     /* setup the real notification */
@@ -1169,6 +1229,14 @@ DECL_HANDLER(read_change)
 
     list_init( &events );
     list_move_tail( &events, &dir->change_records );
+    dir->record_count = 0;
+    if (dir->overflow)
+    {
+        dir->overflow = 0;
+        release_object( dir );
+        set_error( STATUS_NOTIFY_ENUM_DIR );
+        return;
+    }
     release_object( dir );
 
     if (list_empty( &events ))
@@ -339,6 +339,18 @@ static const struct object_ops file_lock_ops =
 
 static file_pos_t max_unix_offset = OFF_T_MAX;
 
+#if defined(__linux__) && !defined(F_OFD_SETLK)
+#define F_OFD_GETLK  36
+#define F_OFD_SETLK  37
+#endif
+
+#ifdef F_OFD_SETLK
+/* open file description locks belong to the fd instead of the server process */
+static int use_ofd_locks;
+#else
+static const int use_ofd_locks = 0;
+#endif
+
 #define DUMP_LONG_LONG(val) do { \
     if (sizeof(val) > sizeof(unsigned long) && (val) > ~0UL) \
         fprintf( stderr, "%lx%08lx", (unsigned long)((unsigned long long)(val) >> 32), (unsigned long)(val) ); \
@@ -1147,12 +1159,40 @@ static int file_lock_signaled( struct object *obj, struct wait_queue_entry *entr
     return !lock->process;
 }
 
+/* check once whether the kernel supports open file description locks */
+void init_file_locks(void)
+{
+#ifdef F_OFD_SETLK
+    struct flock fl;
+    FILE *file;
+
+    if (!(file = tmpfile())) return;
+    fl.l_type   = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start  = 0;
+    fl.l_len    = 0;
+    fl.l_pid    = 0;
+    use_ofd_locks = (fcntl( fileno( file ), F_OFD_GETLK, &fl ) != -1);
+    fclose( file );
+    if (debug_level) fprintf( stderr, "wineserver: %susing open file description locks\n",
+                              use_ofd_locks ? "" : "not " );
+#endif
+}
+
 /* set (or remove) a Unix lock if possible for the given range */
 static int set_unix_lock( struct fd *fd, file_pos_t start, file_pos_t end, int type )
 {
     struct flock fl;
+    int set_cmd = F_SETLK, get_cmd = F_GETLK;
 
     if (!fd->fs_locks) return 1;  /* no fs locks possible for this fd */
+#ifdef F_OFD_SETLK
+    if (use_ofd_locks)
+    {
+        set_cmd = F_OFD_SETLK;
+        get_cmd = F_OFD_GETLK;
+    }
+#endif
     for (;;)
     {
         if (start == end) return 1;  /* can't set zero-byte lock */
@@ -1160,15 +1200,16 @@ static int set_unix_lock( struct fd *fd, file_pos_t start, file_pos_t end, int t
         fl.l_type   = type;
         fl.l_whence = SEEK_SET;
         fl.l_start  = start;
+        fl.l_pid    = 0;
         if (!end || end > max_unix_offset) fl.l_len = 0;
         else fl.l_len = end - start;
-        if (fcntl( fd->unix_fd, F_SETLK, &fl ) != -1) return 1;
+        if (fcntl( fd->unix_fd, set_cmd, &fl ) != -1) return 1;
 
         switch(errno)
         {
         case EACCES:
             /* check whether locks work at all on this file system */
-            if (fcntl( fd->unix_fd, F_GETLK, &fl ) != -1)
+            if (fcntl( fd->unix_fd, get_cmd, &fl ) != -1)
             {
                 set_error( STATUS_FILE_LOCK_CONFLICT );
                 return 0;
@@ -1195,6 +1236,9 @@ static int set_unix_lock( struct fd *fd, file_pos_t start, file_pos_t end, int t
             return 0;
 #ifdef EOVERFLOW
         case EOVERFLOW:
+            /* open file description locks can still overflow with the shrunk limit, */
+            /* the range is then only locked by the server, as beyond max_unix_offset */
+            if (use_ofd_locks && max_unix_offset <= INT_MAX) return 1;
 #endif
         case EINVAL:
             /* this can happen if off_t is 64-bit but the kernel only supports 32-bit */
@@ -1245,6 +1289,7 @@ static void remove_unix_locks( struct fd *fd, file_pos_t start, file_pos_t end )
     {
         struct file_lock *lock = LIST_ENTRY( ptr, struct file_lock, inode_entry );
         if (lock->start == lock->end) continue;
+        if (use_ofd_locks && lock->fd != fd) continue;  /* held on another file description */
         if (lock_overlaps( lock, start, end )) count++;
     }
 
@@ -1271,6 +1316,7 @@ static void remove_unix_locks( struct fd *fd, file_pos_t start, file_pos_t end )
     {
         struct file_lock *lock = LIST_ENTRY( ptr, struct file_lock, inode_entry );
         if (lock->start == lock->end) continue;
+        if (use_ofd_locks && lock->fd != fd) continue;
         if (!lock_overlaps( lock, start, end )) continue;
 
         /* go through all the holes touched by this lock */
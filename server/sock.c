@@ -1239,6 +1239,29 @@ DECL_HANDLER(accept_socket)
     }
 }
 
+/* return the addresses of an accepted socket, so that the client doesn't need to query them */
+static void reply_accept_addresses( struct sock *sock, struct accept_into_socket_reply *reply )
+{
+    union
+    {
+        struct sockaddr addr;
+        char data[128];
+    } local, remote;
+    socklen_t local_len = sizeof(local), remote_len = sizeof(remote);
+    int unix_fd = get_unix_fd( sock->fd );
+    char *ptr;
+
+    if (unix_fd == -1) return;
+    if (getsockname( unix_fd, &local.addr, &local_len ) || local_len > sizeof(local)) return;
+    if (getpeername( unix_fd, &remote.addr, &remote_len ) || remote_len > sizeof(remote)) return;
+    if (local_len + remote_len > get_reply_max_size()) return;
+
+    if (!(ptr = set_reply_data_size( local_len + remote_len ))) return;
+    memcpy( ptr, &local, local_len );
+    memcpy( ptr + local_len, &remote, remote_len );
+    reply->local_len = local_len;
+}
+
 /* accept a socket into an initialized socket */
 DECL_HANDLER(accept_into_socket)
 {
@@ -1260,6 +1283,12 @@ DECL_HANDLER(accept_into_socket)
     {
         acceptsock->wparam = req->ahandle;  /* wparam for message is the socket handle */
         sock_reselect( acceptsock );
+        reply_accept_addresses( acceptsock, reply );
+
+        /* let the next AcceptEx take another pending connection right away
+         * instead of waiting for the listener to be polled again */
+        if (check_fd_events( sock->fd, POLLIN ) & POLLIN)
+            async_wake_up_next_waiting( sock->read_q );
     }
     release_object( acceptsock );
     release_object( sock );
@@ -1361,6 +1390,33 @@ DECL_HANDLER(enable_socket_event)
     release_object( &sock->obj );
 }
 
+DECL_HANDLER(wake_socket_reads)
+{
+    struct sock *sock;
+    data_size_t i, count = get_req_data_size() / sizeof(client_ptr_t), woken = 0;
+    client_ptr_t *woken_iosbs;
+
+    if (!(sock = (struct sock *)get_handle_obj( current->process, req->handle, FILE_READ_DATA, &sock_ops )))
+        return;
+
+    count = min( count, get_reply_max_size() / sizeof(client_ptr_t) );
+    if (count && (woken_iosbs = mem_alloc( count * sizeof(client_ptr_t) )))
+    {
+        /* only the reads that are still queued on this socket may receive data */
+        for (i = 0; i < count; i++)
+        {
+            client_ptr_t iosb;
+
+            memcpy( &iosb, (const client_ptr_t *)get_req_data() + i, sizeof(iosb) );
+            if (iosb && async_wake_up_by( sock->read_q, current->process, NULL, iosb, STATUS_ALERTED ))
+                woken_iosbs[woken++] = iosb;
+        }
+        if (woken) set_reply_data_ptr( woken_iosbs, woken * sizeof(client_ptr_t) );
+        else free( woken_iosbs );
+    }
+    release_object( &sock->obj );
+}
+
 DECL_HANDLER(set_socket_deferred)
 {
     struct sock *sock, *acceptsock;
@@ -43,6 +43,7 @@
 
 #define MAX_SUBAUTH_COUNT 1
 
+const LUID SeLockMemoryPrivilege           = {  4, 0 };
 const LUID SeIncreaseQuotaPrivilege        = {  5, 0 };
 const LUID SeSecurityPrivilege             = {  8, 0 };
 const LUID SeTakeOwnershipPrivilege        = {  9, 0 };
@@ -653,6 +654,7 @@ struct token *token_create_admin( void )
             { SeIncreaseBasePriorityPrivilege, 0                    },
             { SeLoadDriverPrivilege          , SE_PRIVILEGE_ENABLED },
             { SeCreatePagefilePrivilege      , 0                    },
+            { SeLockMemoryPrivilege          , 0                    },
             { SeIncreaseQuotaPrivilege       , 0                    },
             { SeUndockPrivilege              , 0                    },
             { SeManageVolumePrivilege        , 0                    },
@@ -1783,6 +1783,12 @@ static void dump_accept_into_socket_request( const struct accept_into_socket_req
     fprintf( stderr, ", ahandle=%04x", req->ahandle );
 }
 
+static void dump_accept_into_socket_reply( const struct accept_into_socket_reply *req )
+{
+    fprintf( stderr, " local_len=%u", req->local_len );
+    dump_varargs_bytes( ", addrs=", cur_size );
+}
+
 static void dump_set_socket_event_request( const struct set_socket_event_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -1833,6 +1839,17 @@ static void dump_set_socket_deferred_request( const struct set_socket_deferred_r
     fprintf( stderr, ", deferred=%04x", req->deferred );
 }
 
+static void dump_wake_socket_reads_request( const struct wake_socket_reads_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    dump_varargs_uints64( ", iosbs=", cur_size );
+}
+
+static void dump_wake_socket_reads_reply( const struct wake_socket_reads_reply *req )
+{
+    dump_varargs_uints64( " woken=", cur_size );
+}
+
 static void dump_alloc_console_request( const struct alloc_console_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -4355,6 +4372,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_socket_info_request,
     (dump_func)dump_enable_socket_event_request,
     (dump_func)dump_set_socket_deferred_request,
+    (dump_func)dump_wake_socket_reads_request,
     (dump_func)dump_alloc_console_request,
     (dump_func)dump_free_console_request,
     (dump_func)dump_get_console_renderer_events_request,
@@ -4623,12 +4641,13 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_create_socket_reply,
     (dump_func)dump_accept_socket_reply,
-    NULL,
+    (dump_func)dump_accept_into_socket_reply,
     NULL,
     (dump_func)dump_get_socket_event_reply,
     (dump_func)dump_get_socket_info_reply,
     NULL,
     NULL,
+    (dump_func)dump_wake_socket_reads_reply,
     (dump_func)dump_alloc_console_reply,
     NULL,
     (dump_func)dump_get_console_renderer_events_reply,
@@ -4903,6 +4922,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "get_socket_info",
     "enable_socket_event",
     "set_socket_deferred",
+    "wake_socket_reads",
     "alloc_console",
     "free_console",
     "get_console_renderer_events",
@@ -5192,6 +5212,7 @@ static const struct
     { "NAME_TOO_LONG",               STATUS_NAME_TOO_LONG },
     { "NETWORK_BUSY",                STATUS_NETWORK_BUSY },
     { "NETWORK_UNREACHABLE",         STATUS_NETWORK_UNREACHABLE },
+    { "NOTIFY_ENUM_DIR",             STATUS_NOTIFY_ENUM_DIR },
     { "NOT_ALL_ASSIGNED",            STATUS_NOT_ALL_ASSIGNED },
     { "NOT_A_DIRECTORY",             STATUS_NOT_A_DIRECTORY },
     { "NOT_FOUND",                   STATUS_NOT_FOUND },